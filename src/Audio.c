@@ -11,6 +11,11 @@
 #include "Stream.h"
 #include "Utils.h"
 #include "Options.h"
+#if defined CC_BUILD_SSE2
+#include <emmintrin.h>
+#elif defined CC_BUILD_NEON
+#include <arm_neon.h>
+#endif
 
 int Audio_SoundsVolume, Audio_MusicVolume;
 
@@ -460,7 +465,8 @@ cc_result Audio_Close(AudioHandle handle) {
 *#########################################################################################################################*/
 struct Sound {
 	struct AudioFormat format;
-	cc_uint8* data; cc_uint32 size;
+	float* data;      /* Samples (interleaved if stereo), converted to between -1 and 1 */
+	cc_uint32 frames; /* Number of samples per channel */
 };
 
 #define AUDIO_MAX_SOUNDS 10
@@ -477,6 +483,27 @@ struct Soundboard {
 #define WAV_FourCC(a, b, c, d) (((cc_uint32)a << 24) | ((cc_uint32)b << 16) | ((cc_uint32)c << 8) | (cc_uint32)d)
 #define WAV_FMT_SIZE 16
 
+/* Reads 16 bit samples, then converts them to floats for the sounds mixer */
+static cc_result Sound_ReadSamples(struct Stream* stream, struct Sound* snd, cc_uint32 size) {
+	cc_int16* samples;
+	cc_uint32 i, count = size / 2;
+	cc_result res;
+
+	samples = (cc_int16*)Mem_TryAlloc(count, 2);
+	if (!samples) return ERR_OUT_OF_MEMORY;
+	if ((res = Stream_Read(stream, (cc_uint8*)samples, count * 2))) { Mem_Free(samples); return res; }
+
+	snd->data = (float*)Mem_TryAlloc(count, 4);
+	if (!snd->data) { Mem_Free(samples); return ERR_OUT_OF_MEMORY; }
+	snd->frames = count / snd->format.channels;
+
+	for (i = 0; i < count; i++) {
+		snd->data[i] = samples[i] * (1.0f / 32768.0f);
+	}
+	Mem_Free(samples);
+	return 0;
+}
+
 static cc_result Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 	cc_uint32 fourCC, size;
 	cc_uint8 tmp[WAV_FMT_SIZE];
@@ -507,11 +534,9 @@ static cc_result Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 			if (bitsPerSample != 16) return WAV_ERR_SAMPLE_BITS;
 			size -= WAV_FMT_SIZE;
 		} else if (fourCC == WAV_FourCC('d','a','t','a')) {
-			snd->data = (cc_uint8*)Mem_TryAlloc(size, 1);
-			snd->size = size;
-
-			if (!snd->data) return ERR_OUT_OF_MEMORY;
-			return Stream_Read(stream, snd->data, size);
+			/* sounds mixer only supports mono or stereo */
+			if (snd->format.channels < 1 || snd->format.channels > 2) return WAV_ERR_DATA_TYPE;
+			return Sound_ReadSamples(stream, snd, size);
 		}
 
 		/* Skip over unhandled data */
@@ -580,8 +605,8 @@ static void Soundboard_Init(struct Soundboard* board, const String* boardName, s
 		if (res) {
 			Logger_Warn2(res, "decoding", &file);
 			Mem_Free(snd->data);
-			snd->data = NULL;
-			snd->size = 0;
+			snd->data   = NULL;
+			snd->frames = 0;
 		} else { group->count++; }
 	}
 }
@@ -604,109 +629,224 @@ static struct Sound* Soundboard_PickRandom(struct Soundboard* board, cc_uint8 ty
 /*########################################################################################################################*
 *--------------------------------------------------------Sounds-----------------------------------------------------------*
 *#########################################################################################################################*/
-struct SoundOutput { AudioHandle handle; void* buffer; cc_uint32 capacity; };
-#define AUDIO_MAX_HANDLES 6
-#define HANDLE_INV -1
-#define SOUND_INV { HANDLE_INV, NULL, 0 }
+/* All sounds are mixed together in software into a single output stream, on the sounds mixer thread */
+#define MIXER_SAMPLE_RATE 44100
+#define MIXER_CHANNELS 2
+/* Number of frames mixed per output buffer (~12 milliseconds of audio) */
+#define MIXER_FRAMES 512
+#define MIXER_MAX_VOICES 64
+
+struct SoundVoice {
+	struct Sound* snd;
+	cc_uint64 pos;  /* Current frame in the sound, in 16.16 fixed point */
+	cc_uint32 step; /* Frames to advance per output frame, in 16.16 fixed point */
+	float volume;
+};
 
 static struct Soundboard digBoard, stepBoard;
-static struct SoundOutput monoOutputs[AUDIO_MAX_HANDLES]   = { SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV };
-static struct SoundOutput stereoOutputs[AUDIO_MAX_HANDLES] = { SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV };
+static struct SoundVoice mixer_voices[MIXER_MAX_VOICES];
+static volatile int mixer_numVoices;
+/* NOTE: mixer_voices must only be accessed while holding this lock */
+static void* mixer_lock;
+
+static AudioHandle mixer_out;
+static void* mixer_thread;
+static void* mixer_waitable;
+static volatile cc_bool mixer_pendingStop, mixer_joining;
+
+/* Resamples the given voice (linear interpolation) to stereo frames */
+/* Returns number of frames produced, which is less than count when the sound ends */
+static int Mixer_Resample(struct SoundVoice* voice, float* dst, int count) {
+	struct Sound* snd = voice->snd;
+	const float* src  = snd->data;
+	cc_uint32 cur, next, frames = snd->frames;
+	float t, l, r;
+	int i;
 
-CC_NOINLINE static void Sounds_Fail(cc_result res) {
-	Logger_SimpleWarn(res, "playing sounds");
-	Chat_AddRaw("&cDisabling sounds");
-	Audio_SetSounds(0);
-}
+	for (i = 0; i < count; i++, voice->pos += voice->step) {
+		cur = (cc_uint32)(voice->pos >> 16);
+		if (cur >= frames) break;
 
-static void Sounds_PlayRaw(struct SoundOutput* output, struct Sound* snd, struct AudioFormat* fmt, int volume) {
-	void* data = snd->data;
-	void* tmp;
-	cc_result res;
-	if ((res = Audio_SetFormat(output->handle, fmt))) { Sounds_Fail(res); return; }
-	
-	/* copy to temp buffer to apply volume */
-	if (volume < 100) {
-		/* TODO: Don't need a per sound temp buffer, just a global one */
-		if (output->capacity < snd->size) {
-			/* TODO: check if we can realloc NULL without a problem */
-			if (output->buffer) {
-				tmp = Mem_TryRealloc(output->buffer, snd->size, 1);
-			} else {
-				tmp = Mem_TryAlloc(snd->size, 1);
-			}
-
-			if (!tmp) { Sounds_Fail(ERR_OUT_OF_MEMORY); return; }
-			output->buffer   = tmp;
-			output->capacity = snd->size;
+		next = cur + 1 < frames ? cur + 1 : cur;
+		t    = (voice->pos & 0xFFFF) * (1.0f / 65536.0f);
+
+		if (snd->format.channels == 1) {
+			l = src[cur] + (src[next] - src[cur]) * t; r = l;
+		} else {
+			l = src[cur*2]   + (src[next*2]   - src[cur*2])   * t;
+			r = src[cur*2+1] + (src[next*2+1] - src[cur*2+1]) * t;
 		}
-		data = output->buffer;
+		dst[i*2] = l; dst[i*2+1] = r;
+	}
+	return i;
+}
 
-		Mem_Copy(data, snd->data, snd->size);
-		Volume_Mix16((cc_int16*)data, snd->size / 2, volume);
+/* Adds the given samples, multiplied by volume, to the mixed samples */
+static void Mixer_AddScaled(float* dst, const float* src, float volume, int count) {
+	int i = 0;
+#if defined CC_BUILD_SSE2
+	__m128 vol = _mm_set1_ps(volume);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), vol)));
+	}
+#elif defined CC_BUILD_NEON
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), volume));
 	}
+#endif
 
-	if ((res = Audio_BufferData(output->handle, 0, data, snd->size))) { Sounds_Fail(res); return; }
-	if ((res = Audio_Play(output->handle)))                           { Sounds_Fail(res); return; }
+	for (; i < count; i++) {
+		dst[i] += src[i] * volume;
+	}
 }
 
-static void Sounds_Play(cc_uint8 type, struct Soundboard* board) {
-	struct Sound* snd;
-	struct AudioFormat  fmt;
-	struct SoundOutput* outputs;
-	struct SoundOutput* output;
-	struct AudioFormat* l;
+/* Clamps mixed samples to between -1 and 1, then converts them to 16 bit samples */
+static void Mixer_ConvertSamples(cc_int16* dst, const float* src, int count) {
+	float sample;
+	int i = 0;
+#if defined CC_BUILD_SSE2
+	__m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+	__m128i a, b;
+	#define Mixer_ToInt32(data) _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(data), lo), hi), scale))
+
+	for (; i + 8 <= count; i += 8) {
+		a = Mixer_ToInt32(src + i); b = Mixer_ToInt32(src + i + 4);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+	}
+	#undef Mixer_ToInt32
+#elif defined CC_BUILD_NEON
+	float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+	for (; i + 4 <= count; i += 4) {
+		vst1_s16(dst + i, vqmovn_s32(vcvtq_s32_f32(vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), lo), hi), 32767.0f))));
+	}
+#endif
 
-	cc_bool finished;
-	int i, volume;
-	cc_result res;
+	for (; i < count; i++) {
+		sample = src[i];
+		Math_Clamp(sample, -1.0f, 1.0f);
+		dst[i] = (cc_int16)(sample * 32767);
+	}
+}
 
-	if (type == SOUND_NONE || !Audio_SoundsVolume) return;
-	snd = Soundboard_PickRandom(board, type);
+/* Mixes the next 'count' frames of all active voices together */
+static void Mixer_Mix(cc_int16* data, int count) {
+	float mixed[MIXER_FRAMES * MIXER_CHANNELS];
+	float voiceData[MIXER_FRAMES * MIXER_CHANNELS];
+	struct SoundVoice* voice;
+	int i, frames;
+	Mem_Set(mixed, 0, sizeof(mixed));
+
+	Mutex_Lock(mixer_lock);
+	for (i = 0; i < mixer_numVoices;) {
+		voice  = &mixer_voices[i];
+		frames = Mixer_Resample(voice, voiceData, count);
+		Mixer_AddScaled(mixed, voiceData, voice->volume, frames * MIXER_CHANNELS);
+
+		/* Sound has finished playing, so replace with last voice */
+		if (frames < count) {
+			*voice = mixer_voices[--mixer_numVoices];
+		} else { i++; }
+	}
+	Mutex_Unlock(mixer_lock);
 
-	if (!snd) return;
-	if (!Audio_SysInit()) { Audio_SoundsVolume = 0; return; }
+	Mixer_ConvertSamples(data, mixed, count * MIXER_CHANNELS);
+}
 
-	fmt     = snd->format;
-	volume  = Audio_SoundsVolume;
-	outputs = fmt.channels == 1 ? monoOutputs : stereoOutputs;
+static cc_result Mixer_Update(cc_int16 (*data)[MIXER_FRAMES * MIXER_CHANNELS]) {
+	cc_bool finished, completed, queued = false;
+	cc_result res;
+	int i;
 
-	if (board == &digBoard) {
-		if (type == SOUND_METAL) fmt.sampleRate = (fmt.sampleRate * 6) / 5;
-		else fmt.sampleRate = (fmt.sampleRate * 4) / 5;
-	} else {
-		volume /= 2;
-		if (type == SOUND_METAL) fmt.sampleRate = (fmt.sampleRate * 7) / 5;
+	/* Output stops once it runs out of queued audio, so needs to be restarted */
+	if ((res = Audio_IsFinished(mixer_out, &finished))) return res;
+
+	for (i = 0; i < AUDIO_MAX_BUFFERS; i++) {
+		if ((res = Audio_IsCompleted(mixer_out, i, &completed))) return res;
+		if (!completed) continue;
+
+		Mixer_Mix(data[i], MIXER_FRAMES);
+		if ((res = Audio_BufferData(mixer_out, i, data[i], sizeof(data[i])))) return res;
+		queued = true;
 	}
 
-	/* Try to play on fresh device, or device with same data format */
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		output = &outputs[i];
-		if (output->handle == HANDLE_INV) {
-			Audio_Open(&output->handle, 1);
-		} else {
-			res = Audio_IsFinished(output->handle, &finished);
+	if (finished && queued) return Audio_Play(mixer_out);
+	return 0;
+}
 
-			if (res) { Sounds_Fail(res); return; }
-			if (!finished) continue;
+static void Mixer_RunLoop(void) {
+	static cc_int16 data[AUDIO_MAX_BUFFERS][MIXER_FRAMES * MIXER_CHANNELS];
+	struct AudioFormat fmt;
+	cc_bool finished;
+	cc_result res;
+
+	fmt.channels   = MIXER_CHANNELS;
+	fmt.sampleRate = MIXER_SAMPLE_RATE;
+	Audio_Open(&mixer_out, AUDIO_MAX_BUFFERS);
+	res = Audio_SetFormat(mixer_out, &fmt);
+
+	while (!res && !mixer_pendingStop) {
+		if (mixer_numVoices) {
+			res = Mixer_Update(data);
+			Thread_Sleep(5);
+			continue;
 		}
 
-		l = Audio_GetFormat(output->handle);
-		if (!l->channels || AudioFormat_Eq(l, &fmt)) {
-			Sounds_PlayRaw(output, snd, &fmt, volume); return;
+		/* Wait for queued audio to finish, then wait for Sounds_Play to add a voice */
+		res = Audio_IsFinished(mixer_out, &finished);
+		if (res) break;
+
+		if (finished) {
+			Waitable_Wait(mixer_waitable);
+		} else {
+			Thread_Sleep(5);
 		}
 	}
 
-	/* Try again with all devices, even if need to recreate one (expensive) */
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		output = &outputs[i];
-		res = Audio_IsFinished(output->handle, &finished);
+	if (res) {
+		Logger_SimpleWarn(res, "playing sounds");
+		Chat_AddRaw("&cDisabling sounds");
+		Audio_SoundsVolume = 0;
+	}
+	Audio_Close(mixer_out);
+
+	if (mixer_joining) return;
+	Thread_Detach(mixer_thread);
+	mixer_thread = NULL;
+}
 
-		if (res) { Sounds_Fail(res); return; }
-		if (!finished) continue;
+static void Sounds_Play(cc_uint8 type, struct Soundboard* board) {
+	struct SoundVoice* voice;
+	struct Sound* snd;
+	int sampleRate;
+	float volume;
 
-		Sounds_PlayRaw(output, snd, &fmt, volume); return;
+	if (type == SOUND_NONE || !Audio_SoundsVolume) return;
+	snd = Soundboard_PickRandom(board, type);
+	if (!snd || !mixer_thread) return;
+
+	sampleRate = snd->format.sampleRate;
+	volume     = Audio_SoundsVolume / 100.0f;
+
+	if (board == &digBoard) {
+		if (type == SOUND_METAL) sampleRate = (sampleRate * 6) / 5;
+		else sampleRate = (sampleRate * 4) / 5;
+	} else {
+		volume /= 2;
+		if (type == SOUND_METAL) sampleRate = (sampleRate * 7) / 5;
 	}
+
+	/* Too many sounds already playing, so just drop this one */
+	Mutex_Lock(mixer_lock);
+	if (mixer_numVoices < MIXER_MAX_VOICES) {
+		voice = &mixer_voices[mixer_numVoices];
+		voice->snd    = snd;
+		voice->pos    = 0;
+		voice->step   = (cc_uint32)(((cc_uint64)sampleRate << 16) / MIXER_SAMPLE_RATE);
+		voice->volume = volume;
+		mixer_numVoices++;
+	}
+	Mutex_Unlock(mixer_lock);
+	Waitable_Signal(mixer_waitable);
 }
 
 static void Audio_PlayBlockSound(void* obj, IVec3 coords, BlockID old, BlockID now) {
@@ -717,38 +857,37 @@ static void Audio_PlayBlockSound(void* obj, IVec3 coords, BlockID old, BlockID n
 	}
 }
 
-static void Sounds_FreeOutputs(struct SoundOutput* outputs) {
-	int i;
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		if (outputs[i].handle == HANDLE_INV) continue;
-
-		Audio_Close(outputs[i].handle);
-		outputs[i].handle = HANDLE_INV;
-
-		Mem_Free(outputs[i].buffer);
-		outputs[i].buffer   = NULL;
-		outputs[i].capacity = 0;
-	}
-}
-
 static void Sounds_Init(void) {
 	static const String dig  = String_FromConst("dig_");
 	static const String step = String_FromConst("step_");
 
-	if (digBoard.count || stepBoard.count) return;
-	Soundboard_Init(&digBoard,  &dig,  &files);
-	Soundboard_Init(&stepBoard, &step, &files);
+	if (!digBoard.count && !stepBoard.count) {
+		Soundboard_Init(&digBoard,  &dig,  &files);
+		Soundboard_Init(&stepBoard, &step, &files);
+	}
+
+	if (mixer_thread) return;
+	if (!Audio_SysInit()) { Audio_SoundsVolume = 0; return; }
+
+	mixer_joining     = false;
+	mixer_pendingStop = false;
+	mixer_thread = Thread_Start(Mixer_RunLoop, false);
 }
 
 static void Sounds_Free(void) {
-	Sounds_FreeOutputs(monoOutputs);
-	Sounds_FreeOutputs(stereoOutputs);
+	mixer_joining     = true;
+	mixer_pendingStop = true;
+	Waitable_Signal(mixer_waitable);
+
+	if (mixer_thread) Thread_Join(mixer_thread);
+	mixer_thread    = NULL;
+	mixer_numVoices = 0;
 }
 
 void Audio_SetSounds(int volume) {
+	Audio_SoundsVolume = volume;
 	if (volume) Sounds_Init();
 	else        Sounds_Free();
-	Audio_SoundsVolume = volume;
 }
 
 void Audio_PlayDigSound(cc_uint8 type)  { Sounds_Play(type, &digBoard); }
@@ -957,6 +1096,8 @@ static void Audio_Init(void) {
 
 	Directory_Enum(&path, NULL, Audio_FilesCallback);
 	music_waitable = Waitable_Create();
+	mixer_waitable = Waitable_Create();
+	mixer_lock     = Mutex_Create();
 
 	/* music is delayed between 2 - 7 minutes */
 	music_minDelay = Options_GetInt(OPT_MIN_MUSIC_DELAY, 0, 3600, 120) * MILLIS_PER_SEC;
@@ -973,6 +1114,8 @@ static void Audio_Free(void) {
 	Music_Free();
 	Sounds_Free();
 	Waitable_Free(music_waitable);
+	Waitable_Free(mixer_waitable);
+	Mutex_Free(mixer_lock);
 	Audio_SysFree();
 	Event_UnregisterBlock(&UserEvents.BlockChanged, NULL, Audio_PlayBlockSound);
 }
@@ -7,6 +7,11 @@
 #include "Stream.h"
 #include "Errors.h"
 #include "Utils.h"
+#if defined CC_BUILD_SSE2
+#include <emmintrin.h>
+#elif defined CC_BUILD_NEON
+#include <arm_neon.h>
+#endif
 
 void Bitmap_UNSAFE_CopyBlock(int srcX, int srcY, int dstX, int dstY, Bitmap* src, Bitmap* dst, int size) {
 	int x, y;
@@ -92,8 +97,153 @@ cc_bool Png_Detect(const cc_uint8* data, cc_uint32 len) {
 	return true;
 }
 
+/* Pre-decoded bitmaps start with 'CCRAW', pixel layout, and 2 bytes padding */
+/* Pixel layout is stored so data is never mixed up between RGBA and BGRA platforms */
+static const cc_uint8 rawSig[PNG_SIG_SIZE] = { 'C', 'C', 'R', 'A', 'W', BITMAPCOL_R_SHIFT, 0, 0 };
+
+void Bitmap_MakeRawHeader(Bitmap* bmp, cc_uint8* header) {
+	Mem_Copy(header, rawSig, PNG_SIG_SIZE);
+	Stream_SetU32_LE(header + 8,  bmp->width);
+	Stream_SetU32_LE(header + 12, bmp->height);
+}
+
+cc_bool Bitmap_DetectRaw(const cc_uint8* data, cc_uint32 len) {
+	int i;
+	if (len < PNG_SIG_SIZE) return false;
+
+	for (i = 0; i < PNG_SIG_SIZE; i++) {
+		if (data[i] != rawSig[i]) return false;
+	}
+	return true;
+}
+
+static cc_result Png_DecodeRaw(Bitmap* bmp, struct Stream* stream) {
+	cc_uint8 tmp[8];
+	cc_result res;
+	if ((res = Stream_Read(stream, tmp, sizeof(tmp)))) return res;
+
+	bmp->width  = (int)Stream_GetU32_LE(tmp + 0);
+	bmp->height = (int)Stream_GetU32_LE(tmp + 4);
+	if (bmp->width  < 0 || bmp->width  > PNG_MAX_DIMS) return PNG_ERR_TOO_WIDE;
+	if (bmp->height < 0 || bmp->height > PNG_MAX_DIMS) return PNG_ERR_TOO_TALL;
+
+	bmp->scan0 = (BitmapCol*)Mem_TryAlloc(bmp->width * bmp->height, 4);
+	if (!bmp->scan0) return ERR_OUT_OF_MEMORY;
+	return Stream_Read(stream, (cc_uint8*)bmp->scan0, Bitmap_DataSize(bmp->width, bmp->height));
+}
+
+#if defined CC_BUILD_SSE2 || defined CC_BUILD_NEON
+/* Sub, Average and Paeth filters depend on the previous pixel, so a whole row can't be done at once */
+/* Instead each 3 or 4 byte pixel is unfiltered at once, using SIMD registers */
+#define PNG_SIMD_FILTERS
+
+static CC_INLINE cc_uint32 Png_GetPixel(const cc_uint8* p, int bpp) {
+	cc_uint32 value = p[0] | (p[1] << 8) | (p[2] << 16);
+	return bpp == 4 ? value | ((cc_uint32)p[3] << 24) : value;
+}
+
+static CC_INLINE void Png_SetPixel(cc_uint8* p, cc_uint32 value, int bpp) {
+	p[0] = (cc_uint8)value; p[1] = (cc_uint8)(value >> 8); p[2] = (cc_uint8)(value >> 16);
+	if (bpp == 4) p[3] = (cc_uint8)(value >> 24);
+}
+
+#if defined CC_BUILD_SSE2
+typedef __m128i Png_Vec;
+#define Png_VecZero() _mm_setzero_si128()
+#define Png_VecLoad(p, bpp) _mm_cvtsi32_si128((int)Png_GetPixel(p, bpp))
+#define Png_VecStore(p, v, bpp) Png_SetPixel(p, (cc_uint32)_mm_cvtsi128_si32(v), bpp)
+#define Png_VecAdd(a, b) _mm_add_epi8(a, b)
+/* _mm_avg_epu8 rounds up, but PNG average filter rounds down */
+#define Png_VecAvg(a, b) _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)))
+
+static CC_INLINE __m128i Png_VecPaeth(__m128i a, __m128i b, __m128i c) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i a16  = _mm_unpacklo_epi8(a, zero);
+	__m128i b16  = _mm_unpacklo_epi8(b, zero);
+	__m128i c16  = _mm_unpacklo_epi8(c, zero);
+	/* p = a + b - c, so p - a = b - c, p - b = a - c, p - c = (b - c) + (a - c) */
+	__m128i pa = _mm_sub_epi16(b16, c16);
+	__m128i pb = _mm_sub_epi16(a16, c16);
+	__m128i pc = _mm_add_epi16(pa, pb);
+	__m128i mask;
+
+	pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+	pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+	pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+	/* Pick b if pa > pb, then pick c if min(pa, pb) > pc */
+	mask = _mm_cmpgt_epi16(pa, pb);
+	a16  = _mm_or_si128(_mm_and_si128(mask, b16), _mm_andnot_si128(mask, a16));
+	pa   = _mm_min_epi16(pa, pb);
+	mask = _mm_cmpgt_epi16(pa, pc);
+	a16  = _mm_or_si128(_mm_and_si128(mask, c16), _mm_andnot_si128(mask, a16));
+	return _mm_packus_epi16(a16, a16);
+}
+#else
+typedef uint8x8_t Png_Vec;
+#define Png_VecZero() vdup_n_u8(0)
+#define Png_VecLoad(p, bpp) vreinterpret_u8_u32(vdup_n_u32(Png_GetPixel(p, bpp)))
+#define Png_VecStore(p, v, bpp) Png_SetPixel(p, vget_lane_u32(vreinterpret_u32_u8(v), 0), bpp)
+#define Png_VecAdd(a, b) vadd_u8(a, b)
+#define Png_VecAvg(a, b) vhadd_u8(a, b)
+
+static CC_INLINE uint8x8_t Png_VecPaeth(uint8x8_t a, uint8x8_t b, uint8x8_t c) {
+	uint16x8_t pa = vmovl_u8(vabd_u8(b, c));
+	uint16x8_t pb = vmovl_u8(vabd_u8(a, c));
+	uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vshll_n_u8(c, 1));
+	uint16x8_t mask;
+	uint8x8_t  r;
+
+	/* Pick b if pa > pb, then pick c if min(pa, pb) > pc */
+	mask = vcgtq_u16(pa, pb);
+	r    = vbsl_u8(vmovn_u16(mask), b, a);
+	pa   = vminq_u16(pa, pb);
+	mask = vcgtq_u16(pa, pc);
+	return vbsl_u8(vmovn_u16(mask), c, r);
+}
+#endif
+
+/* Reconstructs a row filtered using Sub, Average or Paeth, for 3 or 4 byte pixels */
+static void Png_ReconstructPixels(cc_uint8 type, int bpp, cc_uint8* line, const cc_uint8* prior, cc_uint32 lineLen) {
+	/* a = pixel to left, b = pixel above, c = pixel above and to left (0 for first pixel) */
+	Png_Vec a = Png_VecZero(), b, c = Png_VecZero(), x;
+	cc_uint32 i;
+
+	switch (type) {
+	case PNG_FILTER_SUB:
+		for (i = 0; i < lineLen; i += bpp) {
+			x = Png_VecAdd(Png_VecLoad(line + i, bpp), a);
+			Png_VecStore(line + i, x, bpp); a = x;
+		}
+		return;
+
+	case PNG_FILTER_AVERAGE:
+		for (i = 0; i < lineLen; i += bpp) {
+			b = Png_VecLoad(prior + i, bpp);
+			x = Png_VecAdd(Png_VecLoad(line + i, bpp), Png_VecAvg(a, b));
+			Png_VecStore(line + i, x, bpp); a = x;
+		}
+		return;
+
+	case PNG_FILTER_PAETH:
+		for (i = 0; i < lineLen; i += bpp) {
+			b = Png_VecLoad(prior + i, bpp);
+			x = Png_VecAdd(Png_VecLoad(line + i, bpp), Png_VecPaeth(a, b, c));
+			Png_VecStore(line + i, x, bpp); a = x; c = b;
+		}
+		return;
+	}
+}
+#endif
+
 static void Png_Reconstruct(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
 	cc_uint32 i, j;
+#ifdef PNG_SIMD_FILTERS
+	if ((bytesPerPixel == 3 || bytesPerPixel == 4) && type != PNG_FILTER_UP) {
+		Png_ReconstructPixels(type, bytesPerPixel, line, prior, lineLen); return;
+	}
+#endif
+
 	switch (type) {
 	case PNG_FILTER_NONE:
 		return;
@@ -105,7 +255,18 @@ static void Png_Reconstruct(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8* lin
 		return;
 
 	case PNG_FILTER_UP:
-		for (i = 0; i < lineLen; i++) {
+		i = 0;
+#if defined CC_BUILD_SSE2
+		for (; i + 16 <= lineLen; i += 16) {
+			_mm_storeu_si128((__m128i*)(line + i), _mm_add_epi8(
+				_mm_loadu_si128((__m128i*)(line + i)), _mm_loadu_si128((__m128i*)(prior + i))));
+		}
+#elif defined CC_BUILD_NEON
+		for (; i + 16 <= lineLen; i += 16) {
+			vst1q_u8(line + i, vaddq_u8(vld1q_u8(line + i), vld1q_u8(prior + i)));
+		}
+#endif
+		for (; i < lineLen; i++) {
 			line[i] += prior[i];
 		}
 		return;
@@ -191,10 +352,49 @@ static void Png_Expand_GRAYSCALE_16(int width, BitmapCol* palette, cc_uint8* src
 	}
 }
 
+#if defined CC_BUILD_SSE2
+/* Swaps R and B of RGBA pixels, when BitmapCol is BGRA */
+#if BITMAPCOL_R_SHIFT == 0
+#define Png_SwapRB(v) (v)
+#else
+#define Png_SwapRB(v) _mm_or_si128(_mm_and_si128(v, _mm_set1_epi32((int)0xFF00FF00)),\
+	_mm_and_si128(_mm_or_si128(_mm_srli_epi32(v, 16), _mm_slli_epi32(v, 16)), _mm_set1_epi32(0x00FF00FF)))
+#endif
+#endif
+
 static void Png_Expand_RGB_8(int width, BitmapCol* palette, cc_uint8* src, BitmapCol* dst) {
-	int i, j;
+	int i = 0, j = 0;
+#if defined CC_BUILD_SSE2
+	/* Spreads 4 pixels of 3 bytes each across the 4 lanes, by shifting pixel n left by n bytes */
+	__m128i lane0 = _mm_set_epi32(0, 0, 0, 0x00FFFFFF), lane1 = _mm_set_epi32(0, 0, 0x00FFFFFF, 0);
+	__m128i lane2 = _mm_set_epi32(0, 0x00FFFFFF, 0, 0), lane3 = _mm_set_epi32(0x00FFFFFF, 0, 0, 0);
+	__m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	__m128i v, rgba;
+
+	/* Loads 16 bytes for 12 bytes of pixels, so stop early enough to not read past end of row */
+	for (; i + 6 <= width; i += 4, j += 12) {
+		v    = _mm_loadu_si128((__m128i*)(src + j));
+		rgba = _mm_or_si128(_mm_and_si128(v, lane0), alpha);
+		rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(v, 1), lane1));
+		rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(v, 2), lane2));
+		rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(v, 3), lane3));
+		_mm_storeu_si128((__m128i*)(dst + i), Png_SwapRB(rgba));
+	}
+#elif defined CC_BUILD_NEON
+	uint8x16x3_t rgb;
+	uint8x16x4_t bgra;
+	bgra.val[BITMAPCOL_A_SHIFT / 8] = vdupq_n_u8(255);
+
+	for (; i + 16 <= width; i += 16, j += 48) {
+		rgb = vld3q_u8(src + j);
+		bgra.val[BITMAPCOL_R_SHIFT / 8] = rgb.val[0];
+		bgra.val[BITMAPCOL_G_SHIFT / 8] = rgb.val[1];
+		bgra.val[BITMAPCOL_B_SHIFT / 8] = rgb.val[2];
+		vst4q_u8((cc_uint8*)(dst + i), bgra);
+	}
+#endif
 
-	for (i = 0, j = 0; i < (width & ~0x03); i += 4, j += 12) {
+	for (; i < (width & ~0x03); i += 4, j += 12) {
 		PNG_Do_RGB__8(i    , j    ); PNG_Do_RGB__8(i + 1, j + 3);
 		PNG_Do_RGB__8(i + 2, j + 6); PNG_Do_RGB__8(i + 3, j + 9);
 	}
@@ -258,9 +458,26 @@ static void Png_Expand_GRAYSCALE_A_16(int width, BitmapCol* palette, cc_uint8* s
 }
 
 static void Png_Expand_RGB_A_8(int width, BitmapCol* palette, cc_uint8* src, BitmapCol* dst) {
-	int i, j;
+	int i = 0, j = 0;
+#if defined CC_BUILD_SSE2
+	__m128i v;
+	for (; i + 4 <= width; i += 4, j += 16) {
+		v = _mm_loadu_si128((__m128i*)(src + j));
+		_mm_storeu_si128((__m128i*)(dst + i), Png_SwapRB(v));
+	}
+#elif defined CC_BUILD_NEON
+	uint8x16x4_t rgba, bgra;
+	for (; i + 16 <= width; i += 16, j += 64) {
+		rgba = vld4q_u8(src + j);
+		bgra.val[BITMAPCOL_R_SHIFT / 8] = rgba.val[0];
+		bgra.val[BITMAPCOL_G_SHIFT / 8] = rgba.val[1];
+		bgra.val[BITMAPCOL_B_SHIFT / 8] = rgba.val[2];
+		bgra.val[BITMAPCOL_A_SHIFT / 8] = rgba.val[3];
+		vst4q_u8((cc_uint8*)(dst + i), bgra);
+	}
+#endif
 
-	for (i = 0, j = 0; i < (width & ~0x3); i += 4, j += 16) {
+	for (; i < (width & ~0x3); i += 4, j += 16) {
 		PNG_Do_RGB_A__8(i    , j    ); PNG_Do_RGB_A__8(i + 1, j + 4 );
 		PNG_Do_RGB_A__8(i + 2, j + 8); PNG_Do_RGB_A__8(i + 3, j + 12);
 	}
@@ -370,6 +587,8 @@ cc_result Png_Decode(Bitmap* bmp, struct Stream* stream) {
 
 	res = Stream_Read(stream, tmp, PNG_SIG_SIZE);
 	if (res) return res;
+
+	if (Bitmap_DetectRaw(tmp, PNG_SIG_SIZE)) return Png_DecodeRaw(bmp, stream);
 	if (!Png_Detect(tmp, PNG_SIG_SIZE)) return PNG_ERR_INVALID_SIG;
 
 	trnsCol = BITMAPCOL_BLACK;
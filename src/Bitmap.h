@@ -77,6 +77,14 @@ CC_API void Bitmap_Scale(Bitmap* dst, Bitmap* src, int srcX, int srcY, int srcWi
 
 /* Whether data starts with PNG format signature/identifier. */
 cc_bool Png_Detect(const cc_uint8* data, cc_uint32 len);
+/* Number of bytes written by Bitmap_MakeRawHeader. */
+#define BITMAP_RAW_HEADER_SIZE 16
+/* Writes the header for storing a bitmap's pixels as-is, without any compression. */
+/* NOTE: Png_Decode also decodes such data, and far quicker than an actual PNG image. */
+/* NOTE: Pixels are in native BitmapCol format, so only use this for locally cached data. */
+void Bitmap_MakeRawHeader(Bitmap* bmp, cc_uint8* header);
+/* Whether data starts with a header written by Bitmap_MakeRawHeader. */
+cc_bool Bitmap_DetectRaw(const cc_uint8* data, cc_uint32 len);
 typedef int (*Png_RowSelector)(Bitmap* bmp, int row);
 /*
   Decodes a bitmap in PNG format. Partially based off information from
@@ -8,6 +8,7 @@
 #include "Event.h"
 #include "Platform.h"
 #include "Picking.h"
+#include "Builder.h"
 
 struct _BlockLists Blocks;
 
@@ -161,12 +162,54 @@ void Block_DefineCustom(BlockID block) {
 
 	Block_SetDrawType(block, Blocks.Draw[block]);
 	Block_CalcRenderBounds(block);
-	Block_UpdateCulling(block);
 	Block_CalcLightOffset(block);
 
 	Inventory_AddDefault(block);
 	Block_SetCustomDefined(block, true);
+	Block_MarkChanged(block, false);
+}
+
+/* Bit flags of blocks changed since last Block_ApplyChanges */
+static cc_uint32 changedBlocks[BLOCK_COUNT >> 5];
+static cc_bool anyBlocksChanged;
+
+void Block_MarkChanged(BlockID block, cc_bool lightChanged) {
+	cc_uint64 bit = (cc_uint64)1 << (block & 63);
+	changedBlocks[block >> 5] |= (1u << (block & 0x1F));
+	anyBlocksChanged = true;
+
+	Blocks.ChangedMask |= bit;
+	if (lightChanged) Blocks.LightChangedMask |= bit;
+}
+
+static void ClearChanges(void) {
+	int i;
+	for (i = 0; i < Array_Elems(changedBlocks); i++) {
+		changedBlocks[i] = 0;
+	}
+	anyBlocksChanged        = false;
+	Blocks.ChangedMask      = 0;
+	Blocks.LightChangedMask = 0;
+}
+
+void Block_ApplyChanges(void) {
+	cc_uint32 bits;
+	int i, j;
+	if (!anyBlocksChanged) return;
+	/* Culling tables are read by builder threads */
+	Builder_CancelChunks();
+
+	for (i = 0; i < Array_Elems(changedBlocks); i++) {
+		bits = changedBlocks[i];
+		if (!bits) continue;
+
+		for (j = 0; j < 32; j++) {
+			if (bits & (1u << j)) Block_UpdateCulling((BlockID)((i << 5) | j));
+		}
+	}
+
 	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
+	ClearChanges();
 }
 
 static void Block_RecalcIsLiquid(BlockID b) {
@@ -228,6 +271,8 @@ static const String Block_DefaultName(BlockID block) {
 
 void Block_ResetProps(BlockID block) {
 	const String name = Block_DefaultName(block);
+	/* Builder threads read block properties, so must not be building while they change */
+	Builder_CancelChunks();
 
 	Blocks.BlocksLight[block] = DefaultSet_BlocksLight(block);
 	Blocks.FullBright[block] = DefaultSet_FullBright(block);
@@ -677,6 +722,8 @@ static void Blocks_Reset(void) {
 	for (i = 0; i < Array_Elems(definedCustomBlocks); i++) {
 		definedCustomBlocks[i] = 0;
 	}
+	/* All culling is recalculated below anyways */
+	ClearChanges();
 
 	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
 		Block_ResetProps((BlockID)block);
@@ -686,6 +733,8 @@ static void Blocks_Reset(void) {
 }
 
 static void OnAtlasChanged(void* obj) { Block_RecalculateAllSpriteBB(); }
+static void Blocks_Tick(struct ScheduledTask* task) { Block_ApplyChanges(); }
+
 static void Blocks_Init(void) {
 	int block;
 	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
@@ -695,6 +744,7 @@ static void Blocks_Init(void) {
 
 	AutoRotate_Enabled = true;
 	Blocks_Reset();
+	ScheduledTask_Add(GAME_NET_TICKS, Blocks_Tick);
 	Event_RegisterVoid(&TextureEvents.AtlasChanged, NULL, OnAtlasChanged);
 
 	Blocks.CanPlace[BLOCK_AIR] = false;         Blocks.CanDelete[BLOCK_AIR] = false;
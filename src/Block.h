@@ -100,6 +100,12 @@ CC_VAR extern struct _BlockLists {
 	cc_uint8 Hidden[BLOCK_COUNT * BLOCK_COUNT];
 	/* Bit flags of which faces of this block can stretch with greedy meshing. */
 	cc_uint8 CanStretch[BLOCK_COUNT];
+
+	/* Bit (block & 63) is set for each block whose definition changed since BlockDefChanged was last raised. */
+	/* BlockDefChanged handlers use this to only update what uses the changed blocks. (0 if not known) */
+	cc_uint64 ChangedMask;
+	/* Same as ChangedMask, but only for blocks which changed whether they block light. */
+	cc_uint64 LightChangedMask;
 } Blocks;
 
 #define Block_Tint(col, block)\
@@ -109,7 +115,15 @@ if (Blocks.Tinted[block]) col = PackedCol_Tint(col, Blocks.FogCol[block]);
 cc_bool Block_IsCustomDefined(BlockID block);
 /* Sets whether the given block has been changed from default. */
 void Block_SetCustomDefined(BlockID block, cc_bool defined);
+/* Updates derived properties of the given block, after its properties were changed to a custom definition. */
+/* NOTE: Culling and BlockDefChanged are deferred until Block_ApplyChanges. (see Block_MarkChanged) */
 void Block_DefineCustom(BlockID block);
+/* Marks the definition of the given block as changed. */
+/* Changes are collected and then applied at once by Block_ApplyChanges, which is called every network tick. */
+/* This way receiving hundreds of block definitions only refreshes the world once, instead of hundreds of times. */
+void Block_MarkChanged(BlockID block, cc_bool lightChanged);
+/* Updates culling of the blocks changed since last call, then raises BlockDefChanged once. */
+void Block_ApplyChanges(void);
 
 /* Sets the basic and extended collide types of the given block. */
 void Block_SetCollide(BlockID block, cc_uint8 collide);
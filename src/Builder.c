@@ -21,24 +21,10 @@ int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 18x18x18 chunk array. Coordinates range from -1 to 16. */
 #define Builder_PackChunk(xx, yy, zz) (((yy) + 1) * EXTCHUNK_SIZE_2 + ((zz) + 1) * EXTCHUNK_SIZE + ((xx) + 1))
 
-static BlockID* Builder_Chunk;
-static cc_uint8* Builder_Counts;
-static int* Builder_BitFlags;
-static cc_bool Builder_UseBitFlags;
-static int Builder_X, Builder_Y, Builder_Z;
-static BlockID Builder_Block;
-static int Builder_ChunkIndex;
-static cc_bool Builder_FullBright;
-static cc_bool Builder_Tinted;
-static int Builder_ChunkEndX, Builder_ChunkEndZ;
-static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
+/* Whether rows of faces are merged along the texture V axis. (see Builder_MergeRows) */
+#define Builder_MergingRows() (Builder_GreedyMeshing && Atlas1D.TilesPerAtlas == 1)
 
-static int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
-static int (*Builder_StretchX)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static int (*Builder_StretchZ)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static void (*Builder_RenderBlock)(int countsIndex);
-static void (*Builder_PreStretchTiles)(void);
-static void (*Builder_PostStretchTiles)(void);
+static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
 
 /* Contains state for vertices for a portion of a chunk mesh (vertices that are in a 1D atlas) */
 struct Builder1DPart {
@@ -47,10 +33,128 @@ struct Builder1DPart {
 	int sCount, sOffset, sAdvance;
 };
 
-/* Part builder data, for both normal and translucent parts.
-The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
-static struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
-static struct VertexTextured* Builder_Vertices;
+/* State used by the advanced/smooth lighting mesh builder */
+struct AdvBuilderData {
+	Vec3 minBB, maxBB;
+	int initBitFlags, baseOffset;
+	float x1, y1, z1, x2, y2, z2;
+	PackedCol lerp[5], lerpX[5], lerpZ[5], lerpY[5];
+};
+
+/* Colours of block faces lit by the sun or in shadow. With vertex lighting, these only */
+/*  contain face shading, as the sun/shadow colours are applied when drawing instead */
+struct BuilderLight {
+	PackedCol SunCol,    SunXSide,    SunZSide,    SunYMin;
+	PackedCol ShadowCol, ShadowXSide, ShadowZSide, ShadowYMin;
+};
+
+struct BuilderContext;
+/* Functions that differ between the normal and smooth lighting mesh builders */
+struct BuilderFuncs {
+	int (*StretchXLiquid)(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
+	int (*StretchX)(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+	int (*StretchZ)(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+	cc_bool (*CanMergeRow)(struct BuilderContext* ctx, int initIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+	void (*RenderBlock)(struct BuilderContext* ctx, int countsIndex);
+	void (*PreStretchTiles)(struct BuilderContext* ctx);
+	void (*PostStretchTiles)(struct BuilderContext* ctx);
+};
+
+/* Settings a chunk mesh is built with. The main thread can change the globals these come from */
+/*  at any time, so they are copied into each job when it is queued and builder threads only read the copy */
+struct BuilderMode {
+	const struct BuilderFuncs* funcs;
+	struct BuilderLight light;
+	int sidesLevel, edgeLevel;
+	cc_bool vertexLighting, mergeRows;
+};
+
+/* All the state needed to build a single chunk mesh. */
+/* Each builder thread has its own context, so chunks can be built in parallel. */
+struct BuilderContext {
+	BlockID* chunk;
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT];
+	/* Number of rows of faces merged into each face along the texture V axis (see Builder_MergeRows) */
+	cc_uint8 rows[CHUNK_SIZE_3 * FACE_COUNT];
+	int bitFlags[EXTCHUNK_SIZE_3];
+	/* Copy of the lighting heightmap for the 18x18 columns around the chunk */
+	cc_int16* heightmap;
+	int x1, z1;
+
+	int x, y, z;
+	BlockID block;
+	int chunkIndex;
+	cc_bool fullBright, tinted;
+	int chunkEndX, chunkEndY, chunkEndZ;
+
+	/* Part builder data, for both normal and translucent parts.
+	The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
+	struct Builder1DPart parts[ATLAS1D_MAX_ATLASES * 2];
+	struct VertexTextured* vertices;
+
+	RNGState spriteRng;
+	struct _DrawerData drawer;
+	struct AdvBuilderData adv;
+	struct BuilderMode mode;
+};
+
+/* Functions of the currently active mesh builder. Only accessed on the main thread. */
+static const struct BuilderFuncs* Builder_Funcs;
+
+/* Returns the light height of the given column, from the context's copy of the lighting heightmap */
+#define Builder_LightHeight(ctx, x, z) ctx->heightmap[((z) - ctx->z1 + 1) * EXTCHUNK_SIZE + ((x) - ctx->x1 + 1)]
+
+cc_bool Builder_VertexLighting;
+
+static void CalcLightCols(struct BuilderLight* light) {
+	PackedCol col;
+	if (!Builder_VertexLighting) {
+		light->SunCol   = Env.SunCol;   light->ShadowCol   = Env.ShadowCol;
+		light->SunXSide = Env.SunXSide; light->ShadowXSide = Env.ShadowXSide;
+		light->SunZSide = Env.SunZSide; light->ShadowZSide = Env.ShadowZSide;
+		light->SunYMin  = Env.SunYMin;  light->ShadowYMin  = Env.ShadowYMin;
+		return;
+	}
+
+	/* alpha is how much the face is lit by the sun (see Gfx_SetVertexLighting) */
+	col = PackedCol_Make(255, 255, 255, 254);
+	light->SunCol = col;
+	PackedCol_GetShaded(col, &light->SunXSide, &light->SunZSide, &light->SunYMin);
+
+	col = PackedCol_Make(255, 255, 255, 0);
+	light->ShadowCol = col;
+	PackedCol_GetShaded(col, &light->ShadowXSide, &light->ShadowZSide, &light->ShadowYMin);
+}
+
+/* Copies the current builder settings, which must only be done on the main thread */
+static void Builder_GetMode(struct BuilderMode* mode) {
+	mode->funcs = Builder_Funcs;
+	CalcLightCols(&mode->light);
+	mode->sidesLevel     = Builder_SidesLevel;
+	mode->edgeLevel      = Builder_EdgeLevel;
+	mode->vertexLighting = Builder_VertexLighting;
+	mode->mergeRows      = Builder_MergingRows();
+}
+
+static PackedCol Builder_Col_Sprite(struct BuilderContext* ctx, int x, int y, int z) {
+	return y > Builder_LightHeight(ctx, x, z) ? ctx->mode.light.SunCol : ctx->mode.light.ShadowCol;
+}
+
+static PackedCol Builder_Col_YMax(struct BuilderContext* ctx, int x, int y, int z) {
+	return y > Builder_LightHeight(ctx, x, z) ? ctx->mode.light.SunCol : ctx->mode.light.ShadowCol;
+}
+
+static PackedCol Builder_Col_YMin(struct BuilderContext* ctx, int x, int y, int z) {
+	return y > Builder_LightHeight(ctx, x, z) ? ctx->mode.light.SunYMin : ctx->mode.light.ShadowYMin;
+}
+
+static PackedCol Builder_Col_XSide(struct BuilderContext* ctx, int x, int y, int z) {
+	return y > Builder_LightHeight(ctx, x, z) ? ctx->mode.light.SunXSide : ctx->mode.light.ShadowXSide;
+}
+
+static PackedCol Builder_Col_ZSide(struct BuilderContext* ctx, int x, int y, int z) {
+	return y > Builder_LightHeight(ctx, x, z) ? ctx->mode.light.SunZSide : ctx->mode.light.ShadowZSide;
+}
 
 static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	int i, count = part->sCount;
@@ -58,23 +162,23 @@ static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	return count;
 }
 
-static int Builder1DPart_CalcOffsets(struct Builder1DPart* part, int offset) {
+static int Builder1DPart_CalcOffsets(struct BuilderContext* ctx, struct Builder1DPart* part, int offset) {
 	int i;
 	part->sOffset  = offset;
 	part->sAdvance = part->sCount >> 2;
 
 	offset += part->sCount;
 	for (i = 0; i < FACE_COUNT; i++) {
-		part->fVertices[i] = &Builder_Vertices[offset];
+		part->fVertices[i] = &ctx->vertices[offset];
 		offset += part->fCount[i];
 	}
 	return offset;
 }
 
-static int Builder_TotalVerticesCount(void) {
+static int Builder_TotalVerticesCount(struct BuilderContext* ctx) {
 	int i, count = 0;
 	for (i = 0; i < ATLAS1D_MAX_ATLASES * 2; i++) {
-		count += Builder1DPart_VerticesCount(&Builder_Parts[i]);
+		count += Builder1DPart_VerticesCount(&ctx->parts[i]);
 	}
 	return count;
 }
@@ -83,28 +187,35 @@ static int Builder_TotalVerticesCount(void) {
 /*########################################################################################################################*
 *----------------------------------------------------Base mesh builder----------------------------------------------------*
 *#########################################################################################################################*/
-static void AddSpriteVertices(BlockID block) {
+static void AddSpriteVertices(struct BuilderContext* ctx, BlockID block) {
 	int i = Atlas1D_Index(Block_Tex(block, FACE_XMAX));
-	struct Builder1DPart* part = &Builder_Parts[i];
+	struct Builder1DPart* part = &ctx->parts[i];
 	part->sCount += 4 * 4;
 }
 
-static void AddVertices(BlockID block, Face face) {
+static void AddVertices(struct BuilderContext* ctx, BlockID block, Face face) {
 	int baseOffset = (Blocks.Draw[block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
 	int i = Atlas1D_Index(Block_Tex(block, face));
-	struct Builder1DPart* part = &Builder_Parts[baseOffset + i];
+	struct Builder1DPart* part = &ctx->parts[baseOffset + i];
 	part->fCount[face] += 4;
 }
 
+static void RemoveVertices(struct BuilderContext* ctx, BlockID block, Face face) {
+	int baseOffset = (Blocks.Draw[block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	int i = Atlas1D_Index(Block_Tex(block, face));
+	struct Builder1DPart* part = &ctx->parts[baseOffset + i];
+	part->fCount[face] -= 4;
+}
+
 #ifdef CC_BUILD_GL11
-static void BuildPartVbs(struct ChunkPartInfo* info) {
+static void BuildPartVbs(struct VertexTextured* vertices, struct ChunkPartInfo* info) {
 	/* Sprites vertices are stored before chunk face sides */
 	int i, count, offset = info->Offset + info->SpriteCount;
 	for (i = 0; i < FACE_COUNT; i++) {
 		count = info->Counts[i];
 
 		if (count) {
-			info->Vbs[i] = Gfx_CreateVb2(&Builder_Vertices[offset], VERTEX_FORMAT_TEXTURED, count);
+			info->Vbs[i] = Gfx_CreateVb2(&vertices[offset], VERTEX_FORMAT_TEXTURED, count);
 			offset += count;
 		} else {
 			info->Vbs[i] = 0;
@@ -114,14 +225,14 @@ static void BuildPartVbs(struct ChunkPartInfo* info) {
 	count  = info->SpriteCount;
 	offset = info->Offset;
 	if (count) {
-		info->Vbs[i] = Gfx_CreateVb2(&Builder_Vertices[offset], VERTEX_FORMAT_TEXTURED, count);
+		info->Vbs[i] = Gfx_CreateVb2(&vertices[offset], VERTEX_FORMAT_TEXTURED, count);
 	} else {
 		info->Vbs[i] = 0;
 	}
 }
 #endif
 
-static void SetPartInfo(struct Builder1DPart* part, int* offset, struct ChunkPartInfo* info, cc_bool* hasParts) {
+static void SetPartInfo(struct VertexTextured* vertices, struct Builder1DPart* part, int* offset, struct ChunkPartInfo* info, cc_bool* hasParts) {
 	int vCount = Builder1DPart_VerticesCount(part);
 	info->Offset = -1;
 	if (!vCount) return;
@@ -139,12 +250,12 @@ static void SetPartInfo(struct Builder1DPart* part, int* offset, struct ChunkPar
 	info->SpriteCount       = part->sCount;
 
 #ifdef CC_BUILD_GL11
-	BuildPartVbs(info);
+	BuildPartVbs(vertices, info);
 #endif
 }
 
 
-static void Builder_Stretch(int x1, int y1, int z1) {
+static void Builder_Stretch(struct BuilderContext* ctx, int x1, int y1, int z1) {
 	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
 	int yMax = min(World.Height, y1 + CHUNK_SIZE);
 	int zMax = min(World.Length, z1 + CHUNK_SIZE);
@@ -153,106 +264,168 @@ static void Builder_Stretch(int x1, int y1, int z1) {
 	BlockID b;
 	int x, y, z, xx, yy, zz;
 
-#ifdef OCCLUSION
-	int flags = ComputeOcclusion();
-#endif
-#ifdef DEBUG_OCCLUSION
-	FastColour col = new FastColour(60, 60, 60, 255);
-	if (flags & 1) col.R = 255; /* x */
-	if (flags & 4) col.G = 255; /* y */
-	if (flags & 2) col.B = 255; /* z */
-	map.Sunlight = map.Shadowlight = col;
-	map.SunlightXSide = map.ShadowlightXSide = col;
-	map.SunlightZSide = map.ShadowlightZSide = col;
-	map.SunlightYBottom = map.ShadowlightYBottom = col;
-#endif
-	
 	for (y = y1, yy = 0; y < yMax; y++, yy++) {
 		for (z = z1, zz = 0; z < zMax; z++, zz++) {
 			cIndex = Builder_PackChunk(0, yy, zz);
 
 			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				b = Builder_Chunk[cIndex];
+				b = ctx->chunk[cIndex];
 				if (Blocks.Draw[b] == DRAW_GAS) continue;
 				index = Builder_PackCount(xx, yy, zz);
 
 				/* Sprites can't be stretched, nor can then be they hidden by other blocks. */
 				/* Note sprites are drawn using DrawSprite and not with any of the DrawXFace. */
 				if (Blocks.Draw[b] == DRAW_SPRITE) {
-					AddSpriteVertices(b);
+					AddSpriteVertices(ctx, b);
 					continue;
 				}
 
-				Builder_X = x; Builder_Y = y; Builder_Z = z;
-				Builder_FullBright = Blocks.FullBright[b];
+				ctx->x = x; ctx->y = y; ctx->z = z;
+				ctx->fullBright = Blocks.FullBright[b];
 				tileIdx = b * BLOCK_COUNT;
 				/* All of these function calls are inlined as they can be called tens of millions to hundreds of millions of times. */
 
-				if (Builder_Counts[index] == 0 ||
-					(x == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - 1]] & (1 << FACE_XMIN)) != 0)) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 ||
+					(x == 0 && (y < ctx->mode.sidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < ctx->mode.edgeLevel))) ||
+					(x != 0 && (Blocks.Hidden[tileIdx + ctx->chunk[cIndex - 1]] & (1 << FACE_XMIN)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					count = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMIN);
-					AddVertices(b, FACE_XMIN);
-					Builder_Counts[index] = count;
+					count = ctx->mode.funcs->StretchZ(ctx, index, x, y, z, cIndex, b, FACE_XMIN);
+					AddVertices(ctx, b, FACE_XMIN);
+					ctx->counts[index] = count;
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
-					(x == World.MaxX && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != World.MaxX && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + 1]] & (1 << FACE_XMAX)) != 0)) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 ||
+					(x == World.MaxX && (y < ctx->mode.sidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < ctx->mode.edgeLevel))) ||
+					(x != World.MaxX && (Blocks.Hidden[tileIdx + ctx->chunk[cIndex + 1]] & (1 << FACE_XMAX)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					count = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMAX);
-					AddVertices(b, FACE_XMAX);
-					Builder_Counts[index] = count;
+					count = ctx->mode.funcs->StretchZ(ctx, index, x, y, z, cIndex, b, FACE_XMAX);
+					AddVertices(ctx, b, FACE_XMAX);
+					ctx->counts[index] = count;
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
-					(z == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE]] & (1 << FACE_ZMIN)) != 0)) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 ||
+					(z == 0 && (y < ctx->mode.sidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < ctx->mode.edgeLevel))) ||
+					(z != 0 && (Blocks.Hidden[tileIdx + ctx->chunk[cIndex - EXTCHUNK_SIZE]] & (1 << FACE_ZMIN)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					count = Builder_StretchX(index, Builder_X, Builder_Y, Builder_Z, cIndex, b, FACE_ZMIN);
-					AddVertices(b, FACE_ZMIN);
-					Builder_Counts[index] = count;
+					count = ctx->mode.funcs->StretchX(ctx, index, ctx->x, ctx->y, ctx->z, cIndex, b, FACE_ZMIN);
+					AddVertices(ctx, b, FACE_ZMIN);
+					ctx->counts[index] = count;
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
-					(z == World.MaxZ && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != World.MaxZ && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE]] & (1 << FACE_ZMAX)) != 0)) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 ||
+					(z == World.MaxZ && (y < ctx->mode.sidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < ctx->mode.edgeLevel))) ||
+					(z != World.MaxZ && (Blocks.Hidden[tileIdx + ctx->chunk[cIndex + EXTCHUNK_SIZE]] & (1 << FACE_ZMAX)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					count = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMAX);
-					AddVertices(b, FACE_ZMAX);
-					Builder_Counts[index] = count;
+					count = ctx->mode.funcs->StretchX(ctx, index, x, y, z, cIndex, b, FACE_ZMAX);
+					AddVertices(ctx, b, FACE_ZMAX);
+					ctx->counts[index] = count;
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 || y == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE_2]] & (1 << FACE_YMIN)) != 0) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 || y == 0 ||
+					(Blocks.Hidden[tileIdx + ctx->chunk[cIndex - EXTCHUNK_SIZE_2]] & (1 << FACE_YMIN)) != 0) {
+					ctx->counts[index] = 0;
 				} else {
-					count = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMIN);
-					AddVertices(b, FACE_YMIN);
-					Builder_Counts[index] = count;
+					count = ctx->mode.funcs->StretchX(ctx, index, x, y, z, cIndex, b, FACE_YMIN);
+					AddVertices(ctx, b, FACE_YMIN);
+					ctx->counts[index] = count;
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE_2]] & (1 << FACE_YMAX)) != 0) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 ||
+					(Blocks.Hidden[tileIdx + ctx->chunk[cIndex + EXTCHUNK_SIZE_2]] & (1 << FACE_YMAX)) != 0) {
+					ctx->counts[index] = 0;
 				} else if (b < BLOCK_WATER || b > BLOCK_STILL_LAVA) {
-					count = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMAX);
-					AddVertices(b, FACE_YMAX);
-					Builder_Counts[index] = count;
+					count = ctx->mode.funcs->StretchX(ctx, index, x, y, z, cIndex, b, FACE_YMAX);
+					AddVertices(ctx, b, FACE_YMAX);
+					ctx->counts[index] = count;
 				} else {
-					count = Builder_StretchXLiquid(index, x, y, z, cIndex, b);
-					if (count > 0) AddVertices(b, FACE_YMAX);
-					Builder_Counts[index] = count;
+					count = ctx->mode.funcs->StretchXLiquid(ctx, index, x, y, z, cIndex, b);
+					if (count > 0) AddVertices(ctx, b, FACE_YMAX);
+					ctx->counts[index] = count;
+				}
+			}
+		}
+	}
+}
+
+/* Merges the row of faces starting at the given block with the rows above it, */
+/*  as long as those rows cover exactly the same blocks and have the same texture and lighting. */
+static int Builder_MergeY(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	int count = ctx->counts[countIndex], rows = 1;
+	int initIndex = chunkIndex;
+	y++;
+	chunkIndex += EXTCHUNK_SIZE_2;
+	countIndex += CHUNK_SIZE_2 * FACE_COUNT;
+
+	while (y < ctx->chunkEndY && ctx->counts[countIndex] == count && ctx->mode.funcs->CanMergeRow(ctx, initIndex, x, y, z, chunkIndex, block, face)) {
+		ctx->counts[countIndex] = 0;
+		RemoveVertices(ctx, block, face);
+		rows++;
+		y++;
+		chunkIndex += EXTCHUNK_SIZE_2;
+		countIndex += CHUNK_SIZE_2 * FACE_COUNT;
+	}
+	return rows;
+}
+
+/* Merges the row of faces starting at the given block with the rows in front of it. (see Builder_MergeY) */
+static int Builder_MergeZ(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	int count = ctx->counts[countIndex], rows = 1;
+	int initIndex = chunkIndex;
+	z++;
+	chunkIndex += EXTCHUNK_SIZE;
+	countIndex += CHUNK_SIZE * FACE_COUNT;
+
+	while (z < ctx->chunkEndZ && ctx->counts[countIndex] == count && ctx->mode.funcs->CanMergeRow(ctx, initIndex, x, y, z, chunkIndex, block, face)) {
+		ctx->counts[countIndex] = 0;
+		RemoveVertices(ctx, block, face);
+		rows++;
+		z++;
+		chunkIndex += EXTCHUNK_SIZE;
+		countIndex += CHUNK_SIZE * FACE_COUNT;
+	}
+	return rows;
+}
+
+/* Merges the rows of faces produced by Builder_Stretch along the texture V axis, turning them into rectangles. */
+/* (Y axis for side faces, Z axis for top and bottom faces) */
+/* NOTE: Textures only repeat along the V axis when each 1D atlas contains a single tile. */
+static void Builder_MergeRows(struct BuilderContext* ctx, int x1, int y1, int z1) {
+	int cIndex, index;
+	cc_bool fullY, fullZ;
+	BlockID b;
+	int x, y, z, xx, yy, zz, face;
+
+	for (y = y1, yy = 0; y < ctx->chunkEndY; y++, yy++) {
+		for (z = z1, zz = 0; z < ctx->chunkEndZ; z++, zz++) {
+			cIndex = Builder_PackChunk(0, yy, zz);
+
+			for (x = x1, xx = 0; x < ctx->chunkEndX; x++, xx++, cIndex++) {
+				b = ctx->chunk[cIndex];
+				if (Blocks.Draw[b] == DRAW_GAS || Blocks.Draw[b] == DRAW_SPRITE) continue;
+				index = Builder_PackCount(xx, yy, zz);
+
+				ctx->x = x; ctx->y = y; ctx->z = z;
+				ctx->fullBright = Blocks.FullBright[b];
+				/* Like Block_CalcStretch, a face can only be repeated along an axis the block fully covers */
+				fullY = Blocks.MinBB[b].Y == 0.0f && Blocks.MaxBB[b].Y == 1.0f;
+				fullZ = Blocks.MinBB[b].Z == 0.0f && Blocks.MaxBB[b].Z == 1.0f;
+
+				for (face = FACE_XMIN; fullY && face <= FACE_ZMAX; face++) {
+					if (!ctx->counts[index + face]) continue;
+					ctx->rows[index + face] = Builder_MergeY(ctx, index + face, x, y, z, cIndex, b, face);
+				}
+				for (face = FACE_YMIN; fullZ && face <= FACE_YMAX; face++) {
+					if (!ctx->counts[index + face]) continue;
+					ctx->rows[index + face] = Builder_MergeZ(ctx, index + face, x, y, z, cIndex, b, face);
 				}
 			}
 		}
@@ -271,14 +444,30 @@ for (yy = -1; yy < 17; ++yy) {\
 			block    = get_block;\
 			allAir   = allAir   && Blocks.Draw[block] == DRAW_GAS;\
 			allSolid = allSolid && Blocks.FullOpaque[block];\
-			Builder_Chunk[cIndex] = block;\
+			chunk[cIndex] = block;\
 		}\
 	}\
 }
 
-static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+#ifdef EXTENDED_BLOCKS
+/* Copies the 18 blocks from (x1 - 1, y, z) to (x1 + 16, y, z) into row */
+static void ReadSectionsRow(BlockID* row, int x1, int y, int z) {
+	const struct WorldSection* s = &World.Sections[World_PackSection(x1 >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+	int i = WorldSection_Pack(0, y, z), xx;
+
+	row[0]              = World_GetSectionBlock(x1 - 1,          y, z);
+	row[CHUNK_SIZE + 1] = World_GetSectionBlock(x1 + CHUNK_SIZE, y, z);
+
+	if (!s->indices) {
+		for (xx = 1; xx <= CHUNK_SIZE; xx++) { row[xx] = s->block; }
+	} else {
+		for (xx = 1; xx <= CHUNK_SIZE; xx++, i++) { row[xx] = WorldSection_Get(s, i); }
+	}
+}
+#endif
+
+static cc_bool ReadChunkData(BlockID* chunk, int x1, int y1, int z1, cc_bool* outAllAir) {
 	BlockRaw* blocks = World.Blocks;
-	BlockRaw* blocks2;
 	cc_bool allAir = true, allSolid = true;
 	int index, cIndex;
 	BlockID block;
@@ -287,11 +476,16 @@ static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 #ifndef EXTENDED_BLOCKS
 	ReadChunkBody(blocks[index]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World.Sections) {
 		ReadChunkBody(blocks[index]);
 	} else {
-		blocks2 = World.Blocks2;
-		ReadChunkBody(blocks[index] | (blocks2[index] << 8));
+		/* Much faster to copy whole rows, than to look up the section of each block */
+		for (yy = -1; yy < 17; ++yy) {
+			for (zz = -1; zz < 17; ++zz) {
+				ReadSectionsRow(&chunk[Builder_PackChunk(-1, yy, zz)], x1, y1 + yy, z1 + zz);
+			}
+		}
+		ReadChunkBody(chunk[cIndex]);
 	}
 #endif
 
@@ -320,14 +514,13 @@ for (yy = -1; yy < 17; ++yy) {\
 \
 			block  = get_block;\
 			allAir = allAir && Blocks.Draw[block] == DRAW_GAS;\
-			Builder_Chunk[cIndex] = block;\
+			chunk[cIndex] = block;\
 		}\
 	}\
 }
 
-static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+static cc_bool ReadBorderChunkData(BlockID* chunk, int x1, int y1, int z1, cc_bool* outAllAir) {
 	BlockRaw* blocks = World.Blocks;
-	BlockRaw* blocks2;
 	cc_bool allAir = true;
 	int index, cIndex;
 	BlockID block;
@@ -336,11 +529,10 @@ static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 #ifndef EXTENDED_BLOCKS
 	ReadBorderChunkBody(blocks[index]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World.Sections) {
 		ReadBorderChunkBody(blocks[index]);
 	} else {
-		blocks2 = World.Blocks2;
-		ReadBorderChunkBody(blocks[index] | (blocks2[index] << 8));
+		ReadBorderChunkBody(World_GetSectionBlock(x, y, z));
 	}
 #endif
 
@@ -348,20 +540,26 @@ static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 	return false;
 }
 
-static cc_bool BuildChunk(int x1, int y1, int z1, struct ChunkInfo* info) {
-	BlockID chunk[EXTCHUNK_SIZE_3]; 
-	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
-	int bitFlags[EXTCHUNK_SIZE_3];
-
-	cc_bool allAir, allSolid, onBorder;
-	int xMax, yMax, zMax, totalVerts;
-	int cIndex, index;
-	int x, y, z, xx, yy, zz;
+/* Whether the given chunk is known to not need a mesh, just from the occupancy of sections */
+static cc_bool CanSkipChunk(int x1, int y1, int z1, cc_bool* allAir) {
+	int cx = x1 >> CHUNK_SHIFT, cy = y1 >> CHUNK_SHIFT, cz = z1 >> CHUNK_SHIFT;
+	*allAir = World_IsSectionAllAir(cx, cy, cz);
+	if (*allAir) return true;
+
+	/* Faces of a fully opaque block are only visible when next to a block that isn't fully opaque */
+	return World_IsSectionAllSolid(cx,     cy,     cz    )
+		&& World_IsSectionAllSolid(cx - 1, cy,     cz    ) && World_IsSectionAllSolid(cx + 1, cy,     cz    )
+		&& World_IsSectionAllSolid(cx,     cy - 1, cz    ) && World_IsSectionAllSolid(cx,     cy + 1, cz    )
+		&& World_IsSectionAllSolid(cx,     cy,     cz - 1) && World_IsSectionAllSolid(cx,     cy,     cz + 1);
+}
 
-	Builder_Chunk  = chunk;
-	Builder_Counts = counts;
-	Builder_BitFlags = bitFlags;
-	Builder_PreStretchTiles();
+/* Copies the blocks and lighting heightmap around the given chunk, so the mesh can be built without */
+/* accessing World or Lighting. Returns false if the chunk does not need a mesh. (e.g. completely air) */
+/* NOTE: Must be called on the main thread. */
+static cc_bool ReadChunk(BlockID* chunk, cc_int16* heightmap, int x1, int y1, int z1, cc_bool* allAir) {
+	cc_bool allSolid, onBorder;
+	int x, z, xx, zz, hIndex = 0;
+	if (CanSkipChunk(x1, y1, z1, allAir)) return false;
 	
 	onBorder = 
 		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
@@ -370,52 +568,226 @@ static cc_bool BuildChunk(int x1, int y1, int z1, struct ChunkInfo* info) {
 	if (onBorder) {
 		/* less optimal case here */
 		Mem_Set(chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
-		allSolid = ReadBorderChunkData(x1, y1, z1, &allAir);
+		allSolid = ReadBorderChunkData(chunk, x1, y1, z1, allAir);
 	} else {
-		allSolid = ReadChunkData(x1, y1, z1, &allAir);
+		allSolid = ReadChunkData(chunk, x1, y1, z1, allAir);
 	}
 
-	info->AllAir = allAir;
-	if (allAir || allSolid) return false;
+	if (*allAir || allSolid) return false;
 	Lighting_LightHint(x1 - 1, z1 - 1);
 
-	Mem_Set(counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
-	xMax = min(World.Width,  x1 + CHUNK_SIZE);
-	yMax = min(World.Height, y1 + CHUNK_SIZE);
-	zMax = min(World.Length, z1 + CHUNK_SIZE);
+	for (zz = -1; zz < 17; zz++) {
+		z = z1 + zz;
+		for (xx = -1; xx < 17; xx++, hIndex++) {
+			x = x1 + xx;
+			heightmap[hIndex] = World_ContainsXZ(x, z) ? Lighting_Heightmap[Lighting_Pack(x, z)] : 0;
+		}
+	}
+	return true;
+}
 
-	Builder_ChunkEndX = xMax; Builder_ChunkEndZ = zMax;
-	Builder_Stretch(x1, y1, z1);
+/* Calculates which faces of blocks in the chunk are visible, and how many vertices they need */
+static int CountVertices(struct BuilderContext* ctx, int x1, int y1, int z1) {
+	ctx->mode.funcs->PreStretchTiles(ctx);
+	Mem_Set(ctx->counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
+	Mem_Set(ctx->rows,   1, CHUNK_SIZE_3 * FACE_COUNT);
 
-	totalVerts = Builder_TotalVerticesCount();
-	if (!totalVerts) return false;
+	ctx->x1 = x1; ctx->z1 = z1;
+	ctx->chunkEndX = min(World.Width,  x1 + CHUNK_SIZE);
+	ctx->chunkEndY = min(World.Height, y1 + CHUNK_SIZE);
+	ctx->chunkEndZ = min(World.Length, z1 + CHUNK_SIZE);
+	Builder_Stretch(ctx, x1, y1, z1);
 
-#ifndef CC_BUILD_GL11
-	/* add an extra element to fix crashing on some GPUs */
-	Builder_Vertices = (struct VertexTextured*)Gfx_CreateAndLockVb(&info->Vb,
-													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
-#else
-	/* NOTE: Relies on assumption vb is ignored by GL11 Gfx_LockVb implementation */
-	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
-													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
-#endif
-	Builder_PostStretchTiles();
+	if (ctx->mode.mergeRows) Builder_MergeRows(ctx, x1, y1, z1);
+	return Builder_TotalVerticesCount(ctx);
+}
+
+/* Writes the vertices of all visible block faces in the chunk into ctx->vertices */
+static void RenderChunk(struct BuilderContext* ctx, int x1, int y1, int z1) {
+	int xMax, yMax, zMax;
+	int cIndex, index;
+	int x, y, z, xx, yy, zz;
+
+	xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	yMax = min(World.Height, y1 + CHUNK_SIZE);
+	zMax = min(World.Length, z1 + CHUNK_SIZE);
+	ctx->mode.funcs->PostStretchTiles(ctx);
 
 	for (y = y1, yy = 0; y < yMax; y++, yy++) {
 		for (z = z1, zz = 0; z < zMax; z++, zz++) {
 			cIndex = Builder_PackChunk(0, yy, zz);
 
 			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				Builder_Block = chunk[cIndex];
-				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
+				ctx->block = ctx->chunk[cIndex];
+				if (Blocks.Draw[ctx->block] == DRAW_GAS) continue;
 
 				index = Builder_PackCount(xx, yy, zz);
-				Builder_X = x; Builder_Y = y; Builder_Z = z;
-				Builder_ChunkIndex = cIndex;
-				Builder_RenderBlock(index);
+				ctx->x = x; ctx->y = y; ctx->z = z;
+				ctx->chunkIndex = cIndex;
+				ctx->mode.funcs->RenderBlock(ctx, index);
 			}
 		}
 	}
+}
+
+static const cc_uint8 noConnections[FACE_COUNT];
+#define Connections_IsOpaque(i) Blocks.FullOpaque[chunk[Builder_PackChunk((i) & CHUNK_MASK, (i) >> 8, ((i) >> 4) & CHUNK_MASK)]]
+
+#define Connections_Visit(atFace, face, offset)\
+if (atFace) {\
+	faces |= 1 << face;\
+} else if (!visited[i + (offset)]) {\
+	visited[i + (offset)] = true;\
+	if (!Connections_IsOpaque(i + (offset))) queue[count++] = i + (offset);\
+}
+
+/* Calculates which faces of the chunk are connected to each other through blocks that are not fully opaque, */
+/*  by flood filling outwards from each such block. MapRenderer uses this for occlusion culling. */
+static void CalcConnections(const BlockID* chunk, cc_uint8* connections) {
+	cc_uint8  visited[CHUNK_SIZE_3];
+	cc_uint16 queue[CHUNK_SIZE_3];
+	int i, start, head, count, faces;
+	int x, y, z;
+
+	Mem_Set(visited, 0, sizeof(visited));
+	Mem_Set(connections, 0, FACE_COUNT);
+
+	for (start = 0; start < CHUNK_SIZE_3; start++) {
+		if (visited[start]) continue;
+		visited[start] = true;
+		if (Connections_IsOpaque(start)) continue;
+
+		queue[0] = start; head = 0; count = 1; faces = 0;
+		while (head < count) {
+			i = queue[head++];
+			x = i & CHUNK_MASK; z = (i >> 4) & CHUNK_MASK; y = i >> 8;
+
+			Connections_Visit(x == 0,         FACE_XMIN, -1);
+			Connections_Visit(x == CHUNK_MAX, FACE_XMAX,  1);
+			Connections_Visit(z == 0,         FACE_ZMIN, -CHUNK_SIZE);
+			Connections_Visit(z == CHUNK_MAX, FACE_ZMAX,  CHUNK_SIZE);
+			Connections_Visit(y == 0,         FACE_YMIN, -CHUNK_SIZE_2);
+			Connections_Visit(y == CHUNK_MAX, FACE_YMAX,  CHUNK_SIZE_2);
+		}
+
+		for (i = 0; i < FACE_COUNT; i++) {
+			if (faces & (1 << i)) connections[i] |= faces;
+		}
+	}
+}
+
+int Builder_PackedVUnits(void) {
+	/* Greedy meshing repeats the only tile up to CHUNK_SIZE times along V */
+	if (Atlas1D.TilesPerAtlas == 1) return 32768 / CHUNK_SIZE;
+	/* Always at least 8 units per texel, since atlases are at most 4096 pixels tall */
+	return 32768 / Atlas1D.TilesPerAtlas;
+}
+
+/* Converts a texture coordinate (in tiles) into fixed point */
+static int PackTexCoord(float value, int units) {
+	/* Rounding may move an inset UV2_Scale coordinate onto the start of the adjacent tile in the atlas, */
+	/*  so always keep the packed coordinate inside the tile the original coordinate was in */
+	int tile  = Math_Floor(value + 1.0f / 4096.0f);
+	int coord = Math_Floor(value * units + 0.5f);
+	Math_Clamp(coord, tile * units, (tile + 1) * units - 1);
+	return coord;
+}
+
+#define PackPosition(value, origin) (cc_int16)Math_Floor(((value) - (origin)) * BUILDER_PACKED_POS_UNITS + 0.5f)
+
+/* Converts the given vertices into VERTEX_FORMAT_PACKED vertices in place */
+/* NOTE: Packed vertices are smaller, so packing in order never overwrites vertices not yet packed */
+static void PackVertices(void* vertices, int count, int x1, int y1, int z1) {
+	struct VertexTextured* src = (struct VertexTextured*)vertices;
+	struct VertexPacked* dst   = (struct VertexPacked*)vertices;
+	struct VertexTextured v;
+	float vTiles = (float)Atlas1D.TilesPerAtlas;
+	int vUnits   = Builder_PackedVUnits();
+	int i;
+
+	x1 = Builder_PackedOrigin(x1); y1 = Builder_PackedOrigin(y1); z1 = Builder_PackedOrigin(z1);
+
+	for (i = 0; i < count; i++) {
+		v = src[i];
+		dst[i].X   = PackPosition(v.X, x1);
+		dst[i].Y   = PackPosition(v.Y, y1);
+		dst[i].Z   = PackPosition(v.Z, z1);
+		dst[i].Pad = 0;
+		dst[i].Col = v.Col;
+		dst[i].U   = (cc_int16)PackTexCoord(v.U,          BUILDER_PACKED_U_UNITS);
+		dst[i].V   = (cc_int16)PackTexCoord(v.V * vTiles, vUnits);
+	}
+}
+
+#ifndef CC_BUILD_GL11
+static void UploadVertices(struct ChunkInfo* info, void* vertices, int count, cc_bool packed) {
+	VertexFormat fmt = packed ? VERTEX_FORMAT_PACKED   : VERTEX_FORMAT_TEXTURED;
+	int stride       = packed ? SIZEOF_VERTEX_PACKED   : SIZEOF_VERTEX_TEXTURED;
+	void* data;
+	if (MapRenderer_UploadToArena(info, vertices, count)) return;
+
+	/* add an extra element to fix crashing on some GPUs */
+	data = Gfx_CreateAndLockVb(&info->Vb, fmt, count + 1);
+	Mem_Copy(data, vertices, count * stride);
+	Gfx_UnlockVb(info->Vb);
+}
+#endif
+
+/* Context used when building chunks on the main thread */
+static BlockID mainChunk[EXTCHUNK_SIZE_3];
+static cc_int16 mainHeightmap[EXTCHUNK_SIZE_2];
+static struct BuilderContext mainCtx;
+/* Vertices are built here first when they are packed or uploaded into a shared vb */
+static struct VertexTextured* mainVertices;
+static int mainVerticesCapacity;
+
+static cc_bool BuildChunk(int x1, int y1, int z1, struct ChunkInfo* info) {
+	struct BuilderContext* ctx = &mainCtx;
+	cc_uint8 connections[FACE_COUNT];
+	cc_bool allAir;
+	int totalVerts;
+
+	ctx->chunk     = mainChunk;
+	ctx->heightmap = mainHeightmap;
+	Builder_GetMode(&ctx->mode);
+	if (!ReadChunk(mainChunk, mainHeightmap, x1, y1, z1, &allAir)) {
+		info->AllAir = allAir;
+		/* Chunk is either completely air or completely solid */
+		MapRenderer_SetConnections(info, allAir ? MapRenderer_AllConnections : noConnections);
+		return false;
+	}
+	info->AllAir = false;
+
+	CalcConnections(mainChunk, connections);
+	MapRenderer_SetConnections(info, connections);
+
+	totalVerts = CountVertices(ctx, x1, y1, z1);
+	if (!totalVerts) return false;
+
+#ifndef CC_BUILD_GL11
+	if (Gfx.PackedVertices || MapRenderer_ChunkArena) {
+		if (totalVerts > mainVerticesCapacity) {
+			mainVertices = (struct VertexTextured*)Mem_Realloc(mainVertices, totalVerts,
+												sizeof(struct VertexTextured), "chunk vertices");
+			mainVerticesCapacity = totalVerts;
+		}
+
+		ctx->vertices = mainVertices;
+		RenderChunk(ctx, x1, y1, z1);
+		if (Gfx.PackedVertices) PackVertices(mainVertices, totalVerts, x1, y1, z1);
+		UploadVertices(info, mainVertices, totalVerts, Gfx.PackedVertices);
+		return true;
+	}
+
+	/* add an extra element to fix crashing on some GPUs */
+	ctx->vertices = (struct VertexTextured*)Gfx_CreateAndLockVb(&info->Vb,
+													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+#else
+	/* NOTE: Relies on assumption vb is ignored by GL11 Gfx_LockVb implementation */
+	ctx->vertices = (struct VertexTextured*)Gfx_LockVb(0, 
+													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+#endif
+	RenderChunk(ctx, x1, y1, z1);
 
 #ifndef CC_BUILD_GL11
 	Gfx_UnlockVb(info->Vb);
@@ -423,26 +795,25 @@ static cc_bool BuildChunk(int x1, int y1, int z1, struct ChunkInfo* info) {
 	return true;
 }
 
-void Builder_MakeChunk(struct ChunkInfo* info) {
+static void SetChunkParts(struct Builder1DPart* parts, struct VertexTextured* vertices, struct ChunkInfo* info) {
 	int x = info->CentreX - 8, y = info->CentreY - 8, z = info->CentreZ - 8;
-	cc_bool hasMesh, hasNorm, hasTran;
+	cc_bool hasNorm, hasTran;
 	int partsIndex;
-	int i, j, curIdx, offset;
-
-	hasMesh = BuildChunk(x, y, z, info);
-	if (!hasMesh) return;
+	int i, j, atlas, curIdx, offset;
 
 	partsIndex = MapRenderer_Pack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
 	offset  = 0;
 	hasNorm = false;
 	hasTran = false;
 
+	/* Unused atlases have no vertices, so offsets still match the ascending order of DefaultPostStretchTiles */
 	for (i = 0; i < MapRenderer_1DUsedCount; i++) {
-		j = i + ATLAS1D_MAX_ATLASES;
+		atlas  = MapRenderer_1DUsedAtlases[i];
+		j      = atlas + ATLAS1D_MAX_ATLASES;
 		curIdx = partsIndex + i * MapRenderer_ChunksCount;
 
-		SetPartInfo(&Builder_Parts[i], &offset, &MapRenderer_PartsNormal[curIdx],      &hasNorm);
-		SetPartInfo(&Builder_Parts[j], &offset, &MapRenderer_PartsTranslucent[curIdx], &hasTran);
+		SetPartInfo(vertices, &parts[atlas], &offset, &MapRenderer_PartsNormal[curIdx],      &hasNorm);
+		SetPartInfo(vertices, &parts[j],     &offset, &MapRenderer_PartsTranslucent[curIdx], &hasTran);
 	}
 
 	if (hasNorm) {
@@ -452,39 +823,44 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 		info->TranslucentParts = &MapRenderer_PartsTranslucent[partsIndex];
 	}
 
-#ifdef OCCLUSION
-	if (info.NormalParts != null || info.TranslucentParts != null)
-		info.occlusionFlags = (cc_uint8)ComputeOcclusion();
-#endif
 }
 
-static cc_bool Builder_OccludedLiquid(int chunkIndex) {
+void Builder_MakeChunk(struct ChunkInfo* info) {
+	int x = info->CentreX - 8, y = info->CentreY - 8, z = info->CentreZ - 8;
+	cc_bool hasMesh;
+
+	hasMesh = BuildChunk(x, y, z, info);
+	if (!hasMesh) return;
+
+	SetChunkParts(mainCtx.parts, mainCtx.vertices, info);
+}
+
+static cc_bool Builder_OccludedLiquid(struct BuilderContext* ctx, int chunkIndex) {
 	chunkIndex += EXTCHUNK_SIZE_2; /* Checking y above */
 	return
-		Blocks.FullOpaque[Builder_Chunk[chunkIndex]]
-		&& Blocks.Draw[Builder_Chunk[chunkIndex - EXTCHUNK_SIZE]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex - 1]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex + 1]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex + EXTCHUNK_SIZE]] != DRAW_GAS;
+		Blocks.FullOpaque[ctx->chunk[chunkIndex]]
+		&& Blocks.Draw[ctx->chunk[chunkIndex - EXTCHUNK_SIZE]] != DRAW_GAS
+		&& Blocks.Draw[ctx->chunk[chunkIndex - 1]] != DRAW_GAS
+		&& Blocks.Draw[ctx->chunk[chunkIndex + 1]] != DRAW_GAS
+		&& Blocks.Draw[ctx->chunk[chunkIndex + EXTCHUNK_SIZE]] != DRAW_GAS;
 }
 
-static void DefaultPreStretchTiles(void) {
-	Mem_Set(Builder_Parts, 0, sizeof(Builder_Parts));
+static void DefaultPreStretchTiles(struct BuilderContext* ctx) {
+	Mem_Set(ctx->parts, 0, sizeof(ctx->parts));
 }
 
-static void DefaultPostStretchTiles(void) {
+static void DefaultPostStretchTiles(struct BuilderContext* ctx) {
 	int i, j, offset;
 	offset = 0;
 	for (i = 0; i < ATLAS1D_MAX_ATLASES; i++) {
 		j = i + ATLAS1D_MAX_ATLASES;
 
-		offset = Builder1DPart_CalcOffsets(&Builder_Parts[i], offset);
-		offset = Builder1DPart_CalcOffsets(&Builder_Parts[j], offset);
+		offset = Builder1DPart_CalcOffsets(ctx, &ctx->parts[i], offset);
+		offset = Builder1DPart_CalcOffsets(ctx, &ctx->parts[j], offset);
 	}
 }
 
-static RNGState spriteRng;
-static void Builder_DrawSprite(void) {
+static void Builder_DrawSprite(struct BuilderContext* ctx) {
 	struct Builder1DPart* part;
 	struct VertexTextured v;
 	PackedCol white = PACKEDCOL_WHITE;
@@ -498,59 +874,59 @@ static void Builder_DrawSprite(void) {
 	float valX, valY, valZ;
 	float x1,y1,z1, x2,y2,z2;
 	
-	X  = (float)Builder_X; Y = (float)Builder_Y; Z = (float)Builder_Z;
+	X  = (float)ctx->x; Y = (float)ctx->y; Z = (float)ctx->z;
 	x1 = X + 2.50f/16.0f; y1 = Y;        z1 = Z + 2.50f/16.0f;
 	x2 = X + 13.5f/16.0f; y2 = Y + 1.0f; z2 = Z + 13.5f/16.0f;
 
 #define s_u1 0.0f
 #define s_u2 UV2_Scale
-	loc = Block_Tex(Builder_Block, FACE_XMAX);
+	loc = Block_Tex(ctx->block, FACE_XMAX);
 	v1  = Atlas1D_RowId(loc) * Atlas1D.InvTileSize;
 	v2  = v1 + Atlas1D.InvTileSize * UV2_Scale;
 
-	offsetType = Blocks.SpriteOffset[Builder_Block];
+	offsetType = Blocks.SpriteOffset[ctx->block];
 	if (offsetType >= 6 && offsetType <= 7) {
-		Random_Seed(&spriteRng, (Builder_X + 1217 * Builder_Z) & 0x7fffffff);
-		valX = Random_Range(&spriteRng, -3, 3 + 1) / 16.0f;
-		valY = Random_Range(&spriteRng, 0,  3 + 1) / 16.0f;
-		valZ = Random_Range(&spriteRng, -3, 3 + 1) / 16.0f;
+		Random_Seed(&ctx->spriteRng, (ctx->x + 1217 * ctx->z) & 0x7fffffff);
+		valX = Random_Range(&ctx->spriteRng, -3, 3 + 1) / 16.0f;
+		valY = Random_Range(&ctx->spriteRng, 0,  3 + 1) / 16.0f;
+		valZ = Random_Range(&ctx->spriteRng, -3, 3 + 1) / 16.0f;
 
 		x1 += valX - 1.7f/16.0f; x2 += valX + 1.7f/16.0f;
 		z1 += valZ - 1.7f/16.0f; z2 += valZ + 1.7f/16.0f;
 		if (offsetType == 7) { y1 -= valY; y2 -= valY; }
 	}
 	
-	part  = &Builder_Parts[Atlas1D_Index(loc)];
-	v.Col = Builder_FullBright ? white : Lighting_Col_Sprite_Fast(Builder_X, Builder_Y, Builder_Z);
-	Block_Tint(v.Col, Builder_Block);
+	part  = &ctx->parts[Atlas1D_Index(loc)];
+	v.Col = ctx->fullBright ? white : Builder_Col_Sprite(ctx, ctx->x, ctx->y, ctx->z);
+	Block_Tint(v.Col, ctx->block);
 
 	/* Draw Z axis */
 	index = part->sOffset;
-	v.X = x1; v.Y = y1; v.Z = z1; v.U = s_u2; v.V = v2; Builder_Vertices[index + 0] = v;
-	          v.Y = y2;                       v.V = v1; Builder_Vertices[index + 1] = v;
-	v.X = x2;           v.Z = z2; v.U = s_u1;           Builder_Vertices[index + 2] = v;
-	          v.Y = y1;                       v.V = v2; Builder_Vertices[index + 3] = v;
+	v.X = x1; v.Y = y1; v.Z = z1; v.U = s_u2; v.V = v2; ctx->vertices[index + 0] = v;
+	          v.Y = y2;                       v.V = v1; ctx->vertices[index + 1] = v;
+	v.X = x2;           v.Z = z2; v.U = s_u1;           ctx->vertices[index + 2] = v;
+	          v.Y = y1;                       v.V = v2; ctx->vertices[index + 3] = v;
 
 	/* Draw Z axis mirrored */
 	index += part->sAdvance;
-	v.X = x2; v.Y = y1; v.Z = z2; v.U = s_u2;           Builder_Vertices[index + 0] = v;
-	          v.Y = y2;                       v.V = v1; Builder_Vertices[index + 1] = v;
-	v.X = x1;           v.Z = z1; v.U = s_u1;           Builder_Vertices[index + 2] = v;
-	          v.Y = y1;                       v.V = v2; Builder_Vertices[index + 3] = v;
+	v.X = x2; v.Y = y1; v.Z = z2; v.U = s_u2;           ctx->vertices[index + 0] = v;
+	          v.Y = y2;                       v.V = v1; ctx->vertices[index + 1] = v;
+	v.X = x1;           v.Z = z1; v.U = s_u1;           ctx->vertices[index + 2] = v;
+	          v.Y = y1;                       v.V = v2; ctx->vertices[index + 3] = v;
 
 	/* Draw X axis */
 	index += part->sAdvance;
-	v.X = x1; v.Y = y1; v.Z = z2; v.U = s_u2;           Builder_Vertices[index + 0] = v;
-	          v.Y = y2;                       v.V = v1; Builder_Vertices[index + 1] = v;
-	v.X = x2;           v.Z = z1; v.U = s_u1;           Builder_Vertices[index + 2] = v;
-	          v.Y = y1;                       v.V = v2; Builder_Vertices[index + 3] = v;
+	v.X = x1; v.Y = y1; v.Z = z2; v.U = s_u2;           ctx->vertices[index + 0] = v;
+	          v.Y = y2;                       v.V = v1; ctx->vertices[index + 1] = v;
+	v.X = x2;           v.Z = z1; v.U = s_u1;           ctx->vertices[index + 2] = v;
+	          v.Y = y1;                       v.V = v2; ctx->vertices[index + 3] = v;
 
 	/* Draw X axis mirrored */
 	index += part->sAdvance;
-	v.X = x2; v.Y = y1; v.Z = z1; v.U = s_u2;           Builder_Vertices[index + 0] = v;
-	          v.Y = y2;                       v.V = v1; Builder_Vertices[index + 1] = v;
-	v.X = x1;           v.Z = z2; v.U = s_u1;           Builder_Vertices[index + 2] = v;
-	          v.Y = y1;                       v.V = v2; Builder_Vertices[index + 3] = v;
+	v.X = x2; v.Y = y1; v.Z = z1; v.U = s_u2;           ctx->vertices[index + 0] = v;
+	          v.Y = y2;                       v.V = v1; ctx->vertices[index + 1] = v;
+	v.X = x1;           v.Z = z2; v.U = s_u1;           ctx->vertices[index + 2] = v;
+	          v.Y = y1;                       v.V = v2; ctx->vertices[index + 3] = v;
 
 	part->sOffset += 4;
 }
@@ -559,46 +935,46 @@ static void Builder_DrawSprite(void) {
 /*########################################################################################################################*
 *--------------------------------------------------Normal mesh builder----------------------------------------------------*
 *#########################################################################################################################*/
-static PackedCol Normal_LightCol(int x, int y, int z, Face face, BlockID block) {
+static PackedCol Normal_LightCol(struct BuilderContext* ctx, int x, int y, int z, Face face, BlockID block) {
 	int offset = (Blocks.LightOffset[block] >> face) & 1;
 
 	switch (face) {
 	case FACE_XMIN:
-		return x < offset                ? Env.SunXSide : Lighting_Col_XSide_Fast(x - offset, y, z);
+		return x < offset                ? ctx->mode.light.SunXSide : Builder_Col_XSide(ctx, x - offset, y, z);
 	case FACE_XMAX:
-		return x > (World.MaxX - offset) ? Env.SunXSide : Lighting_Col_XSide_Fast(x + offset, y, z);
+		return x > (World.MaxX - offset) ? ctx->mode.light.SunXSide : Builder_Col_XSide(ctx, x + offset, y, z);
 	case FACE_ZMIN:
-		return z < offset                ? Env.SunZSide : Lighting_Col_ZSide_Fast(x, y, z - offset);
+		return z < offset                ? ctx->mode.light.SunZSide : Builder_Col_ZSide(ctx, x, y, z - offset);
 	case FACE_ZMAX:
-		return z > (World.MaxZ - offset) ? Env.SunZSide : Lighting_Col_ZSide_Fast(x, y, z + offset);
+		return z > (World.MaxZ - offset) ? ctx->mode.light.SunZSide : Builder_Col_ZSide(ctx, x, y, z + offset);
 	case FACE_YMIN:
-		return y <= 0                    ? Env.SunYMin  : Lighting_Col_YMin_Fast(x, y - offset, z);
+		return y <= 0                    ? ctx->mode.light.SunYMin  : Builder_Col_YMin(ctx, x, y - offset, z);
 	case FACE_YMAX:
-		return y >= World.MaxY           ? Env.SunCol   : Lighting_Col_YMax_Fast(x, (y + 1) - offset, z);
+		return y >= World.MaxY           ? ctx->mode.light.SunCol   : Builder_Col_YMax(ctx, x, (y + 1) - offset, z);
 	}
 	return 0; /* should never happen */
 }
 
-static cc_bool Normal_CanStretch(BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
-	BlockID cur = Builder_Chunk[chunkIndex];
+static cc_bool Normal_CanStretch(struct BuilderContext* ctx, BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
+	BlockID cur = ctx->chunk[chunkIndex];
 
-	if (cur != initial || Block_IsFaceHidden(cur, Builder_Chunk[chunkIndex + Builder_Offsets[face]], face)) return false;
-	if (Builder_FullBright) return true;
+	if (cur != initial || Block_IsFaceHidden(cur, ctx->chunk[chunkIndex + Builder_Offsets[face]], face)) return false;
+	if (ctx->fullBright) return true;
 
-	return Normal_LightCol(Builder_X, Builder_Y, Builder_Z, face, initial) == Normal_LightCol(x, y, z, face, cur);
+	return Normal_LightCol(ctx, ctx->x, ctx->y, ctx->z, face, initial) == Normal_LightCol(ctx, x, y, z, face, cur);
 }
 
-static int NormalBuilder_StretchXLiquid(int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
+static int NormalBuilder_StretchXLiquid(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
 	int count = 1; cc_bool stretchTile;
-	if (Builder_OccludedLiquid(chunkIndex)) return 0;
+	if (Builder_OccludedLiquid(ctx, chunkIndex)) return 0;
 	
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << FACE_YMAX)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(chunkIndex)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Normal_CanStretch(ctx, block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(ctx, chunkIndex)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
@@ -607,15 +983,15 @@ static int NormalBuilder_StretchXLiquid(int countIndex, int x, int y, int z, int
 	return count;
 }
 
-static int NormalBuilder_StretchX(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int NormalBuilder_StretchX(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Normal_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
@@ -624,15 +1000,15 @@ static int NormalBuilder_StretchX(int countIndex, int x, int y, int z, int chunk
 	return count;
 }
 
-static int NormalBuilder_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int NormalBuilder_StretchZ(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
 	z++;
 	chunkIndex += EXTCHUNK_SIZE;
 	countIndex += CHUNK_SIZE * FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (z < Builder_ChunkEndZ && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (z < ctx->chunkEndZ && stretchTile && Normal_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		z++;
 		chunkIndex += EXTCHUNK_SIZE;
@@ -641,13 +1017,19 @@ static int NormalBuilder_StretchZ(int countIndex, int x, int y, int z, int chunk
 	return count;
 }
 
-static void NormalBuilder_RenderBlock(int index) {	
+/* Rows are only merged when they have the same light colour. (ctx->x/y/z is the first row) */
+static cc_bool NormalBuilder_CanMergeRow(struct BuilderContext* ctx, int initIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	return Normal_CanStretch(ctx, block, chunkIndex, x, y, z, face);
+}
+
+static void NormalBuilder_RenderBlock(struct BuilderContext* ctx, int index) {	
 	/* counters */
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
 
 	/* block state */
 	PackedCol white = PACKEDCOL_WHITE;
+	struct _DrawerData* drawer;
 	Vec3 min, max;
 	int baseOffset, lightFlags;
 	cc_bool fullBright;
@@ -658,125 +1040,112 @@ static void NormalBuilder_RenderBlock(int index) {
 	PackedCol col;
 	int offset;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
-		Builder_FullBright = Blocks.FullBright[Builder_Block];
-		Builder_Tinted     = Blocks.Tinted[Builder_Block];
-		Builder_DrawSprite();
+	if (Blocks.Draw[ctx->block] == DRAW_SPRITE) {
+		ctx->fullBright = Blocks.FullBright[ctx->block];
+		ctx->tinted     = Blocks.Tinted[ctx->block];
+		Builder_DrawSprite(ctx);
 		return;
 	}
 
-	count_XMin = Builder_Counts[index + FACE_XMIN];
-	count_XMax = Builder_Counts[index + FACE_XMAX];
-	count_ZMin = Builder_Counts[index + FACE_ZMIN];
-	count_ZMax = Builder_Counts[index + FACE_ZMAX];
-	count_YMin = Builder_Counts[index + FACE_YMIN];
-	count_YMax = Builder_Counts[index + FACE_YMAX];
+	count_XMin = ctx->counts[index + FACE_XMIN];
+	count_XMax = ctx->counts[index + FACE_XMAX];
+	count_ZMin = ctx->counts[index + FACE_ZMIN];
+	count_ZMax = ctx->counts[index + FACE_ZMAX];
+	count_YMin = ctx->counts[index + FACE_YMIN];
+	count_YMax = ctx->counts[index + FACE_YMAX];
 
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	fullBright = Blocks.FullBright[Builder_Block];
-	baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	lightFlags = Blocks.LightOffset[Builder_Block];
+	fullBright = Blocks.FullBright[ctx->block];
+	baseOffset = (Blocks.Draw[ctx->block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	lightFlags = Blocks.LightOffset[ctx->block];
 
-	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.Y = 1.0f - Drawer.MinBB.Y;
-	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.Y = 1.0f - Drawer.MaxBB.Y;
+	drawer = &ctx->drawer;
+	drawer->MinBB = Blocks.MinBB[ctx->block]; drawer->MinBB.Y = 1.0f - drawer->MinBB.Y;
+	drawer->MaxBB = Blocks.MaxBB[ctx->block]; drawer->MaxBB.Y = 1.0f - drawer->MaxBB.Y;
 
-	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	Drawer.X1 = Builder_X + min.X; Drawer.Y1 = Builder_Y + min.Y; Drawer.Z1 = Builder_Z + min.Z;
-	Drawer.X2 = Builder_X + max.X; Drawer.Y2 = Builder_Y + max.Y; Drawer.Z2 = Builder_Z + max.Z;
+	min = Blocks.RenderMinBB[ctx->block]; max = Blocks.RenderMaxBB[ctx->block];
+	drawer->X1 = ctx->x + min.X; drawer->Y1 = ctx->y + min.Y; drawer->Z1 = ctx->z + min.Z;
+	drawer->X2 = ctx->x + max.X; drawer->Y2 = ctx->y + max.Y; drawer->Z2 = ctx->z + max.Z;
 
-	Drawer.Tinted  = Blocks.Tinted[Builder_Block];
-	Drawer.TintCol = Blocks.FogCol[Builder_Block];
+	drawer->Tinted  = Blocks.Tinted[ctx->block];
+	drawer->TintCol = Blocks.FogCol[ctx->block];
 
 	if (count_XMin) {
-		loc    = Block_Tex(Builder_Block, FACE_XMIN);
+		loc    = Block_Tex(ctx->block, FACE_XMIN);
 		offset = (lightFlags >> FACE_XMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_X >= offset ? Lighting_Col_XSide_Fast(Builder_X - offset, Builder_Y, Builder_Z) : Env.SunXSide;
-		Drawer_XMin(count_XMin, col, loc, &part->fVertices[FACE_XMIN]);
+			ctx->x >= offset ? Builder_Col_XSide(ctx, ctx->x - offset, ctx->y, ctx->z) : ctx->mode.light.SunXSide;
+		DrawerData_XMin(drawer, count_XMin, ctx->rows[index + FACE_XMIN], col, loc, &part->fVertices[FACE_XMIN]);
 	}
 
 	if (count_XMax) {
-		loc    = Block_Tex(Builder_Block, FACE_XMAX);
+		loc    = Block_Tex(ctx->block, FACE_XMAX);
 		offset = (lightFlags >> FACE_XMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_X <= (World.MaxX - offset) ? Lighting_Col_XSide_Fast(Builder_X + offset, Builder_Y, Builder_Z) : Env.SunXSide;
-		Drawer_XMax(count_XMax, col, loc, &part->fVertices[FACE_XMAX]);
+			ctx->x <= (World.MaxX - offset) ? Builder_Col_XSide(ctx, ctx->x + offset, ctx->y, ctx->z) : ctx->mode.light.SunXSide;
+		DrawerData_XMax(drawer, count_XMax, ctx->rows[index + FACE_XMAX], col, loc, &part->fVertices[FACE_XMAX]);
 	}
 
 	if (count_ZMin) {
-		loc    = Block_Tex(Builder_Block, FACE_ZMIN);
+		loc    = Block_Tex(ctx->block, FACE_ZMIN);
 		offset = (lightFlags >> FACE_ZMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_Z >= offset ? Lighting_Col_ZSide_Fast(Builder_X, Builder_Y, Builder_Z - offset) : Env.SunZSide;
-		Drawer_ZMin(count_ZMin, col, loc, &part->fVertices[FACE_ZMIN]);
+			ctx->z >= offset ? Builder_Col_ZSide(ctx, ctx->x, ctx->y, ctx->z - offset) : ctx->mode.light.SunZSide;
+		DrawerData_ZMin(drawer, count_ZMin, ctx->rows[index + FACE_ZMIN], col, loc, &part->fVertices[FACE_ZMIN]);
 	}
 
 	if (count_ZMax) {
-		loc    = Block_Tex(Builder_Block, FACE_ZMAX);
+		loc    = Block_Tex(ctx->block, FACE_ZMAX);
 		offset = (lightFlags >> FACE_ZMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? white :
-			Builder_Z <= (World.MaxZ - offset) ? Lighting_Col_ZSide_Fast(Builder_X, Builder_Y, Builder_Z + offset) : Env.SunZSide;
-		Drawer_ZMax(count_ZMax, col, loc, &part->fVertices[FACE_ZMAX]);
+			ctx->z <= (World.MaxZ - offset) ? Builder_Col_ZSide(ctx, ctx->x, ctx->y, ctx->z + offset) : ctx->mode.light.SunZSide;
+		DrawerData_ZMax(drawer, count_ZMax, ctx->rows[index + FACE_ZMAX], col, loc, &part->fVertices[FACE_ZMAX]);
 	}
 
 	if (count_YMin) {
-		loc    = Block_Tex(Builder_Block, FACE_YMIN);
+		loc    = Block_Tex(ctx->block, FACE_YMIN);
 		offset = (lightFlags >> FACE_YMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
-		col = fullBright ? white : Lighting_Col_YMin_Fast(Builder_X, Builder_Y - offset, Builder_Z);
-		Drawer_YMin(count_YMin, col, loc, &part->fVertices[FACE_YMIN]);
+		col = fullBright ? white : Builder_Col_YMin(ctx, ctx->x, ctx->y - offset, ctx->z);
+		DrawerData_YMin(drawer, count_YMin, ctx->rows[index + FACE_YMIN], col, loc, &part->fVertices[FACE_YMIN]);
 	}
 
 	if (count_YMax) {
-		loc    = Block_Tex(Builder_Block, FACE_YMAX);
+		loc    = Block_Tex(ctx->block, FACE_YMAX);
 		offset = (lightFlags >> FACE_YMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
-		col = fullBright ? white : Lighting_Col_YMax_Fast(Builder_X, (Builder_Y + 1) - offset, Builder_Z);
-		Drawer_YMax(count_YMax, col, loc, &part->fVertices[FACE_YMAX]);
+		col = fullBright ? white : Builder_Col_YMax(ctx, ctx->x, (ctx->y + 1) - offset, ctx->z);
+		DrawerData_YMax(drawer, count_YMax, ctx->rows[index + FACE_YMAX], col, loc, &part->fVertices[FACE_YMAX]);
 	}
 }
 
-static void Builder_SetDefault(void) {
-	Builder_StretchXLiquid = NULL;
-	Builder_StretchX       = NULL;
-	Builder_StretchZ       = NULL;
-	Builder_RenderBlock    = NULL;
-
-	Builder_UseBitFlags      = false;
-	Builder_PreStretchTiles  = DefaultPreStretchTiles;
-	Builder_PostStretchTiles = DefaultPostStretchTiles;
-}
-
-static void NormalBuilder_SetActive(void) {
-	Builder_SetDefault();
-	Builder_StretchXLiquid = NormalBuilder_StretchXLiquid;
-	Builder_StretchX       = NormalBuilder_StretchX;
-	Builder_StretchZ       = NormalBuilder_StretchZ;
-	Builder_RenderBlock    = NormalBuilder_RenderBlock;
-}
+static const struct BuilderFuncs normalBuilder = {
+	NormalBuilder_StretchXLiquid,
+	NormalBuilder_StretchX,
+	NormalBuilder_StretchZ,
+	NormalBuilder_CanMergeRow,
+	NormalBuilder_RenderBlock,
+	DefaultPreStretchTiles,
+	DefaultPostStretchTiles
+};
+static void NormalBuilder_SetActive(void) { Builder_Funcs = &normalBuilder; }
 
 
 /*########################################################################################################################*
 *-------------------------------------------------Advanced mesh builder---------------------------------------------------*
 *#########################################################################################################################*/
-static Vec3 adv_minBB, adv_maxBB;
-static int adv_initBitFlags, adv_lightFlags, adv_baseOffset;
-static int* adv_bitFlags;
-static float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
-static PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
-
 enum ADV_MASK {
 	/* z-1 cube points */
 	xM1_yM1_zM1, xM1_yCC_zM1, xM1_yP1_zM1,
@@ -792,52 +1161,52 @@ enum ADV_MASK {
 	xP1_yM1_zP1, xP1_yCC_zP1, xP1_yP1_zP1,
 };
 
-static int Adv_Lit(int x, int y, int z, int cIndex) {
-	int flags, offset, lightHeight;
+static int Adv_Lit(struct BuilderContext* ctx, int x, int y, int z, int cIndex) {
+	int flags, offset, lightHeight, lightFlags;
 	BlockID block;
 	if (y < 0 || y >= World.Height) return 7; /* all faces lit */
 
 	/* TODO: check sides height (if sides > edges), check if edge block casts a shadow */
 	if (!World_ContainsXZ(x, z)) {
-		return y >= Builder_EdgeLevel ? 7 : y == (Builder_EdgeLevel - 1) ? 6 : 0;
+		return y >= ctx->mode.edgeLevel ? 7 : y == (ctx->mode.edgeLevel - 1) ? 6 : 0;
 	}
 
 	flags = 0;
-	block = Builder_Chunk[cIndex];
-	lightHeight    = Lighting_Heightmap[Lighting_Pack(x, z)];
-	adv_lightFlags = Blocks.LightOffset[block];
+	block = ctx->chunk[cIndex];
+	lightHeight = Builder_LightHeight(ctx, x, z);
+	lightFlags  = Blocks.LightOffset[block];
 
 	/* Use fact Light(Y.YMin) == Light((Y-1).YMax) */
-	offset = (adv_lightFlags >> FACE_YMIN) & 1;
+	offset = (lightFlags >> FACE_YMIN) & 1;
 	flags |= ((y - offset) > lightHeight ? 1 : 0);
 
 	/* Light is same for all the horizontal faces */
 	flags |= (y > lightHeight ? 2 : 0);
 
 	/* Use fact Light((Y+1).YMin) == Light(Y.YMax) */
-	offset = (adv_lightFlags >> FACE_YMAX) & 1;
+	offset = (lightFlags >> FACE_YMAX) & 1;
 	flags |= ((y - offset) >= lightHeight ? 4 : 0);
 
 	/* Dynamic lighting */
 	if (Blocks.FullBright[block])                       flags |= 5;
-	if (Blocks.FullBright[Builder_Chunk[cIndex + 324]]) flags |= 4;
-	if (Blocks.FullBright[Builder_Chunk[cIndex - 324]]) flags |= 1;
+	if (Blocks.FullBright[ctx->chunk[cIndex + 324]]) flags |= 4;
+	if (Blocks.FullBright[ctx->chunk[cIndex - 324]]) flags |= 1;
 	return flags;
 }
 
-static int Adv_ComputeLightFlags(int x, int y, int z, int cIndex) {
-	if (Builder_FullBright) return (1 << xP1_yP1_zP1) - 1; /* all faces fully bright */
+static int Adv_ComputeLightFlags(struct BuilderContext* ctx, int x, int y, int z, int cIndex) {
+	if (ctx->fullBright) return (1 << xP1_yP1_zP1) - 1; /* all faces fully bright */
 
 	return
-		Adv_Lit(x - 1, y, z - 1, cIndex - 1 - 18) << xM1_yM1_zM1 |
-		Adv_Lit(x - 1, y, z,     cIndex - 1)      << xM1_yM1_zCC |
-		Adv_Lit(x - 1, y, z + 1, cIndex - 1 + 18) << xM1_yM1_zP1 |
-		Adv_Lit(x,     y, z - 1, cIndex + 0 - 18) << xCC_yM1_zM1 |
-		Adv_Lit(x,     y, z,     cIndex + 0)      << xCC_yM1_zCC |
-		Adv_Lit(x,     y, z + 1, cIndex + 0 + 18) << xCC_yM1_zP1 |
-		Adv_Lit(x + 1, y, z - 1, cIndex + 1 - 18) << xP1_yM1_zM1 |
-		Adv_Lit(x + 1, y, z,     cIndex + 1)      << xP1_yM1_zCC |
-		Adv_Lit(x + 1, y, z + 1, cIndex + 1 + 18) << xP1_yM1_zP1;
+		Adv_Lit(ctx, x - 1, y, z - 1, cIndex - 1 - 18) << xM1_yM1_zM1 |
+		Adv_Lit(ctx, x - 1, y, z,     cIndex - 1)      << xM1_yM1_zCC |
+		Adv_Lit(ctx, x - 1, y, z + 1, cIndex - 1 + 18) << xM1_yM1_zP1 |
+		Adv_Lit(ctx, x,     y, z - 1, cIndex + 0 - 18) << xCC_yM1_zM1 |
+		Adv_Lit(ctx, x,     y, z,     cIndex + 0)      << xCC_yM1_zCC |
+		Adv_Lit(ctx, x,     y, z + 1, cIndex + 0 + 18) << xCC_yM1_zP1 |
+		Adv_Lit(ctx, x + 1, y, z - 1, cIndex + 1 - 18) << xP1_yM1_zM1 |
+		Adv_Lit(ctx, x + 1, y, z,     cIndex + 1)      << xP1_yM1_zCC |
+		Adv_Lit(ctx, x + 1, y, z + 1, cIndex + 1 + 18) << xP1_yM1_zP1;
 }
 
 static int adv_masks[FACE_COUNT] = {
@@ -868,30 +1237,30 @@ static int adv_masks[FACE_COUNT] = {
 };
 
 
-static cc_bool Adv_CanStretch(BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
-	BlockID cur = Builder_Chunk[chunkIndex];
-	adv_bitFlags[chunkIndex] = Adv_ComputeLightFlags(x, y, z, chunkIndex);
+static cc_bool Adv_CanStretch(struct BuilderContext* ctx, BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
+	BlockID cur = ctx->chunk[chunkIndex];
+	ctx->bitFlags[chunkIndex] = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
 
 	return cur == initial
-		&& !Block_IsFaceHidden(cur, Builder_Chunk[chunkIndex + Builder_Offsets[face]], face)
-		&& (adv_initBitFlags == adv_bitFlags[chunkIndex]
+		&& !Block_IsFaceHidden(cur, ctx->chunk[chunkIndex + Builder_Offsets[face]], face)
+		&& (ctx->adv.initBitFlags == ctx->bitFlags[chunkIndex]
 		/* Check that this face is either fully bright or fully in shadow */
-		&& (adv_initBitFlags == 0 || (adv_initBitFlags & adv_masks[face]) == adv_masks[face]));
+		&& (ctx->adv.initBitFlags == 0 || (ctx->adv.initBitFlags & adv_masks[face]) == adv_masks[face]));
 }
 
-static int Adv_StretchXLiquid(int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
+static int Adv_StretchXLiquid(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
 	int count = 1; cc_bool stretchTile;
-	if (Builder_OccludedLiquid(chunkIndex)) return 0;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
-	adv_bitFlags[chunkIndex] = adv_initBitFlags;
+	if (Builder_OccludedLiquid(ctx, chunkIndex)) return 0;
+	ctx->adv.initBitFlags = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
+	ctx->bitFlags[chunkIndex] = ctx->adv.initBitFlags;
 
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << FACE_YMAX)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(chunkIndex)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Adv_CanStretch(ctx, block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(ctx, chunkIndex)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
@@ -900,18 +1269,18 @@ static int Adv_StretchXLiquid(int countIndex, int x, int y, int z, int chunkInde
 	return count;
 }
 
-static int Adv_StretchX(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int Adv_StretchX(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
-	adv_bitFlags[chunkIndex] = adv_initBitFlags;
+	ctx->adv.initBitFlags = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
+	ctx->bitFlags[chunkIndex] = ctx->adv.initBitFlags;
 	
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Adv_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
@@ -920,18 +1289,18 @@ static int Adv_StretchX(int countIndex, int x, int y, int z, int chunkIndex, Blo
 	return count;
 }
 
-static int Adv_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int Adv_StretchZ(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
-	adv_bitFlags[chunkIndex] = adv_initBitFlags;
+	ctx->adv.initBitFlags = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
+	ctx->bitFlags[chunkIndex] = ctx->adv.initBitFlags;
 
 	z++;
 	chunkIndex += EXTCHUNK_SIZE;
 	countIndex += CHUNK_SIZE * FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (z < Builder_ChunkEndZ && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (z < ctx->chunkEndZ && stretchTile && Adv_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		z++;
 		chunkIndex += EXTCHUNK_SIZE;
@@ -940,330 +1309,683 @@ static int Adv_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, Blo
 	return count;
 }
 
+/* Rows are only merged when all their corners have the same light, i.e. every block */
+/*  has the same light flags and the face is either fully bright or fully in shadow. */
+static cc_bool Adv_CanMergeRow(struct BuilderContext* ctx, int initIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	ctx->adv.initBitFlags = ctx->bitFlags[initIndex];
+	return Adv_CanStretch(ctx, block, chunkIndex, x, y, z, face);
+}
+
 
 #define Adv_CountBits(F, a, b, c, d) (((F >> a) & 1) + ((F >> b) & 1) + ((F >> c) & 1) + ((F >> d) & 1))
 
-static void Adv_DrawXMin(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMIN);
+static void Adv_DrawXMin(struct BuilderContext* ctx, int count, int rows) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_XMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.Z, u2 = (count - 1) + adv_maxBB.Z * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.Y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.Y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.Z, u2 = (count - 1) + ctx->adv.maxBB.Z * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ((rows - 1) + ctx->adv.minBB.Y * UV2_Scale) * Atlas1D.InvTileSize;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aY0_Z0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yCC_zM1, xM1_yM1_zCC, xM1_yCC_zCC);
 	int aY0_Z1 = Adv_CountBits(F, xM1_yM1_zP1, xM1_yCC_zP1, xM1_yM1_zCC, xM1_yCC_zCC);
 	int aY1_Z0 = Adv_CountBits(F, xM1_yP1_zM1, xM1_yCC_zM1, xM1_yP1_zCC, xM1_yCC_zCC);
 	int aY1_Z1 = Adv_CountBits(F, xM1_yP1_zP1, xM1_yCC_zP1, xM1_yP1_zCC, xM1_yCC_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpX[aY0_Z0], col1_0 = Builder_FullBright ? white : adv_lerpX[aY1_Z0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpX[aY1_Z1], col0_1 = Builder_FullBright ? white : adv_lerpX[aY0_Z1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z0], col1_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z1], col0_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z1];
 	struct VertexTextured* vertices, v;
 
-	if (Builder_Tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->fVertices[FACE_XMIN];
-	v.X = adv_x1;
+	v.X = ctx->adv.x1;
 	if (aY0_Z0 + aY1_Z1 > aY0_Z1 + aY1_Z0) {
-		v.Y = adv_y2; v.Z = adv_z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
-		v.Y = adv_y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
-		              v.Z = adv_z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
-		v.Y = adv_y2;                                       v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.Y = ctx->adv.y2 + (rows - 1); v.Z = ctx->adv.z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.Y = ctx->adv.y1;                                            v.V = v2; v.Col = col0_0; *vertices++ = v;
+		                   v.Z = ctx->adv.z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
+		v.Y = ctx->adv.y2 + (rows - 1);                                            v.V = v1; v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.Y = adv_y2; v.Z = adv_z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		              v.Z = adv_z1;               v.U = u1;           v.Col = col1_0; *vertices++ = v;
-		v.Y = adv_y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
-		              v.Z = adv_z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
+		v.Y = ctx->adv.y2 + (rows - 1); v.Z = ctx->adv.z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		                   v.Z = ctx->adv.z1;               v.U = u1;           v.Col = col1_0; *vertices++ = v;
+		v.Y = ctx->adv.y1;                                            v.V = v2; v.Col = col0_0; *vertices++ = v;
+		                   v.Z = ctx->adv.z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
 	}
 	part->fVertices[FACE_XMIN] = vertices;
 }
 
-static void Adv_DrawXMax(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMAX);
+static void Adv_DrawXMax(struct BuilderContext* ctx, int count, int rows) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_XMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - adv_minBB.Z), u2 = (1 - adv_maxBB.Z) * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.Y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.Y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = (count - ctx->adv.minBB.Z), u2 = (1 - ctx->adv.maxBB.Z) * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ((rows - 1) + ctx->adv.minBB.Y * UV2_Scale) * Atlas1D.InvTileSize;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aY0_Z0 = Adv_CountBits(F, xP1_yM1_zM1, xP1_yCC_zM1, xP1_yM1_zCC, xP1_yCC_zCC);
 	int aY0_Z1 = Adv_CountBits(F, xP1_yM1_zP1, xP1_yCC_zP1, xP1_yM1_zCC, xP1_yCC_zCC);
 	int aY1_Z0 = Adv_CountBits(F, xP1_yP1_zM1, xP1_yCC_zM1, xP1_yP1_zCC, xP1_yCC_zCC);
 	int aY1_Z1 = Adv_CountBits(F, xP1_yP1_zP1, xP1_yCC_zP1, xP1_yP1_zCC, xP1_yCC_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpX[aY0_Z0], col1_0 = Builder_FullBright ? white : adv_lerpX[aY1_Z0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpX[aY1_Z1], col0_1 = Builder_FullBright ? white : adv_lerpX[aY0_Z1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z0], col1_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z1], col0_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z1];
 	struct VertexTextured* vertices, v;
 
-	if (Builder_Tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->fVertices[FACE_XMAX];
-	v.X = adv_x2;
+	v.X = ctx->adv.x2;
 	if (aY0_Z0 + aY1_Z1 > aY0_Z1 + aY1_Z0) {
-		v.Y = adv_y2; v.Z = adv_z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
-		              v.Z = adv_z2 + (count - 1); v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		v.Y = adv_y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
-		              v.Z = adv_z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		v.Y = ctx->adv.y2 + (rows - 1); v.Z = ctx->adv.z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
+		                   v.Z = ctx->adv.z2 + (count - 1); v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		v.Y = ctx->adv.y1;                                            v.V = v2; v.Col = col0_1; *vertices++ = v;
+		                   v.Z = ctx->adv.z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
 	} else {
-		v.Y = adv_y2; v.Z = adv_z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		v.Y = adv_y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
-		              v.Z = adv_z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
-		v.Y = adv_y2;                                       v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.Y = ctx->adv.y2 + (rows - 1); v.Z = ctx->adv.z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.Y = ctx->adv.y1;                                            v.V = v2; v.Col = col0_1; *vertices++ = v;
+		                   v.Z = ctx->adv.z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		v.Y = ctx->adv.y2 + (rows - 1);                                            v.V = v1; v.Col = col1_0; *vertices++ = v;
 	}
 	part->fVertices[FACE_XMAX] = vertices;
 }
 
-static void Adv_DrawZMin(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMIN);
+static void Adv_DrawZMin(struct BuilderContext* ctx, int count, int rows) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_ZMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - adv_minBB.X), u2 = (1 - adv_maxBB.X) * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.Y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.Y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = (count - ctx->adv.minBB.X), u2 = (1 - ctx->adv.maxBB.X) * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ((rows - 1) + ctx->adv.minBB.Y * UV2_Scale) * Atlas1D.InvTileSize;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Y0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yCC_zM1, xCC_yM1_zM1, xCC_yCC_zM1);
 	int aX0_Y1 = Adv_CountBits(F, xM1_yP1_zM1, xM1_yCC_zM1, xCC_yP1_zM1, xCC_yCC_zM1);
 	int aX1_Y0 = Adv_CountBits(F, xP1_yM1_zM1, xP1_yCC_zM1, xCC_yM1_zM1, xCC_yCC_zM1);
 	int aX1_Y1 = Adv_CountBits(F, xP1_yP1_zM1, xP1_yCC_zM1, xCC_yP1_zM1, xCC_yCC_zM1);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpZ[aX0_Y0], col1_0 = Builder_FullBright ? white : adv_lerpZ[aX1_Y0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpZ[aX1_Y1], col0_1 = Builder_FullBright ? white : adv_lerpZ[aX0_Y1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y0], col1_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y1], col0_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y1];
 	struct VertexTextured* vertices, v;
 
-	if (Builder_Tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->fVertices[FACE_ZMIN];
-	v.Z = adv_z1;
+	v.Z = ctx->adv.z1;
 	if (aX1_Y1 + aX0_Y0 > aX0_Y1 + aX1_Y0) {
-		v.X = adv_x2 + (count - 1); v.Y = adv_y1; v.U = u2; v.V = v2; v.Col = col1_0; *vertices++ = v;
-		v.X = adv_x1;                             v.U = u1;           v.Col = col0_0; *vertices++ = v;
-		                            v.Y = adv_y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1); v.Y = ctx->adv.y1; v.U = u2; v.V = v2; v.Col = col1_0; *vertices++ = v;
+		v.X = ctx->adv.x1;                                  v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		                                 v.Y = ctx->adv.y2 + (rows - 1);           v.V = v1; v.Col = col0_1; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);                    v.U = u2;           v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.X = adv_x1;               v.Y = adv_y1; v.U = u1; v.V = v2; v.Col = col0_0; *vertices++ = v;
-		                            v.Y = adv_y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		                            v.Y = adv_y1;           v.V = v2; v.Col = col1_0; *vertices++ = v;
+		v.X = ctx->adv.x1;          v.Y = ctx->adv.y1; v.U = u1; v.V = v2; v.Col = col0_0; *vertices++ = v;
+		                            v.Y = ctx->adv.y2 + (rows - 1);           v.V = v1; v.Col = col0_1; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		                            v.Y = ctx->adv.y1;           v.V = v2; v.Col = col1_0; *vertices++ = v;
 	}
 	part->fVertices[FACE_ZMIN] = vertices;
 }
 
-static void Adv_DrawZMax(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMAX);
+static void Adv_DrawZMax(struct BuilderContext* ctx, int count, int rows) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_ZMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.X, u2 = (count - 1) + adv_maxBB.X * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.Y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.Y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.X, u2 = (count - 1) + ctx->adv.maxBB.X * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.Y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ((rows - 1) + ctx->adv.minBB.Y * UV2_Scale) * Atlas1D.InvTileSize;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Y0 = Adv_CountBits(F, xM1_yM1_zP1, xM1_yCC_zP1, xCC_yM1_zP1, xCC_yCC_zP1);
 	int aX1_Y0 = Adv_CountBits(F, xP1_yM1_zP1, xP1_yCC_zP1, xCC_yM1_zP1, xCC_yCC_zP1);
 	int aX0_Y1 = Adv_CountBits(F, xM1_yP1_zP1, xM1_yCC_zP1, xCC_yP1_zP1, xCC_yCC_zP1);
 	int aX1_Y1 = Adv_CountBits(F, xP1_yP1_zP1, xP1_yCC_zP1, xCC_yP1_zP1, xCC_yCC_zP1);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpZ[aX1_Y1], col1_0 = Builder_FullBright ? white : adv_lerpZ[aX1_Y0];
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpZ[aX0_Y0], col0_1 = Builder_FullBright ? white : adv_lerpZ[aX0_Y1];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y1], col1_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y0];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y0], col0_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y1];
 	struct VertexTextured* vertices, v;
 
-	if (Builder_Tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->fVertices[FACE_ZMAX];
-	v.Z = adv_z2;
+	v.Z = ctx->adv.z2;
 	if (aX1_Y1 + aX0_Y0 > aX0_Y1 + aX1_Y0) {
-		v.X = adv_x1;               v.Y = adv_y2; v.U = u1; v.V = v1; v.Col = col0_1; *vertices++ = v;
-		                            v.Y = adv_y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
-		                            v.Y = adv_y2;           v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.X = ctx->adv.x1;          v.Y = ctx->adv.y2 + (rows - 1); v.U = u1; v.V = v1; v.Col = col0_1; *vertices++ = v;
+		                            v.Y = ctx->adv.y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		                            v.Y = ctx->adv.y2 + (rows - 1);           v.V = v1; v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.X = adv_x2 + (count - 1); v.Y = adv_y2; v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		v.X = adv_x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
-		                            v.Y = adv_y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1); v.Y = ctx->adv.y2 + (rows - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.X = ctx->adv.x1;                                  v.U = u1;           v.Col = col0_1; *vertices++ = v;
+		                                 v.Y = ctx->adv.y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);                    v.U = u2;           v.Col = col1_0; *vertices++ = v;
 	}
 	part->fVertices[FACE_ZMAX] = vertices;
 }
 
-static void Adv_DrawYMin(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMIN);
+static void Adv_DrawYMin(struct BuilderContext* ctx, int count, int rows) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_YMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.X, u2 = (count - 1) + adv_maxBB.X * UV2_Scale;
-	float v1 = vOrigin + adv_minBB.Z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_maxBB.Z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.X, u2 = (count - 1) + ctx->adv.maxBB.X * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.minBB.Z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ((rows - 1) + ctx->adv.maxBB.Z * UV2_Scale) * Atlas1D.InvTileSize;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Z0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yM1_zCC, xCC_yM1_zM1, xCC_yM1_zCC);
 	int aX1_Z0 = Adv_CountBits(F, xP1_yM1_zM1, xP1_yM1_zCC, xCC_yM1_zM1, xCC_yM1_zCC);
 	int aX0_Z1 = Adv_CountBits(F, xM1_yM1_zP1, xM1_yM1_zCC, xCC_yM1_zP1, xCC_yM1_zCC);
 	int aX1_Z1 = Adv_CountBits(F, xP1_yM1_zP1, xP1_yM1_zCC, xCC_yM1_zP1, xCC_yM1_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_1 = Builder_FullBright ? white : adv_lerpY[aX0_Z1], col1_1 = Builder_FullBright ? white : adv_lerpY[aX1_Z1];
-	PackedCol col1_0 = Builder_FullBright ? white : adv_lerpY[aX1_Z0], col0_0 = Builder_FullBright ? white : adv_lerpY[aX0_Z0];
+	PackedCol col0_1 = ctx->fullBright ? white : ctx->adv.lerpY[aX0_Z1], col1_1 = ctx->fullBright ? white : ctx->adv.lerpY[aX1_Z1];
+	PackedCol col1_0 = ctx->fullBright ? white : ctx->adv.lerpY[aX1_Z0], col0_0 = ctx->fullBright ? white : ctx->adv.lerpY[aX0_Z0];
 	struct VertexTextured* vertices, v;
 
-	if (Builder_Tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->fVertices[FACE_YMIN];
-	v.Y = adv_y1;
+	v.Y = ctx->adv.y1;
 	if (aX0_Z1 + aX1_Z0 > aX0_Z0 + aX1_Z1) {
-		v.X = adv_x2 + (count - 1); v.Z = adv_z2; v.U = u2; v.V = v2; v.Col = col1_1; *vertices++ = v;
-		v.X = adv_x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
-		                            v.Z = adv_z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1); v.Z = ctx->adv.z2 + (rows - 1); v.U = u2; v.V = v2; v.Col = col1_1; *vertices++ = v;
+		v.X = ctx->adv.x1;                                  v.U = u1;           v.Col = col0_1; *vertices++ = v;
+		                                 v.Z = ctx->adv.z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);                    v.U = u2;           v.Col = col1_0; *vertices++ = v;
 	} else {
-		v.X = adv_x1;               v.Z = adv_z2; v.U = u1; v.V = v2; v.Col = col0_1; *vertices++ = v;
-		                            v.Z = adv_z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
-		                            v.Z = adv_z2;           v.V = v2; v.Col = col1_1; *vertices++ = v;
+		v.X = ctx->adv.x1;          v.Z = ctx->adv.z2 + (rows - 1); v.U = u1; v.V = v2; v.Col = col0_1; *vertices++ = v;
+		                            v.Z = ctx->adv.z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		                            v.Z = ctx->adv.z2 + (rows - 1);           v.V = v2; v.Col = col1_1; *vertices++ = v;
 	}
 	part->fVertices[FACE_YMIN] = vertices;
 }
 
-static void Adv_DrawYMax(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMAX);
+static void Adv_DrawYMax(struct BuilderContext* ctx, int count, int rows) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_YMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.X, u2 = (count - 1) + adv_maxBB.X * UV2_Scale;
-	float v1 = vOrigin + adv_minBB.Z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_maxBB.Z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.X, u2 = (count - 1) + ctx->adv.maxBB.X * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.minBB.Z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ((rows - 1) + ctx->adv.maxBB.Z * UV2_Scale) * Atlas1D.InvTileSize;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Z0 = Adv_CountBits(F, xM1_yP1_zM1, xM1_yP1_zCC, xCC_yP1_zM1, xCC_yP1_zCC);
 	int aX1_Z0 = Adv_CountBits(F, xP1_yP1_zM1, xP1_yP1_zCC, xCC_yP1_zM1, xCC_yP1_zCC);
 	int aX0_Z1 = Adv_CountBits(F, xM1_yP1_zP1, xM1_yP1_zCC, xCC_yP1_zP1, xCC_yP1_zCC);
 	int aX1_Z1 = Adv_CountBits(F, xP1_yP1_zP1, xP1_yP1_zCC, xCC_yP1_zP1, xCC_yP1_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerp[aX0_Z0], col1_0 = Builder_FullBright ? white : adv_lerp[aX1_Z0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerp[aX1_Z1], col0_1 = Builder_FullBright ? white : adv_lerp[aX0_Z1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerp[aX0_Z0], col1_0 = ctx->fullBright ? white : ctx->adv.lerp[aX1_Z0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerp[aX1_Z1], col0_1 = ctx->fullBright ? white : ctx->adv.lerp[aX0_Z1];
 	struct VertexTextured* vertices, v;
 
-	if (Builder_Tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->fVertices[FACE_YMAX];
-	v.Y = adv_y2;
+	v.Y = ctx->adv.y2;
 	if (aX0_Z0 + aX1_Z1 > aX0_Z1 + aX1_Z0) {
-		v.X = adv_x2 + (count - 1); v.Z = adv_z1; v.U = u2; v.V = v1; v.Col = col1_0; *vertices++ = v;
-		v.X = adv_x1;                             v.U = u1;           v.Col = col0_0; *vertices++ = v;
-		                            v.Z = adv_z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1); v.Z = ctx->adv.z1; v.U = u2; v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.X = ctx->adv.x1;                                  v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		                                 v.Z = ctx->adv.z2 + (rows - 1);           v.V = v2; v.Col = col0_1; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);                    v.U = u2;           v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.X = adv_x1;               v.Z = adv_z1; v.U = u1; v.V = v1; v.Col = col0_0; *vertices++ = v;
-		                            v.Z = adv_z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
-		v.X = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		                            v.Z = adv_z1;           v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.X = ctx->adv.x1;          v.Z = ctx->adv.z1; v.U = u1; v.V = v1; v.Col = col0_0; *vertices++ = v;
+		                            v.Z = ctx->adv.z2 + (rows - 1);           v.V = v2; v.Col = col0_1; *vertices++ = v;
+		v.X = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		                            v.Z = ctx->adv.z1;           v.V = v1; v.Col = col1_0; *vertices++ = v;
 	}
 	part->fVertices[FACE_YMAX] = vertices;
 }
 
-static void Adv_RenderBlock(int index) {
+static void Adv_RenderBlock(struct BuilderContext* ctx, int index) {
 	Vec3 min, max;
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
-		Builder_FullBright = Blocks.FullBright[Builder_Block];
-		Builder_Tinted     = Blocks.Tinted[Builder_Block];
-		Builder_DrawSprite();
+	if (Blocks.Draw[ctx->block] == DRAW_SPRITE) {
+		ctx->fullBright = Blocks.FullBright[ctx->block];
+		ctx->tinted     = Blocks.Tinted[ctx->block];
+		Builder_DrawSprite(ctx);
 		return;
 	}
 
-	count_XMin = Builder_Counts[index + FACE_XMIN];
-	count_XMax = Builder_Counts[index + FACE_XMAX];
-	count_ZMin = Builder_Counts[index + FACE_ZMIN];
-	count_ZMax = Builder_Counts[index + FACE_ZMAX];
-	count_YMin = Builder_Counts[index + FACE_YMIN];
-	count_YMax = Builder_Counts[index + FACE_YMAX];
+	count_XMin = ctx->counts[index + FACE_XMIN];
+	count_XMax = ctx->counts[index + FACE_XMAX];
+	count_ZMin = ctx->counts[index + FACE_ZMIN];
+	count_ZMax = ctx->counts[index + FACE_ZMAX];
+	count_YMin = ctx->counts[index + FACE_YMIN];
+	count_YMax = ctx->counts[index + FACE_YMAX];
 
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	Builder_FullBright = Blocks.FullBright[Builder_Block];
-	adv_baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	adv_lightFlags = Blocks.LightOffset[Builder_Block];
-	Builder_Tinted = Blocks.Tinted[Builder_Block];
+	ctx->fullBright = Blocks.FullBright[ctx->block];
+	ctx->adv.baseOffset = (Blocks.Draw[ctx->block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	ctx->tinted = Blocks.Tinted[ctx->block];
 
-	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	adv_x1 = Builder_X + min.X; adv_y1 = Builder_Y + min.Y; adv_z1 = Builder_Z + min.Z;
-	adv_x2 = Builder_X + max.X; adv_y2 = Builder_Y + max.Y; adv_z2 = Builder_Z + max.Z;
+	min = Blocks.RenderMinBB[ctx->block]; max = Blocks.RenderMaxBB[ctx->block];
+	ctx->adv.x1 = ctx->x + min.X; ctx->adv.y1 = ctx->y + min.Y; ctx->adv.z1 = ctx->z + min.Z;
+	ctx->adv.x2 = ctx->x + max.X; ctx->adv.y2 = ctx->y + max.Y; ctx->adv.z2 = ctx->z + max.Z;
 
-	adv_minBB = Blocks.MinBB[Builder_Block]; adv_maxBB = Blocks.MaxBB[Builder_Block];
-	adv_minBB.Y = 1.0f - adv_minBB.Y; adv_maxBB.Y = 1.0f - adv_maxBB.Y;
+	ctx->adv.minBB = Blocks.MinBB[ctx->block]; ctx->adv.maxBB = Blocks.MaxBB[ctx->block];
+	ctx->adv.minBB.Y = 1.0f - ctx->adv.minBB.Y; ctx->adv.maxBB.Y = 1.0f - ctx->adv.maxBB.Y;
 
-	if (count_XMin) Adv_DrawXMin(count_XMin);
-	if (count_XMax) Adv_DrawXMax(count_XMax);
-	if (count_ZMin) Adv_DrawZMin(count_ZMin);
-	if (count_ZMax) Adv_DrawZMax(count_ZMax);
-	if (count_YMin) Adv_DrawYMin(count_YMin);
-	if (count_YMax) Adv_DrawYMax(count_YMax);
+	if (count_XMin) Adv_DrawXMin(ctx, count_XMin, ctx->rows[index + FACE_XMIN]);
+	if (count_XMax) Adv_DrawXMax(ctx, count_XMax, ctx->rows[index + FACE_XMAX]);
+	if (count_ZMin) Adv_DrawZMin(ctx, count_ZMin, ctx->rows[index + FACE_ZMIN]);
+	if (count_ZMax) Adv_DrawZMax(ctx, count_ZMax, ctx->rows[index + FACE_ZMAX]);
+	if (count_YMin) Adv_DrawYMin(ctx, count_YMin, ctx->rows[index + FACE_YMIN]);
+	if (count_YMax) Adv_DrawYMax(ctx, count_YMax, ctx->rows[index + FACE_YMAX]);
 }
 
-static void Adv_PreStretchTiles(void) {
+/* Returns the colour of a vertex lit by the sun from 'lit' of the 4 blocks around it */
+static PackedCol Adv_LerpLight(struct BuilderContext* ctx, PackedCol shadow, PackedCol sun, int lit) {
+	PackedCol col = PackedCol_Lerp(shadow, sun, lit / 4.0f);
+	if (!ctx->mode.vertexLighting) return col;
+	return (col & PACKEDCOL_RGB_MASK) | PackedCol_A_Bits(254 * lit / 4);
+}
+
+static void Adv_PreStretchTiles(struct BuilderContext* ctx) {
 	int i;
-	DefaultPreStretchTiles();
-	adv_bitFlags = Builder_BitFlags;
+	DefaultPreStretchTiles(ctx);
 
 	for (i = 0; i <= 4; i++) {
-		adv_lerp[i]  = PackedCol_Lerp(Env.ShadowCol,   Env.SunCol,   i / 4.0f);
-		adv_lerpX[i] = PackedCol_Lerp(Env.ShadowXSide, Env.SunXSide, i / 4.0f);
-		adv_lerpZ[i] = PackedCol_Lerp(Env.ShadowZSide, Env.SunZSide, i / 4.0f);
-		adv_lerpY[i] = PackedCol_Lerp(Env.ShadowYMin,  Env.SunYMin,  i / 4.0f);
+		ctx->adv.lerp[i]  = Adv_LerpLight(ctx, ctx->mode.light.ShadowCol,   ctx->mode.light.SunCol,   i);
+		ctx->adv.lerpX[i] = Adv_LerpLight(ctx, ctx->mode.light.ShadowXSide, ctx->mode.light.SunXSide, i);
+		ctx->adv.lerpZ[i] = Adv_LerpLight(ctx, ctx->mode.light.ShadowZSide, ctx->mode.light.SunZSide, i);
+		ctx->adv.lerpY[i] = Adv_LerpLight(ctx, ctx->mode.light.ShadowYMin,  ctx->mode.light.SunYMin,  i);
+	}
+}
+
+static const struct BuilderFuncs advBuilder = {
+	Adv_StretchXLiquid,
+	Adv_StretchX,
+	Adv_StretchZ,
+	Adv_CanMergeRow,
+	Adv_RenderBlock,
+	Adv_PreStretchTiles,
+	DefaultPostStretchTiles
+};
+static void AdvBuilder_SetActive(void) { Builder_Funcs = &advBuilder; }
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Mesh statistics-----------------------------------------------------*
+*#########################################################################################################################*/
+static void MeasureMesh(struct BuilderContext* ctx, int x1, int y1, int z1, struct BuilderStats* stats,
+						struct VertexTextured** vertices, int* capacity) {
+	cc_uint64 beg, end, elapsed;
+	int totalVerts;
+
+	beg = Stopwatch_Measure();
+	totalVerts = CountVertices(ctx, x1, y1, z1);
+	end = Stopwatch_Measure();
+	elapsed = Stopwatch_ElapsedMicroseconds(beg, end);
+
+	if (totalVerts > *capacity) {
+		*vertices = (struct VertexTextured*)Mem_Realloc(*vertices, totalVerts,
+											sizeof(struct VertexTextured), "chunk vertices");
+		*capacity = totalVerts;
 	}
+
+	if (totalVerts) {
+		ctx->vertices = *vertices;
+		beg = Stopwatch_Measure();
+		RenderChunk(ctx, x1, y1, z1);
+		end = Stopwatch_Measure();
+		elapsed += Stopwatch_ElapsedMicroseconds(beg, end);
+		stats->chunks++;
+	}
+	stats->vertices  += totalVerts;
+	stats->buildTime += elapsed;
 }
 
-static void AdvBuilder_SetActive(void) {
-	Builder_SetDefault();
-	Builder_StretchXLiquid  = Adv_StretchXLiquid;
-	Builder_StretchX        = Adv_StretchX;
-	Builder_StretchZ        = Adv_StretchZ;
-	Builder_RenderBlock     = Adv_RenderBlock;
-	Builder_PreStretchTiles = Adv_PreStretchTiles;
+/* Builds the mesh of a chunk both with and without greedy meshing, without uploading it */
+static void MeasureChunk(struct BuilderContext* ctx, int x1, int y1, int z1, struct BuilderStats* normal,
+						struct BuilderStats* greedy, struct VertexTextured** vertices, int* capacity) {
+	ctx->mode.mergeRows = false;
+	MeasureMesh(ctx, x1, y1, z1, normal, vertices, capacity);
+	ctx->mode.mergeRows = true;
+	MeasureMesh(ctx, x1, y1, z1, greedy, vertices, capacity);
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Builder threads------------------------------------------------------*
+*#########################################################################################################################*/
+/* A chunk whose mesh is built on one of the builder threads */
+struct BuilderJob {
+	struct ChunkInfo* info;
+	int x1, y1, z1, generation;
+	cc_bool packed, measure;
+	struct BuilderMode mode;
+	BlockID chunk[EXTCHUNK_SIZE_3];
+	cc_int16 heightmap[EXTCHUNK_SIZE_2];
+	/* Output from the builder thread */
+	struct Builder1DPart parts[ATLAS1D_MAX_ATLASES * 2];
+	struct VertexTextured* vertices;
+	int totalVerts, verticesCapacity;
+	cc_uint8 connections[FACE_COUNT];
+	/* Output from the builder thread for jobs that only measure the chunk's meshes */
+	struct BuilderStats normal, greedy;
+	struct BuilderJob* next;
+};
+struct BuilderJobQueue { struct BuilderJob* head; struct BuilderJob* tail; };
+
+#define BUILDER_MAX_THREADS 16
+int Builder_WorkersCount;
+static void* builder_threads[BUILDER_MAX_THREADS];
+static struct BuilderContext* builder_ctxs;
+static int builder_ctxsUsed;
+
+static void* builder_mutex;
+static void* builder_waitable;
+static volatile cc_bool builder_quit;
+/* Incremented whenever queued jobs are cancelled, so results of any in-progress jobs are discarded */
+static volatile int builder_generation;
+/* NOTE: job queues must only be accessed while builder_mutex is locked */
+static struct BuilderJobQueue builder_pending, builder_finished, builder_measured, builder_free;
+/* Number of jobs currently being built by builder threads (only accessed while builder_mutex is locked) */
+static int builder_running;
+
+static void JobQueue_Push(struct BuilderJobQueue* queue, struct BuilderJob* job) {
+	job->next = NULL;
+	if (queue->tail) { queue->tail->next = job; } else { queue->head = job; }
+	queue->tail = job;
+}
+
+static struct BuilderJob* JobQueue_Pop(struct BuilderJobQueue* queue) {
+	struct BuilderJob* job = queue->head;
+	if (!job) return NULL;
+
+	queue->head = job->next;
+	if (!queue->head) queue->tail = NULL;
+	return job;
+}
+
+static void JobQueue_Free(struct BuilderJobQueue* queue) {
+	struct BuilderJob* job;
+	while ((job = JobQueue_Pop(queue))) {
+		Mem_Free(job->vertices);
+		Mem_Free(job);
+	}
+}
+
+static void Builder_RunJob(struct BuilderContext* ctx, struct BuilderJob* job) {
+	int totalVerts;
+	ctx->chunk     = job->chunk;
+	ctx->heightmap = job->heightmap;
+	ctx->mode      = job->mode;
+
+	if (job->measure) {
+		Mem_Set(&job->normal, 0, sizeof(struct BuilderStats));
+		Mem_Set(&job->greedy, 0, sizeof(struct BuilderStats));
+		MeasureChunk(ctx, job->x1, job->y1, job->z1, &job->normal, &job->greedy,
+					&job->vertices, &job->verticesCapacity);
+		return;
+	}
+	CalcConnections(job->chunk, job->connections);
+
+	totalVerts      = CountVertices(ctx, job->x1, job->y1, job->z1);
+	job->totalVerts = totalVerts;
+	if (!totalVerts) return;
+
+	if (totalVerts > job->verticesCapacity) {
+		job->vertices = (struct VertexTextured*)Mem_Realloc(job->vertices, totalVerts, 
+												sizeof(struct VertexTextured), "chunk vertices");
+		job->verticesCapacity = totalVerts;
+	}
+
+	ctx->vertices = job->vertices;
+	RenderChunk(ctx, job->x1, job->y1, job->z1);
+	Mem_Copy(job->parts, ctx->parts, sizeof(ctx->parts));
+	if (job->packed) PackVertices(job->vertices, totalVerts, job->x1, job->y1, job->z1);
+}
+
+static void Builder_WorkerFunc(void) {
+	struct BuilderContext* ctx;
+	struct BuilderJob* job;
+
+	Mutex_Lock(builder_mutex);
+	{
+		ctx = &builder_ctxs[builder_ctxsUsed++];
+	}
+	Mutex_Unlock(builder_mutex);
+
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		{
+			job = JobQueue_Pop(&builder_pending);
+			if (job) builder_running++;
+		}
+		Mutex_Unlock(builder_mutex);
+
+		if (!job) {
+			/* Wake up the next builder thread too, since signals may have been coalesced */
+			if (builder_quit) { Waitable_Signal(builder_waitable); return; }
+			Waitable_Wait(builder_waitable);
+			continue;
+		}
+
+		Builder_RunJob(ctx, job);
+		Mutex_Lock(builder_mutex);
+		{
+			JobQueue_Push(job->measure ? &builder_measured : &builder_finished, job);
+			builder_running--;
+		}
+		Mutex_Unlock(builder_mutex);
+	}
+}
+
+static struct BuilderJob* Builder_AllocJob(void) {
+	struct BuilderJob* job;
+	Mutex_Lock(builder_mutex);
+	{
+		job = JobQueue_Pop(&builder_free);
+	}
+	Mutex_Unlock(builder_mutex);
+
+	if (job) return job;
+	return (struct BuilderJob*)Mem_AllocCleared(1, sizeof(struct BuilderJob), "builder job");
+}
+
+static void Builder_ReleaseJob(struct BuilderJob* job) {
+	Mutex_Lock(builder_mutex);
+	{
+		JobQueue_Push(&builder_free, job);
+	}
+	Mutex_Unlock(builder_mutex);
+}
+
+static void Builder_SubmitJob(struct BuilderJob* job, int x, int y, int z) {
+	job->x1 = x; job->y1 = y; job->z1 = z;
+	job->generation = builder_generation;
+	Builder_GetMode(&job->mode);
+
+	Mutex_Lock(builder_mutex);
+	{
+		JobQueue_Push(&builder_pending, job);
+	}
+	Mutex_Unlock(builder_mutex);
+	Waitable_Signal(builder_waitable);
+}
+
+cc_bool Builder_QueueChunk(struct ChunkInfo* info) {
+	int x = info->CentreX - 8, y = info->CentreY - 8, z = info->CentreZ - 8;
+	struct BuilderJob* job = Builder_AllocJob();
+	cc_bool allAir;
+
+	if (!ReadChunk(job->chunk, job->heightmap, x, y, z, &allAir)) {
+		info->AllAir = allAir;
+		MapRenderer_SetConnections(info, allAir ? MapRenderer_AllConnections : noConnections);
+		Builder_ReleaseJob(job);
+		return false;
+	}
+
+	job->info    = info;
+	job->packed  = Gfx.PackedVertices;
+	job->measure = false;
+	Builder_SubmitJob(job, x, y, z);
+	return true;
+}
+
+static void Builder_Upload(struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	/* The old mesh is kept until now to avoid chunks flickering while being rebuilt */
+	MapRenderer_DeleteChunk(info);
+	MapRenderer_SetConnections(info, job->connections);
+	if (!job->totalVerts) return;
+
+#ifndef CC_BUILD_GL11
+	UploadVertices(info, job->vertices, job->totalVerts, job->packed);
+#endif
+	SetChunkParts(job->parts, job->vertices, info);
+}
+
+struct ChunkInfo* Builder_UploadChunk(void) {
+	struct ChunkInfo* info;
+	struct BuilderJob* job;
+
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		{
+			job = JobQueue_Pop(&builder_finished);
+		}
+		Mutex_Unlock(builder_mutex);
+		if (!job) return NULL;
+
+		/* Results of cancelled jobs are simply discarded */
+		info = job->generation == builder_generation ? job->info : NULL;
+		if (info) Builder_Upload(job);
+
+		Builder_ReleaseJob(job);
+		if (info) return info;
+	}
+}
+
+/* Marks the chunk of a cancelled job as needing to be built again */
+/* NOTE: Must only be called while builder_mutex is locked */
+static void Builder_CancelJob(struct BuilderJob* job) {
+	if (!job->measure) {
+		job->info->Building      = false;
+		job->info->PendingDelete = true;
+	}
+	JobQueue_Push(&builder_free, job);
+}
+
+void Builder_CancelChunks(void) {
+	struct BuilderJob* job;
+	int running;
+	if (!Builder_WorkersCount) return;
+
+	Mutex_Lock(builder_mutex);
+	{
+		builder_generation++;
+		while ((job = JobQueue_Pop(&builder_pending))) { Builder_CancelJob(job); }
+	}
+	Mutex_Unlock(builder_mutex);
+
+	/* Jobs already being built may still be reading block properties that the caller is */
+	/*  about to change, so wait for those to finish before returning */
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		{
+			running = builder_running;
+			while ((job = JobQueue_Pop(&builder_finished))) { Builder_CancelJob(job); }
+		}
+		Mutex_Unlock(builder_mutex);
+
+		if (!running) return;
+		Thread_Sleep(1);
+	}
+}
+
+static int Builder_DefaultWorkersCount(void) {
+#ifdef CC_BUILD_WEB
+	return 0; /* no real threading support */
+#else
+	/* Leave one core free for the main thread */
+	int count = Thread_ProcessorsCount() - 1;
+	return min(count, 4);
+#endif
+}
+
+static void Builder_StartWorkers(void) {
+	int i, count = Builder_DefaultWorkersCount();
+#ifndef CC_BUILD_WEB
+	count = Options_GetInt(OPT_BUILDER_THREADS, 0, BUILDER_MAX_THREADS, count);
+#endif
+	if (count <= 0) return;
+
+	builder_ctxs     = (struct BuilderContext*)Mem_AllocCleared(count, sizeof(struct BuilderContext), "builder contexts");
+	builder_mutex    = Mutex_Create();
+	builder_waitable = Waitable_Create();
+	Builder_WorkersCount = count;
+
+	for (i = 0; i < count; i++) {
+		builder_threads[i] = Thread_Start(Builder_WorkerFunc, false);
+	}
+}
+
+static void Builder_StopWorkers(void) {
+	int i;
+	if (!Builder_WorkersCount) return;
+
+	builder_quit = true;
+	Waitable_Signal(builder_waitable);
+	for (i = 0; i < Builder_WorkersCount; i++) {
+		Thread_Join(builder_threads[i]);
+	}
+
+	JobQueue_Free(&builder_pending);
+	JobQueue_Free(&builder_finished);
+	JobQueue_Free(&builder_measured);
+	JobQueue_Free(&builder_free);
+	Mutex_Free(builder_mutex);
+	Waitable_Free(builder_waitable);
+	Mem_Free(builder_ctxs);
+	Builder_WorkersCount = 0;
 }
 
 
 /*########################################################################################################################*
 *---------------------------------------------------Builder interface-----------------------------------------------------*
 *#########################################################################################################################*/
-cc_bool Builder_SmoothLighting;
+cc_bool Builder_SmoothLighting, Builder_GreedyMeshing;
 void Builder_ApplyActive(void) {
 	if (Builder_SmoothLighting) {
 		AdvBuilder_SetActive();
@@ -1272,6 +1994,137 @@ void Builder_ApplyActive(void) {
 	}
 }
 
+/* Maximum number of chunks being measured at once on each builder thread */
+#define MEASURE_JOBS_PER_THREAD 32
+/* Maximum number of chunks measured every tick when there are no builder threads */
+#define MEASURE_CHUNKS_PER_TICK 4
+
+static cc_bool measure_active, measure_addedTask;
+static int measure_x, measure_y, measure_z;
+/* Number of measuring jobs queued on the builder threads that have not been collected yet */
+static int measure_jobs, measure_generation;
+static struct BuilderStats measure_normal, measure_greedy;
+static BuilderStatsCallback measure_callback;
+
+cc_bool Builder_IsMeasuring(void) { return measure_active; }
+
+/* Gets the coordinates of the next chunk to measure, returning false once all chunks have been measured */
+static cc_bool MeasureStats_NextChunk(int* x, int* y, int* z) {
+	if (measure_y >= World.Height) return false;
+	*x = measure_x; *y = measure_y; *z = measure_z;
+
+	measure_x += CHUNK_SIZE;
+	if (measure_x < World.Width)  return true;
+	measure_x  = 0; measure_z += CHUNK_SIZE;
+	if (measure_z < World.Length) return true;
+	measure_z  = 0; measure_y += CHUNK_SIZE;
+	return true;
+}
+
+static void MeasureStats_Add(struct BuilderStats* dst, struct BuilderStats* src) {
+	dst->chunks    += src->chunks;
+	dst->vertices  += src->vertices;
+	dst->buildTime += src->buildTime;
+}
+
+static void MeasureStats_Cancel(void) {
+	measure_active = false;
+	measure_jobs   = 0;
+	measure_callback(NULL, NULL);
+}
+
+/* Adds up the results of measuring jobs the builder threads have finished */
+static void MeasureStats_CollectJobs(void) {
+	struct BuilderJob* job;
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		{
+			job = JobQueue_Pop(&builder_measured);
+		}
+		Mutex_Unlock(builder_mutex);
+		if (!job) return;
+
+		/* Results of cancelled jobs are simply discarded */
+		if (measure_active && job->generation == measure_generation) {
+			MeasureStats_Add(&measure_normal, &job->normal);
+			MeasureStats_Add(&measure_greedy, &job->greedy);
+			measure_jobs--;
+		}
+		Builder_ReleaseJob(job);
+	}
+}
+
+static void MeasureStats_QueueJobs(void) {
+	int maxJobs = Builder_WorkersCount * MEASURE_JOBS_PER_THREAD;
+	struct BuilderJob* job = NULL;
+	cc_bool allAir;
+	int x, y, z;
+
+	while (measure_jobs < maxJobs && MeasureStats_NextChunk(&x, &y, &z)) {
+		if (!job) job = Builder_AllocJob();
+		if (!ReadChunk(job->chunk, job->heightmap, x, y, z, &allAir)) continue;
+
+		job->info    = NULL;
+		job->packed  = false;
+		job->measure = true;
+		Builder_SubmitJob(job, x, y, z);
+		measure_jobs++;
+		job = NULL;
+	}
+	if (job) Builder_ReleaseJob(job);
+}
+
+static void MeasureStats_MeasureChunks(void) {
+	struct BuilderContext* ctx = &mainCtx;
+	cc_bool allAir;
+	int count = 0, x, y, z;
+
+	ctx->chunk     = mainChunk;
+	ctx->heightmap = mainHeightmap;
+	Builder_GetMode(&ctx->mode);
+
+	while (count < MEASURE_CHUNKS_PER_TICK && MeasureStats_NextChunk(&x, &y, &z)) {
+		if (!ReadChunk(mainChunk, mainHeightmap, x, y, z, &allAir)) continue;
+
+		MeasureChunk(ctx, x, y, z, &measure_normal, &measure_greedy, &mainVertices, &mainVerticesCapacity);
+		count++;
+	}
+}
+
+static void MeasureStats_Tick(struct ScheduledTask* task) {
+	if (Builder_WorkersCount) MeasureStats_CollectJobs();
+	if (!measure_active) return;
+
+	/* Queued jobs were cancelled, because block properties changed or a new map is being loaded */
+	if (measure_generation != builder_generation) { MeasureStats_Cancel(); return; }
+
+	if (Builder_WorkersCount) {
+		MeasureStats_QueueJobs();
+	} else {
+		MeasureStats_MeasureChunks();
+	}
+	if (measure_jobs || measure_y < World.Height) return;
+
+	measure_active = false;
+	measure_callback(&measure_normal, &measure_greedy);
+}
+
+void Builder_MeasureStatsAsync(BuilderStatsCallback callback) {
+	if (measure_active) return;
+	if (!measure_addedTask) {
+		ScheduledTask_Add(GAME_DEF_TICKS, MeasureStats_Tick);
+		measure_addedTask = true;
+	}
+
+	Mem_Set(&measure_normal, 0, sizeof(struct BuilderStats));
+	Mem_Set(&measure_greedy, 0, sizeof(struct BuilderStats));
+	measure_x = 0; measure_y = 0; measure_z = 0;
+	measure_jobs       = 0;
+	measure_generation = builder_generation;
+	measure_callback   = callback;
+	measure_active     = true;
+}
+
 static void Builder_Init(void) {
 	Builder_Offsets[FACE_XMIN] = -1;
 	Builder_Offsets[FACE_XMAX] =  1;
@@ -1281,7 +2134,23 @@ static void Builder_Init(void) {
 	Builder_Offsets[FACE_YMAX] =  EXTCHUNK_SIZE_2;
 
 	if (!Game_ClassicMode) Builder_SmoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
+	Builder_GreedyMeshing = Options_GetBool(OPT_GREEDY_MESHING, false);
+	Builder_VertexLighting = Gfx.VertexLighting;
 	Builder_ApplyActive();
+	Builder_StartWorkers();
+}
+
+static void Builder_Free(void) {
+	Builder_StopWorkers();
+	Mem_Free(mainVertices);
+	mainVertices         = NULL;
+	mainVerticesCapacity = 0;
+	measure_active       = false;
+}
+
+static void Builder_OnNewMap(void) {
+	/* Chunks of the old map can no longer be measured */
+	if (measure_active) MeasureStats_Cancel();
 }
 
 static void Builder_OnNewMapLoaded(void) {
@@ -1291,8 +2160,8 @@ static void Builder_OnNewMapLoaded(void) {
 
 struct IGameComponent Builder_Component = {
 	Builder_Init, /* Init */
-	NULL, /* Free */
+	Builder_Free, /* Free */
 	NULL, /* Reset */
-	NULL, /* OnNewMap */
+	Builder_OnNewMap, /* OnNewMap */
 	Builder_OnNewMapLoaded /* OnNewMapLoaded */
 };
@@ -15,9 +15,57 @@ extern struct IGameComponent Builder_Component;
 extern int Builder_SidesLevel, Builder_EdgeLevel;
 /* Whether smooth/advanced lighting mesh builder is used. */
 extern cc_bool Builder_SmoothLighting;
+/* Whether faces are also merged along the texture V axis, producing rectangles instead of rows. */
+/* NOTE: This requires each 1D atlas to contain only one tile, so uses many more textures. */
+extern cc_bool Builder_GreedyMeshing;
+/* Whether the sun and shadow colours are applied to chunk meshes when drawing, instead of when building. */
+/* When true, chunks don't need to be rebuilt when the sun or shadow colour changes. */
+extern cc_bool Builder_VertexLighting;
 
 /* Builds the mesh of vertices for the given chunk. */
 void Builder_MakeChunk(struct ChunkInfo* info);
 
+/* Number of background threads used to build chunk meshes. (0 if disabled) */
+extern int Builder_WorkersCount;
+/* Copies the blocks around the given chunk, then queues its mesh to be built on a builder thread. */
+/* Returns false if the chunk has no mesh. (e.g. completely air, so there is nothing to build) */
+/* NOTE: The old mesh of the chunk is kept until the new mesh is uploaded. */
+cc_bool Builder_QueueChunk(struct ChunkInfo* info);
+/* Uploads the mesh of a chunk that has finished building on a builder thread. */
+/* Returns the chunk that was uploaded, or NULL if no chunks have finished building. */
+struct ChunkInfo* Builder_UploadChunk(void);
+/* Discards all queued chunks, as well as the results of any chunks currently being built. */
+/* Waits for chunks currently being built to finish, so builder threads are no longer */
+/*  reading block properties once this returns. Cancelled chunks are built again later. */
+void Builder_CancelChunks(void);
+
 void Builder_ApplyActive(void);
+
+/* When Gfx.PackedVertices is supported, chunk meshes use VERTEX_FORMAT_PACKED vertices, which store: */
+/*  positions relative to Builder_PackedOrigin, in 1/BUILDER_PACKED_POS_UNITS of a block */
+/*  U texture coordinates in 1/BUILDER_PACKED_U_UNITS of a tile */
+/*  V texture coordinates in 1/Builder_PackedVUnits() of a tile */
+#define BUILDER_PACKED_POS_UNITS 256
+#define BUILDER_PACKED_U_UNITS   1024
+/* Packed positions are relative to the centre of the 128x128x128 region containing the chunk, */
+/*  so that the meshes of all chunks in a region can be drawn together with the same matrix. */
+#define BUILDER_PACKED_REGION_SHIFT 7
+#define Builder_PackedOrigin(coord) ((((coord) >> BUILDER_PACKED_REGION_SHIFT) << BUILDER_PACKED_REGION_SHIFT) + 64)
+/* Returns the number of units per tile that packed V texture coordinates are stored in. */
+/* NOTE: This depends on the current terrain atlas. */
+int Builder_PackedVUnits(void);
+
+struct BuilderStats {
+	int chunks, vertices;
+	cc_uint64 buildTime; /* in microseconds */
+};
+/* Callback invoked on the main thread once the meshes of all chunks have been measured. */
+/* NOTE: normal and greedy are NULL when measuring was cancelled, due to a new map or block changes. */
+typedef void (*BuilderStatsCallback)(struct BuilderStats* normal, struct BuilderStats* greedy);
+/* Whether the meshes of chunks are currently being measured in the background. */
+cc_bool Builder_IsMeasuring(void);
+/* Builds the meshes of all chunks in the map without uploading them, both with and without greedy meshing. */
+/* Chunks are measured on the builder threads, or a few every tick when there are no builder threads. */
+/* NOTE: Does nothing if the meshes of chunks are already being measured. */
+void Builder_MeasureStatsAsync(BuilderStatsCallback callback);
 #endif
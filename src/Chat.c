@@ -16,6 +16,8 @@
 #include "Utils.h"
 #include "TexturePack.h"
 #include "Options.h"
+#include "Builder.h"
+#include "MapRenderer.h"
 
 static char msgs[10][STRING_SIZE];
 String Chat_Status[4]       = { String_FromArray(msgs[0]), String_FromArray(msgs[1]), String_FromArray(msgs[2]), String_FromArray(msgs[3]) };
@@ -447,6 +449,60 @@ static struct ChatCommand ClearDeniedCommand = {
 	}
 };
 
+static void MeshStatsCommand_Print(const char* name, struct BuilderStats* stats) {
+	int stride = Gfx.PackedVertices ? SIZEOF_VERTEX_PACKED : SIZEOF_VERTEX_TEXTURED;
+	int vramKB = (int)(((cc_uint64)stats->vertices * stride) / 1024);
+	int timeMS = (int)(stats->buildTime / 1000);
+	Chat_Add4("&e%c: &f%i vertices, &e%i &fKB of VRAM, built in &e%i &fms", 
+				name, &stats->vertices, &vramKB, &timeMS);
+}
+
+/* Chunk parts are stored for every chunk and used 1D atlas, and each used 1D atlas is drawn as a separate batch */
+static void MeshStatsCommand_PrintParts(const char* name, int tilesPerAtlas) {
+	int batches = MapRenderer_CountUsedAtlases(tilesPerAtlas);
+	int partsKB = (int)((cc_uint64)MapRenderer_ChunksCount * batches * 2 * sizeof(struct ChunkPartInfo) / 1024);
+	Chat_Add3("&e%c: &f%i &etexture batches, &f%i &eKB of chunk parts", name, &batches, &partsKB);
+}
+
+static void MeshStatsCommand_OnMeasured(struct BuilderStats* normal, struct BuilderStats* greedy) {
+	int saved;
+	if (!normal) {
+		Chat_AddRaw("&e/client meshstats: &cMeasuring was cancelled, as the map or blocks changed."); return;
+	}
+
+	Chat_Add1("&eMeshes of &f%i &echunks:", &normal->chunks);
+	MeshStatsCommand_Print("Current builder", normal);
+	MeshStatsCommand_Print("Greedy meshing", greedy);
+	/* Greedy meshing needs one tile per 1D atlas */
+	MeshStatsCommand_PrintParts("Current builder", Atlas1D_MaxTilesPerAtlas());
+	MeshStatsCommand_PrintParts("Greedy meshing",  1);
+
+	saved = normal->vertices ? 100 - (int)((cc_uint64)greedy->vertices * 100 / normal->vertices) : 0;
+	Chat_Add1("&eGreedy meshing uses &f%i%% &efewer vertices", &saved);
+	if (!Builder_GreedyMeshing) Chat_AddRaw("&eSet gfx-greedymeshing=true in options.txt to enable it");
+}
+
+static void MeshStatsCommand_Execute(const String* args, int argsCount) {
+	if (!World_HasBlocks()) {
+		Chat_AddRaw("&e/client meshstats: &cThere is no map loaded."); return;
+	}
+	if (Builder_IsMeasuring()) {
+		Chat_AddRaw("&e/client meshstats: &cAlready measuring chunk meshes, please wait."); return;
+	}
+
+	Chat_AddRaw("&eMeasuring chunk meshes in the background..");
+	Builder_MeasureStatsAsync(MeshStatsCommand_OnMeasured);
+}
+
+static struct ChatCommand MeshStatsCommand = {
+	"MeshStats", MeshStatsCommand_Execute, false,
+	{
+		"&a/client meshstats",
+		"&eCompares the chunk meshes of the current map with and without greedy meshing.",
+		"&eGreedy meshing needs one texture per tile, so may increase draw calls.",
+	}
+};
+
 
 /*########################################################################################################################*
 *-------------------------------------------------------CuboidCommand-----------------------------------------------------*
@@ -487,6 +543,7 @@ static void CuboidCommand_DoCuboid(void) {
 	toPlace = (BlockID)cuboid_block;
 	if (cuboid_block == -1) toPlace = Inventory_SelectedBlock;
 
+	Game_BeginBlockBatch();
 	for (y = min.Y; y <= max.Y; y++) {
 		for (z = min.Z; z <= max.Z; z++) {
 			for (x = min.X; x <= max.X; x++) {
@@ -494,6 +551,7 @@ static void CuboidCommand_DoCuboid(void) {
 			}
 		}
 	}
+	Game_EndBlockBatch();
 }
 
 static void CuboidCommand_BlockChanged(void* obj, IVec3 coords, BlockID old, BlockID now) {
@@ -608,6 +666,7 @@ static void Chat_Init(void) {
 	Commands_Register(&CuboidCommand);
 	Commands_Register(&TeleportCommand);
 	Commands_Register(&ClearDeniedCommand);
+	Commands_Register(&MeshStatsCommand);
 
 #ifndef CC_BUILD_MINFILES
 	Chat_Logging = Options_GetBool(OPT_CHAT_LOGGING, true);
@@ -229,6 +229,15 @@ typedef struct TextureRec_ { float U1, V1, U2, V2; } TextureRec;
 #endif
 #endif
 
+/* SIMD instruction sets guaranteed to be supported by the target CPU */
+/* NOTE: Code using these must always also provide a plain C fallback */
+#if defined CC_BUILD_NOSIMD
+#elif defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define CC_BUILD_SSE2
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#define CC_BUILD_NEON
+#endif
+
 #ifdef CC_BUILD_D3D9
 typedef void* GfxResourceID;
 #else
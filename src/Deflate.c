@@ -5,6 +5,7 @@
 #include "Stream.h"
 #include "Errors.h"
 #include "Utils.h"
+#include "ExtMath.h"
 
 #define Header_ReadU8(value) if ((res = s->ReadU8(s, &value))) return res;
 /*########################################################################################################################*
@@ -141,9 +142,9 @@ enum INFLATE_STATE_ {
 };
 
 /* Insert next byte into the bit buffer */
-#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (cc_uint32)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
+#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (cc_uint64)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
 /* Retrieves bits from the bit buffer */
-#define Inflate_PeekBits(state, bits) (state->Bits & ((1UL << (bits)) - 1UL))
+#define Inflate_PeekBits(state, bits) ((cc_uint32)state->Bits & ((1UL << (bits)) - 1UL))
 /* Consumes/eats up bits from the bit buffer */
 #define Inflate_ConsumeBits(state, bits) state->Bits >>= (bits); state->NumBits -= (bits);
 /* Aligns bit buffer to be on a byte boundary */
@@ -154,6 +155,18 @@ enum INFLATE_STATE_ {
 #define Inflate_UNSAFE_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { Inflate_GetByte(state); }
 /* Peeks then consumes given bits */
 #define Inflate_ReadBits(state, bitsCount) Inflate_PeekBits(state, bitsCount); Inflate_ConsumeBits(state, bitsCount);
+/* Fills the bit buffer up to at least 56 bits, by inserting the next 8 bytes all at once */
+/* Bits past NumBits are then just the bits of the next byte, so ORing that byte in again later is harmless */
+/* NOTE: There must be at least 8 bytes of input available */
+/* NOTE: Bytes read directly from NextIn skip the bit buffer, so Inflate_ClearExtraBits must be used first */
+#define Inflate_UNSAFE_Refill(state) \
+	state->Bits    |= Inflate_ReadU64(state->NextIn) << state->NumBits;\
+	state->NextIn  += (63 - state->NumBits) >> 3;\
+	state->AvailIn -= (63 - state->NumBits) >> 3;\
+	state->NumBits |= 56;
+
+/* Clears bits past NumBits left behind by Inflate_UNSAFE_Refill */
+#define Inflate_ClearExtraBits(state) state->Bits &= ((cc_uint64)1 << state->NumBits) - 1;
 
 /* Goes to the next state, after having read data of a block */
 #define Inflate_NextBlockState(state) (state->LastBlock ? INFLATE_STATE_DONE : INFLATE_STATE_HEADER)
@@ -162,8 +175,35 @@ enum INFLATE_STATE_ {
 /* The maximum amount of bytes that can be output is 258 */
 #define INFLATE_FASTINF_OUT 258
 /* The most input bytes required for huffman codes and extra data is 16 + 5 + 16 + 13 bits. Add 3 extra bytes to account for putting data into the bit buffer. */
+/* (this also ensures the 8 bytes read by Inflate_UNSAFE_Refill are always available) */
 #define INFLATE_FASTINF_IN 10
 
+/* Huffman table entries are packed as: bits 0-8 value, bits 9-12 codeword length (only in Fast table), */
+/*  bits 13-16 number of extra bits, and bits 17-31 base length/distance the extra bits are added to */
+#define Huffman_MakeEntry(value, len, extra, base) ((value) | ((len) << 9) | ((extra) << 13) | ((cc_uint32)(base) << 17))
+#define Huffman_Value(entry) ((entry) & 0x1FF)
+#define Huffman_Len(entry)   (((entry) >>  9) & 0x0F)
+#define Huffman_Extra(entry) (((entry) >> 13) & 0x0F)
+#define Huffman_Base(entry)  ((entry) >> 17)
+
+/* Reads 8 bytes of little endian data, which may be unaligned */
+static CC_INLINE cc_uint64 Inflate_ReadU64(const cc_uint8* data) {
+#if defined __GNUC__ && !defined CC_BIG_ENDIAN
+	cc_uint64 value;
+	__builtin_memcpy(&value, data, 8);
+	return value;
+#else
+	return (cc_uint64)Stream_GetU32_LE(data) | ((cc_uint64)Stream_GetU32_LE(data + 4) << 32);
+#endif
+}
+
+/* Copies 8 bytes, which may be unaligned */
+#ifdef __GNUC__
+#define Inflate_Copy8(dst, src) __builtin_memcpy(dst, src, 8)
+#else
+#define Inflate_Copy8(dst, src) Mem_Copy(dst, src, 8)
+#endif
+
 static cc_uint32 Huffman_ReverseBits(cc_uint32 n, cc_uint8 bits) {
 	n = ((n & 0xAAAA) >> 1) | ((n & 0x5555) << 1);
 	n = ((n & 0xCCCC) >> 2) | ((n & 0x3333) << 2);
@@ -173,7 +213,9 @@ static cc_uint32 Huffman_ReverseBits(cc_uint32 n, cc_uint8 bits) {
 }
 
 /* Builds a huffman tree, based on input lengths of each codeword */
-static void Huffman_Build(struct HuffmanTable* table, const cc_uint8* bitLens, int count) {
+/* If base is non NULL, entries for values from 'first' onwards also store the base and number of extra bits */
+static void Huffman_Build(struct HuffmanTable* table, const cc_uint8* bitLens, int count,
+						const cc_uint16* base, const cc_uint8* extra, int first) {
 	int bl_count[INFLATE_MAX_BITS], bl_offsets[INFLATE_MAX_BITS];
 	int code, offset, value;
 	int i, j;
@@ -227,11 +269,18 @@ static void Huffman_Build(struct HuffmanTable* table, const cc_uint8* bitLens, i
 	*  Some values may also not be assigned to any codeword.
 	*/
 	value = 0;
-	Mem_Set(table->Fast, UInt8_MaxValue, sizeof(table->Fast));
+	Mem_Set(table->Fast, 0, sizeof(table->Fast));
 	for (i = 0; i < count; i++, value++) {
 		int len = bitLens[i];
+		cc_uint32 entry;
 		if (!len) continue;
-		table->Values[bl_offsets[len]] = value;
+
+		if (base && value >= first) {
+			entry = Huffman_MakeEntry(value, 0, extra[value - first], base[value - first]);
+		} else {
+			entry = Huffman_MakeEntry(value, 0, 0, 0);
+		}
+		table->Values[bl_offsets[len]] = entry;
 
 		/* Compute the accelerated lookup table values for this codeword.
 		* For example, assume len = 4 and codeword = 0100
@@ -241,7 +290,7 @@ static void Huffman_Build(struct HuffmanTable* table, const cc_uint8* bitLens, i
 		*   - set fast value to specify a 'value' value, and to skip 'len' bits
 		*/
 		if (len <= INFLATE_FAST_BITS) {
-			cc_int16 packed = (cc_int16)((len << INFLATE_FAST_BITS) | value);
+			cc_uint32 packed = entry | Huffman_MakeEntry(0, len, 0, 0);
 			int codeword = table->FirstCodewords[len] + (bl_offsets[len] - table->FirstOffsets[len]);
 			codeword <<= (INFLATE_FAST_BITS - len);
 
@@ -257,8 +306,8 @@ static void Huffman_Build(struct HuffmanTable* table, const cc_uint8* bitLens, i
 /* Attempts to read the next huffman encoded value from the bitstream, using given table */
 /* Returns -1 if there are insufficient bits to read the value */
 static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table) {
-	cc_uint32 i, j, codeword;
-	int packed, bits, offset;
+	cc_uint32 i, j, codeword, entry;
+	int bits, offset;
 
 	/* Buffer as many bits as possible */
 	while (state->NumBits <= INFLATE_MAX_BITS) {
@@ -268,11 +317,11 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 
 	/* Try fast accelerated table lookup */
 	if (state->NumBits >= INFLATE_FAST_BITS) {
-		packed = table->Fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];
-		if (packed >= 0) {
-			bits = packed >> INFLATE_FAST_BITS;
+		entry = table->Fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];
+		if (entry) {
+			bits = Huffman_Len(entry);
 			Inflate_ConsumeBits(state, bits);
-			return packed & 0x1FF;
+			return Huffman_Value(entry);
 		}
 	}
 
@@ -285,7 +334,7 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 		if (codeword < table->EndCodewords[i]) {
 			offset = table->FirstOffsets[i] + (codeword - table->FirstCodewords[i]);
 			Inflate_ConsumeBits(state, i);
-			return table->Values[offset];
+			return Huffman_Value(table->Values[offset]);
 		}
 	}
 
@@ -293,21 +342,20 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 	return -1;
 }
 
-/* Inline the common <= 9 bits case */
+/* Inline the common <= 11 bits case. Result is the packed table entry. */
+/* NOTE: Bit buffer must already have at least INFLATE_MAX_BITS bits */
 #define Huffman_Unsafe_Decode(state, table, result) \
 {\
-	Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS);\
-	packed = table.Fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
-	if (packed >= 0) {\
-		consumedBits = packed >> INFLATE_FAST_BITS;\
+	result = table.Fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
+	if (result) {\
+		consumedBits = Huffman_Len(result);\
 		Inflate_ConsumeBits(state, consumedBits);\
-		result = packed & 0x1FF;\
 	} else {\
 		result = Huffman_Unsafe_Decode_Slow(state, &table);\
 	}\
 }
 
-static int Huffman_Unsafe_Decode_Slow(struct InflateState* state, struct HuffmanTable* table) {
+static cc_uint32 Huffman_Unsafe_Decode_Slow(struct InflateState* state, struct HuffmanTable* table) {
 	cc_uint32 i, j, codeword;
 	int offset;
 
@@ -326,7 +374,7 @@ static int Huffman_Unsafe_Decode_Slow(struct InflateState* state, struct Huffman
 	}
 
 	Logger_Abort("DEFLATE - Invalid huffman code");
-	return -1;
+	return 0;
 }
 
 void Inflate_Init(struct InflateState* state, struct Stream* source) {
@@ -340,6 +388,9 @@ void Inflate_Init(struct InflateState* state, struct Stream* source) {
 	state->AvailOut = 0;
 	state->Source = source;
 	state->WindowIndex = 0;
+	state->DirectOutput = false;
+	state->DirectLen  = 0;
+	state->OutputBase = NULL;
 }
 
 static const cc_uint8 fixed_lits[INFLATE_MAX_LITS] = {
@@ -381,11 +432,48 @@ static const cc_uint8 codelens_order[INFLATE_MAX_CODELENS] = {
 	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 
 };
 
+/* Copies a back reference within the output, using 8 byte copies when they cannot overlap */
+static void Inflate_CopyMatch(cc_uint8* dst, const cc_uint8* src, cc_uint32 dist, cc_uint32 len) {
+	cc_uint32 i = 0;
+
+	if (dist >= 8) {
+		for (; i + 8 <= len; i += 8) { Inflate_Copy8(dst + i, src + i); }
+	} else if (dist == 1) {
+		/* Very common case for runs of the same byte */
+		Mem_Set(dst, *src, len); return;
+	}
+	for (; i < len; i++) { dst[i] = src[i]; }
+}
+
+/* Copies a back reference, when decompressing directly into the output buffer */
+/* Start of the back reference may be before the output buffer, in which case it is in the window instead */
+static void Inflate_CopyDirect(struct InflateState* state, cc_uint8* dst, cc_uint32 dist, cc_uint32 len) {
+	cc_uint32 i, startIdx, before, produced = (cc_uint32)(dst - state->OutputBase);
+
+	if (dist > produced) {
+		before   = min(len, dist - produced);
+		startIdx = (state->WindowIndex - (dist - produced)) & INFLATE_WINDOW_MASK;
+
+		for (i = 0; i < before; i++) {
+			*dst++ = state->Window[(startIdx + i) & INFLATE_WINDOW_MASK];
+		}
+		len -= before;
+	}
+	Inflate_CopyMatch(dst, dst - dist, dist, len);
+}
+
+/* Decodes the length and distance of a back reference, given its literal/length table entry */
+#define Inflate_UNSAFE_DecodeMatch(state, entry, len, dist) \
+	bits = Huffman_Extra(entry);\
+	len  = Huffman_Base(entry) + Inflate_ReadBits(state, bits);\
+	Huffman_Unsafe_Decode(state, state->TableDists, entry);\
+	bits = Huffman_Extra(entry);\
+	dist = Huffman_Base(entry) + Inflate_ReadBits(state, bits);
+
 static void Inflate_InflateFast(struct InflateState* state) {
 	/* huffman variables */
-	cc_uint32 lit, len, dist;
-	cc_uint32 bits, lenIdx, distIdx;
-	int packed, consumedBits;
+	cc_uint32 entry, lit, len, dist;
+	cc_uint32 bits, consumedBits;
 
 	/* window variables */
 	cc_uint8* window;
@@ -399,7 +487,10 @@ static void Inflate_InflateFast(struct InflateState* state) {
 
 #define INFLATE_FAST_COPY_MAX (INFLATE_WINDOW_SIZE - INFLATE_FASTINF_OUT)
 	while (state->AvailOut >= INFLATE_FASTINF_OUT && state->AvailIn >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
-		Huffman_Unsafe_Decode(state, state->Table.Lits, lit);
+		/* Worst case of lit + length extra + dist + dist extra is 48 bits, so only need to refill once */
+		Inflate_UNSAFE_Refill(state);
+		Huffman_Unsafe_Decode(state, state->Table.Lits, entry);
+		lit = Huffman_Value(entry);
 
 		if (lit <= 256) {
 			if (lit < 256) {
@@ -411,27 +502,13 @@ static void Inflate_InflateFast(struct InflateState* state) {
 				break;
 			}
 		} else {
-			lenIdx = lit - 257;
-			bits = len_bits[lenIdx];
-			Inflate_UNSAFE_EnsureBits(state, bits);
-			len  = len_base[lenIdx] + Inflate_ReadBits(state, bits);
-
-			Huffman_Unsafe_Decode(state, state->TableDists, distIdx);
-			bits = dist_bits[distIdx];
-			Inflate_UNSAFE_EnsureBits(state, bits);
-			dist = dist_base[distIdx] + Inflate_ReadBits(state, bits);
+			Inflate_UNSAFE_DecodeMatch(state, entry, len, dist);
 	
 			/* Window is infinitely repeating like ... [xyz][xyz][xyz] ... */
 			/* If start and end don't cross a boundary, can avoid masking index */
 			startIdx = (curIdx - dist) & INFLATE_WINDOW_MASK;
 			if (curIdx >= startIdx && (curIdx + len) < INFLATE_WINDOW_SIZE) {
-				cc_uint8* src = &window[startIdx]; 
-				cc_uint8* dst = &window[curIdx];
-
-				for (i = 0; i < (len & ~0x3); i += 4) {
-					*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
-				}
-				for (; i < len; i++) { *dst++ = *src++; }
+				Inflate_CopyMatch(&window[curIdx], &window[startIdx], dist, len);
 			} else {
 				for (i = 0; i < len; i++) {
 					window[(curIdx + i) & INFLATE_WINDOW_MASK] = window[(startIdx + i) & INFLATE_WINDOW_MASK];
@@ -457,6 +534,32 @@ static void Inflate_InflateFast(struct InflateState* state) {
 	}
 }
 
+/* Same as Inflate_InflateFast, but decompresses straight into the output buffer (See Inflate_UseDirectOutput) */
+static void Inflate_InflateFastDirect(struct InflateState* state) {
+	cc_uint32 entry, lit, len, dist;
+	cc_uint32 bits, consumedBits;
+	cc_uint8* out = state->Output;
+
+	while (state->AvailOut >= INFLATE_FASTINF_OUT && state->AvailIn >= INFLATE_FASTINF_IN) {
+		Inflate_UNSAFE_Refill(state);
+		Huffman_Unsafe_Decode(state, state->Table.Lits, entry);
+		lit = Huffman_Value(entry);
+
+		if (lit < 256) {
+			*out++ = (cc_uint8)lit;
+			state->AvailOut--;
+		} else if (lit == 256) {
+			state->State = Inflate_NextBlockState(state);
+			break;
+		} else {
+			Inflate_UNSAFE_DecodeMatch(state, entry, len, dist);
+			Inflate_CopyDirect(state, out, dist, len);
+			out += len; state->AvailOut -= len;
+		}
+	}
+	state->Output = out;
+}
+
 void Inflate_Process(struct InflateState* state) {
 	cc_uint32 len, dist, nlen;
 	cc_uint32 i, bits;
@@ -486,8 +589,8 @@ void Inflate_Process(struct InflateState* state) {
 			} break;
 
 			case 1: { /* Fixed/static huffman compressed */
-				Huffman_Build(&state->Table.Lits, fixed_lits,  INFLATE_MAX_LITS);
-				Huffman_Build(&state->TableDists, fixed_dists, INFLATE_MAX_DISTS);
+				Huffman_Build(&state->Table.Lits, fixed_lits,  INFLATE_MAX_LITS,  len_base,  len_bits,  257);
+				Huffman_Build(&state->TableDists, fixed_dists, INFLATE_MAX_DISTS, dist_base, dist_bits, 0);
 				state->State = Inflate_NextCompressState(state);
 			} break;
 
@@ -504,6 +607,8 @@ void Inflate_Process(struct InflateState* state) {
 		}
 
 		case INFLATE_STATE_UNCOMPRESSED_HEADER: {
+			/* Stored data is copied straight from the input, so leftover bits must not be ORed into later */
+			Inflate_ClearExtraBits(state);
 			Inflate_EnsureBits(state, 32);
 			len  = Inflate_ReadBits(state, 16);
 			nlen = Inflate_ReadBits(state, 16);
@@ -519,16 +624,21 @@ void Inflate_Process(struct InflateState* state) {
 			/* read bits left in bit buffer (slow way) */
 			while (state->NumBits && state->AvailOut && state->Index) {
 				*state->Output = Inflate_ReadBits(state, 8);
-				state->Window[state->WindowIndex] = *state->Output;
-
-				state->WindowIndex = (state->WindowIndex + 1) & INFLATE_WINDOW_MASK;
+				if (!state->DirectOutput) {
+					state->Window[state->WindowIndex] = *state->Output;
+					state->WindowIndex = (state->WindowIndex + 1) & INFLATE_WINDOW_MASK;
+				}
 				state->Output++; state->AvailOut--;	state->Index--;
 			}
 			if (!state->AvailIn || !state->AvailOut) return;
 
 			copyLen = min(state->AvailIn, state->AvailOut);
 			copyLen = min(copyLen, state->Index);
-			if (copyLen > 0) {
+			if (copyLen > 0 && state->DirectOutput) {
+				Mem_Copy(state->Output, state->NextIn, copyLen);
+				state->Output += copyLen; state->AvailOut -= copyLen; state->Index -= copyLen;
+				state->NextIn += copyLen; state->AvailIn  -= copyLen;
+			} else if (copyLen > 0) {
 				Mem_Copy(state->Output, state->NextIn, copyLen);
 				windowCopyLen = INFLATE_WINDOW_SIZE - state->WindowIndex;
 				windowCopyLen = min(windowCopyLen, copyLen);
@@ -570,7 +680,7 @@ void Inflate_Process(struct InflateState* state) {
 
 			state->Index = 0;
 			state->State = INFLATE_STATE_DYNAMIC_LITSDISTS;
-			Huffman_Build(&state->Table.CodeLens, state->Buffer, INFLATE_MAX_CODELENS);
+			Huffman_Build(&state->Table.CodeLens, state->Buffer, INFLATE_MAX_CODELENS, NULL, NULL, 0);
 		}
 
 		case INFLATE_STATE_DYNAMIC_LITSDISTS: {
@@ -591,8 +701,8 @@ void Inflate_Process(struct InflateState* state) {
 			if (state->Index == count) {
 				state->Index = 0;
 				state->State = Inflate_NextCompressState(state);
-				Huffman_Build(&state->Table.Lits, state->Buffer, state->NumLits);
-				Huffman_Build(&state->TableDists, &state->Buffer[state->NumLits], state->NumDists);
+				Huffman_Build(&state->Table.Lits, state->Buffer, state->NumLits, len_base, len_bits, 257);
+				Huffman_Build(&state->TableDists, &state->Buffer[state->NumLits], state->NumDists, dist_base, dist_bits, 0);
 			}
 			break;
 		}
@@ -637,8 +747,10 @@ void Inflate_Process(struct InflateState* state) {
 			if (lit < 256) {
 				if (lit == -1) return;
 				*state->Output = (cc_uint8)lit;
-				state->Window[state->WindowIndex] = (cc_uint8)lit;
 				state->Output++; state->AvailOut--;
+				if (state->DirectOutput) break;
+
+				state->Window[state->WindowIndex] = (cc_uint8)lit;
 				state->WindowIndex = (state->WindowIndex + 1) & INFLATE_WINDOW_MASK;
 				break;
 			} else if (lit == 256) {
@@ -677,17 +789,22 @@ void Inflate_Process(struct InflateState* state) {
 			len = state->TmpLit; dist = state->TmpDist;
 			len = min(len, state->AvailOut);
 
-			/* TODO: Should we test outside of the loop, whether a masking will be required or not? */		
-			startIdx = (state->WindowIndex - dist) & INFLATE_WINDOW_MASK;
-			curIdx   = state->WindowIndex;
-			for (i = 0; i < len; i++) {
-				cc_uint8 value = state->Window[(startIdx + i) & INFLATE_WINDOW_MASK];
-				*state->Output = value;
-				state->Window[(curIdx + i) & INFLATE_WINDOW_MASK] = value;
-				state->Output++;
+			if (state->DirectOutput) {
+				Inflate_CopyDirect(state, state->Output, dist, len);
+				state->Output += len;
+			} else {
+				/* TODO: Should we test outside of the loop, whether a masking will be required or not? */
+				startIdx = (state->WindowIndex - dist) & INFLATE_WINDOW_MASK;
+				curIdx   = state->WindowIndex;
+				for (i = 0; i < len; i++) {
+					cc_uint8 value = state->Window[(startIdx + i) & INFLATE_WINDOW_MASK];
+					*state->Output = value;
+					state->Window[(curIdx + i) & INFLATE_WINDOW_MASK] = value;
+					state->Output++;
+				}
+				state->WindowIndex = (curIdx + len) & INFLATE_WINDOW_MASK;
 			}
 
-			state->WindowIndex = (curIdx + len) & INFLATE_WINDOW_MASK;
 			state->TmpLit   -= len;
 			state->AvailOut -= len;
 			if (!state->TmpLit) { state->State = Inflate_NextCompressState(state); }
@@ -695,7 +812,11 @@ void Inflate_Process(struct InflateState* state) {
 		}
 
 		case INFLATE_STATE_FASTCOMPRESSED: {
-			Inflate_InflateFast(state);
+			if (state->DirectOutput) {
+				Inflate_InflateFastDirect(state);
+			} else {
+				Inflate_InflateFast(state);
+			}
 			if (state->State == INFLATE_STATE_FASTCOMPRESSED) {
 				state->State = Inflate_NextCompressState(state);
 			}
@@ -720,6 +841,8 @@ static cc_result Inflate_StreamRead(struct Stream* stream, cc_uint8* data, cc_ui
 	state = (struct InflateState*)stream->Meta.Inflate;
 	state->Output   = data;
 	state->AvailOut = count;
+	/* Previously decompressed data immediately precedes this read's data (See Inflate_UseDirectOutput) */
+	state->OutputBase = data - state->DirectLen;
 
 	hasInput = true;
 	while (state->AvailOut > 0 && hasInput) {
@@ -745,6 +868,8 @@ static cc_result Inflate_StreamRead(struct Stream* stream, cc_uint8* data, cc_ui
 		Inflate_Process(state);
 		*modified += (startAvailOut - state->AvailOut);
 	}
+
+	if (state->DirectOutput) state->DirectLen += *modified;
 	return 0;
 }
 
@@ -755,6 +880,11 @@ void Inflate_MakeStream(struct Stream* stream, struct InflateState* state, struc
 	stream->Read = Inflate_StreamRead;
 }
 
+void Inflate_UseDirectOutput(struct InflateState* state) {
+	state->DirectOutput = true;
+	state->DirectLen    = 0;
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Deflate (compress)----------------------------------------------------*
@@ -771,12 +901,25 @@ static const cc_uint16 deflate_dist[31] = {
 	1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,UInt16_MaxValue
 };
 
+/* Match finding settings for each compression level */
+static const struct DeflateConfig {
+	cc_uint16 maxChain; /* Max number of previous matches to explore */
+	cc_uint16 niceLen;  /* Stop exploring previous matches once a match is at least this long */
+	cc_uint16 lazyLen;  /* Only check for a longer match at next byte if match is shorter than this */
+	cc_bool insertAll;  /* Whether to also insert every byte within a match into the hash chains */
+} deflate_configs[DEFLATE_LEVEL_COUNT] = {
+	{    0,   0,   0, false }, /* DEFLATE_LEVEL_STORE   */
+	{    4,  32,   0, false }, /* DEFLATE_LEVEL_FAST    */
+	{  128, 258, 258, true  }, /* DEFLATE_LEVEL_DEFAULT */
+	{ 4096, 258, 258, true  }  /* DEFLATE_LEVEL_BEST    */
+};
+
 /* Pushes given bits, but does not write them */
 #define Deflate_PushBits(state, value, bits) state->Bits |= (value) << state->NumBits; state->NumBits += (bits);
 /* Pushes bits of the huffman codeword bits for the given literal, but does not write them */
 #define Deflate_PushLit(state, value) Deflate_PushBits(state, state->LitsCodewords[value], state->LitsLens[value])
-/* Pushes given bits (reversing for huffman code), but does not write them */
-#define Deflate_PushHuff(state, value, bits) Deflate_PushBits(state, Huffman_ReverseBits(value, bits), bits)
+/* Pushes bits of the huffman codeword bits for the given distance code, but does not write them */
+#define Deflate_PushDist(state, value) Deflate_PushBits(state, state->DistsCodewords[value], state->DistsLens[value])
 /* Writes given byte to output */
 #define Deflate_WriteByte(state) *state->NextOut++ = state->Bits; state->AvailOut--; state->Bits >>= 8; state->NumBits -= 8;
 /* Flushes bits in buffer to output buffer */
@@ -784,6 +927,12 @@ static const cc_uint16 deflate_dist[31] = {
 
 #define MIN_MATCH_LEN 3
 #define MAX_MATCH_LEN 258
+/* Number of literal/length codes that can actually be used (286 and 287 are reserved) */
+#define DEFLATE_MAX_LITS 286
+/* Number of distance codes that can actually be used (30 and 31 are reserved) */
+#define DEFLATE_MAX_DISTS 30
+#define DEFLATE_MAX_CODEWORD_BITS 15
+#define DEFLATE_MAX_CODELEN_BITS 7
 
 /* Number of bytes that match (are the same) from a and b */
 static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
@@ -794,131 +943,430 @@ static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
 
 /* Hashes 3 bytes of data */
 static cc_uint32 Deflate_Hash(cc_uint8* src) {
-	return (cc_uint32)((src[0] << 8) ^ (src[1] << 4) ^ (src[2])) & DEFLATE_HASH_MASK;
-}
-
-/* Writes a literal to state->Output */
-static void Deflate_Lit(struct DeflateState* state, int lit) {
-	Deflate_PushLit(state, lit);
-	Deflate_FlushBits(state);
+	return (cc_uint32)((src[0] << 10) ^ (src[1] << 5) ^ (src[2])) & DEFLATE_HASH_MASK;
 }
 
-/* Writes a length-distance pair to state->Output */
-static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
+static int Deflate_LenCode(int len) {
 	int j;
-	/* TODO: Do we actually need the if (len_bits[j]) ????????? does writing 0 bits matter??? */
-
 	for (j = 0; len >= deflate_len[j + 1]; j++);
-	Deflate_PushLit(state, j + 257);
-	if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
-	Deflate_FlushBits(state);
+	return j;
+}
 
+static int Deflate_DistCode(int dist) {
+	int j;
 	for (j = 0; dist >= deflate_dist[j + 1]; j++);
-	Deflate_PushHuff(state, j, 5);
-	if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
-	Deflate_FlushBits(state);
+	return j;
 }
 
-/* Moves "current block" to "previous block", adjusting state if needed. */
-static void Deflate_MoveBlock(struct DeflateState* state) {
-	int i;
-	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
-	state->InputPosition = DEFLATE_BLOCK_SIZE;
+/* Inserts the 3 bytes at the given position into the hash chains */
+static void Deflate_Insert(struct DeflateState* state, int pos) {
+	cc_uint32 hash    = Deflate_Hash(&state->Input[pos]);
+	state->Prev[pos]  = state->Head[hash];
+	state->Head[hash] = pos;
+}
 
-	/* adjust hash table offsets, removing offsets that are no longer in data at all */
-	for (i = 0; i < Array_Elems(state->Head); i++) {
-		state->Head[i] = state->Head[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Head[i] - DEFLATE_BLOCK_SIZE);
-	}
-	for (i = 0; i < Array_Elems(state->Prev); i++) {
-		state->Prev[i] = state->Prev[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Prev[i] - DEFLATE_BLOCK_SIZE);
+/* Finds longest previous match for the bytes at the given position */
+/* Returns length of the longest match (less than MIN_MATCH_LEN if no match was found) */
+static int Deflate_LongestMatch(struct DeflateState* state, const struct DeflateConfig* cfg, int cur, int maxLen, int* matchPos) {
+	cc_uint8* input = state->Input;
+	int bestLen = MIN_MATCH_LEN - 1; /* Match must be at least 3 bytes */
+	int pos, depth, matchLen;
+
+	pos = state->Head[Deflate_Hash(&input[cur])];
+	for (depth = 0; pos != 0 && depth < cfg->maxChain; depth++) {
+		/* Quickly skip over matches that cannot be longer than the current best match */
+		if (input[pos + bestLen] == input[cur + bestLen]) {
+			matchLen = Deflate_MatchLen(&input[pos], &input[cur], maxLen);
+
+			if (matchLen > bestLen) {
+				bestLen   = matchLen;
+				*matchPos = pos;
+				if (bestLen >= cfg->niceLen || bestLen == maxLen) break;
+			}
+		}
+		pos = state->Prev[pos];
 	}
+	return bestLen;
 }
 
-/* Compresses current block of data */
-static cc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
-	cc_uint32 hash, nextHash;
-	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
-	cc_uint16 oldHead;
-	cc_uint8* input;
-	cc_uint8* cur;
-	cc_result res;
+/* Adds a literal to the symbols of the current block */
+static void Deflate_AddLit(struct DeflateState* state, int lit) {
+	state->SymLits[state->NumSyms]  = lit;
+	state->SymDists[state->NumSyms] = 0;
+	state->NumSyms++;
+	state->LitFreqs[lit]++;
+}
 
-	if (!state->WroteHeader) {
-		state->WroteHeader = true;
-		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
-	}
+/* Adds a length-distance pair to the symbols of the current block */
+static void Deflate_AddMatch(struct DeflateState* state, int len, int dist) {
+	int lenCode  = Deflate_LenCode(len);
+	int distCode = Deflate_DistCode(dist);
+
+	state->SymLits[state->NumSyms]  = len - MIN_MATCH_LEN;
+	state->SymDists[state->NumSyms] = dist;
+	state->NumSyms++;
+
+	state->LitFreqs[lenCode + 257]++;
+	state->DistFreqs[distCode]++;
+	state->ExtraBits += len_bits[lenCode] + dist_bits[distCode];
+}
+
+/* Converts the current block of data into literals and length-distance pairs */
+static void Deflate_FindMatches(struct DeflateState* state, int len) {
+	const struct DeflateConfig* cfg = &deflate_configs[state->Level];
+	int bestLen, bestPos, nextLen, nextPos;
+	int cur = DEFLATE_BLOCK_SIZE, i;
 
 	/* Based off descriptions from http://www.gzip.org/algorithm.txt and
 	https://github.com/nothings/stb/blob/master/stb_image_write.h */
-	input = state->Input;
-	cur   = input + DEFLATE_BLOCK_SIZE;
-
-	/* Compress current block of data */
 	/* Use > instead of >=, because also try match at one byte after current */
 	while (len > MIN_MATCH_LEN) {
-		hash   = Deflate_Hash(cur);
-		maxLen = min(len, MAX_MATCH_LEN);
-
-		bestLen = MIN_MATCH_LEN - 1; /* Match must be at least 3 bytes */
-		bestPos = 0;
-
-		/* Find longest match starting at this byte */
-		/* Only explore up to 5 previous matches, to avoid slow performance */
-		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
-		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
-			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
-			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
-			pos = state->Prev[pos];
-		}
-
-		/* Insert this entry into the hash chain */
-		pos = (int)(cur - input);
-		oldHead = state->Head[hash];
-		state->Head[hash] = pos;
-		state->Prev[pos]  = oldHead;
+		bestLen = Deflate_LongestMatch(state, cfg, cur, min(len, MAX_MATCH_LEN), &bestPos);
+		Deflate_Insert(state, cur);
 
 		/* Lazy evaluation: Find longest match starting at next byte */
 		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
-			nextHash = Deflate_Hash(cur + 1);
-			nextPos  = state->Head[nextHash];
-			maxLen   = min(len - 1, MAX_MATCH_LEN);
-
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
-				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
-				if (matchLen > bestLen) { bestPos = 0; break; }
-				nextPos = state->Prev[nextPos];
-			}
+		if (bestLen >= MIN_MATCH_LEN && bestLen < cfg->lazyLen) {
+			nextLen = Deflate_LongestMatch(state, cfg, cur + 1, min(len - 1, MAX_MATCH_LEN), &nextPos);
+			if (nextLen > bestLen) bestLen = 0;
 		}
 
-		if (bestPos) {
-			Deflate_LenDist(state, bestLen, pos - bestPos);
-			len -= bestLen; cur += bestLen;
-		} else {
-			Deflate_Lit(state, *cur);
-			len--; cur++;
+		if (bestLen < MIN_MATCH_LEN) {
+			Deflate_AddLit(state, state->Input[cur]);
+			len--; cur++; continue;
 		}
+		Deflate_AddMatch(state, bestLen, cur - bestPos);
 
-		/* leave room for a few bytes and literals at end */
-		if (state->AvailOut >= 20) continue;
-		res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-		state->NextOut  = state->Output;
-		state->AvailOut = DEFLATE_OUT_SIZE;
-		if (res) return res;
+		/* Makes later matches more likely to be found, at the cost of slower compression */
+		if (cfg->insertAll) {
+			for (i = 1; i < bestLen && i + MIN_MATCH_LEN <= len; i++) {
+				Deflate_Insert(state, cur + i);
+			}
+		}
+		len -= bestLen; cur += bestLen;
 	}
 
 	/* literals for last few bytes */
 	while (len > 0) {
-		Deflate_Lit(state, *cur);
+		Deflate_AddLit(state, state->Input[cur]);
 		len--; cur++;
 	}
+}
+
+/* Calculates huffman codeword lengths (limited to maxBits) for the given symbol frequencies */
+static void Deflate_BuildLengths(const cc_uint16* freqs, int count, int maxBits, cc_uint8* lens) {
+	cc_uint16 syms[INFLATE_MAX_LITS];
+	cc_uint32 weights[INFLATE_MAX_LITS * 2];
+	cc_uint16 parents[INFLATE_MAX_LITS * 2];
+	int blCount[INFLATE_MAX_BITS];
+	int i, j, n = 0, leaf, node, next, a, b, sym;
+	cc_uint32 total;
+
+	for (i = 0; i < count; i++) {
+		lens[i] = 0;
+		if (freqs[i]) syms[n++] = i;
+	}
+	/* Always use at least two codewords, as some decoders do not handle a single codeword */
+	for (i = 0; n < 2; i++) {
+		if (!freqs[i]) syms[n++] = i;
+	}
+
+	/* Sort symbols by increasing frequency */
+	for (i = 1; i < n; i++) {
+		sym = syms[i];
+		for (j = i; j > 0 && freqs[syms[j - 1]] > freqs[sym]; j--) { syms[j] = syms[j - 1]; }
+		syms[j] = sym;
+	}
+	for (i = 0; i < n; i++) { weights[i] = freqs[syms[i]]; }
+
+	/* Build huffman tree from the sorted leaves, using a second queue for internal nodes */
+	/* (internal nodes are always created in increasing weight order, so that queue stays sorted too) */
+	leaf = 0; node = n;
+	for (next = n; next < 2 * n - 1; next++) {
+		if (leaf < n && (node >= next || weights[leaf] <= weights[node])) { a = leaf++; } else { a = node++; }
+		if (leaf < n && (node >= next || weights[leaf] <= weights[node])) { b = leaf++; } else { b = node++; }
+
+		weights[next] = weights[a] + weights[b];
+		parents[a] = next; parents[b] = next;
+	}
+
+	/* Calculate depth of every node (root node is last, and parents always come after children) */
+	weights[2 * n - 2] = 0;
+	for (i = 2 * n - 3; i >= 0; i--) { weights[i] = weights[parents[i]] + 1; }
+
+	for (i = 0; i <= maxBits; i++) { blCount[i] = 0; }
+	for (i = 0; i < n; i++) { blCount[min(weights[i], (cc_uint32)maxBits)]++; }
+
+	/* Clamping lengths to maxBits may have oversubscribed the code, so */
+	/* lengthen other codewords until the code is exactly complete again */
+	total = 0;
+	for (i = 1; i <= maxBits; i++) { total += (cc_uint32)blCount[i] << (maxBits - i); }
+
+	while (total != (1UL << maxBits)) {
+		blCount[maxBits]--;
+		for (i = maxBits - 1; i > 0; i--) {
+			if (!blCount[i]) continue;
+			blCount[i]--; blCount[i + 1] += 2; break;
+		}
+		total--;
+	}
+
+	/* Longest codewords go to the least frequent symbols */
+	j = 0;
+	for (i = maxBits; i > 0; i--) {
+		for (a = 0; a < blCount[i]; a++) { lens[syms[j++]] = i; }
+	}
+}
+
+/* Constructs a huffman encoding table (for values to codewords) */
+static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
+	int blCount[INFLATE_MAX_BITS], nextCodeword[INFLATE_MAX_BITS];
+	int i, codeword = 0;
+
+	for (i = 0; i < INFLATE_MAX_BITS; i++) { blCount[i] = 0; }
+	for (i = 0; i < count; i++) { blCount[lens[i]]++; }
+	blCount[0] = 0;
+
+	for (i = 1; i < INFLATE_MAX_BITS; i++) {
+		codeword = (codeword + blCount[i - 1]) << 1;
+		nextCodeword[i] = codeword;
+	}
+
+	for (i = 0; i < count; i++) {
+		bitlens[i]   = lens[i];
+		codewords[i] = lens[i] ? Huffman_ReverseBits(nextCodeword[lens[i]]++, lens[i]) : 0;
+	}
+}
+
+/* Run length encodes the codeword lengths of the literal and distance codes */
+/* Returns number of code length symbols produced */
+static int Deflate_EncodeLengths(const cc_uint8* lens, int count, cc_uint8* syms, cc_uint8* extra) {
+	int i = 0, n = 0, cur, run, rep;
+
+	while (i < count) {
+		cur = lens[i];
+		for (run = 1; i + run < count && lens[i + run] == cur; run++) { }
+		i += run;
+
+		if (!cur) {
+			/* 18 = repeat zero 11-138 times, 17 = repeat zero 3-10 times */
+			while (run >= 11) { rep = min(run, 138); syms[n] = 18; extra[n++] = rep - 11; run -= rep; }
+			if (run >= 3)     { syms[n] = 17; extra[n++] = run - 3; run = 0; }
+		} else {
+			/* 16 = repeat previous length 3-6 times */
+			syms[n] = cur; extra[n++] = 0; run--;
+			while (run >= 3)  { rep = min(run, 6); syms[n] = 16; extra[n++] = rep - 3; run -= rep; }
+		}
+		while (run > 0) { syms[n] = cur; extra[n++] = 0; run--; }
+	}
+	return n;
+}
+
+/* Writes the output buffer to the destination stream, if less than the given number of bytes are left in it */
+static cc_result Deflate_CheckOutput(struct DeflateState* state, cc_uint32 needed) {
+	cc_result res;
+	if (state->AvailOut >= needed) return 0;
 
 	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
 	state->NextOut  = state->Output;
 	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
+}
+
+static cc_result Deflate_WriteStored(struct DeflateState* state, cc_uint8* data, int len) {
+	cc_result res;
+	/* Stored blocks start at next byte boundary */
+	Deflate_FlushBits(state);
+	if (state->NumBits) { Deflate_PushBits(state, 0, 8 - state->NumBits); }
+	Deflate_FlushBits(state);
+
+	Deflate_PushBits(state, len,           16); Deflate_FlushBits(state);
+	Deflate_PushBits(state, len ^ 0xFFFFU, 16); Deflate_FlushBits(state);
+
+	if ((res = Deflate_CheckOutput(state, DEFLATE_OUT_SIZE))) return res;
+	return Stream_Write(state->Dest, data, len);
+}
+
+/* Writes the header describing the dynamic huffman codes */
+static cc_result Deflate_WriteCodes(struct DeflateState* state, int numLits, int numDists, int numCodelens,
+									const cc_uint8* codelens, const cc_uint8* syms, const cc_uint8* extra, int count) {
+	static const cc_uint8 extraBits[3] = { 2, 3, 7 };
+	cc_uint16 codewords[INFLATE_MAX_CODELENS];
+	cc_uint8 bitlens[INFLATE_MAX_CODELENS];
+	cc_result res;
+	int i, sym;
+
+	if ((res = Deflate_CheckOutput(state, 1024))) return res;
+	Deflate_BuildTable(codelens, INFLATE_MAX_CODELENS, codewords, bitlens);
+
+	Deflate_PushBits(state, numLits - 257,  5);
+	Deflate_PushBits(state, numDists - 1,   5);
+	Deflate_PushBits(state, numCodelens - 4, 4);
+	Deflate_FlushBits(state);
+
+	for (i = 0; i < numCodelens; i++) {
+		Deflate_PushBits(state, codelens[codelens_order[i]], 3);
+		Deflate_FlushBits(state);
+	}
+
+	for (i = 0; i < count; i++) {
+		sym = syms[i];
+		Deflate_PushBits(state, codewords[sym], bitlens[sym]);
+		if (sym >= 16) { Deflate_PushBits(state, extra[i], extraBits[sym - 16]); }
+		Deflate_FlushBits(state);
+	}
+	return 0;
+}
+
+/* Writes the literals and length-distance pairs of the current block */
+static cc_result Deflate_WriteSymbols(struct DeflateState* state) {
+	int i, len, dist, j;
+	cc_result res;
+
+	for (i = 0; i < state->NumSyms; i++) {
+		/* leave room for a few bytes and literals at end */
+		if ((res = Deflate_CheckOutput(state, 20))) return res;
+		dist = state->SymDists[i];
+
+		if (!dist) {
+			Deflate_PushLit(state, state->SymLits[i]);
+			Deflate_FlushBits(state);
+			continue;
+		}
+
+		len = state->SymLits[i] + MIN_MATCH_LEN;
+		j   = Deflate_LenCode(len);
+		Deflate_PushLit(state, j + 257);
+		Deflate_PushBits(state, len - deflate_len[j], len_bits[j]);
+		Deflate_FlushBits(state);
+
+		j = Deflate_DistCode(dist);
+		Deflate_PushDist(state, j);
+		Deflate_FlushBits(state);
+		Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]);
+		Deflate_FlushBits(state);
+	}
+
+	/* Write huffman encoded "literal 256" to terminate symbols */
+	if ((res = Deflate_CheckOutput(state, 20))) return res;
+	Deflate_PushLit(state, 256);
+	Deflate_FlushBits(state);
+	return 0;
+}
 
+/* Writes current block using whichever of stored, fixed huffman, or dynamic huffman is smallest */
+static cc_result Deflate_WriteBlock(struct DeflateState* state, cc_uint8* data, int len, cc_bool final) {
+	cc_uint8 lens[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint8 syms[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint8 extra[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint16 codelenFreqs[INFLATE_MAX_CODELENS];
+	cc_uint8 codelens[INFLATE_MAX_CODELENS];
+	cc_uint32 dynamicBits, fixedBits, storedBits;
+	int i, count, numLits, numDists, numCodelens;
+	cc_uint8* distLens;
+	cc_result res;
+
+	state->LitFreqs[256]++; /* end of block symbol */
+	distLens = lens + DEFLATE_MAX_LITS;
+	Deflate_BuildLengths(state->LitFreqs,  DEFLATE_MAX_LITS,  DEFLATE_MAX_CODEWORD_BITS, lens);
+	Deflate_BuildLengths(state->DistFreqs, DEFLATE_MAX_DISTS, DEFLATE_MAX_CODEWORD_BITS, distLens);
+
+	for (numLits  = DEFLATE_MAX_LITS;  numLits  > 257 && !lens[numLits - 1];      numLits--)  { }
+	for (numDists = DEFLATE_MAX_DISTS; numDists > 1   && !distLens[numDists - 1]; numDists--) { }
+	/* Literal and distance codeword lengths are encoded as one sequence */
+	for (i = 0; i < numDists; i++) { lens[numLits + i] = distLens[i]; }
+	count = Deflate_EncodeLengths(lens, numLits + numDists, syms, extra);
+
+	for (i = 0; i < INFLATE_MAX_CODELENS; i++) { codelenFreqs[i] = 0; }
+	for (i = 0; i < count; i++) { codelenFreqs[syms[i]]++; }
+	Deflate_BuildLengths(codelenFreqs, INFLATE_MAX_CODELENS, DEFLATE_MAX_CODELEN_BITS, codelens);
+	for (numCodelens = INFLATE_MAX_CODELENS; numCodelens > 4 && !codelens[codelens_order[numCodelens - 1]]; numCodelens--) { }
+
+	/* Calculate how many bits each type of block would need */
+	dynamicBits = 3 + 14 + numCodelens * 3 + state->ExtraBits;
+	fixedBits   = 3 + state->ExtraBits;
+	storedBits  = 3 + 7 + 32 + len * 8;
+
+	for (i = 0; i < INFLATE_MAX_CODELENS; i++) {
+		dynamicBits += codelenFreqs[i] * codelens[i];
+	}
+	for (i = 0; i < count; i++) {
+		if (syms[i] >= 16) dynamicBits += syms[i] == 16 ? 2 : (syms[i] == 17 ? 3 : 7);
+	}
+	for (i = 0; i < DEFLATE_MAX_LITS; i++) {
+		dynamicBits += state->LitFreqs[i] * (i < numLits ? lens[i] : 0);
+		fixedBits   += state->LitFreqs[i] * fixed_lits[i];
+	}
+	for (i = 0; i < DEFLATE_MAX_DISTS; i++) {
+		dynamicBits += state->DistFreqs[i] * (i < numDists ? lens[numLits + i] : 0);
+		fixedBits   += state->DistFreqs[i] * fixed_dists[i];
+	}
+
+	if ((res = Deflate_CheckOutput(state, 20))) return res;
+	/* No symbols are found for store level, so it must always use stored blocks */
+	/* (Can't use stored blocks when symbols from earlier input are in the block too, as that input isn't in data) */
+	if (state->Level == DEFLATE_LEVEL_STORE || 
+			(state->BlockLen == len && storedBits <= fixedBits && storedBits <= dynamicBits)) {
+		Deflate_PushBits(state, final, 3); /* block type STORED */
+		return Deflate_WriteStored(state, data, len);
+	}
+
+	if (dynamicBits < fixedBits) {
+		Deflate_PushBits(state, final | (2 << 1), 3); /* block type DYNAMIC */
+		res = Deflate_WriteCodes(state, numLits, numDists, numCodelens, codelens, syms, extra, count);
+		if (res) return res;
+
+		Deflate_BuildTable(lens,           numLits,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(lens + numLits, numDists, state->DistsCodewords, state->DistsLens);
+	} else {
+		Deflate_PushBits(state, final | (1 << 1), 3); /* block type FIXED */
+		Deflate_BuildTable(fixed_lits,  INFLATE_MAX_LITS,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(fixed_dists, INFLATE_MAX_DISTS, state->DistsCodewords, state->DistsLens);
+	}
+	return Deflate_WriteSymbols(state);
+}
+
+/* Moves "current block" to "previous block", adjusting state if needed. */
+static void Deflate_MoveBlock(struct DeflateState* state) {
+	int i;
+	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
+	state->InputPosition = DEFLATE_BLOCK_SIZE;
+
+	/* adjust hash table offsets, removing offsets that are no longer in data at all */
+	for (i = 0; i < Array_Elems(state->Head); i++) {
+		state->Head[i] = state->Head[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Head[i] - DEFLATE_BLOCK_SIZE);
+	}
+	/* chain entries for current block become the entries for previous block */
+	for (i = 0; i < DEFLATE_BLOCK_SIZE; i++) {
+		cc_uint16 prev = state->Prev[i + DEFLATE_BLOCK_SIZE];
+		state->Prev[i] = prev < DEFLATE_BLOCK_SIZE ? 0 : (prev - DEFLATE_BLOCK_SIZE);
+	}
+}
+
+/* Compresses current block of data */
+/* NOTE: len is less than DEFLATE_BLOCK_SIZE only for the last block of data */
+static cc_result Deflate_FlushBlock(struct DeflateState* state, int len, cc_bool final) {
+	cc_result res;
+	/* Stored blocks don't need to find matches at all */
+	if (state->Level != DEFLATE_LEVEL_STORE) Deflate_FindMatches(state, len);
+	state->BlockLen += len;
+
+	/* Very compressible data (e.g. long runs of the same block) only needs a few symbols, so the */
+	/*  symbols of following data are added to the same block, rather than writing many small blocks */
+	/*  (as each dynamic block has to start with its own set of huffman codeword lengths) */
+	if (final || len < DEFLATE_BLOCK_SIZE || state->Level == DEFLATE_LEVEL_STORE
+			|| state->NumSyms > DEFLATE_MAX_SYMS - DEFLATE_BLOCK_SIZE) {
+		res = Deflate_WriteBlock(state, state->Input + DEFLATE_BLOCK_SIZE, len, final);
+		if (res) return res;
+
+		state->NumSyms   = 0;
+		state->ExtraBits = 0;
+		state->BlockLen  = 0;
+		Mem_Set(state->LitFreqs,  0, sizeof(state->LitFreqs));
+		Mem_Set(state->DistFreqs, 0, sizeof(state->DistFreqs));
+	}
+
+	res = Deflate_CheckOutput(state, DEFLATE_OUT_SIZE);
 	Deflate_MoveBlock(state);
 	return res;
 }
@@ -945,25 +1393,36 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 		data += len;
 
 		if (state->InputPosition == DEFLATE_BUFFER_SIZE) {
-			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
+			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE, false);
 			if (res) return res;
 		}
 	}
 	return 0;
 }
 
-/* Flushes any buffered data, then writes terminating symbol */
-static cc_result Deflate_StreamClose(struct Stream* stream) {
-	struct DeflateState* state;
-	cc_result res;
+/* Primes the compressor with the given data (at most DEFLATE_BLOCK_SIZE bytes), so matches can refer back to it */
+static void Deflate_SetDictionary(struct DeflateState* state, const cc_uint8* data, int len) {
+	int i, beg = DEFLATE_BLOCK_SIZE - len;
+	Mem_Copy(state->Input + beg, data, len);
 
-	state = (struct DeflateState*)stream->Meta.Inflate;
-	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
-	if (res) return res;
+	/* Last 2 bytes can't be hashed yet, as that needs bytes from the first block */
+	for (i = beg; i < DEFLATE_BLOCK_SIZE - 2; i++) { Deflate_Insert(state, i); }
+}
 
-	/* Write huffman encoded "literal 256" to terminate symbols */
-	Deflate_PushLit(state, 256);
-	Deflate_FlushBits(state);
+/* Compresses any buffered data, then writes all the compressed output to the destination stream */
+/* If not final, output is instead ended with an empty stored block, so that it ends on a byte boundary */
+static cc_result Deflate_Finish(struct DeflateState* state, cc_bool final) {
+	int len = state->InputPosition - DEFLATE_BLOCK_SIZE;
+	cc_result res;
+
+	if (len || final || state->NumSyms) {
+		if ((res = Deflate_FlushBlock(state, len, final))) return res;
+	}
+	if (!final) {
+		if ((res = Deflate_CheckOutput(state, 20))) return res;
+		Deflate_PushBits(state, 0, 3); /* block type STORED */
+		if ((res = Deflate_WriteStored(state, NULL, 0))) return res;
+	}
 
 	/* In case last byte still has a few extra bits */
 	if (state->NumBits) {
@@ -974,23 +1433,10 @@ static cc_result Deflate_StreamClose(struct Stream* stream) {
 	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
 }
 
-/* Constructs a huffman encoding table (for values to codewords) */
-static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
-	int i, j, offset, codeword;
-	struct HuffmanTable table;
-
-	Huffman_Build(&table, lens, count);
-	for (i = 0; i < INFLATE_MAX_BITS; i++) {
-		if (!table.EndCodewords[i]) continue;
-		count = table.EndCodewords[i] - table.FirstCodewords[i];
-
-		for (j = 0; j < count; j++) {
-			offset   = table.Values[table.FirstOffsets[i] + j];
-			codeword = table.FirstCodewords[i] + j;
-			bitlens[offset]   = i;
-			codewords[offset] = Huffman_ReverseBits(codeword, i);
-		}
-	}
+/* Flushes any buffered data as the final block */
+static cc_result Deflate_StreamClose(struct Stream* stream) {
+	struct DeflateState* state = (struct DeflateState*)stream->Meta.Inflate;
+	return Deflate_Finish(state, true);
 }
 
 void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
@@ -1007,11 +1453,15 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 	state->NextOut  = state->Output;
 	state->AvailOut = DEFLATE_OUT_SIZE;
 	state->Dest     = underlying;
-	state->WroteHeader = false;
+	state->Level    = DEFLATE_LEVEL_DEFAULT;
 
+	state->NumSyms   = 0;
+	state->ExtraBits = 0;
+	state->BlockLen  = 0;
+	Mem_Set(state->LitFreqs,  0, sizeof(state->LitFreqs));
+	Mem_Set(state->DistFreqs, 0, sizeof(state->DistFreqs));
 	Mem_Set(state->Head, 0, sizeof(state->Head));
 	Mem_Set(state->Prev, 0, sizeof(state->Prev));
-	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
 }
 
 
@@ -1062,6 +1512,344 @@ void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stre
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------GZip (parallel compress)-------------------------------------------------*
+*#########################################################################################################################*/
+#define PGZIP_CHUNK_SIZE (128 * 1024)
+#define PGZIP_MAX_WORKERS 16
+#define PGZIP_MAX_CHUNKS (PGZIP_MAX_WORKERS * 2)
+enum PGZIP_STATE { PGZIP_FREE, PGZIP_QUEUED, PGZIP_BUSY, PGZIP_DONE };
+
+struct PGZipChunk {
+	cc_uint8* Input;    /* Dictionary (end of previous chunk's data), followed by this chunk's data */
+	cc_uint32 DictLen;  /* Number of bytes of dictionary data, just before Input + DEFLATE_BLOCK_SIZE */
+	cc_uint32 DataLen;  /* Number of bytes of this chunk's data, starting at Input + DEFLATE_BLOCK_SIZE */
+	cc_uint8* Output;   /* Compressed output of this chunk */
+	cc_uint32 OutputLen, OutputCapacity;
+	cc_uint32 Crc32;    /* CRC32 of this chunk's data */
+	cc_result Result;
+	cc_bool Final;
+	volatile int State;
+};
+
+static struct PGZipChunk pgzip_chunks[PGZIP_MAX_CHUNKS];
+static struct DeflateState* pgzip_states;
+static void* pgzip_threads[PGZIP_MAX_WORKERS];
+static int pgzip_workers, pgzip_chunksCount, pgzip_statesUsed;
+static int pgzip_level;
+static void* pgzip_mutex;
+static void* pgzip_workWaitable;
+static void* pgzip_doneWaitable;
+static volatile cc_bool pgzip_quit;
+
+static struct Stream* pgzip_dest;
+static int pgzip_fill, pgzip_oldest; /* Chunk being filled by writer, and next chunk to be written to output */
+static cc_uint32 pgzip_crc32, pgzip_size;
+static cc_bool pgzip_wroteHeader;
+
+static cc_uint32 Crc32_Gf2Times(const cc_uint32* mat, cc_uint32 vec) {
+	cc_uint32 sum = 0;
+	for (; vec; vec >>= 1, mat++) {
+		if (vec & 1) sum ^= *mat;
+	}
+	return sum;
+}
+
+static void Crc32_Gf2Square(cc_uint32* square, const cc_uint32* mat) {
+	int i;
+	for (i = 0; i < 32; i++) { square[i] = Crc32_Gf2Times(mat, mat[i]); }
+}
+
+/* Calculates CRC32 of data A followed by data B, from CRC32 of A, CRC32 of B, and length of B */
+/* Based off crc32_combine from zlib */
+static cc_uint32 Crc32_Combine(cc_uint32 crc1, cc_uint32 crc2, cc_uint32 len2) {
+	cc_uint32 even[32], odd[32], row = 1;
+	int i;
+	if (!len2) return crc1;
+
+	/* Operator for one zero bit */
+	odd[0] = 0xEDB88320UL;
+	for (i = 1; i < 32; i++) { odd[i] = row; row <<= 1; }
+	Crc32_Gf2Square(even, odd); /* operator for two zero bits */
+	Crc32_Gf2Square(odd, even); /* operator for four zero bits */
+
+	/* Apply len2 zero bytes to crc1 (first square puts operator for one zero byte in even) */
+	for (;;) {
+		Crc32_Gf2Square(even, odd);
+		if (len2 & 1) crc1 = Crc32_Gf2Times(even, crc1);
+		if (!(len2 >>= 1)) break;
+
+		Crc32_Gf2Square(odd, even);
+		if (len2 & 1) crc1 = Crc32_Gf2Times(odd, crc1);
+		if (!(len2 >>= 1)) break;
+	}
+	return crc1 ^ crc2;
+}
+
+static cc_result PGZip_OutputWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	struct PGZipChunk* chunk = (struct PGZipChunk*)stream->Meta.Inflate;
+	cc_uint32 capacity = chunk->OutputCapacity;
+	cc_uint8* output;
+
+	if (chunk->OutputLen + count > capacity) {
+		while (chunk->OutputLen + count > capacity) capacity = capacity ? capacity * 2 : PGZIP_CHUNK_SIZE / 2;
+		output = (cc_uint8*)Mem_TryRealloc(chunk->Output, capacity, 1);
+		if (!output) return ERR_OUT_OF_MEMORY;
+
+		chunk->Output         = output;
+		chunk->OutputCapacity = capacity;
+	}
+
+	Mem_Copy(chunk->Output + chunk->OutputLen, data, count);
+	chunk->OutputLen += count;
+	*modified = count;
+	return 0;
+}
+
+/* Compresses a chunk of data into raw DEFLATE data, that can be concatenated with the other chunks */
+static void PGZip_CompressChunk(struct DeflateState* state, struct PGZipChunk* chunk) {
+	cc_uint8* data = chunk->Input + DEFLATE_BLOCK_SIZE;
+	cc_uint32 i, crc32 = 0xFFFFFFFFUL;
+	struct Stream stream, output;
+	cc_result res;
+
+	for (i = 0; i < chunk->DataLen; i++) {
+		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
+	}
+	chunk->Crc32 = crc32 ^ 0xFFFFFFFFUL;
+
+	Stream_Init(&output);
+	output.Meta.Inflate = chunk;
+	output.Write        = PGZip_OutputWrite;
+	chunk->OutputLen    = 0;
+
+	Deflate_MakeStream(&stream, state, &output);
+	state->Level = pgzip_level;
+	Deflate_SetDictionary(state, data - chunk->DictLen, chunk->DictLen);
+
+	res = Stream_Write(&stream, data, chunk->DataLen);
+	if (!res) res = Deflate_Finish(state, chunk->Final);
+	chunk->Result = res;
+}
+
+static void PGZip_WorkerFunc(void) {
+	struct DeflateState* state;
+	struct PGZipChunk* chunk;
+	int i, queued;
+
+	Mutex_Lock(pgzip_mutex);
+	{
+		state = &pgzip_states[pgzip_statesUsed++];
+	}
+	Mutex_Unlock(pgzip_mutex);
+
+	for (;;) {
+		chunk = NULL; queued = 0;
+		Mutex_Lock(pgzip_mutex);
+		{
+			/* Prefer compressing the chunks that will be written to output soonest */
+			for (i = 0; i < pgzip_chunksCount; i++) {
+				struct PGZipChunk* c = &pgzip_chunks[(pgzip_oldest + i) % pgzip_chunksCount];
+				if (c->State != PGZIP_QUEUED) continue;
+
+				if (!chunk) { chunk = c; chunk->State = PGZIP_BUSY; } else { queued++; }
+			}
+		}
+		Mutex_Unlock(pgzip_mutex);
+
+		if (!chunk) {
+			/* Wake up the next worker thread too, since signals may have been coalesced */
+			if (pgzip_quit) { Waitable_Signal(pgzip_workWaitable); return; }
+			Waitable_Wait(pgzip_workWaitable);
+			continue;
+		}
+		if (queued) Waitable_Signal(pgzip_workWaitable);
+
+		PGZip_CompressChunk(state, chunk);
+		Mutex_Lock(pgzip_mutex);
+		{
+			chunk->State = PGZIP_DONE;
+		}
+		Mutex_Unlock(pgzip_mutex);
+		Waitable_Signal(pgzip_doneWaitable);
+	}
+}
+
+/* Waits for the oldest chunk to be compressed, then writes it to the output */
+static cc_result PGZip_WriteOldest(void) {
+	static cc_uint8 header[10] = { 0x1F, 0x8B, 0x08 }; /* GZip header */
+	struct PGZipChunk* chunk = &pgzip_chunks[pgzip_oldest];
+	cc_bool done;
+	cc_result res;
+
+	for (;;) {
+		Mutex_Lock(pgzip_mutex);
+		{
+			done = chunk->State == PGZIP_DONE;
+		}
+		Mutex_Unlock(pgzip_mutex);
+
+		if (done) break;
+		Waitable_Wait(pgzip_doneWaitable);
+	}
+
+	Mutex_Lock(pgzip_mutex);
+	{
+		chunk->State = PGZIP_FREE;
+		pgzip_oldest = (pgzip_oldest + 1) % pgzip_chunksCount;
+	}
+	Mutex_Unlock(pgzip_mutex);
+	if (chunk->Result) return chunk->Result;
+
+	if (!pgzip_wroteHeader) {
+		if ((res = Stream_Write(pgzip_dest, header, sizeof(header)))) return res;
+		pgzip_wroteHeader = true;
+	}
+
+	pgzip_crc32 = Crc32_Combine(pgzip_crc32, chunk->Crc32, chunk->DataLen);
+	pgzip_size += chunk->DataLen;
+	return Stream_Write(pgzip_dest, chunk->Output, chunk->OutputLen);
+}
+
+/* Queues the chunk being filled to be compressed, then moves onto the next chunk */
+static cc_result PGZip_SubmitChunk(cc_bool final) {
+	struct PGZipChunk* chunk = &pgzip_chunks[pgzip_fill];
+	struct PGZipChunk* next;
+	cc_result res;
+	chunk->Final = final;
+
+	if (!pgzip_workers) {
+		PGZip_CompressChunk(&pgzip_states[0], chunk);
+		chunk->State = PGZIP_DONE;
+	} else {
+		Mutex_Lock(pgzip_mutex);
+		{
+			chunk->State = PGZIP_QUEUED;
+		}
+		Mutex_Unlock(pgzip_mutex);
+		Waitable_Signal(pgzip_workWaitable);
+	}
+
+	pgzip_fill = (pgzip_fill + 1) % pgzip_chunksCount;
+	if (final) return 0;
+	next = &pgzip_chunks[pgzip_fill];
+
+	/* All chunks are in use, so need to wait for the oldest one to finish */
+	if (next->State != PGZIP_FREE) {
+		if ((res = PGZip_WriteOldest())) return res;
+	}
+
+	/* Dictionary is last DEFLATE_BLOCK_SIZE bytes of previous chunk's data */
+	/* (previous chunk is only read from by worker threads, so it's safe to copy from) */
+	next->DictLen = DEFLATE_BLOCK_SIZE;
+	next->DataLen = 0;
+	Mem_Copy(next->Input, chunk->Input + chunk->DataLen, DEFLATE_BLOCK_SIZE);
+	return 0;
+}
+
+static cc_result PGZip_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	struct PGZipChunk* chunk;
+	cc_uint32 len;
+	cc_result res;
+	*modified = 0;
+
+	while (count) {
+		chunk = &pgzip_chunks[pgzip_fill];
+		len   = min(count, PGZIP_CHUNK_SIZE - chunk->DataLen);
+
+		Mem_Copy(chunk->Input + DEFLATE_BLOCK_SIZE + chunk->DataLen, data, len);
+		chunk->DataLen += len;
+		*modified += len;
+		data      += len;
+		count     -= len;
+
+		if (chunk->DataLen < PGZIP_CHUNK_SIZE) break;
+		if ((res = PGZip_SubmitChunk(false))) return res;
+	}
+	return 0;
+}
+
+static void PGZip_Free(void) {
+	int i;
+	pgzip_quit = true;
+	Waitable_Signal(pgzip_workWaitable);
+	for (i = 0; i < pgzip_workers; i++) { Thread_Join(pgzip_threads[i]); }
+
+	Mutex_Free(pgzip_mutex);
+	Waitable_Free(pgzip_workWaitable);
+	Waitable_Free(pgzip_doneWaitable);
+
+	for (i = 0; i < pgzip_chunksCount; i++) {
+		Mem_Free(pgzip_chunks[i].Input);
+		Mem_Free(pgzip_chunks[i].Output);
+		pgzip_chunks[i].Output = NULL;
+	}
+	Mem_Free(pgzip_states);
+	pgzip_states       = NULL;
+	pgzip_workers      = 0;
+	pgzip_chunksCount  = 0;
+}
+
+static cc_result PGZip_StreamClose(struct Stream* stream) {
+	cc_uint8 data[8];
+	cc_result res;
+
+	res = PGZip_SubmitChunk(true);
+	/* Still need to wait for all the queued chunks even on error, as worker threads may be using them */
+	while (pgzip_oldest != pgzip_fill || pgzip_chunks[pgzip_oldest].State != PGZIP_FREE) {
+		cc_result writeRes = PGZip_WriteOldest();
+		if (!res) res = writeRes;
+	}
+	PGZip_Free();
+	if (res) return res;
+
+	Stream_SetU32_LE(&data[0], pgzip_crc32);
+	Stream_SetU32_LE(&data[4], pgzip_size);
+	return Stream_Write(pgzip_dest, data, sizeof(data));
+}
+
+void GZip_MakeParallelStream(struct Stream* stream, struct Stream* underlying, int level) {
+	int i, workers = min(Thread_ProcessorsCount(), PGZIP_MAX_WORKERS);
+	/* Just compress on the calling thread when there's only one processor */
+	if (workers < 2) workers = 0;
+
+	Stream_Init(stream);
+	stream->Write = PGZip_StreamWrite;
+	stream->Close = PGZip_StreamClose;
+
+	pgzip_dest    = underlying;
+	pgzip_level   = level;
+	pgzip_fill    = 0;
+	pgzip_oldest  = 0;
+	pgzip_crc32   = 0;
+	pgzip_size    = 0;
+	pgzip_wroteHeader = false;
+
+	pgzip_chunksCount = max(2, workers * 2);
+	for (i = 0; i < pgzip_chunksCount; i++) {
+		pgzip_chunks[i].Input   = (cc_uint8*)Mem_Alloc(DEFLATE_BLOCK_SIZE + PGZIP_CHUNK_SIZE, 1, "GZip chunk");
+		pgzip_chunks[i].Output  = NULL;
+		pgzip_chunks[i].OutputCapacity = 0;
+		pgzip_chunks[i].State   = PGZIP_FREE;
+		pgzip_chunks[i].DictLen = 0;
+		pgzip_chunks[i].DataLen = 0;
+	}
+
+	pgzip_states     = (struct DeflateState*)Mem_Alloc(max(1, workers), sizeof(struct DeflateState), "GZip states");
+	pgzip_statesUsed = 0;
+	pgzip_workers    = workers;
+
+	pgzip_quit         = false;
+	pgzip_mutex        = Mutex_Create();
+	pgzip_workWaitable = Waitable_Create();
+	pgzip_doneWaitable = Waitable_Create();
+
+	for (i = 0; i < workers; i++) {
+		pgzip_threads[i] = Thread_Start(PGZip_WorkerFunc, false);
+	}
+}
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------ZLib (compress)-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -1113,38 +1901,78 @@ void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stre
 *--------------------------------------------------------ZipEntry---------------------------------------------------------*
 *#########################################################################################################################*/
 #define ZIP_MAXNAMELEN 512
-static cc_result Zip_ReadLocalFileHeader(struct ZipState* state, struct ZipEntry* entry) {
+enum ZipSig {
+	ZIP_SIG_ENDOFCENTRALDIR = 0x06054b50,
+	ZIP_SIG_CENTRALDIR      = 0x02014b50,
+	ZIP_SIG_LOCALFILEHEADER = 0x04034b50
+};
+#define ZIP_CENTRALDIR_SIZE 46
+
+static String Zip_UNSAFE_GetPath(struct ZipState* state, struct ZipEntry* entry) {
+	/* NOTE: ZIP spec says path uses code page 437 for encoding */
+	char* path = (char*)state->_centralDir + entry->_pathOffset;
+	return String_Init(path, entry->_pathLength, entry->_pathLength);
+}
+
+/* Case insensitive hash of a path */
+static cc_uint32 Zip_HashPath(const String* path) {
+	cc_uint32 hash = 2166136261UL;
+	int i;
+	char c;
+
+	for (i = 0; i < path->length; i++) {
+		c = path->buffer[i];
+		Char_MakeLower(c);
+		hash = (hash ^ (cc_uint8)c) * 16777619UL;
+	}
+	return hash;
+}
+
+/* Seeks to the data of the given entry, and reads its compression method and sizes */
+static cc_result Zip_SeekToData(struct ZipState* state, struct ZipEntry* entry,
+								int* method, cc_uint32* compressedSize, cc_uint32* uncompressedSize) {
 	struct Stream* stream = state->input;
 	cc_uint8 header[26];
-	cc_uint32 compressedSize, uncompressedSize;
-	int method, pathLen, extraLen;
-
-	String path; char pathBuffer[ZIP_MAXNAMELEN];
-	struct Stream portion, compStream;
-	struct InflateState inflate;
+	cc_uint32 sig;
+	int pathLen, extraLen;
 	cc_result res;
+
+	res = stream->Seek(stream, entry->LocalHeaderOffset);
+	if (res) return ZIP_ERR_SEEK_LOCAL_DIR;
+
+	if ((res = Stream_ReadU32_LE(stream, &sig))) return res;
+	if (sig != ZIP_SIG_LOCALFILEHEADER) return ZIP_ERR_INVALID_LOCAL_DIR;
 	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
 
-	method           = Stream_GetU16_LE(&header[4]);
-	compressedSize   = Stream_GetU32_LE(&header[14]);
-	uncompressedSize = Stream_GetU32_LE(&header[18]);
+	*method           = Stream_GetU16_LE(&header[4]);
+	*compressedSize   = Stream_GetU32_LE(&header[14]);
+	*uncompressedSize = Stream_GetU32_LE(&header[18]);
 
 	/* Some .zip files don't set these in local file header */
-	if (!compressedSize)   compressedSize   = entry->CompressedSize;
-	if (!uncompressedSize) uncompressedSize = entry->UncompressedSize;
+	if (!(*compressedSize))   *compressedSize   = entry->CompressedSize;
+	if (!(*uncompressedSize)) *uncompressedSize = entry->UncompressedSize;
 
+	/* path is the same as in central directory, and local file may have extra data (e.g. ZIP64) */
 	pathLen  = Stream_GetU16_LE(&header[22]);
 	extraLen = Stream_GetU16_LE(&header[24]);
 	if (pathLen > ZIP_MAXNAMELEN) return ZIP_ERR_FILENAME_LEN;
+	return stream->Skip(stream, pathLen + extraLen);
+}
 
-	/* NOTE: ZIP spec says path uses code page 437 for encoding */
-	path = String_Init(pathBuffer, pathLen, pathLen);	
-	if ((res = Stream_Read(stream, (cc_uint8*)pathBuffer, pathLen))) return res;
-	state->_curEntry = entry;
+cc_result Zip_ExtractEntry(struct ZipState* state, struct ZipEntry* entry) {
+	struct Stream* stream = state->input;
+	cc_uint32 compressedSize, uncompressedSize;
+	int method;
+
+	String path;
+	struct Stream portion, compStream;
+	struct InflateState inflate;
+	cc_result res;
 
-	if (!state->SelectEntry(&path)) return 0;
-	/* local file may have extra data before actual data (e.g. ZIP64) */
-	if ((res = stream->Skip(stream, extraLen))) return res;
+	res = Zip_SeekToData(state, entry, &method, &compressedSize, &uncompressedSize);
+	if (res) return res;
+	path = Zip_UNSAFE_GetPath(state, entry);
+	state->_curEntry = entry;
 
 	if (method == 0) {
 		Stream_ReadonlyPortion(&portion, stream, uncompressedSize);
@@ -1160,40 +1988,49 @@ static cc_result Zip_ReadLocalFileHeader(struct ZipState* state, struct ZipEntry
 	return 0;
 }
 
-static cc_result Zip_ReadCentralDirectory(struct ZipState* state) {
-	struct Stream* stream = state->input;
+static cc_result Zip_ReadCentralDirectory(struct ZipState* state, cc_uint32 size) {
+	cc_uint8* data   = state->_centralDir;
+	cc_uint32 offset = 0;
+	cc_uint8* header;
 	struct ZipEntry* entry;
-	cc_uint8 header[42];
-
-	String path; char pathBuffer[ZIP_MAXNAMELEN];
-	int pathLen, extraLen, commentLen;
-	cc_result res;
-	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
+	cc_uint32 sig, hash;
+	int i, pathLen, extraLen, commentLen;
+	String path;
 
-	pathLen = Stream_GetU16_LE(&header[24]);
-	if (pathLen > ZIP_MAXNAMELEN) return ZIP_ERR_FILENAME_LEN;
+	for (i = 0; i < state->_totalEntries; i++) {
+		if (offset + 4 > size) return ZIP_ERR_INVALID_CENTRAL_DIR;
+		sig = Stream_GetU32_LE(data + offset);
 
-	/* NOTE: ZIP spec says path uses code page 437 for encoding */
-	path = String_Init(pathBuffer, pathLen, pathLen);
-	if ((res = Stream_Read(stream, (cc_uint8*)pathBuffer, pathLen))) return res;
-
-	/* skip data following central directory entry header */
-	extraLen   = Stream_GetU16_LE(&header[26]);
-	commentLen = Stream_GetU16_LE(&header[28]);
-	if ((res = stream->Skip(stream, extraLen + commentLen))) return res;
-
-	if (!state->SelectEntry(&path)) return 0;
-	if (state->_usedEntries >= ZIP_MAX_ENTRIES) return ZIP_ERR_TOO_MANY_ENTRIES;
-	entry = &state->entries[state->_usedEntries++];
-
-	entry->CRC32             = Stream_GetU32_LE(&header[12]);
-	entry->CompressedSize    = Stream_GetU32_LE(&header[16]);
-	entry->UncompressedSize  = Stream_GetU32_LE(&header[20]);
-	entry->LocalHeaderOffset = Stream_GetU32_LE(&header[38]);
+		if (sig == ZIP_SIG_ENDOFCENTRALDIR) break;
+		if (sig != ZIP_SIG_CENTRALDIR || offset + ZIP_CENTRALDIR_SIZE > size) return ZIP_ERR_INVALID_CENTRAL_DIR;
+		header = data + offset + 4;
+
+		pathLen    = Stream_GetU16_LE(&header[24]);
+		extraLen   = Stream_GetU16_LE(&header[26]);
+		commentLen = Stream_GetU16_LE(&header[28]);
+		if (pathLen > ZIP_MAXNAMELEN) return ZIP_ERR_FILENAME_LEN;
+		if (offset + ZIP_CENTRALDIR_SIZE + pathLen > size) return ZIP_ERR_INVALID_CENTRAL_DIR;
+
+		path    = String_Init((char*)data + offset + ZIP_CENTRALDIR_SIZE, pathLen, pathLen);
+		offset += ZIP_CENTRALDIR_SIZE + pathLen + extraLen + commentLen;
+		if (!state->SelectEntry(&path)) continue;
+		entry = &state->entries[state->_usedEntries];
+
+		entry->CRC32             = Stream_GetU32_LE(&header[12]);
+		entry->CompressedSize    = Stream_GetU32_LE(&header[16]);
+		entry->UncompressedSize  = Stream_GetU32_LE(&header[20]);
+		entry->LocalHeaderOffset = Stream_GetU32_LE(&header[38]);
+		entry->_pathOffset       = (cc_uint32)(path.buffer - (char*)data);
+		entry->_pathLength       = pathLen;
+
+		hash = Zip_HashPath(&path) & state->_bucketsMask;
+		entry->_next          = state->_buckets[hash];
+		state->_buckets[hash] = state->_usedEntries++;
+	}
 	return 0;
 }
 
-static cc_result Zip_ReadEndOfCentralDirectory(struct ZipState* state) {
+static cc_result Zip_ReadEndOfCentralDirectory(struct ZipState* state, cc_uint32* size) {
 	struct Stream* stream = state->input;
 	cc_uint8 header[18];
 
@@ -1201,16 +2038,11 @@ static cc_result Zip_ReadEndOfCentralDirectory(struct ZipState* state) {
 	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
 
 	state->_totalEntries  = Stream_GetU16_LE(&header[6]);
+	*size                 = Stream_GetU32_LE(&header[8]);
 	state->_centralDirBeg = Stream_GetU32_LE(&header[12]);
 	return 0;
 }
 
-enum ZipSig {
-	ZIP_SIG_ENDOFCENTRALDIR = 0x06054b50,
-	ZIP_SIG_CENTRALDIR      = 0x02014b50,
-	ZIP_SIG_LOCALFILEHEADER = 0x04034b50
-};
-
 static cc_result Zip_DefaultProcessor(const String* path, struct Stream* data, struct ZipState* s) { return 0; }
 static cc_bool Zip_DefaultSelector(const String* path) { return true; }
 void Zip_Init(struct ZipState* state, struct Stream* input) {
@@ -1218,11 +2050,16 @@ void Zip_Init(struct ZipState* state, struct Stream* input) {
 	state->obj   = NULL;
 	state->ProcessEntry = Zip_DefaultProcessor;
 	state->SelectEntry  = Zip_DefaultSelector;
+	state->PrepareEntry = NULL;
+
+	state->_centralDir = NULL;
+	state->_buckets    = NULL;
+	state->entries     = NULL;
 }
 
-cc_result Zip_Extract(struct ZipState* state) {
+static cc_result Zip_ReadIndexData(struct ZipState* state) {
 	struct Stream* stream = state->input;
-	cc_uint32 stream_len;
+	cc_uint32 stream_len, size;
 	cc_uint32 sig = 0;
 	int i, count;
 
@@ -1240,38 +2077,322 @@ cc_result Zip_Extract(struct ZipState* state) {
 	}
 
 	if (sig != ZIP_SIG_ENDOFCENTRALDIR) return ZIP_ERR_NO_END_OF_CENTRAL_DIR;
-	res = Zip_ReadEndOfCentralDirectory(state);
+	res = Zip_ReadEndOfCentralDirectory(state, &size);
 	if (res) return res;
 
+	/* Read the whole central directory at once, instead of many small reads */
+	if (size > stream_len) return ZIP_ERR_INVALID_CENTRAL_DIR;
+	state->_centralDir  = (cc_uint8*)Mem_TryAlloc(size + 1, 1);
+	count               = Math_NextPowOf2(state->_totalEntries + 1);
+	state->_buckets     = (int*)Mem_TryAlloc(count, sizeof(int));
+	state->_bucketsMask = count - 1;
+	state->entries      = (struct ZipEntry*)Mem_TryAlloc(state->_totalEntries + 1, sizeof(struct ZipEntry));
+	state->_usedEntries = 0;
+
+	if (!state->_centralDir || !state->_buckets || !state->entries) return ERR_OUT_OF_MEMORY;
+	for (i = 0; i < count; i++) { state->_buckets[i] = -1; }
+
 	res = stream->Seek(stream, state->_centralDirBeg);
 	if (res) return ZIP_ERR_SEEK_CENTRAL_DIR;
-	state->_usedEntries = 0;
+	if ((res = Stream_Read(stream, state->_centralDir, size))) return res;
+	return Zip_ReadCentralDirectory(state, size);
+}
 
-	/* Read all the central directory entries */
-	for (i = 0; i < state->_totalEntries; i++) {
-		if ((res = Stream_ReadU32_LE(stream, &sig))) return res;
+cc_result Zip_ReadIndex(struct ZipState* state) {
+	cc_result res = Zip_ReadIndexData(state);
+	if (res) Zip_Free(state);
+	return res;
+}
 
-		if (sig == ZIP_SIG_CENTRALDIR) {
-			res = Zip_ReadCentralDirectory(state);
-			if (res) return res;
-		} else if (sig == ZIP_SIG_ENDOFCENTRALDIR) {
-			break;
+struct ZipEntry* Zip_FindEntry(struct ZipState* state, const String* path) {
+	struct ZipEntry* entry;
+	String entryPath;
+	int i = state->_buckets[Zip_HashPath(path) & state->_bucketsMask];
+
+	for (; i >= 0; i = entry->_next) {
+		entry     = &state->entries[i];
+		entryPath = Zip_UNSAFE_GetPath(state, entry);
+		if (String_CaselessEquals(&entryPath, path)) return entry;
+	}
+	return NULL;
+}
+
+void Zip_Free(struct ZipState* state) {
+	Mem_Free(state->_centralDir);
+	Mem_Free(state->_buckets);
+	Mem_Free(state->entries);
+
+	state->_centralDir = NULL;
+	state->_buckets    = NULL;
+	state->entries     = NULL;
+}
+
+cc_result Zip_Extract(struct ZipState* state) {
+	cc_result res;
+	int i;
+	if ((res = Zip_ReadIndex(state))) return res;
+
+	for (i = 0; i < state->_usedEntries; i++) {
+		if ((res = Zip_ExtractEntry(state, &state->entries[i]))) break;
+	}
+	Zip_Free(state);
+	return res;
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------Zip (parallel extract)--------------------------------------------------*
+*#########################################################################################################################*/
+#define PZIP_MAX_WORKERS 16
+#define PZIP_MAX_SLOTS (PZIP_MAX_WORKERS * 2)
+enum PZIP_STATE { PZIP_FREE, PZIP_QUEUED, PZIP_BUSY, PZIP_DONE };
+
+struct PZipSlot {
+	struct ZipEntry* Entry;
+	int Method;
+	cc_uint8* Input;    /* Compressed data of the entry */
+	cc_uint32 InputLen;
+	cc_uint8* Data;     /* Decompressed (and possibly prepared) data of the entry */
+	cc_uint32 DataLen;
+	cc_result Result;
+	volatile int State;
+};
+
+static struct PZipSlot pzip_slots[PZIP_MAX_SLOTS];
+static struct InflateState* pzip_states;
+static struct ZipState* pzip_zip;
+static void* pzip_threads[PZIP_MAX_WORKERS];
+static int pzip_workers, pzip_slotsCount, pzip_statesUsed;
+static void* pzip_mutex;
+static void* pzip_workWaitable;
+static void* pzip_doneWaitable;
+static volatile cc_bool pzip_quit;
+static int pzip_fill, pzip_oldest; /* Slot to queue next entry in, and slot of next entry to be processed */
+
+/* Decompresses the data of an entry, then prepares it using the PrepareEntry callback */
+static void PZip_DecompressSlot(struct InflateState* inflate, struct PZipSlot* slot) {
+	struct Stream mem, stream;
+	String path;
+	cc_result res = 0;
+
+	if (slot->Method == 0) {
+		slot->Data    = slot->Input;
+		slot->DataLen = slot->InputLen;
+	} else {
+		slot->DataLen = slot->Entry->UncompressedSize;
+		slot->Data    = slot->DataLen ? (cc_uint8*)Mem_TryAlloc(slot->DataLen, 1) : NULL;
+
+		if (slot->DataLen && !slot->Data) {
+			res = ERR_OUT_OF_MEMORY;
 		} else {
-			return ZIP_ERR_INVALID_CENTRAL_DIR;
+			Stream_ReadonlyMemory(&mem, slot->Input, slot->InputLen);
+			Inflate_MakeStream(&stream, inflate, &mem);
+			Inflate_UseDirectOutput(inflate);
+			res = Stream_Read(&stream, slot->Data, slot->DataLen);
 		}
+		Mem_Free(slot->Input);
 	}
+	slot->Input = NULL;
 
-	/* Now read the local file header entries */
-	for (i = 0; i < state->_usedEntries; i++) {
-		struct ZipEntry* entry = &state->entries[i];
-		res = stream->Seek(stream, entry->LocalHeaderOffset);
-		if (res) return ZIP_ERR_SEEK_LOCAL_DIR;
+	if (!res && pzip_zip->PrepareEntry) {
+		path = Zip_UNSAFE_GetPath(pzip_zip, slot->Entry);
+		res  = pzip_zip->PrepareEntry(&path, &slot->Data, &slot->DataLen, pzip_zip);
+	}
+	slot->Result = res;
+}
 
-		if ((res = Stream_ReadU32_LE(stream, &sig))) return res;
-		if (sig != ZIP_SIG_LOCALFILEHEADER) return ZIP_ERR_INVALID_LOCAL_DIR;
+static void PZip_WorkerFunc(void) {
+	struct InflateState* state;
+	struct PZipSlot* slot;
+	int i, queued;
 
-		res = Zip_ReadLocalFileHeader(state, entry);
-		if (res) return res;
+	Mutex_Lock(pzip_mutex);
+	{
+		state = &pzip_states[pzip_statesUsed++];
 	}
+	Mutex_Unlock(pzip_mutex);
+
+	for (;;) {
+		slot = NULL; queued = 0;
+		Mutex_Lock(pzip_mutex);
+		{
+			/* Prefer decompressing the entries that will be processed soonest */
+			for (i = 0; i < pzip_slotsCount; i++) {
+				struct PZipSlot* s = &pzip_slots[(pzip_oldest + i) % pzip_slotsCount];
+				if (s->State != PZIP_QUEUED) continue;
+
+				if (!slot) { slot = s; slot->State = PZIP_BUSY; } else { queued++; }
+			}
+		}
+		Mutex_Unlock(pzip_mutex);
+
+		if (!slot) {
+			/* Wake up the next worker thread too, since signals may have been coalesced */
+			if (pzip_quit) { Waitable_Signal(pzip_workWaitable); return; }
+			Waitable_Wait(pzip_workWaitable);
+			continue;
+		}
+		if (queued) Waitable_Signal(pzip_workWaitable);
+
+		PZip_DecompressSlot(state, slot);
+		Mutex_Lock(pzip_mutex);
+		{
+			slot->State = PZIP_DONE;
+		}
+		Mutex_Unlock(pzip_mutex);
+		Waitable_Signal(pzip_doneWaitable);
+	}
+}
+
+/* Waits for the oldest entry to be decompressed, then processes it (unless an error has already occurred) */
+static cc_result PZip_ProcessOldest(cc_bool failed) {
+	struct PZipSlot* slot = &pzip_slots[pzip_oldest];
+	struct Stream mem;
+	String path;
+	cc_bool done;
+	cc_result res;
+
+	for (;;) {
+		Mutex_Lock(pzip_mutex);
+		{
+			done = slot->State == PZIP_DONE;
+		}
+		Mutex_Unlock(pzip_mutex);
+
+		if (done) break;
+		Waitable_Wait(pzip_doneWaitable);
+	}
+
+	res = slot->Result;
+	if (!res && !failed) {
+		path = Zip_UNSAFE_GetPath(pzip_zip, slot->Entry);
+		pzip_zip->_curEntry = slot->Entry;
+
+		Stream_ReadonlyMemory(&mem, slot->Data, slot->DataLen);
+		res = pzip_zip->ProcessEntry(&path, &mem, pzip_zip);
+	}
+	Mem_Free(slot->Data);
+	slot->Data = NULL;
+
+	Mutex_Lock(pzip_mutex);
+	{
+		slot->State = PZIP_FREE;
+		pzip_oldest = (pzip_oldest + 1) % pzip_slotsCount;
+	}
+	Mutex_Unlock(pzip_mutex);
+	return res;
+}
+
+/* Reads the compressed data of an entry, then queues it to be decompressed */
+static cc_result PZip_SubmitEntry(struct ZipEntry* entry) {
+	struct PZipSlot* slot = &pzip_slots[pzip_fill];
+	cc_uint32 compressedSize, uncompressedSize;
+	int method;
+	cc_result res;
+
+	res = Zip_SeekToData(pzip_zip, entry, &method, &compressedSize, &uncompressedSize);
+	if (res) return res;
+
+	if (method != 0 && method != 8) {
+		Platform_Log1("Unsupported.zip entry compression method: %i", &method);
+		return 0;
+	}
+
+	slot->Entry    = entry;
+	slot->Method   = method;
+	slot->InputLen = method == 0 ? uncompressedSize : compressedSize;
+	slot->Input    = (cc_uint8*)Mem_TryAlloc(slot->InputLen + 1, 1);
+
+	if (!slot->Input) return ERR_OUT_OF_MEMORY;
+	if ((res = Stream_Read(pzip_zip->input, slot->Input, slot->InputLen))) {
+		Mem_Free(slot->Input); 
+		slot->Input = NULL;
+		return res;
+	}
+
+	if (!pzip_workers) {
+		PZip_DecompressSlot(&pzip_states[0], slot);
+		slot->State = PZIP_DONE;
+	} else {
+		Mutex_Lock(pzip_mutex);
+		{
+			slot->State = PZIP_QUEUED;
+		}
+		Mutex_Unlock(pzip_mutex);
+		Waitable_Signal(pzip_workWaitable);
+	}
+
+	pzip_fill = (pzip_fill + 1) % pzip_slotsCount;
 	return 0;
 }
+
+static void PZip_Init(struct ZipState* state) {
+	int i, workers = min(Thread_ProcessorsCount(), PZIP_MAX_WORKERS);
+	/* Just decompress on the calling thread when there's only one processor */
+	if (workers < 2) workers = 0;
+
+	pzip_zip    = state;
+	pzip_fill   = 0;
+	pzip_oldest = 0;
+
+	pzip_slotsCount = max(1, workers * 2);
+	for (i = 0; i < pzip_slotsCount; i++) {
+		pzip_slots[i].Input = NULL;
+		pzip_slots[i].Data  = NULL;
+		pzip_slots[i].State = PZIP_FREE;
+	}
+
+	pzip_states     = (struct InflateState*)Mem_Alloc(max(1, workers), sizeof(struct InflateState), "Zip states");
+	pzip_statesUsed = 0;
+	pzip_workers    = workers;
+
+	pzip_quit         = false;
+	pzip_mutex        = Mutex_Create();
+	pzip_workWaitable = Waitable_Create();
+	pzip_doneWaitable = Waitable_Create();
+
+	for (i = 0; i < workers; i++) {
+		pzip_threads[i] = Thread_Start(PZip_WorkerFunc, false);
+	}
+}
+
+static void PZip_Free(void) {
+	int i;
+	pzip_quit = true;
+	Waitable_Signal(pzip_workWaitable);
+	for (i = 0; i < pzip_workers; i++) { Thread_Join(pzip_threads[i]); }
+
+	Mutex_Free(pzip_mutex);
+	Waitable_Free(pzip_workWaitable);
+	Waitable_Free(pzip_doneWaitable);
+
+	Mem_Free(pzip_states);
+	pzip_states     = NULL;
+	pzip_workers    = 0;
+	pzip_slotsCount = 0;
+}
+
+cc_result Zip_ExtractParallel(struct ZipState* state) {
+	cc_result res;
+	int i;
+	if ((res = Zip_ReadIndex(state))) return res;
+	PZip_Init(state);
+
+	for (i = 0; i < state->_usedEntries; i++) {
+		/* All slots are in use, so need to wait for the oldest one to be processed */
+		if (pzip_slots[pzip_fill].State != PZIP_FREE) {
+			if ((res = PZip_ProcessOldest(false))) break;
+		}
+		if ((res = PZip_SubmitEntry(&state->entries[i]))) break;
+	}
+
+	/* Still need to wait for all the queued entries even on error, as worker threads may be using them */
+	while (pzip_slots[pzip_oldest].State != PZIP_FREE) {
+		cc_result processRes = PZip_ProcessOldest(res != 0);
+		if (!res) res = processRes;
+	}
+
+	PZip_Free();
+	Zip_Free(state);
+	return res;
+}
@@ -27,22 +27,22 @@ cc_result ZLibHeader_Read(struct Stream* s, struct ZLibHeader* header);
 #define INFLATE_MAX_DISTS 32
 #define INFLATE_MAX_LITS_DISTS (INFLATE_MAX_LITS + INFLATE_MAX_DISTS)
 #define INFLATE_MAX_BITS 16
-#define INFLATE_FAST_BITS 9
+#define INFLATE_FAST_BITS 11
 #define INFLATE_WINDOW_SIZE 0x8000UL
 #define INFLATE_WINDOW_MASK 0x7FFFUL
 
 struct HuffmanTable {
-	cc_int16 Fast[1 << INFLATE_FAST_BITS];      /* Fast lookup table for huffman codes */
+	cc_uint32 Fast[1 << INFLATE_FAST_BITS];     /* Fast lookup table for huffman codes (packed entries, 0 if code is longer) */
 	cc_uint16 FirstCodewords[INFLATE_MAX_BITS]; /* Starting codeword for each bit length */
 	cc_uint16 EndCodewords[INFLATE_MAX_BITS];   /* (Last codeword + 1) for each bit length. 0 is ignored. */
 	cc_uint16 FirstOffsets[INFLATE_MAX_BITS];   /* Base offset into Values for codewords of each bit length. */
-	cc_uint16 Values[INFLATE_MAX_LITS];         /* Values/Symbols list */
+	cc_uint32 Values[INFLATE_MAX_LITS];         /* Values/Symbols list (packed with base and extra bits) */
 };
 
 struct InflateState {
 	cc_uint8 State;
 	cc_bool LastBlock; /* Whether the last DEFLATE block has been encounted in the stream */
-	cc_uint32 Bits;    /* Holds bits across byte boundaries */
+	cc_uint64 Bits;    /* Holds bits across byte boundaries */
 	cc_uint32 NumBits; /* Number of bits in Bits buffer */
 
 	cc_uint8* NextIn;   /* Pointer within Input buffer to next byte that can be read */
@@ -50,6 +50,9 @@ struct InflateState {
 	cc_uint8* Output;   /* Pointer for output data */
 	cc_uint32 AvailOut; /* Max number of bytes that can be written to Output buffer */
 	struct Stream* Source;  /* Source for filling Input buffer */
+	cc_bool DirectOutput;   /* Whether LZ77 back references are resolved from output data (See Inflate_UseDirectOutput) */
+	cc_uint32 DirectLen;    /* Number of bytes decompressed since direct output was enabled */
+	cc_uint8* OutputBase;   /* Start of the data decompressed since direct output was enabled */
 
 	cc_uint32 Index;                          /* General purpose index / counter */
 	cc_uint32 WindowIndex;                    /* Current index within window circular buffer */
@@ -75,13 +78,28 @@ void Inflate_Process(struct InflateState* state);
 /* NOTE: This only uncompresses pure DEFLATE compressed data. */
 /* If data starts with a GZIP or ZLIB header, use GZipHeader_Read or ZLibHeader_Read to first skip it. */
 CC_API void Inflate_MakeStream(struct Stream* stream, struct InflateState* state, struct Stream* underlying);
+/* Makes all further data be decompressed straight into the destination, instead of through the window. */
+/* Faster, but the destination of each read MUST immediately follow the data returned by previous reads. */
+/* (i.e. everything is read in order into one buffer, which may be moved by Mem_TryRealloc between reads) */
+/* NOTE: Only use this when the total size is known or all remaining data is read, e.g. map blocks */
+void Inflate_UseDirectOutput(struct InflateState* state);
 
 
 #define DEFLATE_BLOCK_SIZE  16384
 #define DEFLATE_BUFFER_SIZE 32768
 #define DEFLATE_OUT_SIZE 8192
-#define DEFLATE_HASH_SIZE 0x1000UL
-#define DEFLATE_HASH_MASK 0x0FFFUL
+#define DEFLATE_HASH_SIZE 0x8000UL
+#define DEFLATE_HASH_MASK 0x7FFFUL
+/* Max symbols in a block (symbols for more than one DEFLATE_BLOCK_SIZE of input can be combined into one block) */
+#define DEFLATE_MAX_SYMS (DEFLATE_BLOCK_SIZE + DEFLATE_BLOCK_SIZE / 2)
+/* Compression levels, trading off compression speed against compressed size */
+enum DEFLATE_LEVEL {
+	DEFLATE_LEVEL_STORE,   /* No compression at all (stored blocks only) */
+	DEFLATE_LEVEL_FAST,    /* Short hash chains, no lazy matching */
+	DEFLATE_LEVEL_DEFAULT, /* Good balance between speed and compressed size */
+	DEFLATE_LEVEL_BEST,    /* Long hash chains, always lazy match */
+	DEFLATE_LEVEL_COUNT
+};
 struct DeflateState {
 	cc_uint32 Bits;         /* Holds bits across byte boundaries */
 	cc_uint32 NumBits;      /* Number of bits in Bits buffer */
@@ -91,14 +109,25 @@ struct DeflateState {
 	cc_uint32 AvailOut;   /* Max number of bytes that can be written to Output buffer */
 	struct Stream* Dest; /* Destination that Output buffer is written to */
 
-	cc_uint16 LitsCodewords[INFLATE_MAX_LITS]; /* Codewords for each value */
-	cc_uint8 LitsLens[INFLATE_MAX_LITS];       /* Bit lengths of each codeword */
+	int Level;           /* Compression level (see DEFLATE_LEVEL enum), can be changed before writing any data */
+
+	cc_uint16 LitsCodewords[INFLATE_MAX_LITS];   /* Codewords for each literal/length value */
+	cc_uint8 LitsLens[INFLATE_MAX_LITS];         /* Bit lengths of each literal/length codeword */
+	cc_uint16 DistsCodewords[INFLATE_MAX_DISTS]; /* Codewords for each distance value */
+	cc_uint8 DistsLens[INFLATE_MAX_DISTS];       /* Bit lengths of each distance codeword */
+
+	cc_uint16 LitFreqs[INFLATE_MAX_LITS];  /* Frequency of each literal/length value in current block */
+	cc_uint16 DistFreqs[INFLATE_MAX_DISTS];/* Frequency of each distance value in current block */
+	int NumSyms;         /* Number of symbols in current block */
+	cc_uint32 ExtraBits; /* Total number of extra bits needed by lengths and distances in current block */
+	cc_uint32 BlockLen;  /* Number of bytes of input that the symbols in current block were found from */
+	cc_uint8 SymLits[DEFLATE_MAX_SYMS];   /* Literal value, or (match length - 3) for each symbol */
+	cc_uint16 SymDists[DEFLATE_MAX_SYMS]; /* Match distance for each symbol, 0 if symbol is a literal */
 	
 	cc_uint8 Input[DEFLATE_BUFFER_SIZE];
 	cc_uint8 Output[DEFLATE_OUT_SIZE];
-	int Head[DEFLATE_HASH_SIZE];
-	int Prev[DEFLATE_BUFFER_SIZE];
-	cc_bool WroteHeader;
+	cc_uint16 Head[DEFLATE_HASH_SIZE];
+	cc_uint16 Prev[DEFLATE_BUFFER_SIZE];
 };
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
@@ -108,6 +137,10 @@ struct GZipState { struct DeflateState Base; cc_uint32 Crc32, Size; };
 /* Compresses input data using GZIP, then writes compressed output to another stream. Write only stream. */
 /* GZIP compression is GZIP header, followed by DEFLATE compressed data, followed by GZIP footer. */
 CC_API void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stream* underlying);
+/* Same as GZip_MakeStream, but splits input into chunks that are compressed on multiple worker threads. */
+/* Output is still a single GZIP stream, with each chunk primed using the end of the previous chunk's data. */
+/* NOTE: Only one parallel GZIP stream can be in use at a time. Close must always be called, even on error. */
+void GZip_MakeParallelStream(struct Stream* stream, struct Stream* underlying, int level);
 
 struct ZLibState { struct DeflateState Base; cc_uint32 Adler32; };
 /* Compresses input data using ZLIB, then writes compressed output to another stream. Write only stream. */
@@ -115,8 +148,13 @@ struct ZLibState { struct DeflateState Base; cc_uint32 Adler32; };
 CC_API void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
 
 /* Minimal data needed to describe an entry in a .zip archive. */
-struct ZipEntry { cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset, CRC32; };
-#define ZIP_MAX_ENTRIES 1024
+struct ZipEntry { 
+	cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset, CRC32;
+	/* (internal) Offset of path in the central directory data, and length of path */
+	cc_uint32 _pathOffset, _pathLength;
+	/* (internal) Index of next entry in the same hash table bucket, or -1 if none */
+	int _next;
+};
 struct ZipState;
 
 /* Stores state for reading and processing entries in a .zip archive. */
@@ -130,6 +168,10 @@ struct ZipState {
 	/* Predicate used to select which entries in a .zip archive get processed. */
 	/* NOTE: returning false entirely skips the entry. (avoids pointless seek to entry) */
 	cc_bool (*SelectEntry)(const String* path);
+	/* Optional callback called on worker threads by Zip_ExtractParallel, before ProcessEntry. */
+	/* Can replace the entry's data with other data, which must be allocated using Mem_TryAlloc. */
+	/* (e.g. to decode images in parallel) Return non-zero to indicate an error and stop further processing. */
+	cc_result (*PrepareEntry)(const String* path, cc_uint8** data, cc_uint32* size, struct ZipState* state);
 	/* Generic object/pointer for ProcessEntry callback. */
 	void* obj;
 
@@ -141,13 +183,33 @@ struct ZipState {
 	cc_uint32 _centralDirBeg;
 	/* (internal) Current entry being processed. */
 	struct ZipEntry* _curEntry;
-	/* Data for each entry in the .zip archive. */
-	struct ZipEntry entries[ZIP_MAX_ENTRIES];
+	/* (internal) Data of the central directory, which paths of entries are stored in. */
+	cc_uint8* _centralDir;
+	/* (internal) Hash table of entries by path, and number of buckets minus 1. */
+	int* _buckets; int _bucketsMask;
+	/* Data for each selected entry in the .zip archive. (allocated by Zip_ReadIndex) */
+	struct ZipEntry* entries;
 };
 
 /* Initialises .zip archive reader state to defaults. */
 CC_API void Zip_Init(struct ZipState* state, struct Stream* input);
+/* Reads the central directory of a .zip archive, and builds an index of the entries selected by SelectEntry. */
+/* NOTE: Must have been initialised with Zip_Init first. Zip_Free must be called afterwards if successful. */
+CC_API cc_result Zip_ReadIndex(struct ZipState* state);
+/* Returns the entry with the given path (case insensitive), or NULL if the archive has no such entry. */
+/* NOTE: Zip_ReadIndex must have been successfully called first. */
+CC_API struct ZipEntry* Zip_FindEntry(struct ZipState* state, const String* path);
+/* Reads and processes just the given entry in a .zip archive. */
+/* NOTE: Zip_ReadIndex must have been successfully called first. */
+CC_API cc_result Zip_ExtractEntry(struct ZipState* state, struct ZipEntry* entry);
+/* Frees the index built by Zip_ReadIndex. */
+CC_API void Zip_Free(struct ZipState* state);
 /* Reads and processes the entries in a .zip archive. */
 /* NOTE: Must have been initialised with Zip_Init first. */
 CC_API cc_result Zip_Extract(struct ZipState* state);
+/* Same as Zip_Extract, but entries are decompressed (and then prepared) on multiple worker threads. */
+/* ProcessEntry is still called on the calling thread, for each entry in the same order as Zip_Extract. */
+/* NOTE: The data stream given to ProcessEntry is always a readonly memory stream. (Stream_ReadonlyMemory) */
+/* NOTE: Only one parallel extraction can be in progress at a time. */
+CC_API cc_result Zip_ExtractParallel(struct ZipState* state);
 #endif
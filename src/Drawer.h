@@ -34,4 +34,15 @@ CC_API void Drawer_ZMax(int count, PackedCol col, TextureLoc texLoc, struct Vert
 CC_API void Drawer_YMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
 /* Draws maximum Y face of the cuboid. (i.e. at Y2) */
 CC_API void Drawer_YMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+
+/* Same as Drawer_XMin etc, but draws the cuboid described by the given state instead of Drawer. */
+/* NOTE: Unlike the Drawer_ functions, these can be safely used from multiple threads. */
+/* rows is how many times the face is repeated along the texture V axis. (Y for sides, Z for top/bottom) */
+/* NOTE: rows above 1 only tile correctly when each 1D atlas contains a single tile. */
+void DrawerData_XMin(const struct _DrawerData* state, int count, int rows, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_XMax(const struct _DrawerData* state, int count, int rows, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_ZMin(const struct _DrawerData* state, int count, int rows, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_ZMax(const struct _DrawerData* state, int count, int rows, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_YMin(const struct _DrawerData* state, int count, int rows, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_YMax(const struct _DrawerData* state, int count, int rows, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
 #endif
@@ -385,10 +385,10 @@ static int CalcRainHeightAt(int x, int maxY, int z, int hIndex) {
 #ifndef EXTENDED_BLOCKS
 	RainCalcBody(World.Blocks[i]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World.Sections) {
 		RainCalcBody(World.Blocks[i]);
 	} else {
-		RainCalcBody(World.Blocks[i] | (World.Blocks2[i] << 8));
+		RainCalcBody(World_GetSectionBlock(x, y, z));
 	}
 #endif
 
@@ -431,6 +431,14 @@ void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID n
 	}
 }
 
+void EnvRenderer_OnColumnChanged(int x, int z, int maxY) {
+	int hIndex = Weather_Pack(x, z);
+	/* Rain height is unaffected by changes below it (or was not calculated to begin with) */
+	if (maxY < Weather_Heightmap[hIndex]) return;
+	/* Blocks above maxY did not change, so still do not block rain */
+	CalcRainHeightAt(x, maxY, z, hIndex);
+}
+
 static float CalcRainAlphaAt(float x) {
 	/* Wolfram Alpha: fit {0,178},{1,169},{4,147},{9,114},{16,59},{25,9} */
 	float falloff = 0.05f * x * x - 7 * x;
@@ -28,6 +28,8 @@ cc_bool EnvRenderer_ShouldRenderSkybox(void);
 
 extern cc_int16* Weather_Heightmap;
 void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+/* Updates rain height of a column, after any number of blocks at or below maxY in it changed */
+void EnvRenderer_OnColumnChanged(int x, int z, int maxY);
 /* Renders rainfall/snowfall weather. */
 void EnvRenderer_RenderWeather(double deltaTime);
 
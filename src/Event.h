@@ -175,6 +175,7 @@ CC_VAR extern struct _WorldEventsList {
 	struct Event_Void  NewMap;        /* Player begins loading a new world */
 	struct Event_Float Loading;       /* Portion of world is decompressed/generated (Arg is progress from 0-1) */
 	struct Event_Void  MapLoaded;     /* New world has finished loading, player can now interact with it */
+	struct Event_Int   LayersLoaded;  /* More layers of a progressively loading world can be shown (Arg is World.LoadedHeight) */
 	struct Event_Int   EnvVarChanged; /* World environment variable changed by player/CPE/WoM config */
 } WorldEvents;
 
@@ -15,6 +15,8 @@
 #include "Chat.h"
 #include "Inventory.h"
 #include "TexturePack.h"
+#include "Options.h"
+#include "Screens.h"
 
 
 /*########################################################################################################################*
@@ -22,7 +24,8 @@
 *#########################################################################################################################*/
 static cc_result Map_ReadBlocks(struct Stream* stream) {
 	World.Volume = World.Width * World.Length * World.Height;
-	World.Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+	/* Blocks were already allocated if the map was progressively loaded */
+	if (!World.Blocks) World.Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
 
 	if (!World.Blocks) return ERR_OUT_OF_MEMORY;
 	return Stream_Read(stream, World.Blocks, World.Volume);
@@ -53,34 +56,13 @@ IMapImporter Map_FindImporter(const String* path) {
 	return NULL;
 }
 
-void Map_LoadFrom(const String* path) {
-	IMapImporter importer;
-	struct Stream stream;
-	cc_result res;
-	Game_Reset();
-	
-	res = Stream_OpenFile(&stream, path);
-	if (res) { Logger_Warn2(res, "opening", path); return; }
-
-	importer = Map_FindImporter(path);
-	if ((res = importer(&stream))) {
-		World_Reset();
-		Logger_Warn2(res, "decoding", path);
-	}
-
-	res = stream.Close(&stream);
-	if (res) { Logger_Warn2(res, "closing", path); }
-
-	World_SetNewMap(World.Blocks, World.Width, World.Height, World.Length);
-	LocalPlayer_MoveToSpawn();
-}
-
 
 /*########################################################################################################################*
 *--------------------------------------------------MCSharp level Format---------------------------------------------------*
 *#########################################################################################################################*/
 #define LVL_CUSTOMTILE 163
 #define LVL_CHUNKSIZE 16
+#define LVL_HEADER_SIZE 18
 /* MCSharp* format is a GZIP compressed binary map format. All metadata is discarded.
 	U16 "Identifier" (must be 1874)
 	U16 "Width",  "Length", "Height"
@@ -156,20 +138,16 @@ static cc_result Lvl_ReadCustomBlocks(struct Stream* stream) {
 	return 0;
 }
 
-cc_result Lvl_Load(struct Stream* stream) {
-	cc_uint8 header[18];
+/* Decodes the decompressed contents of a .lvl file */
+static cc_result Lvl_Decode(struct Stream* stream) {
+	cc_uint8 header[LVL_HEADER_SIZE];
 	cc_uint8* blocks;
 	cc_uint8 section;
 	cc_result res;
 	int i;
-
 	struct LocalPlayer* p = &LocalPlayer_Instance;
-	struct Stream compStream;
-	struct InflateState state;
-	Inflate_MakeStream(&compStream, &state, stream);
-	
-	if ((res = Map_SkipGZipHeader(stream)))                       return res;
-	if ((res = Stream_Read(&compStream, header, sizeof(header)))) return res;
+
+	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
 	if (Stream_GetU16_LE(&header[0]) != 1874) return LVL_ERR_VERSION;
 
 	World.Width  = Stream_GetU16_LE(&header[2]);
@@ -183,7 +161,7 @@ cc_result Lvl_Load(struct Stream* stream) {
 	p->SpawnPitch = Math_Packed2Deg(header[15]);
 	/* (2) pervisit, perbuild permissions */
 
-	if ((res = Map_ReadBlocks(&compStream))) return res;
+	if ((res = Map_ReadBlocks(stream))) return res;
 	blocks = World.Blocks;
 	/* Bulk convert 4 blocks at once */
 	for (i = 0; i < (World.Volume & ~3); i += 4) {
@@ -197,11 +175,21 @@ cc_result Lvl_Load(struct Stream* stream) {
 	}
 
 	/* 0xBD section type is not present in older .lvl files */
-	res = compStream.ReadU8(&compStream, &section);
+	res = stream->ReadU8(stream, &section);
 	if (res == ERR_END_OF_STREAM) return 0;
 
 	if (res) return res;
-	return section == 0xBD ? Lvl_ReadCustomBlocks(&compStream) : 0;
+	return section == 0xBD ? Lvl_ReadCustomBlocks(stream) : 0;
+}
+
+cc_result Lvl_Load(struct Stream* stream) {
+	struct Stream compStream;
+	struct InflateState state;
+	cc_result res;
+	Inflate_MakeStream(&compStream, &state, stream);
+
+	if ((res = Map_SkipGZipHeader(stream))) return res;
+	return Lvl_Decode(&compStream);
 }
 
 
@@ -233,15 +221,13 @@ static cc_result Fcm_ReadString(struct Stream* stream) {
 	return stream->Skip(stream, len);
 }
 
-cc_result Fcm_Load(struct Stream* stream) {
-	cc_uint8 header[79];	
+#define FCM_HEADER_SIZE 79
+/* Decodes a .fcm file, given the raw header stream and the decompressed data stream */
+static cc_result Fcm_Decode2(struct Stream* stream, struct Stream* compStream) {
+	cc_uint8 header[FCM_HEADER_SIZE];
 	cc_result res;
 	int i, count;
-
 	struct LocalPlayer* p = &LocalPlayer_Instance;
-	struct Stream compStream;
-	struct InflateState state;
-	Inflate_MakeStream(&compStream, &state, stream);
 
 	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
 	if (Stream_GetU32_LE(&header[0]) != 0x0FC2AF40UL)        return FCM_ERR_IDENTIFIER;
@@ -265,12 +251,22 @@ cc_result Fcm_Load(struct Stream* stream) {
 
 	/* header isn't compressed, rest of data is though */
 	for (i = 0; i < count; i++) {
-		if ((res = Fcm_ReadString(&compStream))) return res; /* Group */
-		if ((res = Fcm_ReadString(&compStream))) return res; /* Key   */
-		if ((res = Fcm_ReadString(&compStream))) return res; /* Value */
+		if ((res = Fcm_ReadString(compStream))) return res; /* Group */
+		if ((res = Fcm_ReadString(compStream))) return res; /* Key   */
+		if ((res = Fcm_ReadString(compStream))) return res; /* Value */
 	}
 
-	return Map_ReadBlocks(&compStream);
+	return Map_ReadBlocks(compStream);
+}
+
+/* Decodes a .fcm file whose data has already been decompressed (i.e. header then data) */
+static cc_result Fcm_Decode(struct Stream* stream) { return Fcm_Decode2(stream, stream); }
+
+cc_result Fcm_Load(struct Stream* stream) {
+	struct Stream compStream;
+	struct InflateState state;
+	Inflate_MakeStream(&compStream, &state, stream);
+	return Fcm_Decode2(stream, &compStream);
 }
 
 
@@ -683,19 +679,15 @@ static void Cw_Callback(struct NbtTag* tag) {
 	        0             1         2        3          4   */
 }
 
-cc_result Cw_Load(struct Stream* stream) {
+/* Decodes the decompressed contents of a .cw file */
+static cc_result Cw_Decode(struct Stream* stream) {
 	cc_uint8 tag;
-	struct Stream compStream;
-	struct InflateState state;
 	Vec3* spawn; IVec3 pos;
 	cc_result res;
 
-	Inflate_MakeStream(&compStream, &state, stream);
-	if ((res = Map_SkipGZipHeader(stream))) return res;
-	if ((res = compStream.ReadU8(&compStream, &tag))) return res;
-
+	if ((res = stream->ReadU8(stream, &tag))) return res;
 	if (tag != NBT_DICT) return CW_ERR_ROOT_TAG;
-	res = Nbt_ReadTag(NBT_DICT, true, &compStream, NULL, Cw_Callback);
+	res = Nbt_ReadTag(NBT_DICT, true, stream, NULL, Cw_Callback);
 	if (res) return res;
 
 	/* Older versions incorrectly multiplied spawn coords by * 32, so we check for that */
@@ -708,6 +700,16 @@ cc_result Cw_Load(struct Stream* stream) {
 	return 0;
 }
 
+cc_result Cw_Load(struct Stream* stream) {
+	struct Stream compStream;
+	struct InflateState state;
+	cc_result res;
+	Inflate_MakeStream(&compStream, &state, stream);
+
+	if ((res = Map_SkipGZipHeader(stream))) return res;
+	return Cw_Decode(&compStream);
+}
+
 
 /*########################################################################################################################*
 *-------------------------------------------------Minecraft .dat format---------------------------------------------------*
@@ -888,21 +890,17 @@ static cc_int32 Dat_I32(struct JFieldDesc* field) {
 	return field->Value.I32;
 }
 
-cc_result Dat_Load(struct Stream* stream) {
+/* Decodes the decompressed contents of a .dat file */
+static cc_result Dat_Decode(struct Stream* stream) {
 	cc_uint8 header[10];
 	struct JClassDesc obj;
 	struct JFieldDesc* field;
 	String fieldName;
 	cc_result res;
 	int i;
-
 	struct LocalPlayer* p = &LocalPlayer_Instance;
-	struct Stream compStream;
-	struct InflateState state;
-	Inflate_MakeStream(&compStream, &state, stream);
 
-	if ((res = Map_SkipGZipHeader(stream)))                       return res;
-	if ((res = Stream_Read(&compStream, header, sizeof(header)))) return res;
+	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
 	/* .dat header */
 	if (Stream_GetU32_BE(&header[0]) != 0x271BB788) return DAT_ERR_IDENTIFIER;
 	if (header[4] != 0x02) return DAT_ERR_VERSION;
@@ -911,11 +909,11 @@ cc_result Dat_Load(struct Stream* stream) {
 	if (Stream_GetU16_BE(&header[5]) != 0xACED) return DAT_ERR_JIDENTIFIER;
 	if (Stream_GetU16_BE(&header[7]) != 0x0005) return DAT_ERR_JVERSION;
 	if (header[9] != TC_OBJECT)                 return DAT_ERR_ROOT_TYPE;
-	if ((res = Dat_ReadClassDesc(&compStream, &obj))) return res;
+	if ((res = Dat_ReadClassDesc(stream, &obj))) return res;
 
 	for (i = 0; i < obj.FieldsCount; i++) {
 		field = &obj.Fields[i];
-		if ((res = Dat_ReadFieldData(&compStream, field))) return res;
+		if ((res = Dat_ReadFieldData(stream, field))) return res;
 		fieldName = String_FromRaw((char*)field->FieldName, JNAME_SIZE);
 
 		if (String_CaselessEqualsConst(&fieldName, "width")) {
@@ -939,6 +937,332 @@ cc_result Dat_Load(struct Stream* stream) {
 	return 0;
 }
 
+cc_result Dat_Load(struct Stream* stream) {
+	struct Stream compStream;
+	struct InflateState state;
+	cc_result res;
+	Inflate_MakeStream(&compStream, &state, stream);
+
+	if ((res = Map_SkipGZipHeader(stream))) return res;
+	return Dat_Decode(&compStream);
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Background map import--------------------------------------------------*
+*#########################################################################################################################*/
+/* Decodes the decompressed contents of a map file */
+typedef cc_result (*MapDecoder)(struct Stream* stream);
+/* Copies the layers of blocks decompressed so far into load_layers (Runs on the background loading thread) */
+typedef void (*MapLayersReader)(void);
+struct MapFormat {
+	IMapImporter importer;
+	MapDecoder decoder;
+	MapLayersReader layers; /* NULL if blocks can't be read before the whole file is decompressed */
+	cc_uint8 headerSize; /* Number of uncompressed bytes before the compressed data */
+	cc_bool gzip;        /* Whether compressed data is wrapped in a GZIP header */
+};
+
+static void Lvl_ReadLayers(void);
+static const struct MapFormat map_formats[] = {
+	{ Cw_Load,  Cw_Decode,  NULL,           0,               true  },
+	{ Lvl_Load, Lvl_Decode, Lvl_ReadLayers, 0,               true  },
+	{ Fcm_Load, Fcm_Decode, NULL,           FCM_HEADER_SIZE, false },
+	{ Dat_Load, Dat_Decode, NULL,           0,               true  }
+};
+
+/* Max bytes decompressed at once, so progress is regularly updated */
+#define LOAD_READ_SIZE (256 * 1024)
+/* Max compression ratio of DEFLATE is ~1032:1, so larger size hints must be bogus */
+#define LOAD_MAX_RATIO 1032
+
+static const struct MapFormat* load_format;
+static struct Stream load_file;
+static struct InflateState load_inflate;
+static char load_pathBuffer[FILENAME_SIZE];
+static String load_path = String_FromArray(load_pathBuffer);
+static cc_uint8* load_data;
+static cc_uint32 load_len, load_capacity;
+static cc_result load_result, load_closeResult;
+static cc_bool load_active;
+
+volatile float MapLoad_Progress;
+volatile cc_bool MapLoad_Done;
+
+/* Blocks of the bottom layers of the map, which are shown while the rest of the map is loading */
+static struct MapLoadLayers {
+	BlockRaw* blocks;
+	int width, height, length;
+	Vec3 spawn; float spawnYaw, spawnPitch;
+	volatile int count; /* Number of layers fully copied into blocks */
+	cc_bool failed;     /* Whether layers can't be shown (e.g. invalid header or out of memory) */
+	cc_bool shown;      /* Whether blocks have been given to World_BeginProgressiveMap */
+} load_layers;
+
+static void Lvl_ReadLayers(void) {
+	struct MapLoadLayers* l = &load_layers;
+	cc_uint32 i, end, layerSize;
+	int count;
+
+	if (!l->blocks) {
+		if (load_len < LVL_HEADER_SIZE) return;
+		l->failed = Stream_GetU16_LE(&load_data[0]) != 1874;
+		if (l->failed) return;
+
+		l->width  = Stream_GetU16_LE(&load_data[2]);
+		l->length = Stream_GetU16_LE(&load_data[4]);
+		l->height = Stream_GetU16_LE(&load_data[6]);
+
+		l->spawn.X = Stream_GetU16_LE(&load_data[8]);
+		l->spawn.Z = Stream_GetU16_LE(&load_data[10]);
+		l->spawn.Y = Stream_GetU16_LE(&load_data[12]);
+		l->spawnYaw   = Math_Packed2Deg(load_data[14]);
+		l->spawnPitch = Math_Packed2Deg(load_data[15]);
+
+		l->failed = !l->width || !l->height || !l->length;
+		if (l->failed) return;
+		l->blocks = (BlockRaw*)Mem_TryAlloc(l->width * l->height, l->length);
+		l->failed = !l->blocks;
+		if (l->failed) return;
+	}
+
+	layerSize = l->width * l->length;
+	count     = min((load_len - LVL_HEADER_SIZE) / layerSize, (cc_uint32)l->height);
+	end       = count * layerSize;
+
+	for (i = l->count * layerSize; i < end; i++) {
+		l->blocks[i] = Lvl_table[load_data[LVL_HEADER_SIZE + i]];
+	}
+	l->count = count;
+}
+
+void MapLoad_ShowLayers(void) {
+	struct MapLoadLayers* l = &load_layers;
+	struct LocalPlayer* p   = &LocalPlayer_Instance;
+	int count = l->count;
+	if (!count) return;
+
+	if (!l->shown) {
+		l->shown = true;
+		World_BeginProgressiveMap(l->blocks, l->width, l->height, l->length);
+
+		p->Spawn      = l->spawn;
+		p->SpawnYaw   = l->spawnYaw;
+		p->SpawnPitch = l->spawnPitch;
+		LocalPlayer_MoveToSpawn();
+	}
+	World_SetLoadedHeight(count);
+}
+
+/* Estimates size of the decompressed data, using the uncompressed size in the GZIP footer if possible */
+static cc_uint32 MapLoad_EstimateSize(cc_uint32 fileLen) {
+	cc_uint8 footer[4];
+	cc_uint32 size;
+
+	if (!load_format->gzip || fileLen < 18) return fileLen * 4;
+	if (load_file.Seek(&load_file, fileLen - 4))            return fileLen * 4;
+	if (Stream_Read(&load_file, footer, sizeof(footer)))    return fileLen * 4;
+	if (load_file.Seek(&load_file, 0))                      return fileLen * 4;
+
+	size = Stream_GetU32_LE(footer);
+	return size / LOAD_MAX_RATIO > fileLen ? fileLen * 4 : size;
+}
+
+static cc_result MapLoad_Decompress(void) {
+	struct Stream compStream;
+	cc_uint32 fileLen, pos, count, read;
+	cc_uint8* data;
+	cc_result res;
+
+	if ((res = load_file.Length(&load_file, &fileLen))) return res;
+	/* +1 so the final empty read doesn't needlessly grow the buffer */
+	load_capacity = max(load_format->headerSize + MapLoad_EstimateSize(fileLen) + 1, 4096);
+	load_data     = (cc_uint8*)Mem_TryAlloc(load_capacity, 1);
+	if (!load_data) return ERR_OUT_OF_MEMORY;
+
+	if ((res = Stream_Read(&load_file, load_data, load_format->headerSize))) return res;
+	load_len = load_format->headerSize;
+
+	Inflate_MakeStream(&compStream, &load_inflate, &load_file);
+	if (load_format->gzip && (res = Map_SkipGZipHeader(&load_file))) return res;
+	/* All data is decompressed in order into load_data, so can skip copying through the window */
+	Inflate_UseDirectOutput(&load_inflate);
+
+	for (;;) {
+		if (load_len == load_capacity) {
+			data = (cc_uint8*)Mem_TryRealloc(load_data, load_capacity * 2, 1);
+			if (!data) return ERR_OUT_OF_MEMORY;
+			load_data = data; load_capacity *= 2;
+		}
+
+		count = min(load_capacity - load_len, LOAD_READ_SIZE);
+		if ((res = compStream.Read(&compStream, load_data + load_len, count, &read))) return res;
+		if (!read) return 0;
+		load_len += read;
+		if (load_format->layers && !load_layers.failed) load_format->layers();
+
+		if (!fileLen || load_file.Position(&load_file, &pos)) continue;
+		MapLoad_Progress = (float)pos / fileLen;
+	}
+}
+
+void MapLoad_Run(void) {
+	load_result      = MapLoad_Decompress();
+	load_closeResult = load_file.Close(&load_file);
+	MapLoad_Done     = true;
+}
+
+void MapLoad_Finish(void) {
+	struct Stream stream;
+	cc_result res = load_result;
+
+	MapLoad_Done = false;
+	load_active  = false;
+	if (load_closeResult) Logger_Warn2(load_closeResult, "closing", &load_path);
+
+	/* Otherwise the world now owns the blocks, which the decoder reads into again */
+	if (!load_layers.shown) Mem_Free(load_layers.blocks);
+	load_layers.blocks = NULL;
+
+	if (!res) {
+		Stream_ReadonlyMemory(&stream, load_data, load_len);
+		res = load_format->decoder(&stream);
+	}
+	Mem_Free(load_data);
+	load_data = NULL;
+
+	if (res) {
+		World_Reset();
+		Logger_Warn2(res, "decoding", &load_path);
+	}
+	World_SetNewMap(World.Blocks, World.Width, World.Height, World.Length);
+	LocalPlayer_MoveToSpawn();
+}
+
+static void Map_LoadSync(IMapImporter importer, const String* path) {
+	cc_result res;
+	if ((res = importer(&load_file))) {
+		World_Reset();
+		Logger_Warn2(res, "decoding", path);
+	}
+
+	res = load_file.Close(&load_file);
+	if (res) { Logger_Warn2(res, "closing", path); }
+
+	World_SetNewMap(World.Blocks, World.Width, World.Height, World.Length);
+	LocalPlayer_MoveToSpawn();
+}
+
+void Map_LoadFrom(const String* path) {
+	IMapImporter importer;
+	cc_result res;
+	int i;
+	if (load_active) return;
+	Game_Reset();
+	
+	res = Stream_OpenFile(&load_file, path);
+	if (res) { Logger_Warn2(res, "opening", path); return; }
+
+	importer    = Map_FindImporter(path);
+	load_format = NULL;
+	for (i = 0; i < Array_Elems(map_formats); i++) {
+		if (map_formats[i].importer == importer) load_format = &map_formats[i];
+	}
+	if (!load_format) { Map_LoadSync(importer, path); return; }
+
+	String_Copy(&load_path, path);
+	load_data        = NULL;
+	load_len         = 0;
+	load_active      = true;
+	Mem_Set(&load_layers, 0, sizeof(load_layers));
+	MapLoad_Done     = false;
+	MapLoad_Progress = 0.0f;
+	LoadingMapScreen_Show(path);
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Map export--------------------------------------------------------*
+*#########################################################################################################################*/
+enum MAPWRITER_UPPER { MAPWRITER_UPPER_NONE, MAPWRITER_UPPER_BLOCKS, MAPWRITER_UPPER_ZEROS };
+
+/* Writes a map file, where all data besides the blocks is encoded upfront */
+/* File is head, then lower 8 bits of blocks, then mid, then (optionally) upper 8 bits of blocks, then tail */
+struct MapWriter {
+	cc_uint8* data; /* Encoded head, mid, and tail data */
+	cc_uint32 len, capacity, headEnd, midEnd;
+	int upperMode, width, height, length;
+	cc_bool snapshot;        /* Whether to read blocks from the world snapshot, instead of from the world */
+	volatile float progress; /* Fraction of blocks written so far */
+};
+
+static void MapWriter_Init(struct MapWriter* w) {
+	w->data = NULL;
+	w->len  = 0; w->capacity = 0;
+	w->headEnd   = 0; w->midEnd = 0;
+	w->upperMode = MAPWRITER_UPPER_NONE;
+	w->snapshot  = false;
+	w->progress  = 0.0f;
+
+	w->width  = World.Width;
+	w->height = World.Height;
+	w->length = World.Length;
+}
+
+static void MapWriter_Append(struct MapWriter* w, const void* data, cc_uint32 len) {
+	if (w->len + len > w->capacity) {
+		w->capacity = max(w->capacity * 2, w->len + len);
+		w->data     = (cc_uint8*)Mem_Realloc(w->data, w->capacity, 1, "map metadata");
+	}
+	Mem_Copy(w->data + w->len, data, len);
+	w->len += len;
+}
+
+static void MapWriter_ReadLayer(struct MapWriter* w, int y, BlockRaw* layer, cc_bool upper) {
+	if (w->snapshot) {
+		World_ReadSnapshotLayer(y, layer, upper);
+	} else if (!upper) {
+		World_GetLayer(y, layer);
+	} else {
+#ifdef EXTENDED_BLOCKS
+		World_GetUpperLayer(y, layer);
+#endif
+	}
+}
+
+static cc_result MapWriter_Write(struct MapWriter* w, struct Stream* stream) {
+	int y, size = w->width * w->length;
+	int total   = w->upperMode ? w->height * 2 : w->height;
+	BlockRaw* layer;
+	cc_result res;
+
+	if ((res = Stream_Write(stream, w->data, w->headEnd))) return res;
+	layer = (BlockRaw*)Mem_Alloc(size, 1, "map layer");
+
+	for (y = 0; y < w->height && !res; y++) {
+		MapWriter_ReadLayer(w, y, layer, false);
+		res = Stream_Write(stream, layer, size);
+		w->progress = (float)y / total;
+	}
+	if (!res) res = Stream_Write(stream, w->data + w->headEnd, w->midEnd - w->headEnd);
+
+	if (w->upperMode == MAPWRITER_UPPER_ZEROS) Mem_Set(layer, 0, size);
+	for (y = 0; y < w->height && w->upperMode && !res; y++) {
+		if (w->upperMode == MAPWRITER_UPPER_BLOCKS) MapWriter_ReadLayer(w, y, layer, true);
+		res = Stream_Write(stream, layer, size);
+		w->progress = (float)(w->height + y) / total;
+	}
+	if (!res) res = Stream_Write(stream, w->data + w->midEnd, w->len - w->midEnd);
+
+	Mem_Free(layer);
+	return res;
+}
+
+static void MapWriter_Free(struct MapWriter* w) {
+	Mem_Free(w->data);
+	w->data = NULL;
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------ClassicWorld export----------------------------------------------------*
@@ -1036,8 +1360,7 @@ NBT_END,
 };
 
 
-static cc_result Cw_WriteBockDef(struct Stream* stream, int b) {
-	cc_uint8 tmp[512];
+static int Cw_WriteBockDef(cc_uint8* tmp, int b) {
 	String name;
 	int len;
 
@@ -1091,14 +1414,13 @@ static cc_result Cw_WriteBockDef(struct Stream* stream, int b) {
 
 	name = Block_UNSAFE_GetName(b);
 	len  = Cw_WriteEndString(&tmp[187], &name);
-	return Stream_Write(stream, tmp, sizeof(cw_meta_def) + len);
+	return sizeof(cw_meta_def) + len;
 }
 
-cc_result Cw_Save(struct Stream* stream) {
+static void Cw_Prepare(struct MapWriter* w) {
 	cc_uint8 tmp[768];
 	PackedCol col;
 	struct LocalPlayer* p = &LocalPlayer_Instance;
-	cc_result res;
 	int b, len;
 
 	Mem_Copy(tmp, cw_begin, sizeof(cw_begin));
@@ -1116,16 +1438,19 @@ cc_result Cw_Save(struct Stream* stream) {
 		tmp[107] = Math_Deg2Packed(p->SpawnYaw);
 		tmp[112] = Math_Deg2Packed(p->SpawnPitch);
 	}
-	if ((res = Stream_Write(stream, tmp,      sizeof(cw_begin)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume))) return res;
+	MapWriter_Append(w, tmp, sizeof(cw_begin));
+	w->headEnd = w->len;
 
-	if (World.Blocks != World.Blocks2) {
+#ifdef EXTENDED_BLOCKS
+	if (World.IDMask > 0xFF) {
 		Mem_Copy(tmp, cw_map2, sizeof(cw_map2));
 		Stream_SetU32_BE(&tmp[14], World.Volume);
 
-		if ((res = Stream_Write(stream, tmp,        sizeof(cw_map2)))) return res;
-		if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
+		MapWriter_Append(w, tmp, sizeof(cw_map2));
+		w->upperMode = MAPWRITER_UPPER_BLOCKS;
 	}
+#endif
+	w->midEnd = w->len;
 
 	Mem_Copy(tmp, cw_meta_cpe, sizeof(cw_meta_cpe));
 	{
@@ -1143,16 +1468,28 @@ cc_result Cw_Save(struct Stream* stream) {
 		Stream_SetU16_BE(&tmp[286], Env.EdgeHeight);
 	}
 	len = Cw_WriteEndString(&tmp[301], &World_TextureUrl);
-	if ((res = Stream_Write(stream, tmp, sizeof(cw_meta_cpe) + len))) return res;
+	MapWriter_Append(w, tmp, sizeof(cw_meta_cpe) + len);
 
-	if ((res = Stream_Write(stream, cw_meta_defs, sizeof(cw_meta_defs)))) return res;
+	MapWriter_Append(w, cw_meta_defs, sizeof(cw_meta_defs));
 	/* Write block definitions in reverse order so that software that only reads byte 'ID' */
 	/* still loads correct first 256 block defs when saving a map with over 256 block defs */
 	for (b = BLOCK_MAX_DEFINED; b >= 1; b--) {
 		if (!Block_IsCustomDefined(b)) continue;
-		if ((res = Cw_WriteBockDef(stream, b))) return res;
+		len = Cw_WriteBockDef(tmp, b);
+		MapWriter_Append(w, tmp, len);
 	}
-	return Stream_Write(stream, cw_end, sizeof(cw_end));
+	MapWriter_Append(w, cw_end, sizeof(cw_end));
+}
+
+cc_result Cw_Save(struct Stream* stream) {
+	struct MapWriter w;
+	cc_result res;
+
+	MapWriter_Init(&w);
+	Cw_Prepare(&w);
+	res = MapWriter_Write(&w, stream);
+	MapWriter_Free(&w);
+	return res;
 }
 
 
@@ -1177,10 +1514,8 @@ static cc_uint8 sc_end[37] = {
 NBT_END,
 };
 
-cc_result Schematic_Save(struct Stream* stream) {
-	cc_uint8 tmp[256], chunk[8192] = { 0 };
-	cc_result res;
-	int i;
+static void Schematic_Prepare(struct MapWriter* w) {
+	cc_uint8 tmp[256];
 
 	Mem_Copy(tmp, sc_begin, sizeof(sc_begin));
 	{
@@ -1189,18 +1524,122 @@ cc_result Schematic_Save(struct Stream* stream) {
 		Stream_SetU16_BE(&tmp[63], World.Length);
 		Stream_SetU32_BE(&tmp[74], World.Volume);
 	}
-	if ((res = Stream_Write(stream, tmp, sizeof(sc_begin)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume))) return res;
+	MapWriter_Append(w, tmp, sizeof(sc_begin));
+	w->headEnd = w->len;
 
 	Mem_Copy(tmp, sc_data, sizeof(sc_data));
 	{
 		Stream_SetU32_BE(&tmp[7], World.Volume);
 	}
-	if ((res = Stream_Write(stream, tmp, sizeof(sc_data)))) return res;
+	MapWriter_Append(w, tmp, sizeof(sc_data));
+	w->midEnd    = w->len;
+	w->upperMode = MAPWRITER_UPPER_ZEROS;
+
+	MapWriter_Append(w, sc_end, sizeof(sc_end));
+}
+
+cc_result Schematic_Save(struct Stream* stream) {
+	struct MapWriter w;
+	cc_result res;
+
+	MapWriter_Init(&w);
+	Schematic_Prepare(&w);
+	res = MapWriter_Write(&w, stream);
+	MapWriter_Free(&w);
+	return res;
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Background map export--------------------------------------------------*
+*#########################################################################################################################*/
+static struct MapWriter save_writer;
+static struct Stream save_file;
+static char save_pathBuffer[FILENAME_SIZE], save_tmpPathBuffer[FILENAME_SIZE + 4];
+static String save_path    = String_FromArray(save_pathBuffer);
+static String save_tmpPath = String_FromArray(save_tmpPathBuffer);
+static MapSaveCallback save_callback;
+static void* save_thread;
+static cc_bool save_active, save_addedTask;
+static volatile cc_bool save_finished;
+static cc_result save_result;
+static int save_level;
+
+static void MapSave_ThreadFunc(void) {
+	struct Stream compStream;
+	cc_result res, closeRes;
+
+	GZip_MakeParallelStream(&compStream, &save_file, save_level);
+	res = MapWriter_Write(&save_writer, &compStream);
+
+	/* Still need to close even on error, so that the compression worker threads are stopped */
+	closeRes = compStream.Close(&compStream);
+	if (!res) res = closeRes;
+	closeRes = save_file.Close(&save_file);
+	if (!res) res = closeRes;
+
+	save_result   = res;
+	save_finished = true;
+}
+
+static void MapSave_Tick(struct ScheduledTask* task) {
+	String msg; char msgBuffer[STRING_SIZE];
+	cc_result res;
+	int progress;
+	if (!save_active) return;
+
+	if (!save_finished) {
+		progress = (int)(save_writer.progress * 100);
+		String_InitArray(msg, msgBuffer);
+		String_Format1(&msg, "&eSaving map.. &7%i%%", &progress);
+		Chat_AddOf(&msg, MSG_TYPE_STATUS_2);
+		return;
+	}
+
+	Thread_Join(save_thread);
+	World_EndSnapshot();
+	MapWriter_Free(&save_writer);
+	save_active = false;
+	Chat_AddOf(&String_Empty, MSG_TYPE_STATUS_2);
+
+	/* Only replace the existing file once the new one has been fully written */
+	res = save_result;
+	if (!res) res = File_Rename(&save_tmpPath, &save_path);
+	/* Don't leave a partially written file behind */
+	if (res) File_Delete(&save_tmpPath);
+	save_callback(&save_path, res);
+}
+
+cc_bool Map_IsSaving(void) { return save_active; }
+
+cc_result Map_SaveAsync(const String* path, cc_bool schematic, MapSaveCallback callback) {
+	cc_result res;
+	if (save_active) return ERR_NOT_SUPPORTED;
+
+	String_Copy(&save_path, path);
+	save_tmpPath.length = 0;
+	String_Format1(&save_tmpPath, "%s.tmp", path);
 
-	for (i = 0; i < World.Volume; i += sizeof(chunk)) {
-		int count = World.Volume - i; count = min(count, sizeof(chunk));
-		if ((res = Stream_Write(stream, chunk, count))) return res;
+	res = Stream_CreateFile(&save_file, &save_tmpPath);
+	if (res) return res;
+
+	MapWriter_Init(&save_writer);
+	if (schematic) {
+		Schematic_Prepare(&save_writer);
+	} else {
+		Cw_Prepare(&save_writer);
 	}
-	return Stream_Write(stream, sc_end, sizeof(sc_end));
+	save_writer.snapshot = true;
+	World_BeginSnapshot();
+
+	if (!save_addedTask) {
+		ScheduledTask_Add(GAME_DEF_TICKS, MapSave_Tick);
+		save_addedTask = true;
+	}
+	save_level    = Options_GetInt(OPT_COMPRESSION_LEVEL, 0, DEFLATE_LEVEL_COUNT - 1, DEFLATE_LEVEL_DEFAULT);
+	save_callback = callback;
+	save_active   = true;
+	save_finished = false;
+	save_thread   = Thread_Start(MapSave_ThreadFunc, false);
+	return 0;
 }
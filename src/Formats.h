@@ -13,8 +13,21 @@ typedef cc_result (*IMapImporter)(struct Stream* stream);
 CC_API IMapImporter Map_FindImporter(const String* path);
 /* Attempts to import the map from the given file. */
 /* NOTE: Uses Map_FindImporter to import based on filename. */
+/* NOTE: The file is decompressed on a background thread, while LoadingMapScreen shows progress. */
 CC_API void Map_LoadFrom(const String* path);
 
+/* Fraction of the map file's compressed data read so far by the background loading thread. */
+extern volatile float MapLoad_Progress;
+/* Whether the background loading thread has finished decompressing the map file. */
+extern volatile cc_bool MapLoad_Done;
+/* Decompresses the map file into memory. (Runs on the background loading thread) */
+void MapLoad_Run(void);
+/* Decodes the decompressed map file, then sets it as the current map. (Must be called on main thread) */
+void MapLoad_Finish(void);
+/* Shows the bottom layers of the map decompressed so far, if the map's format allows it. (Must be called on main thread) */
+/* NOTE: Only .lvl maps are shown while loading, as other formats may store the dimensions after the blocks. */
+void MapLoad_ShowLayers(void);
+
 /* Imports a world from a .lvl MCSharp server map file. */
 /* Used by MCSharp/MCLawl/MCForge/MCDzienny/MCGalaxy. */
 cc_result Lvl_Load(struct Stream* stream);
@@ -34,4 +47,14 @@ cc_result Cw_Save(struct Stream* stream);
 /* Exports a world to a .schematic Schematic map file. */
 /* Used by MCEdit and other tools. */
 cc_result Schematic_Save(struct Stream* stream);
+
+/* Callback invoked on the main thread once a map has finished saving in the background. */
+typedef void (*MapSaveCallback)(const String* path, cc_result res);
+/* Whether a map is currently being saved in the background. */
+cc_bool Map_IsSaving(void);
+/* Starts exporting the world to a GZIP compressed .cw (or .schematic) file on a background thread. */
+/* Blocks are read from a world snapshot, so the world can still be modified while saving. */
+/* Data is written to a temp file first, which only replaces the given file once fully written. */
+/* NOTE: Fails with ERR_NOT_SUPPORTED if a map is already being saved. */
+cc_result Map_SaveAsync(const String* path, cc_bool schematic, MapSaveCallback callback);
 #endif
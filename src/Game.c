@@ -190,23 +190,94 @@ void Game_Reset(void) {
 	}
 }
 
+/* A block changed while in a block batch */
+struct BlockBatchChange { int hIndex; cc_uint16 x, y, z; };
+static struct BlockBatchChange* batchChanges;
+static int batchCount, batchCapacity, batchDepth;
+
+static void Game_AddBatched(int x, int y, int z) {
+	struct BlockBatchChange* change;
+	if (batchCount == batchCapacity) {
+		batchCapacity = max(256, batchCapacity * 2);
+		batchChanges  = (struct BlockBatchChange*)Mem_Realloc(batchChanges, batchCapacity,
+											sizeof(struct BlockBatchChange), "block batch");
+	}
+
+	change = &batchChanges[batchCount++];
+	change->hIndex = Lighting_Pack(x, z);
+	change->x = x; change->y = y; change->z = z;
+}
+
 void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 	struct ChunkInfo* chunk;
 	int cx = x >> 4, cy = y >> 4, cz = z >> 4;
 	BlockID old = World_GetBlock(x, y, z);
 	World_SetBlock(x, y, z, block);
+	Lighting_OnBlockChanged(x, y, z, old, block);
+
+	chunk = MapRenderer_GetChunk(cx, cy, cz);
+	chunk->AllAir &= Blocks.Draw[block] == DRAW_GAS;
+	if (batchDepth) { Game_AddBatched(x, y, z); return; }
 
 	if (Weather_Heightmap) {
 		EnvRenderer_OnBlockChanged(x, y, z, old, block);
 	}
-	Lighting_OnBlockChanged(x, y, z, old, block);
-
 	/* Refresh the chunk the block was located in. */
-	chunk = MapRenderer_GetChunk(cx, cy, cz);
-	chunk->AllAir &= Blocks.Draw[block] == DRAW_GAS;
 	MapRenderer_RefreshChunk(cx, cy, cz);
 }
 
+static void Game_SortChanges(int left, int right) {
+	struct BlockBatchChange* keys = batchChanges;
+	struct BlockBatchChange key;
+
+	while (left < right) {
+		int i = left, j = right;
+		int pivot = keys[(i + j) >> 1].hIndex;
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i].hIndex) i++;
+			while (pivot < keys[j].hIndex) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(Game_SortChanges)
+	}
+}
+
+void Game_BeginBlockBatch(void) {
+	batchDepth++;
+	Lighting_BeginBatch();
+}
+
+void Game_EndBlockBatch(void) {
+	struct BlockBatchChange* change;
+	int i, cx, cy, cz, maxY;
+	Lighting_EndBatch();
+	if (!batchDepth || --batchDepth) return;
+	if (!batchCount) return;
+
+	/* Group changes by column, so each column's rain height is only recalculated once */
+	Game_SortChanges(0, batchCount - 1);
+
+	for (i = 0; i < batchCount; ) {
+		change = &batchChanges[i];
+		cx = change->x >> 4; cz = change->z >> 4;
+		cy = change->y >> 4; maxY = change->y;
+		MapRenderer_RefreshChunk(cx, cy, cz);
+
+		for (i++; i < batchCount && batchChanges[i].hIndex == change->hIndex; i++) {
+			maxY = max(maxY, batchChanges[i].y);
+			if (cy == (batchChanges[i].y >> 4)) continue;
+
+			cy = batchChanges[i].y >> 4;
+			MapRenderer_RefreshChunk(cx, cy, cz);
+		}
+		if (Weather_Heightmap) EnvRenderer_OnColumnChanged(change->x, change->z, maxY);
+	}
+	batchCount = 0;
+}
+
 void Game_ChangeBlock(int x, int y, int z, BlockID block) {
 	BlockID old = World_GetBlock(x, y, z);
 	Game_UpdateBlock(x, y, z, block);
@@ -403,6 +474,7 @@ static void Game_Load(void) {
 	Game_AddComponent(&Animations_Component);
 	Game_AddComponent(&Inventory_Component);
 	Game_AddComponent(&Textures_Component);
+	Game_AddComponent(&World_Component);
 	World_Reset();
 
 	Game_AddComponent(&Builder_Component);
@@ -67,6 +67,12 @@ CC_API void Game_UpdateBlock(int x, int y, int z, BlockID block);
 /* Calls Game_UpdateBlock, then informs server connection of the block change. */
 /* In multiplayer this is sent to the server, in singleplayer just activates physics. */
 CC_API void Game_ChangeBlock(int x, int y, int z, BlockID block);
+/* Begins a batch of block changes. (e.g. bulk block update, /client cuboid) */
+/* Lighting is only updated once per changed column when Game_EndBlockBatch is called, */
+/* instead of after every single call to Game_UpdateBlock. Batches can be nested. */
+CC_API void Game_BeginBlockBatch(void);
+/* Ends a batch of block changes, then updates lighting and chunks affected by the changes. */
+CC_API void Game_EndBlockBatch(void);
 
 cc_bool Game_CanPick(BlockID block);
 cc_bool Game_UpdateTexture(GfxResourceID* texId, struct Stream* src, const String* file, cc_uint8* skinType);
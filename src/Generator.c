@@ -640,6 +640,7 @@ void NotchyGen_Generate(void) {
 *#########################################################################################################################*/
 BlockRaw* Tree_Blocks;
 RNGState* Tree_Rnd;
+#define TreeGen_GetBlock(index) (Tree_Blocks ? Tree_Blocks[index] : World_GetBlockAt(index))
 
 cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 	int baseHeight = treeHeight - 4;
@@ -653,7 +654,7 @@ cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (TreeGen_GetBlock(index) != BLOCK_AIR) return false;
 			}
 		}
 	}
@@ -665,7 +666,7 @@ cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (TreeGen_GetBlock(index) != BLOCK_AIR) return false;
 			}
 		}
 	}
@@ -19,6 +19,7 @@ extern BlockRaw* Gen_Blocks;
 void FlatgrassGen_Generate(void);
 void NotchyGen_Generate(void);
 
+/* Blocks that trees are generated in, or NULL to use the blocks of the current world. */
 extern BlockRaw* Tree_Blocks;
 extern RNGState* Tree_Rnd;
 /* Appropriate buffer size to hold positions and blocks generated by the tree generator. */
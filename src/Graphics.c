@@ -22,7 +22,7 @@ struct _GfxData Gfx;
 GfxResourceID Gfx_defaultIb;
 GfxResourceID Gfx_quadVb, Gfx_texVb;
 
-static const int strideSizes[2] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED };
+static const int strideSizes[3] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED, SIZEOF_VERTEX_PACKED };
 /* Current format and size of vertices */
 static int curStride, curFormat = -1;
 /* Whether mipmaps must be created for all dimensions down to 1x1 or not */
@@ -313,7 +313,8 @@ void Texture_RenderShaded(const struct Texture* tex, PackedCol shadeCol) {
 #include <d3d9types.h>
 
 /* https://docs.microsoft.com/en-us/windows/win32/direct3d9/d3dfvf-texcoordsizen */
-static DWORD d3d9_formatMappings[2] = { D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1 };
+/* NOTE: Fixed function pipeline requires float positions, so VERTEX_FORMAT_PACKED is unsupported */
+static DWORD d3d9_formatMappings[3] = { D3DFVF_XYZ | D3DFVF_DIFFUSE, D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1, 0 };
 
 static IDirect3D9* d3d;
 static IDirect3DDevice9* device;
@@ -676,6 +677,10 @@ void Gfx_SetAlphaTest(cc_bool enabled) {
 	IDirect3DDevice9_SetRenderState(device, D3DRS_ALPHATESTENABLE, enabled);
 }
 
+/* Lighting each vertex individually requires shaders */
+void Gfx_SetVertexLighting(cc_bool enabled) { }
+void Gfx_SetLightCols(PackedCol sun, PackedCol shadow) { }
+
 void Gfx_SetAlphaBlending(cc_bool enabled) {
 	if (gfx_alphaBlending == enabled) return;
 	gfx_alphaBlending = enabled;
@@ -844,6 +849,14 @@ void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
 		startVertex, 0, verticesCount, 0, verticesCount >> 1);
 }
 
+void Gfx_DrawIndexedTris_Multi(const int* counts, const int* startVertices, int drawsCount) {
+	int i;
+	for (i = 0; i < drawsCount; i++) {
+		IDirect3DDevice9_DrawIndexedPrimitive(device, D3DPT_TRIANGLELIST,
+			startVertices[i], 0, counts[i], 0, counts[i] >> 1);
+	}
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------Dynamic vertex buffers-------------------------------------------------*
@@ -871,6 +884,21 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	if (res) Logger_Abort2(res, "D3D9_SetDynamicVbData - Bind");
 }
 
+void Gfx_SetDynamicVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount) {
+	IDirect3DVertexBuffer9* buffer = (IDirect3DVertexBuffer9*)vb;
+	int offset = startVertex * strideSizes[fmt];
+	int size   = vCount * strideSizes[fmt];
+	void* dst  = NULL;
+
+	/* NOTE: Can't use D3DLOCK_NOOVERWRITE, since the range may have been drawn from in the last frame */
+	cc_result res = IDirect3DVertexBuffer9_Lock(buffer, offset, size, &dst, 0);
+	if (res) Logger_Abort2(res, "D3D9_SetDynamicVbRange - Lock");
+
+	Mem_Copy(dst, vertices, size);
+	res = IDirect3DVertexBuffer9_Unlock(buffer);
+	if (res) Logger_Abort2(res, "D3D9_SetDynamicVbRange - Unlock");
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------------Matrices--------------------------------------------------------*
@@ -1073,11 +1101,14 @@ typedef void (APIENTRY *FUNC_GLDELETEBUFFERS) (GLsizei n, const GLuint *buffers)
 typedef void (APIENTRY *FUNC_GLGENBUFFERS) (GLsizei n, GLuint *buffers);
 typedef void (APIENTRY *FUNC_GLBUFFERDATA) (GLenum target, cc_uintptr size, const GLvoid* data, GLenum usage);
 typedef void (APIENTRY *FUNC_GLBUFFERSUBDATA) (GLenum target, cc_uintptr offset, cc_uintptr size, const GLvoid* data);
+typedef void (APIENTRY *FUNC_GLMULTIDRAWELEMENTS) (GLenum mode, const GLsizei* count, GLenum type, const GLvoid* const* indices, GLsizei drawcount);
 static FUNC_GLBINDBUFFER    _glBindBuffer;
 static FUNC_GLDELETEBUFFERS _glDeleteBuffers;
 static FUNC_GLGENBUFFERS    _glGenBuffers;
 static FUNC_GLBUFFERDATA    _glBufferData;
 static FUNC_GLBUFFERSUBDATA _glBufferSubData;
+/* NULL when not supported (requires OpenGL 1.4 or GL_EXT_multi_draw_arrays) */
+static FUNC_GLMULTIDRAWELEMENTS _glMultiDrawElements;
 #endif
 
 #if defined CC_BUILD_WEB || defined CC_BUILD_ANDROID
@@ -1405,6 +1436,13 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	_glBindBuffer(_GL_ARRAY_BUFFER, (GLuint)vb);
 	_glBufferSubData(_GL_ARRAY_BUFFER, 0, size, vertices);
 }
+
+void Gfx_SetDynamicVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount) {
+	cc_uint32 offset = startVertex * strideSizes[fmt];
+	cc_uint32 size   = vCount * strideSizes[fmt];
+	_glBindBuffer(_GL_ARRAY_BUFFER, (GLuint)vb);
+	_glBufferSubData(_GL_ARRAY_BUFFER, offset, size, vertices);
+}
 #else
 GfxResourceID Gfx_CreateDynamicVb(VertexFormat fmt, int maxVertices) { 
 	return (GfxResourceID)Mem_Alloc(maxVertices, strideSizes[fmt], "creating dynamic vb");
@@ -1512,6 +1550,7 @@ void Gfx_OnWindowResize(void) {
 #define FTR_LINEAR_FOG (1 << 3)
 #define FTR_DENSIT_FOG (1 << 4)
 #define FTR_HASANY_FOG (FTR_LINEAR_FOG | FTR_DENSIT_FOG)
+#define FTR_VERTEX_LIT (1 << 5)
 #define FTR_FS_MEDIUMP (1 << 7)
 
 #define UNI_MVP_MATRIX (1 << 0)
@@ -1519,19 +1558,21 @@ void Gfx_OnWindowResize(void) {
 #define UNI_FOG_COL    (1 << 2)
 #define UNI_FOG_END    (1 << 3)
 #define UNI_FOG_DENS   (1 << 4)
-#define UNI_MASK_ALL   0x1F
+#define UNI_LIGHT_COLS (1 << 5)
+#define UNI_MASK_ALL   0x3F
 
 /* cached uniforms (cached for multiple programs */
 static struct Matrix _view, _proj, _tex, _mvp;
-static cc_bool gfx_alphaTest, gfx_texTransform;
+static cc_bool gfx_alphaTest, gfx_texTransform, gfx_vertexLighting;
+static PackedCol gfx_sunCol, gfx_shadowCol;
 
 /* shader programs (emulate fixed function) */
 static struct GLShader {
 	int features;     /* what features are enabled for this shader */
 	int uniforms;     /* which associated uniforms need to be resent to GPU */
 	GLuint program;   /* OpenGL program ID (0 if not yet compiled) */
-	int locations[5]; /* location of uniforms (not constant) */
-} shaders[6 * 3] = {
+	int locations[7]; /* location of uniforms (not constant) */
+} shaders[6 * 3 * 2] = {
 	/* no fog */
 	{ 0              },
 	{ 0              | FTR_ALPHA_TEST },
@@ -1553,6 +1594,27 @@ static struct GLShader {
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_MATRIX },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_MATRIX | FTR_ALPHA_TEST },
+	/* vertex lighting, no fog */
+	{ FTR_VERTEX_LIT | 0              },
+	{ FTR_VERTEX_LIT | 0              | FTR_ALPHA_TEST },
+	{ FTR_VERTEX_LIT | FTR_TEXTURE_UV },
+	{ FTR_VERTEX_LIT | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
+	{ FTR_VERTEX_LIT | FTR_TEXTURE_UV | FTR_TEX_MATRIX },
+	{ FTR_VERTEX_LIT | FTR_TEXTURE_UV | FTR_TEX_MATRIX | FTR_ALPHA_TEST },
+	/* vertex lighting, linear fog */
+	{ FTR_VERTEX_LIT | FTR_LINEAR_FOG | 0              },
+	{ FTR_VERTEX_LIT | FTR_LINEAR_FOG | 0              | FTR_ALPHA_TEST },
+	{ FTR_VERTEX_LIT | FTR_LINEAR_FOG | FTR_TEXTURE_UV },
+	{ FTR_VERTEX_LIT | FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
+	{ FTR_VERTEX_LIT | FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TEX_MATRIX },
+	{ FTR_VERTEX_LIT | FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TEX_MATRIX | FTR_ALPHA_TEST },
+	/* vertex lighting, density fog */
+	{ FTR_VERTEX_LIT | FTR_DENSIT_FOG | 0              },
+	{ FTR_VERTEX_LIT | FTR_DENSIT_FOG | 0              | FTR_ALPHA_TEST },
+	{ FTR_VERTEX_LIT | FTR_DENSIT_FOG | FTR_TEXTURE_UV },
+	{ FTR_VERTEX_LIT | FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
+	{ FTR_VERTEX_LIT | FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_MATRIX },
+	{ FTR_VERTEX_LIT | FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_MATRIX | FTR_ALPHA_TEST },
 };
 static struct GLShader* gfx_activeShader;
 
@@ -1560,6 +1622,7 @@ static struct GLShader* gfx_activeShader;
 static void GenVertexShader(const struct GLShader* shader, String* dst) {
 	int uv = shader->features & FTR_TEXTURE_UV;
 	int tm = shader->features & FTR_TEX_MATRIX;
+	int vl = shader->features & FTR_VERTEX_LIT;
 
 	String_AppendConst(dst,         "attribute vec3 in_pos;\n");
 	String_AppendConst(dst,         "attribute vec4 in_col;\n");
@@ -1568,10 +1631,16 @@ static void GenVertexShader(const struct GLShader* shader, String* dst) {
 	if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
 	String_AppendConst(dst,         "uniform mat4 mvp;\n");
 	if (tm) String_AppendConst(dst, "uniform mat4 texMatrix;\n");
+	if (vl) String_AppendConst(dst, "uniform vec3 sunCol;\n");
+	if (vl) String_AppendConst(dst, "uniform vec3 shadowCol;\n");
 
 	String_AppendConst(dst,         "void main() {\n");
 	String_AppendConst(dst,         "  gl_Position = mvp * vec4(in_pos, 1.0);\n");
-	String_AppendConst(dst,         "  out_col = in_col;\n");
+	if (!vl) String_AppendConst(dst, "  out_col = in_col;\n");
+	/* alpha is 0 to 254 for shadow to sun, or 255 for unlit */
+	if (vl) String_AppendConst(dst, "  float sun = in_col.a * (255.0 / 254.0);\n");
+	if (vl) String_AppendConst(dst, "  vec3 light = sun > 1.002 ? vec3(1.0) : mix(shadowCol, sunCol, sun);\n");
+	if (vl) String_AppendConst(dst, "  out_col = vec4(in_col.rgb * light, 1.0);\n");
 	if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
 	/* TODO: Fix this dirty hack for clouds */
 	if (tm) String_AppendConst(dst, "  out_uv = (texMatrix * vec4(out_uv,0.0,1.0)).xy;\n");
@@ -1697,6 +1766,8 @@ static void CompileProgram(struct GLShader* shader) {
 		shader->locations[2] = glGetUniformLocation(program, "fogCol");
 		shader->locations[3] = glGetUniformLocation(program, "fogEnd");
 		shader->locations[4] = glGetUniformLocation(program, "fogDensity");
+		shader->locations[5] = glGetUniformLocation(program, "sunCol");
+		shader->locations[6] = glGetUniformLocation(program, "shadowCol");
 		return;
 	}
 	temp = 0;
@@ -1746,6 +1817,13 @@ static void ReloadUniforms(void) {
 		glUniform1f(s->locations[4], -gfx_fogDensity);
 		s->uniforms &= ~UNI_FOG_DENS;
 	}
+	if ((s->uniforms & UNI_LIGHT_COLS) && (s->features & FTR_VERTEX_LIT)) {
+		glUniform3f(s->locations[5], PackedCol_R(gfx_sunCol) / 255.0f, PackedCol_G(gfx_sunCol) / 255.0f,
+										PackedCol_B(gfx_sunCol) / 255.0f);
+		glUniform3f(s->locations[6], PackedCol_R(gfx_shadowCol) / 255.0f, PackedCol_G(gfx_shadowCol) / 255.0f,
+										PackedCol_B(gfx_shadowCol) / 255.0f);
+		s->uniforms &= ~UNI_LIGHT_COLS;
+	}
 }
 
 /* Switches program to one that duplicates current fixed function state */
@@ -1758,8 +1836,9 @@ static void SwitchProgram(void) {
 		index += 6;                       /* linear fog */
 		if (gfx_fogMode >= 1) index += 6; /* exp fog */
 	}
+	if (gfx_vertexLighting) index += 18;
 
-	if (curFormat == VERTEX_FORMAT_TEXTURED) index += 2;
+	if (curFormat != VERTEX_FORMAT_COLOURED) index += 2;
 	if (gfx_texTransform) index += 2;
 	if (gfx_alphaTest)    index += 1;
 
@@ -1803,6 +1882,15 @@ void Gfx_SetFogMode(FogFunc func) {
 void Gfx_SetTexturing(cc_bool enabled) { }
 void Gfx_SetAlphaTest(cc_bool enabled) { gfx_alphaTest = enabled; SwitchProgram(); }
 
+void Gfx_SetVertexLighting(cc_bool enabled) { gfx_vertexLighting = enabled; SwitchProgram(); }
+void Gfx_SetLightCols(PackedCol sun, PackedCol shadow) {
+	if (sun == gfx_sunCol && shadow == gfx_shadowCol) return;
+	gfx_sunCol    = sun;
+	gfx_shadowCol = shadow;
+	DirtyUniform(UNI_LIGHT_COLS);
+	ReloadUniforms();
+}
+
 void Gfx_LoadMatrix(MatrixType type, struct Matrix* matrix) {
 	if (type == MATRIX_VIEW || type == MATRIX_PROJECTION) {
 		if (type == MATRIX_VIEW)       _view = *matrix;
@@ -1831,6 +1919,8 @@ static void GL_CheckSupport(void) {
 #ifndef CC_BUILD_GLES
 	customMipmapsLevels = true;
 #endif
+	Gfx.PackedVertices = true;
+	Gfx.VertexLighting = true;
 }
 
 static void Gfx_FreeState(void) {
@@ -1868,6 +1958,12 @@ static void GL_SetupVbTextured(void) {
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, (void*)16);
 }
 
+static void GL_SetupVbPacked(void) {
+	glVertexAttribPointer(0, 3, GL_SHORT,         false, SIZEOF_VERTEX_PACKED, (void*)0);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_PACKED, (void*)8);
+	glVertexAttribPointer(2, 2, GL_SHORT,         false, SIZEOF_VERTEX_PACKED, (void*)12);
+}
+
 static void GL_SetupVbColoured_Range(int startVertex) {
 	cc_uint32 offset = startVertex * SIZEOF_VERTEX_COLOURED;
 	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_COLOURED, (void*)(offset));
@@ -1881,6 +1977,13 @@ static void GL_SetupVbTextured_Range(int startVertex) {
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, (void*)(offset + 16));
 }
 
+static void GL_SetupVbPacked_Range(int startVertex) {
+	cc_uint32 offset = startVertex * SIZEOF_VERTEX_PACKED;
+	glVertexAttribPointer(0, 3, GL_SHORT,         false, SIZEOF_VERTEX_PACKED, (void*)(cc_uintptr)(offset));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_PACKED, (void*)(cc_uintptr)(offset + 8));
+	glVertexAttribPointer(2, 2, GL_SHORT,         false, SIZEOF_VERTEX_PACKED, (void*)(cc_uintptr)(offset + 12));
+}
+
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	if (fmt == curFormat) return;
 	curFormat = fmt;
@@ -1890,6 +1993,10 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 		glEnableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbTextured;
 		gfx_setupVBRangeFunc = GL_SetupVbTextured_Range;
+	} else if (fmt == VERTEX_FORMAT_PACKED) {
+		glEnableVertexAttribArray(2);
+		gfx_setupVBFunc      = GL_SetupVbPacked;
+		gfx_setupVBRangeFunc = GL_SetupVbPacked_Range;
 	} else {
 		glDisableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbColoured;
@@ -1915,19 +2022,26 @@ void Gfx_DrawVb_IndexedTris(int verticesCount) {
 
 void Gfx_BindVb_T2fC4b(GfxResourceID vb) {
 	Gfx_BindVb(vb);
-	GL_SetupVbTextured();
+	gfx_setupVBFunc();
 }
 
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
 	if (startVertex + verticesCount > GFX_MAX_VERTICES) {
-		GL_SetupVbTextured_Range(startVertex);
+		gfx_setupVBRangeFunc(startVertex);
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
-		GL_SetupVbTextured();
+		gfx_setupVBFunc();
 	} else {
 		/* ICOUNT(startVertex) * 2 = startVertex * 3  */
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, (void*)(startVertex * 3));
 	}
 }
+
+void Gfx_DrawIndexedTris_Multi(const int* counts, const int* startVertices, int drawsCount) {
+	int i;
+	for (i = 0; i < drawsCount; i++) {
+		glDrawElements(GL_TRIANGLES, ICOUNT(counts[i]), GL_UNSIGNED_SHORT, (void*)(cc_uintptr)(startVertices[i] * 3));
+	}
+}
 #endif
 
 
@@ -1974,6 +2088,10 @@ void Gfx_SetFogMode(FogFunc func) {
 void Gfx_SetTexturing(cc_bool enabled) { gl_Toggle(GL_TEXTURE_2D); }
 void Gfx_SetAlphaTest(cc_bool enabled) { gl_Toggle(GL_ALPHA_TEST); }
 
+/* Lighting each vertex individually requires shaders */
+void Gfx_SetVertexLighting(cc_bool enabled) { }
+void Gfx_SetLightCols(PackedCol sun, PackedCol shadow) { }
+
 static GLenum matrix_modes[3] = { GL_PROJECTION, GL_MODELVIEW, GL_TEXTURE };
 static int lastMatrix;
 
@@ -2043,6 +2161,12 @@ static void GL_SetupVbTextured(void) {
 	glTexCoordPointer(2, GL_FLOAT,      SIZEOF_VERTEX_TEXTURED, (void*)(VB_PTR + 16));
 }
 
+static void GL_SetupVbPacked(void) {
+	glVertexPointer(3, GL_SHORT,        SIZEOF_VERTEX_PACKED, (void*)(VB_PTR + 0));
+	glColorPointer(4, GL_UNSIGNED_BYTE, SIZEOF_VERTEX_PACKED, (void*)(VB_PTR + 8));
+	glTexCoordPointer(2, GL_SHORT,      SIZEOF_VERTEX_PACKED, (void*)(VB_PTR + 12));
+}
+
 static void GL_SetupVbColoured_Range(int startVertex) {
 	cc_uint32 offset = startVertex * SIZEOF_VERTEX_COLOURED;
 	glVertexPointer(3, GL_FLOAT,          SIZEOF_VERTEX_COLOURED, (void*)(VB_PTR + offset));
@@ -2056,6 +2180,13 @@ static void GL_SetupVbTextured_Range(int startVertex) {
 	glTexCoordPointer(2, GL_FLOAT,        SIZEOF_VERTEX_TEXTURED, (void*)(VB_PTR + offset + 16));
 }
 
+static void GL_SetupVbPacked_Range(int startVertex) {
+	cc_uint32 offset = startVertex * SIZEOF_VERTEX_PACKED;
+	glVertexPointer(3, GL_SHORT,          SIZEOF_VERTEX_PACKED, (void*)(cc_uintptr)(VB_PTR + offset));
+	glColorPointer(4, GL_UNSIGNED_BYTE,   SIZEOF_VERTEX_PACKED, (void*)(cc_uintptr)(VB_PTR + offset + 8));
+	glTexCoordPointer(2, GL_SHORT,        SIZEOF_VERTEX_PACKED, (void*)(cc_uintptr)(VB_PTR + offset + 12));
+}
+
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	if (fmt == curFormat) return;
 	curFormat = fmt;
@@ -2065,6 +2196,10 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 		gfx_setupVBFunc      = GL_SetupVbTextured;
 		gfx_setupVBRangeFunc = GL_SetupVbTextured_Range;
+	} else if (fmt == VERTEX_FORMAT_PACKED) {
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		gfx_setupVBFunc      = GL_SetupVbPacked;
+		gfx_setupVBRangeFunc = GL_SetupVbPacked_Range;
 	} else {
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		gfx_setupVBFunc      = GL_SetupVbColoured;
@@ -2095,15 +2230,37 @@ void Gfx_DrawVb_IndexedTris(int verticesCount) {
 
 #ifndef CC_BUILD_GL11
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
-	cc_uint32 offset = startVertex * SIZEOF_VERTEX_TEXTURED;
-	glVertexPointer(3, GL_FLOAT,        SIZEOF_VERTEX_TEXTURED, (void*)(offset));
-	glColorPointer(4, GL_UNSIGNED_BYTE, SIZEOF_VERTEX_TEXTURED, (void*)(offset + 12));
-	glTexCoordPointer(2, GL_FLOAT,      SIZEOF_VERTEX_TEXTURED, (void*)(offset + 16));
-	glDrawElements(GL_TRIANGLES,        ICOUNT(verticesCount),   GL_UNSIGNED_SHORT, NULL);
+	gfx_setupVBRangeFunc(startVertex);
+	glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
+}
+
+void Gfx_DrawIndexedTris_Multi(const int* counts, const int* startVertices, int drawsCount) {
+	GLsizei indicesCounts[256];
+	const GLvoid* indicesOffsets[256];
+	int i, j, count;
+	gfx_setupVBFunc();
+
+	if (!_glMultiDrawElements) {
+		for (i = 0; i < drawsCount; i++) {
+			/* ICOUNT(startVertex) * 2 = startVertex * 3  */
+			glDrawElements(GL_TRIANGLES, ICOUNT(counts[i]), GL_UNSIGNED_SHORT, (void*)(cc_uintptr)(startVertices[i] * 3));
+		}
+		return;
+	}
+
+	for (i = 0; i < drawsCount; i += count) {
+		count = min(drawsCount - i, (int)Array_Elems(indicesCounts));
+		for (j = 0; j < count; j++) {
+			indicesCounts[j]  = ICOUNT(counts[i + j]);
+			indicesOffsets[j] = (const GLvoid*)(cc_uintptr)(startVertices[i + j] * 3);
+		}
+		_glMultiDrawElements(GL_TRIANGLES, indicesCounts, GL_UNSIGNED_SHORT, indicesOffsets, count);
+	}
 }
 
 static void GL_CheckSupport(void) {
-	static const String vboExt = String_FromConst("GL_ARB_vertex_buffer_object");
+	static const String vboExt       = String_FromConst("GL_ARB_vertex_buffer_object");
+	static const String multiDrawExt = String_FromConst("GL_EXT_multi_draw_arrays");
 	String extensions  = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
 	const GLubyte* ver = glGetString(GL_VERSION);
 
@@ -2127,7 +2284,15 @@ static void GL_CheckSupport(void) {
 		Logger_Abort("Only OpenGL 1.1 supported.\n\n" \
 			"Compile the game with CC_BUILD_GL11, or ask on the classicube forums for it");
 	}
+
+	/* Supported in core since 1.4 */
+	if (major > 1 || (major == 1 && minor >= 4)) {
+		_glMultiDrawElements = (FUNC_GLMULTIDRAWELEMENTS)GLContext_GetAddress("glMultiDrawElements");
+	} else if (String_CaselessContains(&extensions, &multiDrawExt)) {
+		_glMultiDrawElements = (FUNC_GLMULTIDRAWELEMENTS)GLContext_GetAddress("glMultiDrawElementsEXT");
+	}
 	customMipmapsLevels = true;
+	Gfx.PackedVertices  = true;
 }
 #else
 void Gfx_DrawIndexedTris_T2fC4b(int list, int ignored) { glCallList(list); }
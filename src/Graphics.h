@@ -10,7 +10,7 @@
 struct Stream;
 
 typedef enum VertexFormat_ {
-	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED
+	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED, VERTEX_FORMAT_PACKED
 } VertexFormat;
 typedef enum FogFunc_ {
 	FOG_LINEAR, FOG_EXP, FOG_EXP2
@@ -21,11 +21,15 @@ typedef enum MatrixType_ {
 
 #define SIZEOF_VERTEX_COLOURED 16
 #define SIZEOF_VERTEX_TEXTURED 24
+#define SIZEOF_VERTEX_PACKED   16
 
 /* 3 floats for position (XYZ), 4 bytes for colour. */
 struct VertexColoured { float X, Y, Z; PackedCol Col; };
 /* 3 floats for position (XYZ), 2 floats for texture coordinates (UV), 4 bytes for colour. */
 struct VertexTextured { float X, Y, Z; PackedCol Col; float U, V; };
+/* 3 shorts for position (XYZ), 1 short padding, 4 bytes for colour, 2 shorts for texture coordinates (UV). */
+/* NOTE: Values are in fixed point, so the view and texture matrices must scale them when drawing. */
+struct VertexPacked { cc_int16 X, Y, Z, Pad; PackedCol Col; cc_int16 U, V; };
 
 void Gfx_Init(void);
 void Gfx_Free(void);
@@ -44,6 +48,12 @@ CC_VAR extern struct _GfxData {
 	/* Whether Gfx_Init has been called to initialise state. */
 	cc_bool Initialised;
 	struct Matrix View, Projection;
+	/* Whether vertices can be drawn using VERTEX_FORMAT_PACKED. */
+	/* If not, VERTEX_FORMAT_TEXTURED must be used instead. */
+	cc_bool PackedVertices;
+	/* Whether vertex colours can be lit using the sun and shadow colours when drawing. */
+	/* If not, the lighting must be baked into the vertex colours instead. */
+	cc_bool VertexLighting;
 } Gfx;
 
 #define GFX_APIINFO_LINES 7
@@ -93,6 +103,12 @@ CC_API void Gfx_SetFogMode(FogFunc func);
 CC_API void Gfx_SetFaceCulling(cc_bool enabled);
 /* Sets whether pixels with an alpha of less than 128 are discarded. */
 CC_API void Gfx_SetAlphaTest(cc_bool enabled);
+/* Sets whether the RGB of vertex colours is multiplied by a mix of the sun and shadow colours. */
+/* The alpha of a vertex colour is then how lit by the sun it is (0 to 254), or 255 for no lighting. */
+/* NOTE: Only does anything when Gfx.VertexLighting is true. Resulting alpha is always 255. */
+CC_API void Gfx_SetVertexLighting(cc_bool enabled);
+/* Sets the colours that vertices are lit with. (see Gfx_SetVertexLighting) */
+CC_API void Gfx_SetLightCols(PackedCol sun, PackedCol shadow);
 /* Sets whether existing and new pixels are blended together. */
 CC_API void Gfx_SetAlphaBlending(cc_bool enabled);
 /* Sets whether blending between the alpha components of texture and vertex colour is performed. */
@@ -167,7 +183,16 @@ CC_API void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex);
 /* Renders vertices from the currently bound vertex and index buffer as triangles. */
 CC_API void Gfx_DrawVb_IndexedTris(int verticesCount);
 /* Special case Gfx_DrawVb_IndexedTris_Range for map renderer */
+/* NOTE: Current vertex format must be VERTEX_FORMAT_TEXTURED or VERTEX_FORMAT_PACKED */
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex);
+#ifndef CC_BUILD_GL11
+/* Special case Gfx_SetDynamicVbData for map renderer, which only updates some of the vertices. */
+void Gfx_SetDynamicVbRange(GfxResourceID vb, VertexFormat fmt, int startVertex, void* vertices, int vCount);
+/* Special case Gfx_DrawIndexedTris_T2fC4b for map renderer, which draws several ranges of vertices at once. */
+/* (using glMultiDrawElements when supported) */
+/* NOTE: startVertex + count must not exceed GFX_MAX_VERTICES for any of the ranges. */
+void Gfx_DrawIndexedTris_Multi(const int* counts, const int* startVertices, int drawsCount);
+#endif
 
 /* Loads the given matrix over the currently active matrix. */
 CC_API void Gfx_LoadMatrix(MatrixType type, struct Matrix* matrix);
@@ -30,10 +30,10 @@ static int Lighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
 #ifndef EXTENDED_BLOCKS
 	Lighting_CalcBody(World.Blocks[i]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World.Sections) {
 		Lighting_CalcBody(World.Blocks[i]);
 	} else {
-		Lighting_CalcBody(World.Blocks[i] | (World.Blocks2[i] << 8));
+		Lighting_CalcBody(World_GetSectionBlock(x, y, z));
 	}
 #endif
 
@@ -44,7 +44,8 @@ static int Lighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
 static int Lighting_GetLightHeight(int x, int z) {
 	int hIndex = Lighting_Pack(x, z);
 	int lightH = Lighting_Heightmap[hIndex];
-	return lightH == HEIGHT_UNCALCULATED ? Lighting_CalcHeightAt(x, World.Height - 1, z, hIndex) : lightH;
+	/* Layers above LoadedHeight may still be being loaded, see World_BeginProgressiveMap */
+	return lightH == HEIGHT_UNCALCULATED ? Lighting_CalcHeightAt(x, World.LoadedHeight - 1, z, hIndex) : lightH;
 }
 
 /* Outside colour is same as sunlight colour, so we reuse when possible */
@@ -138,17 +139,18 @@ for (; y >= minY; y--, i -= World.OneY) {\
 	if (affected) return true;\
 }
 
-static cc_bool Lighting_NeedsNeighour(BlockID block, int i, int minY, int y, int nY) {
+static cc_bool Lighting_NeedsNeighour(BlockID block, int x, int z, int minY, int y, int nY) {
+	int i = World_Pack(x, y, z);
 	BlockID other;
 	cc_bool affected;
 
 #ifndef EXTENDED_BLOCKS
 	Lighting_NeedsNeighourBody(World.Blocks[i]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World.Sections) {
 		Lighting_NeedsNeighourBody(World.Blocks[i]);
 	} else {
-		Lighting_NeedsNeighourBody(World.Blocks[i] | (World.Blocks2[i] << 8));
+		Lighting_NeedsNeighourBody(World_GetSectionBlock(x, y, z));
 	}
 #endif
 	return false;
@@ -160,7 +162,7 @@ static void Lighting_ResetNeighbour(int x, int y, int z, BlockID block, int cx,
 	if (minCy == maxCy) {
 		minY = cy << CHUNK_SHIFT;
 
-		if (Lighting_NeedsNeighour(block, World_Pack(x, y, z), minY, y, y)) {
+		if (Lighting_NeedsNeighour(block, x, z, minY, y, y)) {
 			MapRenderer_RefreshChunk(cx, cy, cz);
 		}
 	} else {
@@ -169,7 +171,7 @@ static void Lighting_ResetNeighbour(int x, int y, int z, BlockID block, int cx,
 			maxY = (cy << CHUNK_SHIFT) + CHUNK_MAX;
 			if (maxY > World.MaxY) maxY = World.MaxY;
 
-			if (Lighting_NeedsNeighour(block, World_Pack(x, maxY, z), minY, maxY, y)) {
+			if (Lighting_NeedsNeighour(block, x, z, minY, maxY, y)) {
 				MapRenderer_RefreshChunk(cx, cy, cz);
 			}
 		}
@@ -218,6 +220,9 @@ static void Lighting_RefreshAffected(int x, int y, int z, BlockID block, int old
 	}
 }
 
+static void Lighting_AddBatched(int x, int y, int z);
+static int batchDepth;
+
 void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
 	int hIndex = Lighting_Pack(x, z);
 	int lightH = Lighting_Heightmap[hIndex];
@@ -226,6 +231,7 @@ void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newB
 	/* Since light wasn't checked to begin with, means column never had meshes for any of its chunks built. */
 	/* So we don't need to do anything. */
 	if (lightH == HEIGHT_UNCALCULATED) return;
+	if (batchDepth) { Lighting_AddBatched(x, y, z); return; }
 
 	Lighting_UpdateLighting(x, y, z, oldBlock, newBlock, hIndex, lightH);
 	newHeight = Lighting_Heightmap[hIndex] + 1;
@@ -233,6 +239,104 @@ void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newB
 }
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------Batched update------------------------------------------------------*
+*#########################################################################################################################*/
+/* A block changed while in a batch */
+struct LightingChange { int hIndex; cc_uint16 x, y, z; };
+static struct LightingChange* batchChanges;
+static int batchCount, batchCapacity;
+
+static void Lighting_AddBatched(int x, int y, int z) {
+	struct LightingChange* change;
+	if (batchCount == batchCapacity) {
+		batchCapacity = max(256, batchCapacity * 2);
+		batchChanges  = (struct LightingChange*)Mem_Realloc(batchChanges, batchCapacity,
+											sizeof(struct LightingChange), "lighting batch");
+	}
+
+	change = &batchChanges[batchCount++];
+	change->hIndex = Lighting_Pack(x, z);
+	change->x = x; change->y = y; change->z = z;
+}
+
+static void Lighting_SortChanges(int left, int right) {
+	struct LightingChange* keys = batchChanges;
+	struct LightingChange key;
+
+	while (left < right) {
+		int i = left, j = right;
+		int pivot = keys[(i + j) >> 1].hIndex;
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i].hIndex) i++;
+			while (pivot < keys[j].hIndex) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(Lighting_SortChanges)
+	}
+}
+
+static void Lighting_RefreshColumn(int cx, int cz, int minCy, int maxCy) {
+	int cy;
+	for (cy = minCy; cy <= maxCy; cy++) {
+		MapRenderer_RefreshChunk(cx, cy, cz);
+	}
+}
+
+/* Recalculates light height of a column changed in a batch, then refreshes all chunks that may be affected */
+/* NOTE: This conservatively refreshes neighbouring chunks, instead of checking which are actually affected */
+/* NOTE: Layers past World.LoadedHeight are skipped, as they may still be being loaded */
+static void Lighting_UpdateColumn(int x, int z, int minY, int maxY) {
+	int hIndex = Lighting_Pack(x, z);
+	int oldCy  = (Lighting_Heightmap[hIndex] + 1) >> CHUNK_SHIFT;
+	int newCy  = (Lighting_CalcHeightAt(x, World.LoadedHeight - 1, z, hIndex) + 1) >> CHUNK_SHIFT;
+	int cx = x >> CHUNK_SHIFT, bX = x & CHUNK_MASK;
+	int cz = z >> CHUNK_SHIFT, bZ = z & CHUNK_MASK;
+	int minCy, maxCy;
+
+	minCy = min(min(oldCy, newCy), minY >> CHUNK_SHIFT);
+	maxCy = max(max(oldCy, newCy), maxY >> CHUNK_SHIFT);
+	/* Chunks above/below may have faces that were hidden by changed blocks */
+	if ((minY & CHUNK_MASK) == 0)         minCy--;
+	if ((maxY & CHUNK_MASK) == CHUNK_MAX) maxCy++;
+	minCy = max(minCy, 0);
+	maxCy = min(maxCy, MapRenderer_ChunksY - 1);
+
+	Lighting_RefreshColumn(cx, cz, minCy, maxCy);
+	if (bX == 0         && cx > 0)                       Lighting_RefreshColumn(cx - 1, cz, minCy, maxCy);
+	if (bZ == 0         && cz > 0)                       Lighting_RefreshColumn(cx, cz - 1, minCy, maxCy);
+	if (bX == CHUNK_MAX && cx < MapRenderer_ChunksX - 1) Lighting_RefreshColumn(cx + 1, cz, minCy, maxCy);
+	if (bZ == CHUNK_MAX && cz < MapRenderer_ChunksZ - 1) Lighting_RefreshColumn(cx, cz + 1, minCy, maxCy);
+}
+
+void Lighting_BeginBatch(void) { batchDepth++; }
+
+void Lighting_EndBatch(void) {
+	struct LightingChange* change;
+	int i, minY, maxY;
+	if (!batchDepth || --batchDepth) return;
+	if (!batchCount) return;
+
+	/* Group changes by column, so each column's light height is only recalculated once */
+	Lighting_SortChanges(0, batchCount - 1);
+
+	for (i = 0; i < batchCount; ) {
+		change = &batchChanges[i];
+		minY   = change->y; maxY = change->y;
+
+		for (i++; i < batchCount && batchChanges[i].hIndex == change->hIndex; i++) {
+			minY = min(minY, batchChanges[i].y);
+			maxY = max(maxY, batchChanges[i].y);
+		}
+		Lighting_UpdateColumn(change->x, change->z, minY, maxY);
+	}
+	batchCount = 0;
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Lighting heightmap----------------------------------------------------*
 *#########################################################################################################################*/
@@ -261,7 +365,7 @@ static int Lighting_InitialHeightmapCoverage(int x1, int z1, int xCount, int zCo
 }
 
 #define Lighting_CalculateBody(get_block)\
-for (y = World.Height - 1; y >= 0; y--) {\
+for (y = World.LoadedHeight - 1; y >= 0; y--) {\
 	if (elemsLeft <= 0) { return true; } \
 	mapIndex = World_Pack(x1, y, z1);\
 	hIndex   = Lighting_Pack(x1, z1);\
@@ -312,10 +416,10 @@ static cc_bool Lighting_CalculateHeightmapCoverage(int x1, int z1, int xCount, i
 #ifndef EXTENDED_BLOCKS
 	Lighting_CalculateBody(World.Blocks[mapIndex]);
 #else
-	if (World.IDMask <= 0xFF) {
+	if (!World.Sections) {
 		Lighting_CalculateBody(World.Blocks[mapIndex]);
 	} else {
-		Lighting_CalculateBody(World.Blocks[mapIndex] | (World.Blocks2[mapIndex] << 8));
+		Lighting_CalculateBody(World_GetSectionBlock(x1 + x, y, z1 + z));
 	}
 #endif
 	return false;
@@ -355,16 +459,76 @@ void Lighting_LightHint(int startX, int startZ) {
 static void Lighting_Reset(void) {
 	Mem_Free(Lighting_Heightmap);
 	Lighting_Heightmap = NULL;
+	/* Changes in a batch are meaningless once the map is gone */
+	batchCount = 0;
 }
 
 static void Lighting_OnNewMapLoaded(void) {
+	/* Heightmap was already allocated if the map was progressively loaded */
+	Mem_Free(Lighting_Heightmap);
 	Lighting_Heightmap = (cc_int16*)Mem_Alloc(World.Width * World.Length, 2, "lighting heightmap");
 	Lighting_Refresh();
 }
 
+static void Lighting_OnLayersLoaded(void* obj, int height) {
+	if (!height) { Lighting_OnNewMapLoaded(); return; }
+	/* Columns may have higher blocks in the newly loaded layers, so all heights need recalculating */
+	Lighting_Refresh();
+}
+
+/* Marks light heights of the given 16x16 column of sections as needing recalculating, */
+/*  then refreshes all chunks that may be affected (including chunks in the columns around) */
+static void Lighting_RefreshSectionColumn(int sx, int sz) {
+	int x1 = sx << CHUNK_SHIFT, x2 = min(x1 + CHUNK_SIZE, World.Width);
+	int z1 = sz << CHUNK_SHIFT, z2 = min(z1 + CHUNK_SIZE, World.Length);
+	int x, z;
+
+	for (z = z1; z < z2; z++) {
+		for (x = x1; x < x2; x++) {
+			Lighting_Heightmap[Lighting_Pack(x, z)] = HEIGHT_UNCALCULATED;
+		}
+	}
+
+	for (z = sz - 1; z <= sz + 1; z++) {
+		for (x = sx - 1; x <= sx + 1; x++) {
+			Lighting_RefreshColumn(x, z, 0, MapRenderer_ChunksY - 1);
+		}
+	}
+}
+
+/* Only columns containing blocks which changed whether they block light need their heights recalculated */
+static void Lighting_OnBlockDefChanged(void* obj) {
+	cc_uint64 changed = Blocks.LightChangedMask;
+	int sx, sy, sz;
+	if (!changed || !Lighting_Heightmap) return;
+
+	for (sz = 0; sz < World.SectionsZ; sz++) {
+		for (sx = 0; sx < World.SectionsX; sx++) {
+			for (sy = 0; sy < World.SectionsY; sy++) {
+				if (World_GetSectionBlocks(sx, sy, sz) & changed) break;
+			}
+			if (sy < World.SectionsY) Lighting_RefreshSectionColumn(sx, sz);
+		}
+	}
+}
+
+static void Lighting_Init(void) {
+	Event_RegisterInt(&WorldEvents.LayersLoaded,     NULL, Lighting_OnLayersLoaded);
+	Event_RegisterVoid(&BlockEvents.BlockDefChanged, NULL, Lighting_OnBlockDefChanged);
+}
+
+static void Lighting_Free(void) {
+	Event_UnregisterInt(&WorldEvents.LayersLoaded,     NULL, Lighting_OnLayersLoaded);
+	Event_UnregisterVoid(&BlockEvents.BlockDefChanged, NULL, Lighting_OnBlockDefChanged);
+	Lighting_Reset();
+	Mem_Free(batchChanges);
+	batchChanges  = NULL;
+	batchCapacity = 0;
+}
+
 struct IGameComponent Lighting_Component = {
-	NULL,           /* Init  */
-	Lighting_Reset, /* Free  */
+	Lighting_Init,  /* Init  */
+	Lighting_Free,  /* Free  */
 	Lighting_Reset, /* Reset */
 	Lighting_Reset, /* OnNewMap */
 	Lighting_OnNewMapLoaded /* OnNewMapLoaded */
@@ -20,6 +20,11 @@ void Lighting_LightHint(int startX, int startZ);
 /* Called when a block is changed, to update the lighting information. */
 /* NOTE: Implementations ***MUST*** mark all chunks affected by this lighting changeas needing to be refreshed. */
 void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+/* Begins deferring lighting updates from Lighting_OnBlockChanged. (Batches can be nested) */
+void Lighting_BeginBatch(void);
+/* Ends a batch, then recalculates light height of each changed column once, */
+/* and marks all chunks affected by the changes as needing to be refreshed. */
+void Lighting_EndBatch(void);
 void Lighting_Refresh(void);
 
 /* Returns whether the block at the given coordinates is fully in sunlight. */
@@ -17,6 +17,7 @@
 
 int MapRenderer_ChunksX, MapRenderer_ChunksY, MapRenderer_ChunksZ;
 int MapRenderer_1DUsedCount, MapRenderer_ChunksCount;
+int MapRenderer_1DUsedAtlases[ATLAS1D_MAX_ATLASES];
 struct ChunkPartInfo* MapRenderer_PartsNormal;
 struct ChunkPartInfo* MapRenderer_PartsTranslucent;
 
@@ -43,8 +44,33 @@ static struct ChunkInfo** renderChunks;
 static int renderChunksCount;
 /* Distance of each chunk from the camera. */
 static cc_uint32* distances;
+/* Number of actually used pointers in the sortedChunks array. */
+static int sortedCount;
+/* Number of chunks at the start of sortedChunks that are within build or render distance. */
+/* Chunks past this are neither built nor rendered, so are skipped when updating chunks. */
+static int nearChunksCount;
+
+/* Offset of a chunk from the chunk the camera is in, in units of chunks */
+struct ChunkOffset { cc_int16 x, y, z; };
+/* Offsets of all chunks within chunkOffsetsDist of the camera's chunk, sorted by distance. */
+/* Re-anchoring this at the camera's chunk is much faster than sorting all the chunks in the map. */
+static struct ChunkOffset* chunkOffsets;
+static int chunkOffsetsCount, chunkOffsetsDist = -1;
 /* Maximum number of chunk updates that can be performed in one frame. */
 static int maxChunkUpdates;
+#define MAX_CHUNK_UPDATES 1024
+/* Whether chunks hidden from the camera by other chunks need to be recalculated. */
+static cc_bool occlusionDirty;
+
+/* Chunks are grouped into cubic regions of 8x8x8 chunks, so that all the chunks */
+/*  in a region outside the view frustum can be culled with just one test. */
+#define REGION_SHIFT (CHUNK_SHIFT + 3)
+#define REGION_HALF_SIZE ((1 << REGION_SHIFT) / 2)
+struct ChunkRegion { cc_uint32 frame; cc_bool inFrustum; };
+static struct ChunkRegion* regions;
+static int regionsX, regionsY;
+/* Regions whose frame differs from this have not been tested against the view frustum yet */
+static cc_uint32 regionsFrame;
 
 struct ChunkInfo* MapRenderer_GetChunk(int cx, int cy, int cz) {
 	return &mapChunks[MapRenderer_Pack(cx, cy, cz)];
@@ -55,26 +81,56 @@ static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->CentreZ = z + HALF_CHUNK_SIZE;
 #ifndef CC_BUILD_GL11
 	chunk->Vb = 0;
+	chunk->ArenaPage = NULL;
 #endif
 
 	chunk->Visible = true;        chunk->Empty = false;
 	chunk->PendingDelete = false; chunk->AllAir = false;
+	/* Chunk is not drawn until CalcOcclusion has reached it */
+	chunk->Building = false;      chunk->Occluded = true;
 	chunk->DrawXMin = false; chunk->DrawXMax = false; chunk->DrawZMin = false;
 	chunk->DrawZMax = false; chunk->DrawYMin = false; chunk->DrawYMax = false;
+	/* Assume chunk can be seen through, until its mesh has been built */
+	Mem_Set(chunk->Connections, CHUNK_ALL_FACES, FACE_COUNT);
 
 	chunk->NormalParts      = NULL;
 	chunk->TranslucentParts = NULL;
 }
 
-/* Index of maximum used 1D atlas + 1 */
-CC_NOINLINE static int MapRenderer_UsedAtlases(void) {
-	TextureLoc maxLoc = 0;
-	int i;
+/* Finds which 1D atlases contain the textures of at least one block, returning how many do */
+/* NOTE: Only storing parts for these atlases matters with one tile per atlas (greedy meshing), */
+/*  as then the max used atlas is the max used tile, and most tiles below it are unused */
+CC_NOINLINE static int CalcUsedAtlases(int* atlases, int shift) {
+	cc_bool used[ATLAS1D_MAX_ATLASES] = { 0 };
+	int i, count = 0;
 
 	for (i = 0; i < Array_Elems(Blocks.Textures); i++) {
-		maxLoc = max(maxLoc, Blocks.Textures[i]);
+		used[Blocks.Textures[i] >> shift] = true;
+	}
+	for (i = 0; i < ATLAS1D_MAX_ATLASES; i++) {
+		if (used[i]) atlases[count++] = i;
+	}
+	return count;
+}
+
+static void UpdateUsedAtlases(void) {
+	MapRenderer_1DUsedCount = CalcUsedAtlases(MapRenderer_1DUsedAtlases, Atlas1D.Shift);
+}
+
+static cc_bool UsedAtlasesChanged(void) {
+	int atlases[ATLAS1D_MAX_ATLASES];
+	int i, count = CalcUsedAtlases(atlases, Atlas1D.Shift);
+	if (count != MapRenderer_1DUsedCount) return true;
+
+	for (i = 0; i < count; i++) {
+		if (atlases[i] != MapRenderer_1DUsedAtlases[i]) return true;
 	}
-	return Atlas1D_Index(maxLoc) + 1;
+	return false;
+}
+
+int MapRenderer_CountUsedAtlases(int tilesPerAtlas) {
+	int atlases[ATLAS1D_MAX_ATLASES];
+	return CalcUsedAtlases(atlases, Math_Log2(tilesPerAtlas));
 }
 
 
@@ -98,6 +154,272 @@ static void CheckWeather(double delta) {
 	Gfx_SetAlphaBlending(false);
 }
 
+/* Vertex format of chunk meshes built by Builder.c */
+#define ChunkVertexFormat() (Gfx.PackedVertices ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_TEXTURED)
+
+static void BeginChunks(void) {
+	struct Matrix m;
+	if (Builder_VertexLighting) {
+		Gfx_SetLightCols(Env.SunCol, Env.ShadowCol);
+		Gfx_SetVertexLighting(true);
+	}
+	if (!Gfx.PackedVertices) return;
+
+	/* Packed vertices are in fixed point, so texture coordinates must be scaled back into the atlas */
+	m = Matrix_Identity;
+	m.Row0.X = 1.0f / BUILDER_PACKED_U_UNITS;
+	m.Row1.Y = 1.0f / (Builder_PackedVUnits() * Atlas1D.TilesPerAtlas);
+	Gfx_LoadMatrix(MATRIX_TEXTURE, &m);
+}
+
+static void EndChunks(void) {
+	if (Builder_VertexLighting) Gfx_SetVertexLighting(false);
+	if (!Gfx.PackedVertices) return;
+	Gfx_LoadIdentityMatrix(MATRIX_TEXTURE);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+}
+
+#ifndef CC_BUILD_GL11
+/* Packed vertices are relative to their region's origin and in fixed point, so must be moved back into the world */
+static void LoadOriginMatrix(int x, int y, int z) {
+	struct Matrix scale, translate, m;
+	Matrix_Scale(&scale, 1.0f / BUILDER_PACKED_POS_UNITS, 1.0f / BUILDER_PACKED_POS_UNITS, 1.0f / BUILDER_PACKED_POS_UNITS);
+	Matrix_Translate(&translate, (float)x, (float)y, (float)z);
+	Matrix_Mul(&m, &scale, &translate);
+	Matrix_MulBy(&m, &Gfx.View);
+	Gfx_LoadMatrix(MATRIX_VIEW, &m);
+}
+
+static void LoadChunkMatrix(struct ChunkInfo* info) {
+	if (!Gfx.PackedVertices) return;
+	LoadOriginMatrix(Builder_PackedOrigin(info->CentreX - 8), Builder_PackedOrigin(info->CentreY - 8), 
+					Builder_PackedOrigin(info->CentreZ - 8));
+}
+#endif
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Chunk arena-------------------------------------------------------*
+*#########################################################################################################################*/
+cc_bool MapRenderer_ChunkArena;
+#ifndef CC_BUILD_GL11
+/* Number of vertices in each shared vertex buffer. Larger meshes use their own vertex buffer instead. */
+#define ARENA_PAGE_VERTICES 16384
+/* Pages with at most this many vertices used that are too fragmented to fit a mesh are repacked */
+#define ARENA_REPACK_VERTICES (ARENA_PAGE_VERTICES / 2)
+/* A range of vertices in a shared vertex buffer */
+struct ArenaRange { int offset, count; };
+
+/* A shared vertex buffer that the meshes of chunks in the same region are sub-allocated from */
+struct ChunkArenaPage {
+	GfxResourceID vb;
+	int originX, originY, originZ; /* see Builder_PackedOrigin */
+	int usedVertices;
+	/* Whether no more meshes are allocated from this page, as it is being repacked */
+	cc_bool retired;
+	/* Unused ranges of vertices, sorted by offset. Adjacent unused ranges are always merged together. */
+	struct ArenaRange* free;
+	int freeCount, freeCapacity;
+	/* Ranges of vertices to draw in the current batch */
+	int* drawCounts;
+	int* drawStarts;
+	int drawsCount, drawsCapacity;
+	struct ChunkArenaPage* next;
+	struct ChunkArenaPage* nextPending;
+};
+static struct ChunkArenaPage* arenaPages;
+/* Pages which have ranges of vertices to draw in the current batch */
+static struct ChunkArenaPage* pendingPages;
+
+static void ArenaPage_InsertFree(struct ChunkArenaPage* page, int i, int offset, int count) {
+	int j;
+	if (page->freeCount == page->freeCapacity) {
+		page->freeCapacity += 16;
+		page->free = (struct ArenaRange*)Mem_Realloc(page->free, page->freeCapacity,
+												sizeof(struct ArenaRange), "arena free ranges");
+	}
+
+	for (j = page->freeCount; j > i; j--) { page->free[j] = page->free[j - 1]; }
+	page->free[i].offset = offset;
+	page->free[i].count  = count;
+	page->freeCount++;
+}
+
+static void ArenaPage_RemoveFree(struct ChunkArenaPage* page, int i) {
+	page->freeCount--;
+	for (; i < page->freeCount; i++) { page->free[i] = page->free[i + 1]; }
+}
+
+/* Finds the first unused range large enough for the given number of vertices */
+static cc_bool ArenaPage_Alloc(struct ChunkArenaPage* page, int count, int* offset) {
+	struct ArenaRange* range;
+	int i;
+
+	for (i = 0; i < page->freeCount; i++) {
+		range = &page->free[i];
+		if (range->count < count) continue;
+
+		*offset = range->offset;
+		range->offset += count;
+		range->count  -= count;
+
+		if (!range->count) ArenaPage_RemoveFree(page, i);
+		page->usedVertices += count;
+		return true;
+	}
+	return false;
+}
+
+/* Marks the given range as unused, merging it with the adjacent unused ranges */
+static void ArenaPage_Free(struct ChunkArenaPage* page, int offset, int count) {
+	struct ArenaRange* range;
+	int i;
+	page->usedVertices -= count;
+
+	for (i = 0; i < page->freeCount; i++) {
+		if (page->free[i].offset > offset) break;
+	}
+
+	if (i > 0 && page->free[i - 1].offset + page->free[i - 1].count == offset) {
+		range = &page->free[i - 1];
+		range->count += count;
+
+		if (i < page->freeCount && range->offset + range->count == page->free[i].offset) {
+			range->count += page->free[i].count;
+			ArenaPage_RemoveFree(page, i);
+		}
+	} else if (i < page->freeCount && offset + count == page->free[i].offset) {
+		page->free[i].offset  = offset;
+		page->free[i].count  += count;
+	} else {
+		ArenaPage_InsertFree(page, i, offset, count);
+	}
+}
+
+static struct ChunkArenaPage* ArenaPage_Create(int x, int y, int z) {
+	struct ChunkArenaPage* page;
+	/* add an extra element to fix crashing on some GPUs */
+	GfxResourceID vb = Gfx_CreateDynamicVb(ChunkVertexFormat(), ARENA_PAGE_VERTICES + 1);
+	if (!vb) return NULL;
+
+	page = (struct ChunkArenaPage*)Mem_AllocCleared(1, sizeof(struct ChunkArenaPage), "arena page");
+	page->vb      = vb;
+	page->originX = x; page->originY = y; page->originZ = z;
+	ArenaPage_InsertFree(page, 0, 0, ARENA_PAGE_VERTICES);
+
+	page->next = arenaPages;
+	arenaPages = page;
+	return page;
+}
+
+static void ArenaPage_Delete(struct ChunkArenaPage* page) {
+	struct ChunkArenaPage** ptr;
+	for (ptr = &arenaPages; *ptr != page; ptr = &(*ptr)->next) { }
+	*ptr = page->next;
+
+	Gfx_DeleteDynamicVb(&page->vb);
+	Mem_Free(page->free);
+	Mem_Free(page->drawCounts);
+	Mem_Free(page->drawStarts);
+	Mem_Free(page);
+}
+
+/* Repacks a fragmented page, by building the meshes of the chunks in it again into other pages */
+/* Once all those chunks have been rebuilt, the page is unused and so gets deleted */
+static void ArenaPage_Retire(struct ChunkArenaPage* page) {
+	int i;
+	page->retired = true;
+
+	for (i = 0; i < MapRenderer_ChunksCount; i++) {
+		if (mapChunks[i].ArenaPage == page) mapChunks[i].PendingDelete = true;
+	}
+}
+
+cc_bool MapRenderer_UploadToArena(struct ChunkInfo* info, void* vertices, int count) {
+	struct ChunkArenaPage* page;
+	int x = 0, y = 0, z = 0, offset;
+	if (!MapRenderer_ChunkArena || count > ARENA_PAGE_VERTICES) return false;
+
+	/* Packed vertices can only share a vb with chunks that have the same origin */
+	if (Gfx.PackedVertices) {
+		x = Builder_PackedOrigin(info->CentreX - 8);
+		y = Builder_PackedOrigin(info->CentreY - 8);
+		z = Builder_PackedOrigin(info->CentreZ - 8);
+	}
+
+	for (page = arenaPages; page; page = page->next) {
+		if (page->retired) continue;
+		if (page->originX != x || page->originY != y || page->originZ != z) continue;
+		if (ArenaPage_Alloc(page, count, &offset)) break;
+
+		/* Page has enough unused vertices in total, just not in one range */
+		if (ARENA_PAGE_VERTICES - page->usedVertices >= count && page->usedVertices <= ARENA_REPACK_VERTICES) {
+			ArenaPage_Retire(page);
+		}
+	}
+
+	if (!page) {
+		page = ArenaPage_Create(x, y, z);
+		if (!page) return false;
+		ArenaPage_Alloc(page, count, &offset);
+	}
+
+	Gfx_SetDynamicVbRange(page->vb, ChunkVertexFormat(), offset, vertices, count);
+	info->ArenaPage   = page;
+	info->ArenaOffset = offset;
+	info->ArenaCount  = count;
+	return true;
+}
+
+static void DeleteArenaMesh(struct ChunkInfo* info) {
+	struct ChunkArenaPage* page = info->ArenaPage;
+	if (!page) return;
+
+	ArenaPage_Free(page, info->ArenaOffset, info->ArenaCount);
+	if (!page->usedVertices) ArenaPage_Delete(page);
+	info->ArenaPage = NULL;
+}
+
+/* Queues a range of vertices to be drawn by DrawArenaPages */
+static void AddArenaDraw(struct ChunkInfo* info, int offset, int count) {
+	struct ChunkArenaPage* page = info->ArenaPage;
+	int last = page->drawsCount - 1;
+	offset  += info->ArenaOffset;
+
+	if (!page->drawsCount) {
+		page->nextPending = pendingPages;
+		pendingPages      = page;
+	} else if (page->drawStarts[last] + page->drawCounts[last] == offset) {
+		/* Merge with previous range, e.g. when all faces of a chunk are drawn */
+		page->drawCounts[last] += count; return;
+	}
+
+	if (page->drawsCount == page->drawsCapacity) {
+		page->drawsCapacity += 64;
+		page->drawCounts = (int*)Mem_Realloc(page->drawCounts, page->drawsCapacity, 4, "arena draw counts");
+		page->drawStarts = (int*)Mem_Realloc(page->drawStarts, page->drawsCapacity, 4, "arena draw starts");
+	}
+	page->drawCounts[page->drawsCount] = count;
+	page->drawStarts[page->drawsCount] = offset;
+	page->drawsCount++;
+}
+
+/* Draws all the ranges of vertices queued by AddArenaDraw */
+static void DrawArenaPages(void) {
+	struct ChunkArenaPage* page;
+	for (page = pendingPages; page; page = page->nextPending) {
+		if (Gfx.PackedVertices) LoadOriginMatrix(page->originX, page->originY, page->originZ);
+
+		Gfx_BindVb_T2fC4b(page->vb);
+		Gfx_DrawIndexedTris_Multi(page->drawCounts, page->drawStarts, page->drawsCount);
+		page->drawsCount = 0;
+	}
+	pendingPages = NULL;
+}
+#else
+cc_bool MapRenderer_UploadToArena(struct ChunkInfo* info, void* vertices, int count) { return false; }
+#endif
+
 #ifdef CC_BUILD_GL11
 #define DrawFace(face, ign)    Gfx_DrawIndexedTris_T2fC4b(part.Vbs[face], 0);
 #define DrawFaces(f1, f2, ign) DrawFace(f1, ign); DrawFace(f2, ign);
@@ -106,6 +428,65 @@ static void CheckWeather(double delta) {
 #define DrawFaces(f1, f2, offset) Gfx_DrawIndexedTris_T2fC4b(part.Counts[f1] + part.Counts[f2], offset);
 #endif
 
+#ifndef CC_BUILD_GL11
+#define AddArenaFaces(minFace, maxFace) \
+if (drawMin && drawMax) { \
+	AddArenaDraw(info, offset, part->Counts[minFace] + part->Counts[maxFace]); \
+	Game_Vertices += (part->Counts[minFace] + part->Counts[maxFace]); \
+} else if (drawMin) { \
+	AddArenaDraw(info, offset, part->Counts[minFace]); \
+	Game_Vertices += part->Counts[minFace]; \
+} else if (drawMax) { \
+	AddArenaDraw(info, offset + part->Counts[minFace], part->Counts[maxFace]); \
+	Game_Vertices += part->Counts[maxFace]; \
+}
+
+/* Queues the visible faces of the given part to be drawn by DrawArenaPages */
+/* allFaces is true when faces must be drawn regardless of which side of the chunk the camera is on */
+static void AddArenaDraws(struct ChunkInfo* info, struct ChunkPartInfo* part, cc_bool allFaces) {
+	cc_bool drawMin, drawMax;
+	int offset;
+
+	offset  = part->Offset + part->SpriteCount;
+	drawMin = (allFaces || info->DrawXMin) && part->Counts[FACE_XMIN];
+	drawMax = (allFaces || info->DrawXMax) && part->Counts[FACE_XMAX];
+	AddArenaFaces(FACE_XMIN, FACE_XMAX);
+
+	offset  += part->Counts[FACE_XMIN] + part->Counts[FACE_XMAX];
+	drawMin = (allFaces || info->DrawZMin) && part->Counts[FACE_ZMIN];
+	drawMax = (allFaces || info->DrawZMax) && part->Counts[FACE_ZMAX];
+	AddArenaFaces(FACE_ZMIN, FACE_ZMAX);
+
+	offset  += part->Counts[FACE_ZMIN] + part->Counts[FACE_ZMAX];
+	drawMin = (allFaces || info->DrawYMin) && part->Counts[FACE_YMIN];
+	drawMax = (allFaces || info->DrawYMax) && part->Counts[FACE_YMAX];
+	AddArenaFaces(FACE_YMIN, FACE_YMAX);
+}
+
+/* Queues the visible sprites of the given part to be drawn by DrawArenaPages */
+static void AddArenaSprites(struct ChunkInfo* info, struct ChunkPartInfo* part) {
+	int offset, count;
+	offset = part->Offset;
+	count  = part->SpriteCount >> 2; /* 4 per sprite */
+
+	if (info->DrawXMax || info->DrawZMin) {
+		AddArenaDraw(info, offset, count); Game_Vertices += count;
+	} offset += count;
+
+	if (info->DrawXMin || info->DrawZMax) {
+		AddArenaDraw(info, offset, count); Game_Vertices += count;
+	} offset += count;
+
+	if (info->DrawXMin || info->DrawZMin) {
+		AddArenaDraw(info, offset, count); Game_Vertices += count;
+	} offset += count;
+
+	if (info->DrawXMax || info->DrawZMax) {
+		AddArenaDraw(info, offset, count); Game_Vertices += count;
+	}
+}
+#endif
+
 #define DrawNormalFaces(minFace, maxFace) \
 if (drawMin && drawMax) { \
 	Gfx_SetFaceCulling(true); \
@@ -136,6 +517,8 @@ static void RenderNormalBatch(int batch) {
 		hasNormParts[batch] = true;
 
 #ifndef CC_BUILD_GL11
+		if (info->ArenaPage) { AddArenaDraws(info, &part, false); continue; }
+		LoadChunkMatrix(info);
 		Gfx_BindVb_T2fC4b(info->Vb);
 #endif
 
@@ -183,33 +566,52 @@ static void RenderNormalBatch(int batch) {
 		}
 		Gfx_SetFaceCulling(false);
 	}
+
+#ifndef CC_BUILD_GL11
+	/* Chunks can have only sprites in this batch, so still need to check for sprites below */
+	if (pendingPages) DrawArenaPages();
+
+	/* Sprites are drawn with back face culling, so must be drawn separately */
+	for (i = 0; i < renderChunksCount; i++) {
+		info = renderChunks[i];
+		if (!info->ArenaPage || !info->NormalParts) continue;
+
+		part = info->NormalParts[batchOffset];
+		if (part.Offset < 0 || !part.SpriteCount) continue;
+		AddArenaSprites(info, &part);
+	}
+
+	if (!pendingPages) return;
+	Gfx_SetFaceCulling(true);
+	DrawArenaPages();
+	Gfx_SetFaceCulling(false);
+#endif
 }
 
 void MapRenderer_RenderNormal(double delta) {
 	int batch;
 	if (!mapChunks) return;
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_SetVertexFormat(ChunkVertexFormat());
 	Gfx_SetTexturing(true);
 	Gfx_SetAlphaTest(true);
 	
 	Gfx_EnableMipmaps();
+	BeginChunks();
 	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) {
 		if (normPartsCount[batch] <= 0) continue;
 		if (hasNormParts[batch] || checkNormParts[batch]) {
-			Gfx_BindTexture(Atlas1D.TexIds[batch]);
+			Gfx_BindTexture(Atlas1D.TexIds[MapRenderer_1DUsedAtlases[batch]]);
 			RenderNormalBatch(batch);
 			checkNormParts[batch] = false;
 		}
 	}
+	EndChunks();
 	Gfx_DisableMipmaps();
 
 	CheckWeather(delta);
 	Gfx_SetAlphaTest(false);
 	Gfx_SetTexturing(false);
-#if DEBUG_OCCLUSION
-	DebugPickedPos();
-#endif
 }
 
 #define DrawTranslucentFaces(minFace, maxFace) \
@@ -240,6 +642,8 @@ static void RenderTranslucentBatch(int batch) {
 		hasTranParts[batch] = true;
 
 #ifndef CC_BUILD_GL11
+		if (info->ArenaPage) { AddArenaDraws(info, &part, inTranslucent); continue; }
+		LoadChunkMatrix(info);
 		Gfx_BindVb_T2fC4b(info->Vb);
 #endif
 
@@ -258,6 +662,10 @@ static void RenderTranslucentBatch(int batch) {
 		drawMax = (inTranslucent || info->DrawYMax) && part.Counts[FACE_YMAX];
 		DrawTranslucentFaces(FACE_YMIN, FACE_YMAX);
 	}
+
+#ifndef CC_BUILD_GL11
+	DrawArenaPages();
+#endif
 }
 
 void MapRenderer_RenderTranslucent(double delta) {
@@ -266,11 +674,12 @@ void MapRenderer_RenderTranslucent(double delta) {
 
 	/* First fill depth buffer */
 	vertices = Game_Vertices;
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_SetVertexFormat(ChunkVertexFormat());
 	Gfx_SetTexturing(false);
 	Gfx_SetAlphaBlending(false);
 	Gfx_SetColWriteMask(false, false, false, false);
 
+	BeginChunks();
 	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) {
 		if (tranPartsCount[batch] <= 0) continue;
 		if (hasTranParts[batch] || checkTranParts[batch]) {
@@ -290,9 +699,10 @@ void MapRenderer_RenderTranslucent(double delta) {
 	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) {
 		if (tranPartsCount[batch] <= 0) continue;
 		if (!hasTranParts[batch]) continue;
-		Gfx_BindTexture(Atlas1D.TexIds[batch]);
+		Gfx_BindTexture(Atlas1D.TexIds[MapRenderer_1DUsedAtlases[batch]]);
 		RenderTranslucentBatch(batch);
 	}
+	EndChunks();
 	Gfx_DisableMipmaps();
 
 	Gfx_SetDepthWrite(true);
@@ -316,16 +726,36 @@ static void FreeParts(void) {
 	MapRenderer_PartsTranslucent = NULL;
 }
 
+/* Entry in the queue of chunks to visit when calculating which chunks are occluded */
+struct OcclusionEntry {
+	int index;      /* Index of the chunk in mapChunks */
+	cc_uint8 from;  /* Face the chunk was entered through, or FACE_COUNT for the starting chunk */
+	cc_uint8 dirs;  /* Bit flags of the faces exited through so far, to get from the camera to this chunk */
+};
+static struct OcclusionEntry* occlusionQueue;
+/* Number of chunks reached by the last CalcOcclusion, which are the first entries in occlusionQueue */
+static int occlusionCount;
+
 static void FreeChunks(void) {
 	Mem_Free(mapChunks);
 	Mem_Free(sortedChunks);
 	Mem_Free(renderChunks);
 	Mem_Free(distances);
+	Mem_Free(occlusionQueue);
+	Mem_Free(regions);
+	Mem_Free(chunkOffsets);
 
 	mapChunks    = NULL;
 	sortedChunks = NULL;
 	renderChunks = NULL;
 	distances    = NULL;
+	occlusionQueue  = NULL;
+	occlusionCount  = 0;
+	regions         = NULL;
+	chunkOffsets    = NULL;
+	sortedCount     = 0;
+	nearChunksCount = 0;
+	chunkOffsetsDist = -1;
 }
 
 static void AllocateParts(void) {
@@ -338,10 +768,17 @@ static void AllocateParts(void) {
 }
 
 static void AllocateChunks(void) {
+	int count;
 	mapChunks    = (struct ChunkInfo*) Mem_Alloc(MapRenderer_ChunksCount, sizeof(struct ChunkInfo),  "chunk info");
 	sortedChunks = (struct ChunkInfo**)Mem_Alloc(MapRenderer_ChunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
 	renderChunks = (struct ChunkInfo**)Mem_Alloc(MapRenderer_ChunksCount, sizeof(struct ChunkInfo*), "render chunk info");
 	distances    = (cc_uint32*)Mem_Alloc(MapRenderer_ChunksCount, 4, "chunk distances");
+	occlusionQueue = (struct OcclusionEntry*)Mem_Alloc(MapRenderer_ChunksCount, sizeof(struct OcclusionEntry), "occlusion queue");
+
+	regionsX = (World.Width  + (1 << REGION_SHIFT) - 1) >> REGION_SHIFT;
+	regionsY = (World.Height + (1 << REGION_SHIFT) - 1) >> REGION_SHIFT;
+	count    = regionsX * regionsY * ((World.Length + (1 << REGION_SHIFT) - 1) >> REGION_SHIFT);
+	regions  = (struct ChunkRegion*)Mem_AllocCleared(count, sizeof(struct ChunkRegion), "chunk regions");
 }
 
 static void ResetPartFlags(void) {
@@ -392,9 +829,11 @@ static void ResetChunks(void) {
 static void DeleteChunks(void) {
 	int i;
 	if (!mapChunks) return;
+	Builder_CancelChunks();
 
 	for (i = 0; i < MapRenderer_ChunksCount; i++) {
 		MapRenderer_DeleteChunk(&mapChunks[i]);
+		mapChunks[i].Building = false;
 	}
 	ResetPartCounts();
 }
@@ -403,12 +842,12 @@ void MapRenderer_Refresh(void) {
 	int oldCount;
 	chunkPos = IVec3_MaxValue();
 
-	if (mapChunks && World.Blocks) {
+	if (mapChunks && World_HasBlocks()) {
 		DeleteChunks();
 		ResetChunks();
 
 		oldCount = MapRenderer_1DUsedCount;
-		MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
+		UpdateUsedAtlases();
 		/* Need to reallocate parts array in this case */
 		if (MapRenderer_1DUsedCount != oldCount) {
 			FreeParts();
@@ -424,7 +863,7 @@ static void RefreshBorderChunks(int maxHeight) {
 	cc_bool onBorder;
 
 	chunkPos = IVec3_MaxValue();
-	if (!mapChunks || !World.Blocks) return;
+	if (!mapChunks || !World_HasBlocks()) return;
 
 	for (cz = 0; cz < MapRenderer_ChunksZ; cz++) {
 		for (cy = 0; cy < MapRenderer_ChunksY; cy++) {
@@ -439,6 +878,32 @@ static void RefreshBorderChunks(int maxHeight) {
 	}
 }
 
+/* Refreshes chunks which contain any of the given blocks, and the chunks around them. */
+/* (see World_GetSectionBlocks for the format of the blocks bit flags) */
+static void RefreshChangedChunks(cc_uint64 blocks) {
+	int cx, cy, cz, x, y, z;
+	if (!mapChunks || !World_HasBlocks()) return;
+
+	for (cz = 0; cz < MapRenderer_ChunksZ; cz++) {
+		for (cy = 0; cy < MapRenderer_ChunksY; cy++) {
+			for (cx = 0; cx < MapRenderer_ChunksX; cx++) {
+				if (!(World_GetSectionBlocks(cx, cy, cz) & blocks)) continue;
+				/* Changed block may no longer be drawn as gas */
+				mapChunks[MapRenderer_Pack(cx, cy, cz)].AllAir = false;
+
+				/* Faces of blocks in chunks around may be hidden by or visible next to the changed blocks */
+				for (y = cy - 1; y <= cy + 1; y++) {
+					for (z = cz - 1; z <= cz + 1; z++) {
+						for (x = cx - 1; x <= cx + 1; x++) {
+							MapRenderer_RefreshChunk(x, y, z);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------Chunks updating/sorting------------------------------------------------*
@@ -453,6 +918,11 @@ static int renderDistSquared;
 /* Max distance from camera that chunks are built within */
 /* Chunks past this distance are automatically unloaded */
 static int buildDistSquared;
+static void CalcOcclusion(void);
+
+/* Whether all the blocks needed to build a chunk's mesh have been loaded yet */
+/* NOTE: Top faces of a chunk depend on the layer just above the chunk */
+#define ChunkInfo_Loaded(info) ((info)->CentreY + HALF_CHUNK_SIZE < World.LoadedHeight || World.LoadedHeight == World.Height)
 
 static int AdjustDist(int dist) {
 	if (dist < CHUNK_SIZE) dist = CHUNK_SIZE;
@@ -465,6 +935,102 @@ static void CalcViewDists(void) {
 	renderDistSquared = AdjustDist(Game_ViewDistance);
 }
 
+static cc_bool RegionInFrustum(struct ChunkInfo* info) {
+	struct ChunkRegion* region;
+	int rx = info->CentreX >> REGION_SHIFT;
+	int ry = info->CentreY >> REGION_SHIFT;
+	int rz = info->CentreZ >> REGION_SHIFT;
+
+	region = &regions[(rz * regionsY + ry) * regionsX + rx];
+	if (region->frame == regionsFrame) return region->inFrustum;
+
+	region->frame     = regionsFrame;
+	region->inFrustum = FrustumCulling_SphereInFrustum(
+		(rx << REGION_SHIFT) + REGION_HALF_SIZE, (ry << REGION_SHIFT) + REGION_HALF_SIZE,
+		(rz << REGION_SHIFT) + REGION_HALF_SIZE, 111); /* 111 ~ sqrt(3 * 64^2) */
+	return region->inFrustum;
+}
+
+/* Whether the given chunk is within render distance, and not hidden by other chunks or outside the view frustum */
+#define ChunkInfo_CalcVisible(info, distSqr) (!(info)->Occluded && (distSqr) <= renderDistSqr && RegionInFrustum(info) && \
+	FrustumCulling_SphereInFrustum((info)->CentreX, (info)->CentreY, (info)->CentreZ, 14)) /* 14 ~ sqrt(3 * 8^2) */
+
+static void AddPartCounts(struct ChunkInfo* info) {
+	struct ChunkPartInfo* ptr;
+	int i;
+
+	if (!info->NormalParts && !info->TranslucentParts) {
+		info->Empty = true; return;
+	}
+	
+	if (info->NormalParts) {
+		ptr = info->NormalParts;
+		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
+			if (ptr->Offset >= 0) normPartsCount[i]++;
+		}
+	}
+
+	if (info->TranslucentParts) {
+		ptr = info->TranslucentParts;
+		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
+			if (ptr->Offset >= 0) tranPartsCount[i]++;
+		}
+	}
+}
+
+static int UploadChunks(void) {
+	struct ChunkInfo* info;
+	int uploaded = 0;
+
+	while ((info = Builder_UploadChunk())) {
+		info->Building = false;
+		AddPartCounts(info);
+		uploaded++;
+	}
+	return uploaded;
+}
+
+static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+	cc_bool allAir;
+	if (!Builder_WorkersCount) {
+		MapRenderer_DeleteChunk(info);
+		MapRenderer_BuildChunk(info, chunkUpdates);
+		return;
+	}
+
+	Game.ChunkUpdates++;
+	(*chunkUpdates)++;
+	info->PendingDelete = false;
+	if (Builder_QueueChunk(info)) { info->Building = true; return; }
+
+	/* Chunk has no mesh, so can just delete the old mesh now */
+	allAir = info->AllAir;
+	MapRenderer_DeleteChunk(info);
+	info->AllAir = allAir;
+	info->Empty  = true;
+}
+
+/* Chunks that need to be built, but are not currently visible from the camera */
+/* These are only built after all the chunks that need to be built and are visible */
+static struct ChunkInfo* offscreenChunks[MAX_CHUNK_UPDATES];
+static int offscreenCount;
+
+static void QueueBuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+	if (info->Visible) {
+		if (*chunkUpdates < chunksTarget) BuildChunk(info, chunkUpdates);
+	} else if (offscreenCount < chunksTarget) {
+		offscreenChunks[offscreenCount++] = info;
+	}
+}
+
+static void BuildOffscreenChunks(int* chunkUpdates) {
+	int i;
+	for (i = 0; i < offscreenCount && *chunkUpdates < chunksTarget; i++) {
+		BuildChunk(offscreenChunks[i], chunkUpdates);
+	}
+	offscreenCount = 0;
+}
+
 static int UpdateChunksAndVisibility(int* chunkUpdates) {
 	int renderDistSqr = renderDistSquared;
 	int buildDistSqr  = buildDistSquared;
@@ -473,7 +1039,7 @@ static int UpdateChunksAndVisibility(int* chunkUpdates) {
 	int i, j = 0, distSqr;
 	cc_bool noData;
 
-	for (i = 0; i < MapRenderer_ChunksCount; i++) {
+	for (i = 0; i < nearChunksCount; i++) {
 		info = sortedChunks[i];
 		if (info->Empty) continue;
 
@@ -485,16 +1051,15 @@ static int UpdateChunksAndVisibility(int* chunkUpdates) {
 			MapRenderer_DeleteChunk(info); continue;
 		}
 		noData |= info->PendingDelete;
+		info->Visible = ChunkInfo_CalcVisible(info, distSqr);
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			MapRenderer_DeleteChunk(info);
-			MapRenderer_BuildChunk(info, chunkUpdates);
+		if (noData && !info->Building && distSqr <= buildDistSqr && ChunkInfo_Loaded(info)) {
+			QueueBuildChunk(info, chunkUpdates);
 		}
-
-		info->Visible = distSqr <= renderDistSqr &&
-			FrustumCulling_SphereInFrustum(info->CentreX, info->CentreY, info->CentreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 		if (info->Visible && !info->Empty) { renderChunks[j] = info; j++; }
 	}
+
+	BuildOffscreenChunks(chunkUpdates);
 	return j;
 }
 
@@ -506,7 +1071,7 @@ static int UpdateChunksStill(int* chunkUpdates) {
 	int i, j = 0, distSqr;
 	cc_bool noData;
 
-	for (i = 0; i < MapRenderer_ChunksCount; i++) {
+	for (i = 0; i < nearChunksCount; i++) {
 		info = sortedChunks[i];
 		if (info->Empty) continue;
 
@@ -519,33 +1084,37 @@ static int UpdateChunksStill(int* chunkUpdates) {
 		}
 		noData |= info->PendingDelete;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			MapRenderer_DeleteChunk(info);
-			MapRenderer_BuildChunk(info, chunkUpdates);
-
+		if (noData && !info->Building && distSqr <= buildDistSqr && ChunkInfo_Loaded(info)) {
 			/* only need to update the visibility of chunks in range. */
-			info->Visible = distSqr <= renderDistSqr &&
-				FrustumCulling_SphereInFrustum(info->CentreX, info->CentreY, info->CentreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
+			info->Visible = ChunkInfo_CalcVisible(info, distSqr);
+			QueueBuildChunk(info, chunkUpdates);
 			if (info->Visible && !info->Empty) { renderChunks[j] = info; j++; }
 		} else if (info->Visible) {
 			renderChunks[j] = info; j++;
 		}
 	}
+
+	BuildOffscreenChunks(chunkUpdates);
 	return j;
 }
 
 static void UpdateChunks(double delta) {
 	struct LocalPlayer* p;
-	cc_bool samePos;
-	int chunkUpdates = 0;
+	cc_bool samePos, occlusionChanged;
+	int chunkUpdates = 0, uploaded = 0;
+	if (Builder_WorkersCount) uploaded = UploadChunks();
+
+	occlusionChanged = occlusionDirty;
+	if (occlusionDirty) CalcOcclusion();
 
 	/* Build more chunks if 30 FPS or over, otherwise slowdown */
 	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
 	Math_Clamp(chunksTarget, 4, maxChunkUpdates);
+	regionsFrame++;
 
 	p = &LocalPlayer_Instance;
 	samePos = Vec3_Equals(&Camera.CurrentPos, &lastCamPos)
-		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw;
+		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw && !occlusionChanged;
 
 	renderChunksCount = samePos ?
 		UpdateChunksStill(&chunkUpdates) :
@@ -555,32 +1124,181 @@ static void UpdateChunks(double delta) {
 	lastPitch  = p->Base.Pitch;
 	lastYaw    = p->Base.Yaw;
 
-	if (!samePos || chunkUpdates) ResetPartFlags();
+	if (!samePos || chunkUpdates || uploaded) ResetPartFlags();
+}
+
+/* Makes a chunk too far away from the camera to be rendered invisible, and unloads it if past build distance */
+static void MakeChunkFar(struct ChunkInfo* info, cc_uint32 distSqr) {
+	info->Visible = false;
+
+	/* Auto unload chunks far away chunks */
+	if (info->Empty || distSqr < (cc_uint32)(buildDistSquared + 32 * 16)) return;
+	if (info->NormalParts || info->TranslucentParts) MapRenderer_DeleteChunk(info);
 }
 
-static void SortMapChunks(int left, int right) {
-	struct ChunkInfo** values = sortedChunks; struct ChunkInfo* value;
-	cc_uint32* keys = distances; cc_uint32 key;
+/* Finds which chunks are close enough to the camera to be built or rendered */
+static void UpdateNearChunks(void) {
+	cc_uint32 maxDistSqr = max(renderDistSquared, buildDistSquared);
+	int i;
+
+	for (i = 0; i < sortedCount && distances[i] <= maxDistSqr; i++) { }
+	nearChunksCount = i;
 
-	while (left < right) {
-		int i = left, j = right;
-		cc_uint32 pivot = keys[(i + j) >> 1];
+	for (; i < sortedCount; i++) {
+		MakeChunkFar(sortedChunks[i], distances[i]);
+	}
+}
 
-		/* partition the list */
-		while (i <= j) {
-			while (pivot > keys[i]) i++;
-			while (pivot < keys[j]) j--;
-			QuickSort_Swap_KV_Maybe();
+static void SetDrawFlags(struct ChunkInfo* info, int dx, int dy, int dz) {
+	/* Consider these 3 chunks: */
+	/* |       X-1      |        X        |       X+1      | */
+	/* |################|########@########|################| */
+	/* Assume the player is standing at @, then DrawXMin/XMax is calculated as this */
+	/*    X-1: DrawXMin = false, DrawXMax = true  */
+	/*    X  : DrawXMin = true,  DrawXMax = true  */
+	/*    X+1: DrawXMin = true,  DrawXMax = false */
+
+	info->DrawXMin = dx >= 0; info->DrawXMax = dx <= 0;
+	info->DrawZMin = dz >= 0; info->DrawZMax = dz <= 0;
+	info->DrawYMin = dy >= 0; info->DrawYMax = dy <= 0;
+}
+
+/* Calculates the offsets of all chunks within the given distance (in chunks, squared) */
+/*  from a chunk in the map, sorted by distance. Distances are integers, so counting sort is used. */
+static void BuildChunkOffsets(int maxDist) {
+	struct ChunkOffset* offset;
+	int rx, ry, rz, x, y, z;
+	int* starts;
+	int r, i, dist, total, count = 0;
+
+	for (r = 0; (r + 1) * (r + 1) <= maxDist; r++) { }
+	/* Chunks further apart than this can't both be in the map */
+	rx = min(r, MapRenderer_ChunksX - 1);
+	ry = min(r, MapRenderer_ChunksY - 1);
+	rz = min(r, MapRenderer_ChunksZ - 1);
+	starts = (int*)Mem_AllocCleared(maxDist + 1, 4, "chunk offset starts");
+
+	for (z = -rz; z <= rz; z++) {
+		for (y = -ry; y <= ry; y++) {
+			for (x = -rx; x <= rx; x++) {
+				dist = x * x + y * y + z * z;
+				if (dist <= maxDist) { starts[dist]++; count++; }
+			}
 		}
-		/* recurse into the smaller subset */
-		QuickSort_Recurse(SortMapChunks)
 	}
+
+	/* Convert number of offsets with each distance into index of first offset with that distance */
+	for (i = 0, total = 0; i <= maxDist; i++) {
+		r = starts[i]; starts[i] = total; total += r;
+	}
+
+	Mem_Free(chunkOffsets);
+	chunkOffsets = (struct ChunkOffset*)Mem_Alloc(count, sizeof(struct ChunkOffset), "chunk offsets");
+	chunkOffsetsCount = count;
+	chunkOffsetsDist  = maxDist;
+
+	for (z = -rz; z <= rz; z++) {
+		for (y = -ry; y <= ry; y++) {
+			for (x = -rx; x <= rx; x++) {
+				dist = x * x + y * y + z * z;
+				if (dist > maxDist) continue;
+
+				offset = &chunkOffsets[starts[dist]++];
+				offset->x = x; offset->y = y; offset->z = z;
+			}
+		}
+	}
+	Mem_Free(starts);
 }
 
-static void UpdateSortOrder(void) {
+/* Sorts the chunks near the camera's chunk (which must be inside the map) using the chunk offsets table */
+static void SortNearChunks(int cx, int cy, int cz) {
+	cc_uint32 maxDistSqr = chunkOffsetsDist * (CHUNK_SIZE * CHUNK_SIZE);
+	struct ChunkOffset* offset;
+	struct ChunkInfo* info;
+	int i, j = 0;
+	int x, y, z, dx, dy, dz;
+
+	for (i = 0; i < sortedCount; i++) {
+		info = sortedChunks[i];
+		dx = info->CentreX - chunkPos.X; dy = info->CentreY - chunkPos.Y; dz = info->CentreZ - chunkPos.Z;
+		if ((cc_uint32)(dx * dx + dy * dy + dz * dz) <= maxDistSqr) continue;
+
+		/* Chunk is no longer near the camera */
+		MakeChunkFar(info, dx * dx + dy * dy + dz * dz);
+	}
+
+	for (i = 0; i < chunkOffsetsCount; i++) {
+		offset = &chunkOffsets[i];
+		x = cx + offset->x; y = cy + offset->y; z = cz + offset->z;
+
+		if (x < 0 || y < 0 || z < 0 || x >= MapRenderer_ChunksX
+			|| y >= MapRenderer_ChunksY || z >= MapRenderer_ChunksZ) continue;
+		info = &mapChunks[MapRenderer_Pack(x, y, z)];
+
+		sortedChunks[j] = info;
+		distances[j]    = (offset->x * offset->x + offset->y * offset->y + offset->z * offset->z) * (CHUNK_SIZE * CHUNK_SIZE);
+		SetDrawFlags(info, offset->x, offset->y, offset->z);
+		j++;
+	}
+	sortedCount = j;
+}
+
+/* Sorts all the chunks in the map by distance, for when the camera is outside the map */
+/* Like BuildChunkOffsets, counting sort is used, as distances between chunk centres are */
+/*  always multiples of CHUNK_SIZE * CHUNK_SIZE. Chunks past unload distance are never drawn, */
+/*  so their order does not matter, and they are all counted as being at the same distance. */
+static void SortAllChunks(void) {
+	cc_uint32 farDist = chunkOffsetsDist * (CHUNK_SIZE * CHUNK_SIZE);
+	cc_uint32 minDist = (cc_uint32)-1;
+	int count = MapRenderer_ChunksCount;
+	struct ChunkInfo** chunks;
+	cc_uint32* dists;
 	struct ChunkInfo* info;
+	int* starts;
+	int i, dx, dy, dz, key, range, total;
+
+	for (i = 0; i < count; i++) {
+		info = &mapChunks[i];
+		/* Calculate distance to chunk centre */
+		dx = info->CentreX - chunkPos.X; dy = info->CentreY - chunkPos.Y; dz = info->CentreZ - chunkPos.Z;
+		distances[i] = dx * dx + dy * dy + dz * dz;
+		SetDrawFlags(info, dx, dy, dz);
+		minDist = min(minDist, distances[i]);
+	}
+
+	minDist = min(minDist, farDist);
+	range   = (farDist - minDist) / (CHUNK_SIZE * CHUNK_SIZE) + 2;
+	starts  = (int*)Mem_AllocCleared(range, 4, "chunk distance starts");
+	chunks  = (struct ChunkInfo**)Mem_Alloc(count, sizeof(struct ChunkInfo*), "sorted chunks");
+	dists   = (cc_uint32*)Mem_Alloc(count, 4, "sorted chunk distances");
+
+#define SortAllChunks_Key(dist) ((dist) > farDist ? range - 1 : ((dist) - minDist) / (CHUNK_SIZE * CHUNK_SIZE))
+	for (i = 0; i < count; i++) { starts[SortAllChunks_Key(distances[i])]++; }
+
+	/* Convert number of chunks with each distance into index of first chunk with that distance */
+	for (key = 0, total = 0; key < range; key++) {
+		i = starts[key]; starts[key] = total; total += i;
+	}
+
+	for (i = 0; i < count; i++) {
+		key = starts[SortAllChunks_Key(distances[i])]++;
+		chunks[key] = &mapChunks[i];
+		dists[key]  = distances[i];
+	}
+
+	Mem_Copy(sortedChunks, chunks, count * sizeof(struct ChunkInfo*));
+	Mem_Copy(distances,    dists,  count * 4);
+	sortedCount = count;
+
+	Mem_Free(starts);
+	Mem_Free(chunks);
+	Mem_Free(dists);
+}
+
+static void UpdateSortOrder(void) {
 	IVec3 pos;
-	int i, dx, dy, dz;
+	int cx, cy, cz, maxDist;
 
 	/* pos is centre coordinate of chunk camera is in */
 	IVec3_Floor(&pos, &Camera.CurrentPos);
@@ -593,28 +1311,22 @@ static void UpdateSortOrder(void) {
 	chunkPos = pos;
 	if (!MapRenderer_ChunksCount) return;
 
-	for (i = 0; i < MapRenderer_ChunksCount; i++) {
-		info = sortedChunks[i];
-		/* Calculate distance to chunk centre */
-		dx = info->CentreX - pos.X; dy = info->CentreY - pos.Y; dz = info->CentreZ - pos.Z;
-		distances[i] = dx * dx + dy * dy + dz * dz;
-
-		/* Consider these 3 chunks: */
-		/* |       X-1      |        X        |       X+1      | */
-		/* |################|########@########|################| */
-		/* Assume the player is standing at @, then DrawXMin/XMax is calculated as this */
-		/*    X-1: DrawXMin = false, DrawXMax = true  */
-		/*    X  : DrawXMin = true,  DrawXMax = true  */
-		/*    X+1: DrawXMin = true,  DrawXMax = false */
-
-		info->DrawXMin = dx >= 0; info->DrawXMax = dx <= 0;
-		info->DrawZMin = dz >= 0; info->DrawZMax = dz <= 0;
-		info->DrawYMin = dy >= 0; info->DrawYMax = dy <= 0;
+	/* Chunks past unload distance need to be in the table, so that they can be unloaded when they leave it */
+	maxDist = max(renderDistSquared, buildDistSquared + 32 * 16) / (CHUNK_SIZE * CHUNK_SIZE);
+	if (maxDist != chunkOffsetsDist) BuildChunkOffsets(maxDist);
+
+	/* When most of the map is near the camera, it's faster to just sort all the chunks */
+	cx = pos.X >> CHUNK_SHIFT; cy = pos.Y >> CHUNK_SHIFT; cz = pos.Z >> CHUNK_SHIFT;
+	if (cx >= 0 && cy >= 0 && cz >= 0 && cx < MapRenderer_ChunksX && cy < MapRenderer_ChunksY 
+		&& cz < MapRenderer_ChunksZ && chunkOffsetsCount <= 4 * MapRenderer_ChunksCount) {
+		SortNearChunks(cx, cy, cz);
+	} else {
+		SortAllChunks();
 	}
 
-	SortMapChunks(0, MapRenderer_ChunksCount - 1);
+	UpdateNearChunks();
 	ResetPartFlags();
-	/*SimpleOcclusionCulling();*/
+	occlusionDirty = true;
 }
 
 void MapRenderer_Update(double delta) {
@@ -624,6 +1336,109 @@ void MapRenderer_Update(double delta) {
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------Occlusion culling----------------------------------------------------*
+*#########################################################################################################################*/
+/* Chunks are occluded if they can't be reached from the camera's chunk, by walking outwards through faces */
+/*  of chunks that are connected by blocks which are not fully opaque. (e.g. caves beneath the player) */
+/* Chunks are never walked back in the direction of the camera, as otherwise most chunks would be reached. */
+static void Occlusion_Visit(int* count, int index, cc_uint8 from, cc_uint8 dirs) {
+	struct ChunkInfo* info = &mapChunks[index];
+	int dx, dy, dz;
+	if (!info->Occluded) return;
+
+	/* Chunks outside render distance are never drawn anyways */
+	dx = info->CentreX - chunkPos.X; dy = info->CentreY - chunkPos.Y; dz = info->CentreZ - chunkPos.Z;
+	if (dx * dx + dy * dy + dz * dz > renderDistSquared) return;
+
+	info->Occluded = false;
+	occlusionQueue[*count].index = index;
+	occlusionQueue[*count].from  = from;
+	occlusionQueue[*count].dirs  = dirs;
+	(*count)++;
+}
+
+/* Visits the chunks on the sides of the map facing the camera, when the camera is outside the map */
+/* NOTE: The camera can be beyond several sides at once (e.g. diagonally past a corner of the map) */
+static void Occlusion_VisitBorders(int* count, int cx, int cy, int cz) {
+	int x, y, z, face, index = 0;
+	cc_uint8 faces, dirs;
+
+	for (z = 0; z < MapRenderer_ChunksZ; z++) {
+		for (y = 0; y < MapRenderer_ChunksY; y++) {
+			for (x = 0; x < MapRenderer_ChunksX; x++, index++) {
+				faces = 0; dirs = 0;
+				if (cx < 0 && x == 0)                                          { faces |= 1 << FACE_XMIN; dirs |= 1 << FACE_XMAX; }
+				if (cx >= MapRenderer_ChunksX && x == MapRenderer_ChunksX - 1) { faces |= 1 << FACE_XMAX; dirs |= 1 << FACE_XMIN; }
+				if (cy < 0 && y == 0)                                          { faces |= 1 << FACE_YMIN; dirs |= 1 << FACE_YMAX; }
+				if (cy >= MapRenderer_ChunksY && y == MapRenderer_ChunksY - 1) { faces |= 1 << FACE_YMAX; dirs |= 1 << FACE_YMIN; }
+				if (cz < 0 && z == 0)                                          { faces |= 1 << FACE_ZMIN; dirs |= 1 << FACE_ZMAX; }
+				if (cz >= MapRenderer_ChunksZ && z == MapRenderer_ChunksZ - 1) { faces |= 1 << FACE_ZMAX; dirs |= 1 << FACE_ZMIN; }
+				if (!faces) continue;
+
+				/* A chunk seen through more than one of its faces can be left through any face */
+				for (face = 0; !(faces & (1 << face)); face++) { }
+				if (faces != (1 << face)) face = FACE_COUNT;
+				Occlusion_Visit(count, index, face, dirs);
+			}
+		}
+	}
+}
+
+#define Occlusion_Step(face, canStep, offset) \
+if (!(entry.dirs & (1 << (face ^ 1))) && canStep && (entry.from == FACE_COUNT || (info->Connections[entry.from] & (1 << face)))) {\
+	Occlusion_Visit(&count, entry.index + (offset), face ^ 1, entry.dirs | (1 << face));\
+}
+
+static void CalcOcclusion(void) {
+	int oneY = MapRenderer_ChunksX, oneZ = MapRenderer_ChunksX * MapRenderer_ChunksY;
+	struct OcclusionEntry entry;
+	struct ChunkInfo* info;
+	int i, head = 0, count = 0;
+	int cx, cy, cz;
+
+	occlusionDirty = false;
+	/* Only the chunks reached last time need to be reset, rather than every chunk in the map */
+	for (i = 0; i < occlusionCount; i++) { mapChunks[occlusionQueue[i].index].Occluded = true; }
+	/* chunkPos is centre coordinate of chunk camera is in */
+	cx = chunkPos.X >> CHUNK_SHIFT; cy = chunkPos.Y >> CHUNK_SHIFT; cz = chunkPos.Z >> CHUNK_SHIFT;
+
+	if (cx >= 0 && cy >= 0 && cz >= 0 && cx < MapRenderer_ChunksX 
+		&& cy < MapRenderer_ChunksY && cz < MapRenderer_ChunksZ) {
+		Occlusion_Visit(&count, MapRenderer_Pack(cx, cy, cz), FACE_COUNT, 0);
+	} else {
+		Occlusion_VisitBorders(&count, cx, cy, cz);
+	}
+
+	while (head < count) {
+		entry = occlusionQueue[head++];
+		info  = &mapChunks[entry.index];
+		cx = info->CentreX >> CHUNK_SHIFT; cy = info->CentreY >> CHUNK_SHIFT; cz = info->CentreZ >> CHUNK_SHIFT;
+
+		Occlusion_Step(FACE_XMIN, cx > 0,                        -1);
+		Occlusion_Step(FACE_XMAX, cx < MapRenderer_ChunksX - 1,   1);
+		Occlusion_Step(FACE_ZMIN, cz > 0,                        -oneZ);
+		Occlusion_Step(FACE_ZMAX, cz < MapRenderer_ChunksZ - 1,   oneZ);
+		Occlusion_Step(FACE_YMIN, cy > 0,                        -oneY);
+		Occlusion_Step(FACE_YMAX, cy < MapRenderer_ChunksY - 1,   oneY);
+	}
+	occlusionCount = count;
+}
+
+const cc_uint8 MapRenderer_AllConnections[FACE_COUNT] = { 
+	CHUNK_ALL_FACES, CHUNK_ALL_FACES, CHUNK_ALL_FACES, CHUNK_ALL_FACES, CHUNK_ALL_FACES, CHUNK_ALL_FACES 
+};
+
+void MapRenderer_SetConnections(struct ChunkInfo* info, const cc_uint8* connections) {
+	int i;
+	for (i = 0; i < FACE_COUNT; i++) {
+		if (info->Connections[i] == connections[i]) continue;
+		info->Connections[i] = connections[i];
+		occlusionDirty = true;
+	}
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------------General---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -636,6 +1451,8 @@ void MapRenderer_RefreshChunk(int cx, int cy, int cz) {
 	if (info->AllAir) return; /* do not recreate chunks completely air */
 	info->Empty         = false;
 	info->PendingDelete = true;
+	/* Chunk may now be seen through, so don't occlude anything behind it until rebuilt */
+	MapRenderer_SetConnections(info, MapRenderer_AllConnections);
 }
 
 void MapRenderer_DeleteChunk(struct ChunkInfo* info) {
@@ -645,13 +1462,10 @@ void MapRenderer_DeleteChunk(struct ChunkInfo* info) {
 	int j;
 #else
 	Gfx_DeleteVb(&info->Vb);
+	DeleteArenaMesh(info);
 #endif
 
 	info->Empty = false; info->AllAir = false;
-#ifdef OCCLUSION
-	info.OcclusionFlags = 0;
-	info.OccludedFlags = 0;
-#endif
 
 	if (info->NormalParts) {
 		ptr = info->NormalParts;
@@ -679,36 +1493,17 @@ void MapRenderer_DeleteChunk(struct ChunkInfo* info) {
 }
 
 void MapRenderer_BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
-	struct ChunkPartInfo* ptr;
-	int i;
-
 	Game.ChunkUpdates++;
 	(*chunkUpdates)++;
 	info->PendingDelete = false;
 	Builder_MakeChunk(info);
-
-	if (!info->NormalParts && !info->TranslucentParts) {
-		info->Empty = true; return;
-	}
-	
-	if (info->NormalParts) {
-		ptr = info->NormalParts;
-		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
-			if (ptr->Offset >= 0) normPartsCount[i]++;
-		}
-	}
-
-	if (info->TranslucentParts) {
-		ptr = info->TranslucentParts;
-		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += MapRenderer_ChunksCount) {
-			if (ptr->Offset >= 0) tranPartsCount[i]++;
-		}
-	}
+	AddPartCounts(info);
 }
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
 	if (envVar == ENV_VAR_SUN_COL || envVar == ENV_VAR_SHADOW_COL) {
-		MapRenderer_Refresh();
+		/* Sun and shadow colours are otherwise baked into the chunk meshes */
+		if (!Builder_VertexLighting) MapRenderer_Refresh();
 	} else if (envVar == ENV_VAR_EDGE_HEIGHT || envVar == ENV_VAR_SIDES_OFFSET) {
 		int oldClip        = Builder_EdgeLevel;
 		Builder_SidesLevel = max(0, Env_SidesHeight);
@@ -726,24 +1521,38 @@ static void OnTerrainAtlasChanged(void* obj) {
 		MapRenderer_Refresh();
 	}
 
-	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
+	UpdateUsedAtlases();
 	tilesPerAtlas = Atlas1D.TilesPerAtlas;
 	ResetPartFlags();
 }
 
 static void OnBlockDefinitionChanged(void* obj) {
-	MapRenderer_Refresh();
-	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
+	/* Parts of all chunks need to be reallocated when used atlases change */
+	if (!Blocks.ChangedMask || UsedAtlasesChanged()) {
+		MapRenderer_Refresh();
+	} else {
+		RefreshChangedChunks(Blocks.ChangedMask);
+	}
+	UpdateUsedAtlases();
 	ResetPartFlags();
 }
 
 static void OnVisibilityChanged(void* obj) {
 	lastCamPos = Vec3_BigPos();
+	/* Need to recalculate which chunks are within the new view distance */
+	chunkPos   = IVec3_MaxValue();
 	CalcViewDists();
+	occlusionDirty = true;
 }
 static void MapRenderer_DeleteChunks_(void* obj) { DeleteChunks(); }
 static void MapRenderer_Refresh_(void* obj)      { MapRenderer_Refresh(); }
 
+static void MapRenderer_OnNewMapLoaded(void);
+static void OnLayersLoaded(void* obj, int height) {
+	/* Chunks are built as soon as the layers they need are loaded, see ChunkInfo_Loaded */
+	if (!height) MapRenderer_OnNewMapLoaded();
+}
+
 static void MapRenderer_OnNewMap(void) {
 	Game.ChunkUpdates = 0;
 	DeleteChunks();
@@ -756,6 +1565,8 @@ static void MapRenderer_OnNewMap(void) {
 
 static void MapRenderer_OnNewMapLoaded(void) {
 	int count;
+	/* Meshes for a progressively loaded map were built with incomplete lighting */
+	DeleteChunks();
 	MapRenderer_ChunksX = (World.Width  + CHUNK_MAX) >> CHUNK_SHIFT;
 	MapRenderer_ChunksY = (World.Height + CHUNK_MAX) >> CHUNK_SHIFT;
 	MapRenderer_ChunksZ = (World.Length + CHUNK_MAX) >> CHUNK_SHIFT;
@@ -775,9 +1586,11 @@ static void MapRenderer_OnNewMapLoaded(void) {
 }
 
 static void MapRenderer_Init(void) {
+	int i;
 	Event_RegisterVoid(&TextureEvents.AtlasChanged,  NULL, OnTerrainAtlasChanged);
 	Event_RegisterInt(&WorldEvents.EnvVarChanged,    NULL, OnEnvVariableChanged);
 	Event_RegisterVoid(&BlockEvents.BlockDefChanged, NULL, OnBlockDefinitionChanged);
+	Event_RegisterInt(&WorldEvents.LayersLoaded,     NULL, OnLayersLoaded);
 
 	Event_RegisterVoid(&GfxEvents.ViewDistanceChanged, NULL, OnVisibilityChanged);
 	Event_RegisterVoid(&GfxEvents.ProjectionChanged,   NULL, OnVisibilityChanged);
@@ -786,8 +1599,12 @@ static void MapRenderer_Init(void) {
 
 	/* This = 87 fixes map being invisible when no textures */
 	MapRenderer_1DUsedCount = 87; /* Atlas1D_UsedAtlasesCount(); */
+	for (i = 0; i < ATLAS1D_MAX_ATLASES; i++) { MapRenderer_1DUsedAtlases[i] = i; }
 	chunkPos   = IVec3_MaxValue();
-	maxChunkUpdates = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, 1024, 30);
+	maxChunkUpdates = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, MAX_CHUNK_UPDATES, 30);
+#ifndef CC_BUILD_GL11
+	MapRenderer_ChunkArena = Options_GetBool(OPT_CHUNK_ARENA, true);
+#endif
 	CalcViewDists();
 }
 
@@ -795,6 +1612,7 @@ static void MapRenderer_Free(void) {
 	Event_UnregisterVoid(&TextureEvents.AtlasChanged,  NULL, OnTerrainAtlasChanged);
 	Event_UnregisterInt(&WorldEvents.EnvVarChanged,    NULL, OnEnvVariableChanged);
 	Event_UnregisterVoid(&BlockEvents.BlockDefChanged, NULL, OnBlockDefinitionChanged);
+	Event_UnregisterInt(&WorldEvents.LayersLoaded,     NULL, OnLayersLoaded);
 
 	Event_UnregisterVoid(&GfxEvents.ViewDistanceChanged, NULL, OnVisibilityChanged);
 	Event_UnregisterVoid(&GfxEvents.ProjectionChanged,   NULL, OnVisibilityChanged);
@@ -14,12 +14,15 @@ extern int MapRenderer_ChunksX, MapRenderer_ChunksY, MapRenderer_ChunksZ;
 #define MapRenderer_Pack(cx, cy, cz) (((cz) * MapRenderer_ChunksY + (cy)) * MapRenderer_ChunksX + (cx))
 /* TODO: Swap Y and Z? Make sure to update ChunkUpdater's ResetChunkCache and ClearChunkCache methods! */
 
-/* Max used 1D atlases. (i.e. Atlas1D_Index(maxTextureLoc) + 1) */
+/* Number of 1D atlases that contain the textures of at least one block. */
 extern int MapRenderer_1DUsedCount;
+/* Indices of the 1D atlases that contain the textures of at least one block, in ascending order. */
+/* NOTE: Chunk parts are only stored for these atlases. (a chunk's part for MapRenderer_1DUsedAtlases[i] is in batch i) */
+extern int MapRenderer_1DUsedAtlases[];
 /* Number of chunks in the world, or ChunksX * ChunksY * ChunksZ */
 extern int MapRenderer_ChunksCount;
 
-/* Buffer for all chunk parts. There are (MapRenderer_ChunksCount * Atlas1D_Count) parts in the buffer,
+/* Buffer for all chunk parts. There are (MapRenderer_ChunksCount * MapRenderer_1DUsedCount) parts in the buffer,
 with parts for 'normal' buffer being in lower half. */
 extern struct ChunkPartInfo* MapRenderer_PartsNormal; /* TODO: THAT DESC SUCKS */
 extern struct ChunkPartInfo* MapRenderer_PartsTranslucent;
@@ -36,6 +39,11 @@ struct ChunkPartInfo {
 	cc_uint16 Counts[FACE_COUNT]; /* Counts per face */
 };
 
+/* Bit flags of all faces of a chunk. (see ChunkInfo.Connections) */
+#define CHUNK_ALL_FACES ((1 << FACE_COUNT) - 1)
+/* Connections of a chunk that can be seen through from every face to every other face. */
+extern const cc_uint8 MapRenderer_AllConnections[FACE_COUNT];
+
 /* Describes data necessary for rendering a chunk. */
 struct ChunkInfo {	
 	cc_uint16 CentreX, CentreY, CentreZ; /* Centre coordinates of the chunk */
@@ -44,6 +52,8 @@ struct ChunkInfo {
 	cc_uint8 Empty : 1;         /* Whether the chunk is empty of data */
 	cc_uint8 PendingDelete : 1; /* Whether chunk is pending deletion */
 	cc_uint8 AllAir : 1;        /* Whether chunk is completely air */
+	cc_uint8 Building : 1;      /* Whether chunk mesh is being built on a builder thread */
+	cc_uint8 Occluded : 1;      /* Whether chunk is hidden from the camera by other chunks */
 	cc_uint8 : 0;               /* pad to next byte*/
 
 	cc_uint8 DrawXMin : 1;
@@ -53,12 +63,14 @@ struct ChunkInfo {
 	cc_uint8 DrawYMin : 1;
 	cc_uint8 DrawYMax : 1;
 	cc_uint8 : 0;          /* pad to next byte */
-#ifdef OCCLUSION
-	public cc_bool Visited = false, Occluded = false;
-	public byte OcclusionFlags, OccludedFlags, DistanceFlags;
-#endif
+	/* For each face of the chunk, bit flags of the faces that can be seen through the chunk from it. */
+	/* (i.e. whether the two faces are connected by blocks which are not fully opaque) */
+	cc_uint8 Connections[FACE_COUNT];
 #ifndef CC_BUILD_GL11
 	GfxResourceID Vb;
+	/* Shared vertex buffer the mesh was sub-allocated from, or NULL if the mesh uses Vb instead. */
+	struct ChunkArenaPage* ArenaPage;
+	int ArenaOffset, ArenaCount; /* Range of vertices in ArenaPage used by the mesh */
 #endif
 	struct ChunkPartInfo* NormalParts;
 	struct ChunkPartInfo* TranslucentParts;
@@ -85,6 +97,17 @@ void MapRenderer_DeleteChunk(struct ChunkInfo* info);
 /* Builds the mesh (and hence vertex buffer) for the given chunk. */
 /* NOTE: This method also adjusts internal state, so do not bypass this. */
 void MapRenderer_BuildChunk(struct ChunkInfo* info, int* chunkUpdates);
+/* Whether chunk meshes are sub-allocated from a few large shared vertex buffers, */
+/*  so that the visible parts in each buffer can be drawn together. (see Gfx_DrawIndexedTris_Multi) */
+extern cc_bool MapRenderer_ChunkArena;
+/* Uploads the mesh of the given chunk into one of the shared vertex buffers. */
+/* Returns false if the mesh must use its own vertex buffer instead. (e.g. mesh is too large) */
+cc_bool MapRenderer_UploadToArena(struct ChunkInfo* info, void* vertices, int count);
+/* Sets which faces of the given chunk can be seen through the chunk from each other face. */
+/* NOTE: This method also adjusts internal state, so do not bypass this. */
+void MapRenderer_SetConnections(struct ChunkInfo* info, const cc_uint8* connections);
+/* Returns how many 1D atlases would contain the textures of at least one block, with the given tiles per atlas. */
+int MapRenderer_CountUsedAtlases(int tilesPerAtlas);
 
 /* Deletes all chunks and resets internal state. */
 void MapRenderer_Refresh(void);
@@ -1305,48 +1305,41 @@ finished:
 }
 #endif
 
-static void SaveLevelScreen_SaveMap(struct SaveLevelScreen* s, const String* path) {
+static void SaveLevelScreen_OnSaved(const String* path, cc_result res) {
+#ifdef CC_BUILD_WEB
 	static const String cw = String_FromConst(".cw");
-	struct Stream stream, compStream;
-	struct GZipState state;
-	cc_result res;
-
-	res = Stream_CreateFile(&stream, path);
-	if (res) { Logger_Warn2(res, "creating", path); return; }
-	GZip_MakeStream(&compStream, &state, &stream);
+#endif
+	if (res) { Logger_Warn2(res, "saving", path); return; }
 
 #ifdef CC_BUILD_WEB
-	res = Cw_Save(&compStream);
-#else
 	if (String_CaselessEnds(path, &cw)) {
-		res = Cw_Save(&compStream);
+		Chat_Add1("&eSaved map to: %s", path);
 	} else {
-		res = Schematic_Save(&compStream);
+		DownloadMap(path);
 	}
+#else
+	Chat_Add1("&eSaved map to: %s", path);
 #endif
+}
 
-	if (res) {
-		stream.Close(&stream);
-		Logger_Warn2(res, "encoding", path); return;
-	}
+static void SaveLevelScreen_SaveMap(struct SaveLevelScreen* s, const String* path) {
+	static const String cw = String_FromConst(".cw");
+	cc_bool schematic;
+	cc_result res;
 
-	if ((res = compStream.Close(&compStream))) {
-		stream.Close(&stream);
-		Logger_Warn2(res, "closing", path); return;
+	if (Map_IsSaving()) {
+		TextWidget_SetConst(&s->desc, "&eAlready saving a map, please wait", &s->textFont);
+		return;
 	}
 
-	res = stream.Close(&stream);
-	if (res) { Logger_Warn2(res, "closing", path); return; }
-
 #ifdef CC_BUILD_WEB
-	if (String_CaselessEnds(path, &cw)) {
-		Chat_Add1("&eSaved map to: %s", path);
-	} else {
-		DownloadMap(path);
-	}
+	schematic = false;
 #else
-	Chat_Add1("&eSaved map to: %s", path);
+	schematic = !String_CaselessEnds(path, &cw);
 #endif
+
+	res = Map_SaveAsync(path, schematic, SaveLevelScreen_OnSaved);
+	if (res) { Logger_Warn2(res, "creating", path); return; }
 	PauseScreen_Show();
 }
 
@@ -66,6 +66,11 @@
 #define OPT_CLASSIC_ARM_MODEL "nostalgia-classicarm"
 #define OPT_CLASSIC_CHAT "nostalgia-classicchat"
 #define OPT_MAX_CHUNK_UPDATES "gfx-maxchunkupdates"
+#define OPT_BUILDER_THREADS "gfx-builderthreads"
+#define OPT_GREEDY_MESHING "gfx-greedymeshing"
+#define OPT_CHUNK_ARENA "gfx-chunkarena"
+#define OPT_WORLD_SECTIONS "world-sections"
+#define OPT_COMPRESSION_LEVEL "compression-level"
 #define OPT_CAMERA_MASS "cameramass"
 
 extern struct StringsBuffer Options;
@@ -433,6 +433,19 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 	*len = GetFileSize(file, NULL);
 	return *len != INVALID_FILE_SIZE ? 0 : GetLastError();
 }
+
+cc_result File_Rename(const String* src, const String* dst) {
+	TCHAR srcStr[NATIVE_STR_LEN], dstStr[NATIVE_STR_LEN];
+	Platform_ConvertString(srcStr, src);
+	Platform_ConvertString(dstStr, dst);
+	return MoveFileEx(srcStr, dstStr, MOVEFILE_REPLACE_EXISTING) ? 0 : GetLastError();
+}
+
+cc_result File_Delete(const String* path) {
+	TCHAR str[NATIVE_STR_LEN];
+	Platform_ConvertString(str, path);
+	return DeleteFile(str) ? 0 : GetLastError();
+}
 #elif defined CC_BUILD_POSIX
 int Directory_Exists(const String* path) {
 	char str[NATIVE_STR_LEN];
@@ -552,6 +565,19 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 	if (fstat(file, &st) == -1) { *len = -1; return errno; }
 	*len = st.st_size; return 0;
 }
+
+cc_result File_Rename(const String* src, const String* dst) {
+	char srcStr[NATIVE_STR_LEN], dstStr[NATIVE_STR_LEN];
+	Platform_ConvertString(srcStr, src);
+	Platform_ConvertString(dstStr, dst);
+	return rename(srcStr, dstStr) == -1 ? errno : 0;
+}
+
+cc_result File_Delete(const String* path) {
+	char str[NATIVE_STR_LEN];
+	Platform_ConvertString(str, path);
+	return unlink(str) == -1 ? errno : 0;
+}
 #endif
 
 
@@ -588,6 +614,12 @@ void Thread_Join(void* handle) {
 	Thread_Detach(handle);
 }
 
+int Thread_ProcessorsCount(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+}
+
 void* Mutex_Create(void) {
 	CRITICAL_SECTION* ptr = (CRITICAL_SECTION*)Mem_Alloc(1, sizeof(CRITICAL_SECTION), "mutex");
 	InitializeCriticalSection(ptr);
@@ -629,6 +661,7 @@ void Thread_Sleep(cc_uint32 milliseconds) { }
 void* Thread_Start(Thread_StartFunc func, cc_bool detach) { func(); return NULL; }
 void Thread_Detach(void* handle) { }
 void Thread_Join(void* handle) { }
+int Thread_ProcessorsCount(void) { return 1; }
 
 void* Mutex_Create(void) { return NULL; }
 void Mutex_Free(void* handle) { }
@@ -671,6 +704,11 @@ void Thread_Join(void* handle) {
 	Mem_Free(ptr);
 }
 
+int Thread_ProcessorsCount(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
 void* Mutex_Create(void) {
 	pthread_mutex_t* ptr = (pthread_mutex_t*)Mem_Alloc(1, sizeof(pthread_mutex_t), "mutex");
 	int res = pthread_mutex_init(ptr, NULL);
@@ -161,6 +161,10 @@ cc_result File_Seek(cc_file file, int offset, int seekType);
 cc_result File_Position(cc_file file, cc_uint32* pos);
 /* Attempts to retrieve the length of the given file. */
 cc_result File_Length(cc_file file, cc_uint32* len);
+/* Attempts to rename a file, replacing the destination file if it already exists. */
+cc_result File_Rename(const String* src, const String* dst);
+/* Attempts to delete the given file. */
+cc_result File_Delete(const String* path);
 
 /* Blocks the current thread for the given number of milliseconds. */
 CC_API void Thread_Sleep(cc_uint32 milliseconds);
@@ -173,6 +177,8 @@ CC_API void Thread_Detach(void* handle);
 /* Blocks the current thread, until the given thread has finished. */
 /* NOTE: Once a thread has been detached, you can no longer use this method. */
 CC_API void Thread_Join(void* handle);
+/* Returns the number of logical processors available to run threads on. */
+CC_API int Thread_ProcessorsCount(void);
 
 /* Allocates a new mutex. (used to synchronise access to a shared resource) */
 CC_API void* Mutex_Create(void);
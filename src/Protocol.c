@@ -15,7 +15,6 @@
 #include "Block.h"
 #include "Model.h"
 #include "Funcs.h"
-#include "Lighting.h"
 #include "Http.h"
 #include "Drawer2D.h"
 #include "Logger.h"
@@ -40,6 +39,8 @@ static cc_bool classic_receivedFirstPos;
 /* Map state */
 static cc_bool map_begunLoading;
 static cc_uint64 map_receiveBeg;
+/* Map decompression state (See Protocol_Preprocess) */
+static cc_bool map_decoding;
 static struct Stream map_part;
 static struct GZipHeader map_gzHeader;
 static int map_sizeIndex, map_volume;
@@ -61,8 +62,10 @@ static struct MapState map2;
 cc_bool cpe_needD3Fix;
 static int cpe_serverExtensionsCount, cpe_pingTicks;
 static int cpe_envMapVer = 2, cpe_blockDefsExtVer = 2, cpe_customModelsVer = 2;
-static cc_bool cpe_sendHeldBlock, cpe_useMessageTypes, cpe_extEntityPos, cpe_blockPerms, cpe_fastMap;
+static cc_bool cpe_sendHeldBlock, cpe_useMessageTypes, cpe_extEntityPos, cpe_blockPerms;
 static cc_bool cpe_twoWayPing, cpe_extTextures, cpe_extBlocks;
+/* CPE state only used when framing and decoding packets (See Protocol_Preprocess) */
+static cc_bool cpe_fastMap, cpe_mapExtBlocks;
 
 /*########################################################################################################################*
 *-----------------------------------------------------Common handlers-----------------------------------------------------*
@@ -425,38 +428,31 @@ static void FreeMapStates(void) {
 #endif
 }
 
-static void MapState_Read(struct MapState* m) {
+static cc_result MapState_Read(struct MapState* m) {
 	cc_uint32 left, read;
-	if (m->allocFailed) return;
+	if (m->allocFailed) return 0;
 
 	if (!m->blocks) {
 		m->blocks = (BlockRaw*)Mem_TryAlloc(map_volume, 1);
 		/* unlikely but possible */
-		if (!m->blocks) {
-			Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
-			m->allocFailed = true;
-			return;
-		}
+		if (!m->blocks) { m->allocFailed = true; return ERR_OUT_OF_MEMORY; }
+		/* Rest of the map data is decompressed in order into blocks */
+		Inflate_UseDirectOutput(&m->inflateState);
 	}
 
 	left = map_volume - m->index;
 	m->stream.Read(&m->stream, &m->blocks[m->index], left, &read);
 	m->index += read;
+	return 0;
 }
 
-static void Classic_StartLoading(void) {
-	World_NewMap();
+/* NOTE: The MapDecode_ functions may be called from the network thread, so must not touch game state */
+static void MapDecode_Begin(void) {
 	Stream_ReadonlyMemory(&map_part, NULL, 0);
-
-	LoadingScreen_Show(&Server.Name, &Server.MOTD);
-	WoM_CheckMotd();
-	classic_receivedFirstPos = false;
-
 	GZipHeader_Init(&map_gzHeader);
-	map_begunLoading = true;
-	map_sizeIndex    = 0;
-	map_receiveBeg   = Stopwatch_Measure();
-	map_volume       = 0;
+	map_decoding  = true;
+	map_sizeIndex = 0;
+	map_volume    = 0;
 
 	MapState_Init(&map);
 #ifdef EXTENDED_BLOCKS
@@ -464,8 +460,8 @@ static void Classic_StartLoading(void) {
 #endif
 }
 
-static void Classic_LevelInit(cc_uint8* data) {
-	if (!map_begunLoading) Classic_StartLoading();
+static void MapDecode_LevelInit(cc_uint8* data) {
+	if (!map_decoding) MapDecode_Begin();
 	if (!cpe_fastMap) return;
 
 	/* Fast map puts volume in header, and uses raw DEFLATE without GZIP header/footer */
@@ -474,40 +470,28 @@ static void Classic_LevelInit(cc_uint8* data) {
 	map_sizeIndex = 4;
 }
 
-static void DisconnectInvalidMap(cc_result res) {
-	static const String title  = String_FromConst("Disconnected");
-	String tmp; char tmpBuffer[STRING_SIZE];
-	String_InitArray(tmp, tmpBuffer);
-
-	String_Format1(&tmp, "Server sent corrupted map data (error %h)", &res);
-	Game_Disconnect(&title, &tmp); return;
-}
-
-static void Classic_LevelDataChunk(cc_uint8* data) {
+static void MapDecode_LevelDataChunk(cc_uint8* data) {
 	int usedLength;
-	float progress;
 	cc_uint32 left, read;
 	cc_uint8 value;
-	cc_result res;
+	cc_result res = 0;
 
 	/* Workaround for some servers that send LevelDataChunk before LevelInit due to their async sending behaviour */
-	if (!map_begunLoading) Classic_StartLoading();
-	usedLength = Stream_GetU16_BE(data); data += 2;
+	if (!map_decoding) MapDecode_Begin();
+	usedLength = Stream_GetU16_BE(data);
 
-	map_part.Meta.Mem.Cur    = data;
-	map_part.Meta.Mem.Base   = data;
+	map_part.Meta.Mem.Cur    = data + 2;
+	map_part.Meta.Mem.Base   = data + 2;
 	map_part.Meta.Mem.Left   = usedLength;
 	map_part.Meta.Mem.Length = usedLength;
-
-	data += 1024;
-	value = *data; /* progress in original classic, but we ignore it */
+	value = data[2 + 1024]; /* progress in original classic, but we ignore it */
 
 	if (!map_gzHeader.done) {
 		res = GZipHeader_Read(&map_part, &map_gzHeader);
-		if (res && res != ERR_END_OF_STREAM) { DisconnectInvalidMap(res); return; }
+		if (res == ERR_END_OF_STREAM) res = 0;
 	}
 
-	if (map_gzHeader.done) {
+	if (!res && map_gzHeader.done) {
 		if (map_sizeIndex < 4) {
 			left = 4 - map_sizeIndex;
 			map.stream.Read(&map.stream, &map_size[map_sizeIndex], left, &read); 
@@ -518,18 +502,66 @@ static void Classic_LevelDataChunk(cc_uint8* data) {
 			if (!map_volume) map_volume = Stream_GetU32_BE(map_size);
 
 #ifndef EXTENDED_BLOCKS
-			MapState_Read(&map);
+			res = MapState_Read(&map);
 #else
-			if (cpe_extBlocks && value) {
-				MapState_Read(&map2);
+			if (cpe_mapExtBlocks && value) {
+				res = MapState_Read(&map2);
 			} else {
-				MapState_Read(&map);
+				res = MapState_Read(&map);
 			}
 #endif
 		}
 	}
 
-	progress = !map.blocks ? 0.0f : (float)map.index / map_volume;
+	/* The compressed data has been consumed at this point, so reuse */
+	/* the packet to pass the decoding results on to the main thread */
+	Stream_SetU32_BE(data + 0, map.blocks ? map.index : 0);
+	Stream_SetU32_BE(data + 4, map_volume);
+	Stream_SetU32_BE(data + 8, res);
+}
+
+static void Classic_StartLoading(void) {
+	World_NewMap();
+	LoadingScreen_Show(&Server.Name, &Server.MOTD);
+	WoM_CheckMotd();
+	classic_receivedFirstPos = false;
+
+	map_begunLoading = true;
+	map_receiveBeg   = Stopwatch_Measure();
+}
+
+static void Classic_LevelInit(cc_uint8* data) {
+	if (!map_begunLoading) Classic_StartLoading();
+}
+
+static void DisconnectInvalidMap(cc_result res) {
+	static const String title  = String_FromConst("Disconnected");
+	String tmp; char tmpBuffer[STRING_SIZE];
+	String_InitArray(tmp, tmpBuffer);
+
+	String_Format1(&tmp, "Server sent corrupted map data (error %h)", &res);
+	Game_Disconnect(&title, &tmp); return;
+}
+
+static void Classic_LevelDataChunk(cc_uint8* data) {
+	cc_uint32 index, volume;
+	float progress;
+	cc_result res;
+
+	/* Workaround for some servers that send LevelDataChunk before LevelInit due to their async sending behaviour */
+	if (!map_begunLoading) Classic_StartLoading();
+	/* Map data was already decompressed by MapDecode_LevelDataChunk */
+	index  = Stream_GetU32_BE(data + 0);
+	volume = Stream_GetU32_BE(data + 4);
+	res    = Stream_GetU32_BE(data + 8);
+
+	if (res == ERR_OUT_OF_MEMORY) {
+		Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
+	} else if (res) {
+		DisconnectInvalidMap(res); return;
+	}
+
+	progress = !index ? 0.0f : (float)index / volume;
 	Event_RaiseFloat(&WorldEvents.Loading, progress);
 }
 
@@ -543,6 +575,7 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 	Platform_Log1("map loading took: %i", &delta);
 	map_begunLoading = false;
 	WoM_CheckSendWomID();
+	/* NOTE: Network thread waits for this packet to be processed before decoding further packets */
 
 #ifdef EXTENDED_BLOCKS
 	if (map2.allocFailed) FreeMapStates();
@@ -719,6 +752,7 @@ static void Classic_ReadAbsoluteLocation(cc_uint8* data, EntityID id, cc_bool in
 
 static void Classic_Reset(void) {
 	map_begunLoading = false;
+	map_decoding     = false;
 	classic_receivedFirstPos = false;
 
 	Net_Set(OPCODE_HANDSHAKE, Classic_Handshake, 131);
@@ -872,9 +906,7 @@ static void CPE_SendCpeExtInfoReply(void) {
 }
 
 static void CPE_ExtInfo(cc_uint8* data) {
-	static const String d3Server = String_FromConst("D3 server");
 	String appName = UNSAFE_GetString(&data[0]);
-	cpe_needD3Fix  = String_CaselessStarts(&appName, &d3Server);
 	Chat_Add1("Server software: %s", &appName);
 
 	/* Workaround for old MCGalaxy that send ExtEntry sync but ExtInfo async. */
@@ -904,14 +936,42 @@ static void CPE_ExtEntry(cc_uint8* data) {
 		Server.SupportsPlayerClick = true;
 	} else if (String_CaselessEqualsConst(&ext, "EnvMapAppearance")) {
 		cpe_envMapVer = version;
-		if (version == 1) return;
-		Net_PacketSizes[OPCODE_ENV_SET_MAP_APPEARANCE] += 4;
 	} else if (String_CaselessEqualsConst(&ext, "LongerMessages")) {
 		Server.SupportsPartialMessages = true;
 	} else if (String_CaselessEqualsConst(&ext, "FullCP437")) {
 		Server.SupportsFullCP437 = true;
 	} else if (String_CaselessEqualsConst(&ext, "BlockDefinitionsExt")) {
 		cpe_blockDefsExtVer = version;
+	} else if (String_CaselessEqualsConst(&ext, "ExtEntityPositions")) {
+		cpe_extEntityPos = true;
+	} else if (String_CaselessEqualsConst(&ext, "TwoWayPing")) {
+		cpe_twoWayPing = true;
+	} else if (String_CaselessEqualsConst(&ext, "CustomModels")) {
+		cpe_customModelsVer = min(2, version);
+	}
+#ifdef EXTENDED_TEXTURES
+	else if (String_CaselessEqualsConst(&ext, "ExtendedTextures")) {
+		cpe_extTextures = true;
+	}
+#endif
+#ifdef EXTENDED_BLOCKS
+	else if (String_CaselessEqualsConst(&ext, "ExtendedBlocks")) {
+		if (!Game_AllowCustomBlocks) return;
+		cpe_extBlocks = true;
+	}
+#endif
+}
+
+/* Updates sizes of packets that are changed by the given extension */
+/* NOTE: May be called from the network thread. (See Protocol_Preprocess) */
+static void CPE_ApplyExtEntry(cc_uint8* data) {
+	String ext  = UNSAFE_GetString(&data[0]);
+	int version = data[67];
+
+	if (String_CaselessEqualsConst(&ext, "EnvMapAppearance")) {
+		if (version == 1) return;
+		Net_PacketSizes[OPCODE_ENV_SET_MAP_APPEARANCE] += 4;
+	} else if (String_CaselessEqualsConst(&ext, "BlockDefinitionsExt")) {
 		if (version == 1) return;
 		Net_PacketSizes[OPCODE_DEFINE_BLOCK_EXT] += 3;
 	} else if (String_CaselessEqualsConst(&ext, "ExtEntityPositions")) {
@@ -919,14 +979,10 @@ static void CPE_ExtEntry(cc_uint8* data) {
 		Net_PacketSizes[OPCODE_ADD_ENTITY]      += 6;
 		Net_PacketSizes[OPCODE_EXT_ADD_ENTITY2] += 6;
 		Net_PacketSizes[OPCODE_SET_SPAWNPOINT]  += 6;
-		cpe_extEntityPos = true;
-	} else if (String_CaselessEqualsConst(&ext, "TwoWayPing")) {
-		cpe_twoWayPing = true;
 	} else if (String_CaselessEqualsConst(&ext, "FastMap")) {
 		Net_PacketSizes[OPCODE_LEVEL_BEGIN] += 4;
 		cpe_fastMap = true;
 	} else if (String_CaselessEqualsConst(&ext, "CustomModels")) {
-		cpe_customModelsVer = min(2, version);
 		if (version == 2) {
 			Net_PacketSizes[OPCODE_DEFINE_MODEL_PART] = 167;
 		}
@@ -935,13 +991,12 @@ static void CPE_ExtEntry(cc_uint8* data) {
 	else if (String_CaselessEqualsConst(&ext, "ExtendedTextures")) {
 		Net_PacketSizes[OPCODE_DEFINE_BLOCK]     += 3;
 		Net_PacketSizes[OPCODE_DEFINE_BLOCK_EXT] += 6;
-		cpe_extTextures = true;
 	}
 #endif
 #ifdef EXTENDED_BLOCKS
 	else if (String_CaselessEqualsConst(&ext, "ExtendedBlocks")) {
 		if (!Game_AllowCustomBlocks) return;
-		cpe_extBlocks = true;
+		cpe_mapExtBlocks = true;
 
 		Net_PacketSizes[OPCODE_SET_BLOCK] += 1;
 		Net_PacketSizes[OPCODE_HOLD_THIS] += 1;
@@ -1184,6 +1239,7 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 		data += BULK_MAX_BLOCKS / 4;
 	}
 
+	Game_BeginBlockBatch();
 	for (i = 0; i < count; i++) {
 		index = indices[i];
 		if (index < 0 || index >= World.Volume) continue;
@@ -1195,6 +1251,7 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 		Game_UpdateBlock(x, y, z, blocks[i]);
 #endif
 	}
+	Game_EndBlockBatch();
 }
 
 static void CPE_SetTextColor(cc_uint8* data) {
@@ -1571,6 +1628,7 @@ static void CPE_Reset(void) {
 	cpe_envMapVer = 2; cpe_blockDefsExtVer = 2; cpe_customModelsVer = 2;
 	cpe_needD3Fix = false; cpe_extEntityPos = false; cpe_twoWayPing = false; 
 	cpe_extTextures = false; cpe_fastMap = false; cpe_extBlocks = false;
+	cpe_mapExtBlocks = false;
 	Game_UseCPEBlocks = false;
 	if (!Game_UseCPE) return;
 
@@ -1627,7 +1685,8 @@ static void CPE_Tick(void) {
 static void BlockDefs_OnBlockUpdated(BlockID block, cc_bool didBlockLight) {
 	if (!World.Loaded) return;
 	/* Need to refresh lighting when a block's light blocking state changes */
-	if (Blocks.BlocksLight[block] != didBlockLight) Lighting_Refresh();
+	/* (only done for the columns that contain the block, once changes are applied) */
+	if (Blocks.BlocksLight[block] != didBlockLight) Block_MarkChanged(block, true);
 }
 
 static TextureLoc BlockDefs_Tex(cc_uint8** ptr) {
@@ -1724,13 +1783,12 @@ static void BlockDefs_UndefineBlock(cc_uint8* data) {
 
 	Block_ResetProps(block);
 	BlockDefs_OnBlockUpdated(block, didBlockLight);
-	Block_UpdateCulling(block);
 
 	Inventory_Remove(block);
 	if (block < BLOCK_CPE_COUNT) { Inventory_AddDefault(block); }
 
 	Block_SetCustomDefined(block, false);
-	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
+	Block_MarkChanged(block, false);
 }
 
 static void BlockDefs_DefineBlockExt(cc_uint8* data) {
@@ -1768,6 +1826,26 @@ static void Protocol_Reset(void) {
 	WoM_Reset();
 }
 
+void Protocol_Preprocess(cc_uint8* data) {
+	static const String d3Server = String_FromConst("D3 server");
+	String appName;
+
+	switch (data[0]) {
+	case OPCODE_LEVEL_BEGIN:
+		MapDecode_LevelInit(data + 1); break;
+	case OPCODE_LEVEL_DATA:
+		MapDecode_LevelDataChunk(data + 1); break;
+	case OPCODE_LEVEL_END:
+		map_decoding = false; break;
+	case OPCODE_EXT_INFO:
+		appName = UNSAFE_GetString(data + 1);
+		cpe_needD3Fix = String_CaselessStarts(&appName, &d3Server);
+		break;
+	case OPCODE_EXT_ENTRY:
+		CPE_ApplyExtEntry(data + 1); break;
+	}
+}
+
 void Protocol_Tick(void) {
 	Classic_Tick();
 	CPE_Tick();
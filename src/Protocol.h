@@ -46,6 +46,10 @@ extern cc_uint16 Net_PacketSizes[OPCODE_COUNT];
 /* Functions that handle processing received packets. */
 extern Net_Handler Net_Handlers[OPCODE_COUNT];
 #define Net_Set(opcode, handler, size) Net_Handlers[opcode] = handler; Net_PacketSizes[opcode] = size;
+/* Does the work for a packet that affects framing of later packets, or that is safe to do off the main thread. */
+/* (e.g. changing packet sizes due to CPE extensions, decompressing map data) */
+/* NOTE: Called on the network thread (if any) for each packet, before its handler runs on the main thread. */
+void Protocol_Preprocess(cc_uint8* data);
 
 struct RayTracer;	
 struct IGameComponent;
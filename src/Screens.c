@@ -19,6 +19,8 @@
 #include "Block.h"
 #include "Menus.h"
 #include "World.h"
+#include "Formats.h"
+#include "Utils.h"
 
 #define CHAT_MAX_STATUS Array_Elems(Chat_Status)
 #define CHAT_MAX_BOTTOMRIGHT Array_Elems(Chat_BottomRight)
@@ -1630,6 +1632,11 @@ static void LoadingScreen_MapLoaded(void* screen) {
 	Gui_Remove((struct Screen*)screen);
 }
 
+static void LoadingScreen_LayersLoaded(void* screen, int height) {
+	/* Show the parts of the world loaded so far behind the progress bar */
+	((struct LoadingScreen*)screen)->blocksWorld = false;
+}
+
 static void LoadingScreen_Init(void* screen) {
 	struct LoadingScreen* s = (struct LoadingScreen*)screen;
 
@@ -1639,6 +1646,7 @@ static void LoadingScreen_Init(void* screen) {
 	Gfx_SetFog(false);
 	Event_RegisterFloat(&WorldEvents.Loading,  s, LoadingScreen_MapLoading);
 	Event_RegisterVoid(&WorldEvents.MapLoaded, s, LoadingScreen_MapLoaded);
+	Event_RegisterInt(&WorldEvents.LayersLoaded, s, LoadingScreen_LayersLoaded);
 }
 
 #define PROG_BAR_WIDTH 200
@@ -1651,7 +1659,7 @@ static void LoadingScreen_Render(void* screen, double delta) {
 	int x, y;
 
 	Gfx_SetTexturing(true);
-	LoadingScreen_DrawBackground();
+	if (s->blocksWorld) LoadingScreen_DrawBackground();
 
 	Elem_Render(&s->title,   delta);
 	Elem_Render(&s->message, delta);
@@ -1669,6 +1677,7 @@ static void LoadingScreen_Free(void* screen) {
 	struct LoadingScreen* s = (struct LoadingScreen*)screen;
 	Event_UnregisterFloat(&WorldEvents.Loading,  s, LoadingScreen_MapLoading);
 	Event_UnregisterVoid(&WorldEvents.MapLoaded, s, LoadingScreen_MapLoaded);
+	Event_UnregisterInt(&WorldEvents.LayersLoaded, s, LoadingScreen_LayersLoaded);
 }
 
 CC_NOINLINE static void LoadingScreen_ShowCommon(const String* title, const String* message) {
@@ -1767,6 +1776,40 @@ void GeneratingScreen_Show(void) {
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------------LoadingMapScreen------------------------------------------------------*
+*#########################################################################################################################*/
+static void LoadingMapScreen_Init(void* screen) {
+	LoadingScreen_Init(screen);
+	Thread_Start(MapLoad_Run, true);
+}
+
+static void LoadingMapScreen_Render(void* screen, double delta) {
+	struct LoadingScreen* s = (struct LoadingScreen*)screen;
+
+	LoadingScreen_Render(s, delta);
+	if (MapLoad_Done) { MapLoad_Finish(); return; }
+	MapLoad_ShowLayers();
+	s->progress = MapLoad_Progress;
+}
+
+static const struct ScreenVTABLE LoadingMapScreen_VTABLE = {
+	LoadingMapScreen_Init,   Screen_NullUpdate, LoadingScreen_Free,
+	LoadingMapScreen_Render, LoadingScreen_BuildMesh,
+	Screen_TInput,           Screen_TInput,     Screen_TKeyPress,   Screen_TText,
+	Screen_TPointer,         Screen_TPointer,   Screen_FPointer,    Screen_TMouseScroll,
+	LoadingScreen_Layout, LoadingScreen_ContextLost, LoadingScreen_ContextRecreated
+};
+void LoadingMapScreen_Show(const String* path) {
+	static const String title = String_FromConst("Loading level");
+	String file = *path;
+	Utils_UNSAFE_GetFilename(&file);
+
+	LoadingScreen.VTABLE = &LoadingMapScreen_VTABLE;
+	LoadingScreen_ShowCommon(&title, &file);
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------DisconnectScreen-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -21,6 +21,7 @@
 #include "Protocol.h"
 #include "Inventory.h"
 #include "Platform.h"
+#include "Stream.h"
 
 static char nameBuffer[STRING_SIZE];
 static char motdBuffer[STRING_SIZE];
@@ -236,12 +237,305 @@ static cc_uint8* net_readCurrent;
 
 static cc_bool net_writeFailed;
 static double net_lastPacket;
-static cc_uint8 net_lastOpcode;
+static cc_uint8 net_lastOpcode, net_framedOpcode;
 
 static cc_bool net_connecting;
 static double net_connectTimeout;
 #define NET_TIMEOUT_SECS 15
 
+static void MPConnection_CheckDisconnection(void) {
+	static const String title  = String_FromConst("Disconnected!");
+	static const String reason = String_FromConst("You've lost connection to the server");
+	cc_result availRes, selectRes;
+	cc_uint32 pending = 0;
+	cc_bool poll_read;
+
+	availRes  = Socket_Available(net_socket, &pending);
+	/* poll read returns true when socket is closed */
+	selectRes = Socket_Poll(net_socket, SOCKET_POLL_READ, &poll_read);
+
+	if (net_writeFailed || availRes || selectRes || (pending == 0 && poll_read)) {	
+		Game_Disconnect(&title, &reason);
+	}
+}
+
+/* Types of entries produced when framing received data */
+enum NET_ENTRY { NET_ENTRY_PACKET, NET_ENTRY_D3_BYTE, NET_ENTRY_INVALID, NET_ENTRY_WRAP };
+static cc_bool Net_Dispatch(int kind, cc_uint8* data, int size);
+
+static void DisconnectInvalidOpcode(cc_uint8 opcode) {
+	static const String title = String_FromConst("Disconnected");
+	String tmp; char tmpBuffer[STRING_SIZE];
+	String_InitArray(tmp, tmpBuffer);
+
+	String_Format2(&tmp, "Server sent invalid packet %b! (prev %b)", &opcode, &net_lastOpcode);
+	Game_Disconnect(&title, &tmp); return;
+}
+
+static void MPConnection_ReadFailed(cc_result res) {
+	static const String title_lost  = String_FromConst("&eLost connection to the server");
+	static const String reason_err  = String_FromConst("I/O error when reading packets");
+	String msg; char msgBuffer[STRING_SIZE * 2];
+
+	String_InitArray(msg, msgBuffer);
+	String_Format3(&msg, "Error reading from %s:%i: %i" _NL, &Server.IP, &Server.Port, &res);
+
+	Logger_Log(&msg);
+	Game_Disconnect(&title_lost, &reason_err);
+}
+
+/* Splits the data in net_readBuffer into packets, and then passes them onto Net_Dispatch */
+/* Returns false if an invalid packet was received, or if no further packets should be processed */
+static cc_bool Net_FramePackets(cc_uint8* readEnd) {
+	cc_uint8* cur = net_readBuffer;
+	cc_uint8 opcode;
+	int i, size, remaining;
+
+	while (cur < readEnd) {
+		opcode = cur[0];
+
+		/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
+		if (cpe_needD3Fix && net_framedOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
+			if (!Net_Dispatch(NET_ENTRY_D3_BYTE, cur, 1)) return false;
+			cur++; continue;
+		}
+
+		if (opcode >= OPCODE_COUNT || !Net_Handlers[opcode]) {
+			Net_Dispatch(NET_ENTRY_INVALID, cur, 1); return false;
+		}
+
+		size = Net_PacketSizes[opcode];
+		if (cur + size > readEnd) break;
+		net_framedOpcode = opcode;
+
+		if (!Net_Dispatch(NET_ENTRY_PACKET, cur, size)) return false;
+		cur += size;
+	}
+
+	/* Protocol packets might be split up across TCP packets */
+	/* If so, copy last few unprocessed bytes back to beginning of buffer */
+	/* These bytes are then later combined with subsequently read TCP packet data */
+	remaining = (int)(readEnd - cur);
+	for (i = 0; i < remaining; i++) {
+		net_readBuffer[i] = cur[i];
+	}
+	net_readCurrent = net_readBuffer + remaining;
+	return true;
+}
+
+/* Runs the handler for a framed packet on the main thread, returning false if disconnected */
+static cc_bool MPConnection_HandleEntry(int kind, cc_uint8* data) {
+	struct LocalPlayer* p;
+	cc_uint8 opcode = data[0];
+
+	if (kind == NET_ENTRY_D3_BYTE) {
+		Platform_LogConst("Skipping invalid HackControl byte from D3 server");
+		p = &LocalPlayer_Instance;
+		p->Physics.JumpVel = 0.42f; /* assume default jump height */
+		p->Physics.ServerJumpVel = p->Physics.JumpVel;
+	} else if (kind == NET_ENTRY_INVALID) {
+		DisconnectInvalidOpcode(opcode); return false;
+	} else {
+		net_lastOpcode = opcode;
+		net_lastPacket = Game.Time;
+		Net_Handlers[opcode](data + 1); /* skip opcode */
+	}
+	return !Server.Disconnected;
+}
+
+#ifdef CC_BUILD_WEB
+/* No threading support, so read and handle packets directly on the main thread */
+static cc_bool Net_Dispatch(int kind, cc_uint8* data, int size) {
+	if (kind == NET_ENTRY_PACKET) Protocol_Preprocess(data);
+	return MPConnection_HandleEntry(kind, data);
+}
+
+static void NetRecv_Start(void) { }
+static void NetRecv_Stop(void) { Socket_Close(net_socket); }
+
+static cc_bool MPConnection_ReadPackets(void) {
+	cc_uint32 pending = 0;
+	cc_uint8* readEnd;
+	cc_result res;
+
+	res     = Socket_Available(net_socket, &pending);
+	readEnd = net_readCurrent;
+
+	if (!res && pending) {
+		/* NOTE: Always using a read call that is a multiple of 4096 (appears to?) improve read performance */	
+		res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &pending);
+		readEnd += pending;
+	}
+
+	if (res) { MPConnection_ReadFailed(res); return false; }
+	return Net_FramePackets(readEnd);
+}
+#else
+/* Received data is read and framed on a separate network thread, with any work that does */
+/*  not touch game state (e.g. map decompression) also done there. (See Protocol_Preprocess) */
+/* Framed packets are then queued in a single producer, single consumer ring buffer, */
+/*  which the main thread then drains each tick and runs the packet handlers for. */
+/* Each entry in the ring consists of a 4 byte header (size and kind), followed by the packet data. */
+#define NET_RING_SIZE (256 * 1024)
+#define NET_ENTRY_HEADER 4
+static cc_uint8 net_ring[NET_RING_SIZE];
+/* Positions in ring that the network thread has written up to, and that the main thread has read up to */
+/* NOTE: Only accessed while holding net_ringMutex, which is only held for updating these. */
+static int net_ringHead, net_ringTail;
+static cc_bool net_recvDone;
+static cc_result net_recvResult;
+
+static void* net_recvThread;
+static void* net_ringMutex;
+static void* net_spaceWaitable;
+static void* net_syncWaitable;
+static volatile cc_bool net_recvQuit;
+/* Position in ring the network thread has written up to, but not made visible to main thread yet */
+static int recv_head;
+
+static void NetRecv_Publish(void) {
+	Mutex_Lock(net_ringMutex);
+	net_ringHead = recv_head;
+	Mutex_Unlock(net_ringMutex);
+}
+
+/* Returns pointer to contiguous space for an entry in the ring, waiting until there is enough space */
+static cc_uint8* NetRecv_Reserve(int size) {
+	int tail;
+	size += NET_ENTRY_HEADER;
+
+	while (!net_recvQuit) {
+		Mutex_Lock(net_ringMutex);
+		tail = net_ringTail;
+		Mutex_Unlock(net_ringMutex);
+
+		/* NOTE: Head must never catch up to tail, as head == tail means the ring is empty */
+		if (recv_head < tail) {
+			if (recv_head + size < tail) return net_ring + recv_head;
+		} else {
+			/* Always leave room at end for a wrap marker */
+			if (recv_head + size + NET_ENTRY_HEADER <= NET_RING_SIZE) return net_ring + recv_head;
+
+			if (size < tail) {
+				net_ring[recv_head + 2] = NET_ENTRY_WRAP;
+				recv_head = 0;
+				return net_ring;
+			}
+		}
+
+		/* Ring is full, so wait for main thread to handle some packets */
+		NetRecv_Publish();
+		Waitable_WaitFor(net_spaceWaitable, 100);
+	}
+	return NULL;
+}
+
+static cc_bool Net_Dispatch(int kind, cc_uint8* data, int size) {
+	cc_uint8* entry;
+	if (kind == NET_ENTRY_PACKET) Protocol_Preprocess(data);
+
+	entry = NetRecv_Reserve(size);
+	if (!entry) return false;
+
+	Stream_SetU16_BE(entry, size);
+	entry[2] = kind;
+	Mem_Copy(entry + NET_ENTRY_HEADER, data, size);
+	recv_head = (int)(entry - net_ring) + NET_ENTRY_HEADER + size;
+
+	/* Map data is still needed by main thread after this, so wait until it is done with it */
+	if (kind == NET_ENTRY_PACKET && data[0] == OPCODE_LEVEL_END) {
+		NetRecv_Publish();
+		Waitable_Wait(net_syncWaitable);
+	}
+	return !net_recvQuit;
+}
+
+static void NetRecv_ThreadFunc(void) {
+	cc_uint32 read = 0;
+	cc_result res;
+
+	for (;;) {
+		/* NOTE: Always using a read call that is a multiple of 4096 (appears to?) improve read performance */	
+		res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &read);
+		if (res || !read || net_recvQuit) break;
+
+		if (!Net_FramePackets(net_readCurrent + read)) break;
+		NetRecv_Publish();
+	}
+
+	Mutex_Lock(net_ringMutex);
+	net_ringHead   = recv_head;
+	net_recvResult = net_recvQuit ? 0 : res;
+	net_recvDone   = true;
+	Mutex_Unlock(net_ringMutex);
+}
+
+static void NetRecv_Start(void) {
+	net_ringHead = 0; net_ringTail = 0; recv_head = 0;
+	net_recvDone = false; net_recvResult = 0; net_recvQuit = false;
+
+	net_ringMutex     = Mutex_Create();
+	net_spaceWaitable = Waitable_Create();
+	net_syncWaitable  = Waitable_Create();
+	net_recvThread    = Thread_Start(NetRecv_ThreadFunc, false);
+}
+
+static void NetRecv_Stop(void) {
+	net_recvQuit = true;
+	/* Closing the socket also wakes up the network thread if it is blocked reading */
+	Socket_Close(net_socket);
+	if (!net_recvThread) return;
+
+	Waitable_Signal(net_spaceWaitable);
+	Waitable_Signal(net_syncWaitable);
+	Thread_Join(net_recvThread);
+	net_recvThread = NULL;
+
+	Mutex_Free(net_ringMutex);
+	Waitable_Free(net_spaceWaitable);
+	Waitable_Free(net_syncWaitable);
+}
+
+/* Handles all the packets the network thread has queued so far, returning false if disconnected */
+static cc_bool MPConnection_ReadPackets(void) {
+	int head, tail, size, kind;
+	cc_uint8* entry;
+	cc_bool done;
+	cc_result res;
+
+	Mutex_Lock(net_ringMutex);
+	head = net_ringHead;
+	done = net_recvDone;
+	res  = net_recvResult;
+	Mutex_Unlock(net_ringMutex);
+
+	for (tail = net_ringTail; tail != head; ) {
+		entry = net_ring + tail;
+		size  = Stream_GetU16_BE(entry);
+		kind  = entry[2];
+		if (kind == NET_ENTRY_WRAP) { tail = 0; continue; }
+
+		tail += NET_ENTRY_HEADER + size;
+		entry += NET_ENTRY_HEADER;
+		if (!MPConnection_HandleEntry(kind, entry)) return false;
+		if (kind == NET_ENTRY_PACKET && entry[0] == OPCODE_LEVEL_END) Waitable_Signal(net_syncWaitable);
+	}
+
+	if (tail != net_ringTail) {
+		Mutex_Lock(net_ringMutex);
+		net_ringTail = tail;
+		Mutex_Unlock(net_ringMutex);
+		Waitable_Signal(net_spaceWaitable);
+	}
+	if (!done) return true;
+
+	/* Network thread stopped after a read error, or because the server closed the connection */
+	if (res) { MPConnection_ReadFailed(res); return false; }
+	MPConnection_CheckDisconnection();
+	return !Server.Disconnected;
+}
+#endif
+
 static void Server_Free(void);
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
@@ -253,6 +547,7 @@ static void MPConnection_FinishConnect(void) {
 
 	Classic_SendLogin();
 	net_lastPacket = Game.Time;
+	NetRecv_Start();
 }
 
 static void MPConnection_FailConnect(cc_result result) {
@@ -344,105 +639,14 @@ static void MPConnection_SendPosition(Vec3 pos, float yaw, float pitch) {
 	Net_SendPacket();
 }
 
-static void MPConnection_CheckDisconnection(void) {
-	static const String title  = String_FromConst("Disconnected!");
-	static const String reason = String_FromConst("You've lost connection to the server");
-	cc_result availRes, selectRes;
-	cc_uint32 pending = 0;
-	cc_bool poll_read;
-
-	availRes  = Socket_Available(net_socket, &pending);
-	/* poll read returns true when socket is closed */
-	selectRes = Socket_Poll(net_socket, SOCKET_POLL_READ, &poll_read);
-
-	if (net_writeFailed || availRes || selectRes || (pending == 0 && poll_read)) {	
-		Game_Disconnect(&title, &reason);
-	}
-}
-
-static void DisconnectInvalidOpcode(cc_uint8 opcode) {
-	static const String title = String_FromConst("Disconnected");
-	String tmp; char tmpBuffer[STRING_SIZE];
-	String_InitArray(tmp, tmpBuffer);
-
-	String_Format2(&tmp, "Server sent invalid packet %b! (prev %b)", &opcode, &net_lastOpcode);
-	Game_Disconnect(&title, &tmp); return;
-}
-
 static void MPConnection_Tick(struct ScheduledTask* task) {
-	static const String title_lost  = String_FromConst("&eLost connection to the server");
-	static const String reason_err  = String_FromConst("I/O error when reading packets");
-	String msg; char msgBuffer[STRING_SIZE * 2];
-
-	struct LocalPlayer* p;
-	cc_uint32 pending;
-	cc_uint8* readEnd;
-	Net_Handler handler;
-	int i, remaining;
-	cc_result res;
-
 	if (Server.Disconnected) return;
 	if (net_connecting) { MPConnection_TickConnect(); return; }
 
 	/* Over 30 seconds since last packet, connection likely dropped */
 	if (net_lastPacket + 30 < Game.Time) MPConnection_CheckDisconnection();
 	if (Server.Disconnected) return;
-
-	pending = 0;
-	res     = Socket_Available(net_socket, &pending);
-	readEnd = net_readCurrent;
-
-	if (!res && pending) {
-		/* NOTE: Always using a read call that is a multiple of 4096 (appears to?) improve read performance */	
-		res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &pending);
-		readEnd += pending;
-	}
-
-	if (res) {
-		String_InitArray(msg, msgBuffer);
-		String_Format3(&msg, "Error reading from %s:%i: %i" _NL, &Server.IP, &Server.Port, &res);
-
-		Logger_Log(&msg);
-		Game_Disconnect(&title_lost, &reason_err);
-		return;
-	}
-
-	net_readCurrent = net_readBuffer;
-	while (net_readCurrent < readEnd) {
-		cc_uint8 opcode = net_readCurrent[0];
-
-		/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
-		if (cpe_needD3Fix && net_lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
-			Platform_LogConst("Skipping invalid HackControl byte from D3 server");
-			net_readCurrent++;
-
-			p = &LocalPlayer_Instance;
-			p->Physics.JumpVel = 0.42f; /* assume default jump height */
-			p->Physics.ServerJumpVel = p->Physics.JumpVel;
-			continue;
-		}
-
-		if (opcode >= OPCODE_COUNT) { DisconnectInvalidOpcode(opcode); return; }
-
-		if (net_readCurrent + Net_PacketSizes[opcode] > readEnd) break;
-		net_lastOpcode = opcode;
-		net_lastPacket = Game.Time;
-
-		handler = Net_Handlers[opcode];
-		if (!handler) { DisconnectInvalidOpcode(opcode); return; }
-
-		handler(net_readCurrent + 1);  /* skip opcode */
-		net_readCurrent += Net_PacketSizes[opcode];
-	}
-
-	/* Protocol packets might be split up across TCP packets */
-	/* If so, copy last few unprocessed bytes back to beginning of buffer */
-	/* These bytes are then later combined with subsequently read TCP packet data */
-	remaining = (int)(readEnd - net_readCurrent);
-	for (i = 0; i < remaining; i++) {
-		net_readBuffer[i] = net_readCurrent[i];
-	}
-	net_readCurrent = net_readBuffer + remaining;
+	if (!MPConnection_ReadPackets()) return;
 
 	/* Network is ticked 60 times a second. We only send position updates 20 times a second */
 	if ((ticks % 3) == 0) {
@@ -528,7 +732,7 @@ static void Server_Free(void) {
 		Physics_Free();
 	} else {
 		if (Server.Disconnected) return;
-		Socket_Close(net_socket);
+		NetRecv_Stop();
 		Server.Disconnected = true;
 	}
 }
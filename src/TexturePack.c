@@ -12,6 +12,8 @@
 #include "ExtMath.h"
 #include "Options.h"
 #include "Logger.h"
+#include "Errors.h"
+#include "Builder.h"
 #include "Chat.h" /* TODO avoid this include */
 
 /*########################################################################################################################*
@@ -57,12 +59,18 @@ static void Atlas_Convert2DTo1D(void) {
 	Mem_Free(atlas1D.scan0);
 }
 
+int Atlas1D_MaxTilesPerAtlas(void) {
+	int maxAtlasHeight = min(4096, Gfx.MaxTexHeight);
+	return maxAtlasHeight / Atlas2D.TileSize;
+}
+
 static void Atlas_Update1D(void) {
-	int maxAtlasHeight, maxTilesPerAtlas, maxTiles;
+	int maxTilesPerAtlas, maxTiles;
 
-	maxAtlasHeight   = min(4096, Gfx.MaxTexHeight);
-	maxTilesPerAtlas = maxAtlasHeight / Atlas2D.TileSize;
+	maxTilesPerAtlas = Atlas1D_MaxTilesPerAtlas();
 	maxTiles         = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+	/* Greedy meshing repeats textures along both axes of a face, which only works with one tile per atlas */
+	if (Builder_GreedyMeshing) maxTilesPerAtlas = 1;
 
 	Atlas1D.TilesPerAtlas = min(maxTilesPerAtlas, maxTiles);
 	Atlas1D.Count = Math_CeilDiv(maxTiles, Atlas1D.TilesPerAtlas);
@@ -150,11 +158,12 @@ cc_bool Atlas_TryChange(Bitmap* atlas) {
 /*########################################################################################################################*
 *------------------------------------------------------TextureCache-------------------------------------------------------*
 *#########################################################################################################################*/
-static struct StringsBuffer acceptedList, deniedList, etagCache, lastModCache;
+static struct StringsBuffer acceptedList, deniedList, etagCache, lastModCache, unpackedList;
 #define ACCEPTED_TXT "texturecache/acceptedurls.txt"
 #define DENIED_TXT   "texturecache/deniedurls.txt"
 #define ETAGS_TXT    "texturecache/etags.txt"
 #define LASTMOD_TXT  "texturecache/lastmodified.txt"
+#define UNPACKED_TXT "texturecache/unpacked.txt"
 
 /* Initialises cache state (loading various lists) */
 static void TextureCache_Init(void) {
@@ -162,6 +171,7 @@ static void TextureCache_Init(void) {
 	EntryList_UNSAFE_Load(&deniedList,   DENIED_TXT);
 	EntryList_UNSAFE_Load(&etagCache,    ETAGS_TXT);
 	EntryList_UNSAFE_Load(&lastModCache, LASTMOD_TXT);
+	EntryList_UNSAFE_Load(&unpackedList, UNPACKED_TXT);
 }
 
 cc_bool TextureCache_HasAccepted(const String* url) { return EntryList_Find(&acceptedList, url, ' ') >= 0; }
@@ -272,6 +282,256 @@ static void UpdateCache(struct HttpRequest* req) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------PackCache---------------------------------------------------------*
+*#########################################################################################################################*/
+/* Files extracted from a .zip texture pack are cached uncompressed, with all .png images already decoded */
+/* (.png images are decoded by TexturePack_PrepareZipEntry while the .zip is extracted) */
+/* Later loads of the same pack then just read each file/bitmap straight into memory, skipping all inflating and decoding */
+#define PACKCACHE_VERSION 1
+#define PACKCACHE_HEADER_SIZE 16
+#define PACKCACHE_ENTRY_SIZE 6
+/* The end of a .zip has the central directory, which stores the CRC32 of every file */
+#define PACKCACHE_TAIL_SIZE (64 * 1024)
+/* Decoded bitmaps are much larger than the .png images, so least recently used caches are */
+/*  deleted once all the caches listed in unpacked.txt use up more than this many bytes */
+#define PACKCACHE_MAX_SIZE (256 * 1024 * 1024)
+enum PACKCACHE_TYPE { PACKCACHE_TYPE_DATA, PACKCACHE_TYPE_BITMAP };
+
+struct PackCache {
+	struct Stream file;
+	const String* src;
+	cc_uint32 length, signature;
+	cc_bool valid, writing, failed;
+};
+
+CC_NOINLINE static void PackCache_MakePath(String* path, const String* src, const char* ext) {
+	String key; char keyBuffer[STRING_INT_CHARS];
+	String_InitArray(key, keyBuffer);
+
+	HashUrl(&key, src);
+	String_Format2(path, "texturecache/%s%c", &key, ext);
+}
+
+/* Signature of a .zip is CRC32 of its last bytes, which changes whenever any file in it does */
+static cc_result PackCache_CalcSignature(struct PackCache* cache, struct Stream* pack) {
+	cc_uint8* data;
+	cc_uint32 size;
+	cc_result res;
+
+	if ((res = pack->Length(pack, &cache->length))) return res;
+	size = min(cache->length, PACKCACHE_TAIL_SIZE);
+	if (!size) return ZIP_ERR_NO_END_OF_CENTRAL_DIR;
+
+	data = (cc_uint8*)Mem_TryAlloc(size, 1);
+	if (!data) return ERR_OUT_OF_MEMORY;
+
+	if (!(res = pack->Seek(pack, cache->length - size)) && !(res = Stream_Read(pack, data, size))) {
+		cache->signature = Utils_CRC32(data, size);
+	}
+	Mem_Free(data);
+	return res;
+}
+
+static void PackCache_MakeHeader(struct PackCache* cache, cc_uint8* header) {
+	header[0] = 'C'; header[1] = 'C'; header[2] = 'T'; header[3] = 'P';
+	Stream_SetU32_LE(header + 4,  PACKCACHE_VERSION);
+	Stream_SetU32_LE(header + 8,  cache->length);
+	Stream_SetU32_LE(header + 12, cache->signature);
+}
+
+static cc_bool PackCache_IsUpToDate(struct PackCache* cache, const cc_uint8* header) {
+	cc_uint8 expected[PACKCACHE_HEADER_SIZE];
+	int i;
+	PackCache_MakeHeader(cache, expected);
+
+	for (i = 0; i < PACKCACHE_HEADER_SIZE; i++) {
+		if (header[i] != expected[i]) return false;
+	}
+	return true;
+}
+
+/* Moves the given cache to the end of unpacked.txt, then deletes least recently used caches if over PACKCACHE_MAX_SIZE */
+static void PackCache_MarkUsed(struct PackCache* cache, cc_uint32 size) {
+	String path;  char pathBuffer[FILENAME_SIZE];
+	String key;   char keyBuffer[STRING_INT_CHARS];
+	String value; char valueBuffer[STRING_INT_CHARS];
+	String entry, curKey, curValue;
+	cc_uint64 total = 0, curSize;
+	int i;
+
+	String_InitArray(key, keyBuffer);
+	HashUrl(&key, cache->src);
+	String_InitArray(value, valueBuffer);
+	String_AppendUInt32(&value, size);
+	EntryList_Set(&unpackedList, &key, &value, ' ');
+
+	for (i = 0; i < unpackedList.count; i++) {
+		entry = StringsBuffer_UNSAFE_Get(&unpackedList, i);
+		String_UNSAFE_Separate(&entry, ' ', &curKey, &curValue);
+		if (Convert_ParseUInt64(&curValue, &curSize)) total += curSize;
+	}
+
+	/* The cache that was just used is always the last entry, so is never deleted */
+	while (total > PACKCACHE_MAX_SIZE && unpackedList.count > 1) {
+		entry = StringsBuffer_UNSAFE_Get(&unpackedList, 0);
+		String_UNSAFE_Separate(&entry, ' ', &curKey, &curValue);
+		if (Convert_ParseUInt64(&curValue, &curSize)) total -= curSize;
+
+		String_InitArray(path, pathBuffer);
+		String_Format1(&path, "texturecache/%s.unpacked", &curKey);
+		File_Delete(&path);
+		StringsBuffer_Remove(&unpackedList, 0);
+	}
+	EntryList_Save(&unpackedList, UNPACKED_TXT);
+}
+
+static cc_result PackCache_ExtractEntries(struct Stream* file) {
+	cc_uint8 header[PACKCACHE_ENTRY_SIZE];
+	String name; char nameBuffer[256];
+	struct Stream portion, mem;
+	cc_uint32 offset, length, size;
+	cc_uint8* data;
+	cc_result res;
+
+	if ((res = file->Length(file, &length))) return res;
+	offset = PACKCACHE_HEADER_SIZE;
+
+	while (offset < length) {
+		if ((res = Stream_Read(file, header, PACKCACHE_ENTRY_SIZE))) return res;
+		size = Stream_GetU32_LE(header);
+		name = String_Init(nameBuffer, header[5], header[5]);
+		if ((res = Stream_Read(file, (cc_uint8*)nameBuffer, name.length))) return res;
+		offset += PACKCACHE_ENTRY_SIZE + name.length + size;
+		/* Handlers don't report when bitmap data is cut off, so a truncated cache has to be detected here */
+		if (offset > length) return ERR_END_OF_STREAM;
+
+		if (header[4] == PACKCACHE_TYPE_BITMAP) {
+			/* Png_Decode reads the pixels directly into the bitmap */
+			Stream_ReadonlyPortion(&portion, file, size);
+			Event_RaiseEntry(&TextureEvents.FileChanged, &portion, &name);
+		} else {
+			data = (cc_uint8*)Mem_TryAlloc(size, 1);
+			if (!data) return ERR_OUT_OF_MEMORY;
+
+			if ((res = Stream_Read(file, data, size))) { Mem_Free(data); return res; }
+			Stream_ReadonlyMemory(&mem, data, size);
+			Event_RaiseEntry(&TextureEvents.FileChanged, &mem, &name);
+			Mem_Free(data);
+		}
+		if ((res = file->Seek(file, offset))) return res;
+	}
+	return 0;
+}
+
+/* Attempts to extract the files of the given .zip texture pack from its cache */
+/* Returns false if there is no up to date cache for the texture pack */
+static cc_bool PackCache_TryExtract(struct PackCache* cache, struct Stream* pack, const String* src) {
+	String path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8 header[PACKCACHE_HEADER_SIZE];
+	struct Stream file;
+	cc_uint32 size;
+	cc_result res;
+
+	cache->src     = src;
+	cache->writing = false;
+	cache->failed  = false;
+	/* Files are stored in IndexedDB on web, so caching would just use up storage space */
+#ifdef CC_BUILD_WEB
+	cache->valid   = false;
+#else
+	cache->valid   = !PackCache_CalcSignature(cache, pack);
+#endif
+	if (!cache->valid) return false;
+	String_InitArray(path, pathBuffer);
+	PackCache_MakePath(&path, src, ".unpacked");
+
+	res = Stream_OpenFile(&file, &path);
+	if (res == ReturnCode_FileNotFound) return false;
+	if (res) { Logger_Warn2(res, "opening cache for", src); return false; }
+
+	res = Stream_Read(&file, header, PACKCACHE_HEADER_SIZE);
+	if (res || !PackCache_IsUpToDate(cache, header)) {
+		/* Out of date, so will be replaced by a new cache */
+		file.Close(&file); return false;
+	}
+
+	Event_RaiseVoid(&TextureEvents.PackChanged);
+	if (!Gfx.LostContext && (res = PackCache_ExtractEntries(&file))) {
+		Logger_Warn2(res, "extracting cache for", src);
+		/* Cache is probably corrupted, so delete it and extract the .zip instead */
+		file.Close(&file);
+		File_Delete(&path);
+		return false;
+	}
+
+	res = file.Length(&file, &size);
+	if (!res) PackCache_MarkUsed(cache, size);
+	res = file.Close(&file);
+	if (res) Logger_Warn2(res, "closing cache for", src);
+	return true;
+}
+
+/* Begins writing a new cache, as the files of the given .zip texture pack are extracted */
+static void PackCache_Begin(struct PackCache* cache) {
+	String path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8 header[PACKCACHE_HEADER_SIZE];
+	cc_result res;
+	if (!cache->valid) return;
+
+	String_InitArray(path, pathBuffer);
+	PackCache_MakePath(&path, cache->src, ".tmp");
+	res = Stream_CreateFile(&cache->file, &path);
+	if (res) { Logger_Warn2(res, "creating cache for", cache->src); return; }
+
+	PackCache_MakeHeader(cache, header);
+	cache->writing = true;
+	res = Stream_Write(&cache->file, header, PACKCACHE_HEADER_SIZE);
+	if (res) { Logger_Warn2(res, "writing cache for", cache->src); cache->failed = true; }
+}
+
+static void PackCache_WriteEntry(struct PackCache* cache, const String* name, cc_uint8* data, cc_uint32 size) {
+	cc_uint8 header[PACKCACHE_ENTRY_SIZE];
+	cc_result res;
+	/* Empty entries are usually just directories */
+	if (!cache->writing || cache->failed || !size || name->length > 255) return;
+
+	Stream_SetU32_LE(header, size);
+	header[4] = Bitmap_DetectRaw(data, size) ? PACKCACHE_TYPE_BITMAP : PACKCACHE_TYPE_DATA;
+	header[5] = name->length;
+
+	if ((res = Stream_Write(&cache->file, header, PACKCACHE_ENTRY_SIZE))         ||
+		(res = Stream_Write(&cache->file, (cc_uint8*)name->buffer, name->length)) ||
+		(res = Stream_Write(&cache->file, data, size))) {
+		Logger_Warn2(res, "writing cache for", cache->src);
+		cache->failed = true;
+	}
+}
+
+/* Finishes writing the cache, only replacing the existing cache if the whole texture pack was extracted */
+static void PackCache_End(struct PackCache* cache, cc_result extractRes) {
+	String path; char pathBuffer[FILENAME_SIZE];
+	String dst;  char dstBuffer[FILENAME_SIZE];
+	cc_uint32 size = 0;
+	cc_result res;
+	if (!cache->writing) return;
+
+	cache->file.Position(&cache->file, &size);
+	res = cache->file.Close(&cache->file);
+	if (res) { Logger_Warn2(res, "closing cache for", cache->src); return; }
+	if (extractRes || cache->failed) return;
+
+	String_InitArray(path, pathBuffer);
+	PackCache_MakePath(&path, cache->src, ".tmp");
+	String_InitArray(dst, dstBuffer);
+	PackCache_MakePath(&dst, cache->src, ".unpacked");
+
+	res = File_Rename(&path, &dst);
+	if (res) { Logger_Warn2(res, "saving cache for", cache->src); return; }
+	PackCache_MarkUsed(cache, size);
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------TexturePack-------------------------------------------------------*
 *#########################################################################################################################*/
@@ -294,22 +554,62 @@ void TexturePack_SetDefault(const String* texPack) {
 	Options_Set(OPT_DEFAULT_TEX_PACK, texPack);
 }
 
+/* Decodes .png files on the zip worker threads, so handlers can then just quickly copy the decoded pixels */
+static cc_result TexturePack_PrepareZipEntry(const String* path, cc_uint8** data, cc_uint32* size, struct ZipState* s) {
+	struct Stream mem;
+	cc_uint8* raw;
+	Bitmap bmp;
+	cc_uint32 bmpSize;
+
+	if (!Png_Detect(*data, *size)) return 0;
+	Stream_ReadonlyMemory(&mem, *data, *size);
+	/* If decoding fails, handlers will report the error when decoding the original data */
+	if (Png_Decode(&bmp, &mem)) { Mem_Free(bmp.scan0); return 0; }
+
+	bmpSize = Bitmap_DataSize(bmp.width, bmp.height);
+	raw     = (cc_uint8*)Mem_TryAlloc(BITMAP_RAW_HEADER_SIZE + bmpSize, 1);
+
+	if (raw) {
+		Bitmap_MakeRawHeader(&bmp, raw);
+		Mem_Copy(raw + BITMAP_RAW_HEADER_SIZE, bmp.scan0, bmpSize);
+		Mem_Free(*data);
+		*data = raw;
+		*size = BITMAP_RAW_HEADER_SIZE + bmpSize;
+	}
+	Mem_Free(bmp.scan0);
+	return 0;
+}
+
 static cc_result TexturePack_ProcessZipEntry(const String* path, struct Stream* stream, struct ZipState* s) {
 	String name = *path; 
 	Utils_UNSAFE_GetFilename(&name);
+
+	/* Zip_ExtractParallel always provides the data in memory */
+	PackCache_WriteEntry((struct PackCache*)s->obj, &name, stream->Meta.Mem.Base, stream->Meta.Mem.Length);
 	Event_RaiseEntry(&TextureEvents.FileChanged, stream, &name);
 	return 0;
 }
 
 /* Extracts all the files from a stream representing a .zip archive */
-static cc_result TexturePack_ExtractZip(struct Stream* stream) {
+/* src is the URL or path the archive came from, and is used to cache the extracted files */
+static cc_result TexturePack_ExtractZip(struct Stream* stream, const String* src) {
+	struct PackCache cache;
 	struct ZipState state;
+	cc_result res;
+	if (PackCache_TryExtract(&cache, stream, src)) return 0;
+
 	Event_RaiseVoid(&TextureEvents.PackChanged);
 	if (Gfx.LostContext) return 0;
+	PackCache_Begin(&cache);
 	
 	Zip_Init(&state, stream);
+	state.PrepareEntry = TexturePack_PrepareZipEntry;
 	state.ProcessEntry = TexturePack_ProcessZipEntry;
-	return Zip_Extract(&state);
+	state.obj          = &cache;
+
+	res = Zip_ExtractParallel(&state);
+	PackCache_End(&cache, res);
+	return res;
 }
 
 /* Changes the current terrain atlas from a stream representing a .png image */
@@ -348,7 +648,7 @@ static void TexturePack_ExtractZip_File(const String* filename) {
 	res = Stream_OpenFile(&stream, &path);
 	if (res) { Logger_Warn2(res, "opening", &path); return; }
 
-	res = TexturePack_ExtractZip(&stream);
+	res = TexturePack_ExtractZip(&stream, &path);
 	if (res) { Logger_Warn2(res, "extracting", &path); }
 
 	res = stream.Close(&stream);
@@ -387,7 +687,7 @@ void TexturePack_ExtractCurrent(cc_bool forceReload) {
 		texturePackDefault = true;
 	} else {
 		zip = String_ContainsConst(&url, ".zip");
-		res = zip ? TexturePack_ExtractZip(&stream) : TexturePack_ExtractPng(&stream);
+		res = zip ? TexturePack_ExtractZip(&stream, &url) : TexturePack_ExtractPng(&stream);
 		if (res) Logger_Warn2(res, zip ? "extracting" : "decoding", &url);
 
 		res = stream.Close(&stream);
@@ -413,7 +713,7 @@ void TexturePack_Apply(struct HttpRequest* item) {
 	Stream_ReadonlyMemory(&mem, data, len);
 
 	png = Png_Detect(data, len);
-	res = png ? TexturePack_ExtractPng(&mem) : TexturePack_ExtractZip(&mem);
+	res = png ? TexturePack_ExtractPng(&mem) : TexturePack_ExtractZip(&mem, &url);
 
 	if (res) Logger_Warn2(res, png ? "decoding" : "extracting", &url);
 	texturePackDefault = false;
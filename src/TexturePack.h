@@ -66,6 +66,9 @@ cc_bool Atlas_TryChange(Bitmap* bmp);
 /* That is, returns U1/U2/V1/V2 coords that make up the tile in a 1D atlas. */
 /* index is set to the index of the 1D atlas that the tile is in. */
 TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index);
+/* Returns the max number of tiles that fit in one 1D atlas. */
+/* NOTE: Atlas1D.TilesPerAtlas is instead 1 when greedy meshing is enabled. */
+int Atlas1D_MaxTilesPerAtlas(void);
 
 /* Whether the given URL is in list of accepted URLs. */
 cc_bool TextureCache_HasAccepted(const String* url);
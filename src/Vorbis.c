@@ -6,6 +6,11 @@
 #include "Funcs.h"
 #include "Errors.h"
 #include "Stream.h"
+#if defined CC_BUILD_SSE2
+#include <emmintrin.h>
+#elif defined CC_BUILD_NEON
+#include <arm_neon.h>
+#endif
 
 /*########################################################################################################################*
 *-------------------------------------------------------Ogg stream--------------------------------------------------------*
@@ -212,11 +217,16 @@ static float float32_unpack(struct VorbisState* ctx) {
 *----------------------------------------------------Vorbis codebooks-----------------------------------------------------*
 *#########################################################################################################################*/
 #define CODEBOOK_SYNC 0x564342
+/* Codewords up to this many bits long are decoded using a single table lookup */
+#define CODEBOOK_FAST_BITS 10
+#define CODEBOOK_FAST_MASK ((1 << CODEBOOK_FAST_BITS) - 1)
 struct Codebook {
 	cc_uint32 Dimensions, Entries, TotalCodewords;
 	cc_uint32* Codewords;
 	cc_uint32* Values;
 	cc_uint32 NumCodewords[33]; /* number of codewords of bit length i */
+	/* (value << 5) | length for codewords starting with the next CODEBOOK_FAST_BITS bits, 0 if none */
+	cc_uint32* Fast;
 	/* vector quantisation values */
 	float MinValue, DeltaValue;
 	cc_uint32 SequenceP, LookupType, LookupValues;
@@ -227,6 +237,7 @@ static void Codebook_Free(struct Codebook* c) {
 	Mem_Free(c->Codewords);
 	Mem_Free(c->Values);
 	Mem_Free(c->Multiplicands);
+	Mem_Free(c->Fast);
 }
 
 static cc_uint32 Codebook_Pow(cc_uint32 base, cc_uint32 exp) {
@@ -314,6 +325,31 @@ static cc_bool Codebook_CalcCodewords(struct Codebook* c, cc_uint8* len) {
 	return true;
 }
 
+static cc_uint32 Codebook_Reverse(cc_uint32 n) {
+	n = ((n & 0xAAAAAAAAUL) >> 1) | ((n & 0x55555555UL) << 1);
+	n = ((n & 0xCCCCCCCCUL) >> 2) | ((n & 0x33333333UL) << 2);
+	n = ((n & 0xF0F0F0F0UL) >> 4) | ((n & 0x0F0F0F0FUL) << 4);
+	n = ((n & 0xFF00FF00UL) >> 8) | ((n & 0x00FF00FFUL) << 8);
+	return (n >> 16) | (n << 16);
+}
+
+static void Codebook_CalcFast(struct Codebook* c) {
+	cc_uint32 i, j, len, offset = 0, code;
+	c->Fast = (cc_uint32*)Mem_AllocCleared(1 << CODEBOOK_FAST_BITS, 4, "codebook fast");
+
+	for (len = 1; len <= CODEBOOK_FAST_BITS; len++) {
+		for (i = 0; i < c->NumCodewords[len]; i++, offset++) {
+			/* Codewords are stored first bit in MSB, but bits are read from the stream LSB first */
+			code = Codebook_Reverse(c->Codewords[offset]);
+
+			/* Fill every entry whose lowest [len] bits are the codeword */
+			for (j = code; j <= CODEBOOK_FAST_MASK; j += 1U << len) {
+				c->Fast[j] = (c->Values[offset] << 5) | len;
+			}
+		}
+	}
+}
+
 static cc_result Codebook_DecodeSetup(struct VorbisState* ctx, struct Codebook* c) {
 	cc_uint32 sync;
 	cc_uint8* codewordLens;
@@ -365,6 +401,7 @@ static cc_result Codebook_DecodeSetup(struct VorbisState* ctx, struct Codebook*
 
 	c->TotalCodewords = entry;
 	Codebook_CalcCodewords(c, codewordLens);
+	Codebook_CalcFast(c);
 	Mem_Free(codewordLens);
 
 	c->LookupType    = Vorbis_ReadBits(ctx, 4);
@@ -391,12 +428,12 @@ static cc_result Codebook_DecodeSetup(struct VorbisState* ctx, struct Codebook*
 	return 0;
 }
 
-static cc_uint32 Codebook_DecodeScalar(struct VorbisState* ctx, struct Codebook* c) {
+/* Decodes a codeword longer than CODEBOOK_FAST_BITS, by reading it bit by bit */
+static cc_uint32 Codebook_DecodeSlow(struct VorbisState* ctx, struct Codebook* c) {
 	cc_uint32 codeword = 0, shift = 31, depth, i;
 	cc_uint32* codewords = c->Codewords;
 	cc_uint32* values    = c->Values;
 
-	/* TODO: This is so massively slow */
 	for (depth = 1; depth <= 32; depth++, shift--) {
 		codeword |= Vorbis_ReadBit(ctx) << shift;
 
@@ -412,6 +449,24 @@ static cc_uint32 Codebook_DecodeScalar(struct VorbisState* ctx, struct Codebook*
 	return -1;
 }
 
+static cc_uint32 Codebook_DecodeScalar(struct VorbisState* ctx, struct Codebook* c) {
+	cc_uint32 entry, len;
+	cc_uint8 portion;
+
+	/* Stream may end before CODEBOOK_FAST_BITS bits, so only read what is possible */
+	while (ctx->NumBits < CODEBOOK_FAST_BITS) {
+		if (Ogg_ReadU8(ctx->source, &portion)) break;
+		Vorbis_PushByte(ctx, portion);
+	}
+
+	entry = c->Fast[Vorbis_PeekBits(ctx, CODEBOOK_FAST_BITS)];
+	len   = entry & 0x1F;
+	if (!entry || len > ctx->NumBits) return Codebook_DecodeSlow(ctx, c);
+
+	Vorbis_ConsumeBits(ctx, len);
+	return entry >> 5;
+}
+
 static void Codebook_DecodeVectors(struct VorbisState* ctx, struct Codebook* c, float* v, int step) {
 	cc_uint32 lookupOffset = Codebook_DecodeScalar(ctx, c);
 	float last = 0.0f, value;
@@ -997,7 +1052,8 @@ static cc_uint32 Vorbis_ReverseBits(cc_uint32 v) {
 
 void imdct_init(struct imdct_state* state, int n) {
 	int k, k2, n4 = n >> 2, n8 = n >> 3, log2_n;
-	float *A = state->a, *B = state->b, *C = state->c;
+	float *A = state->a, *B = state->b, *C = state->c, *T = state->t;
+	int l, r, k1, rMax;
 	cc_uint32* reversed;
 
 	log2_n   = Math_Log2(n);
@@ -1019,20 +1075,76 @@ void imdct_init(struct imdct_state* state, int n) {
 	for (k = 0; k < n8; k++) {
 		reversed[k] = Vorbis_ReverseBits(k) >> (32-log2_n+3);
 	}
+
+	/* step 3 twiddles for each stage: (real, real) pairs, then (-imag, imag) pairs */
+	for (l = 0; l <= log2_n - 4; l++) {
+		k1 = 1 << (l+3); rMax = n >> (l+4);
+
+		for (r = 0; r < rMax; r++) {
+			T[r*2]          =  A[r*k1];   T[r*2+1]          = A[r*k1];
+			T[rMax*2 + r*2] = -A[r*k1+1]; T[rMax*2 + r*2+1] = A[r*k1+1];
+		}
+		T += rMax * 4;
+	}
+}
+
+/* Performs one stage of the step 3 butterflies on 'count' complex values */
+/* NOTE: Values are (real, imag) pairs, so arrays are actually count * 2 floats long */
+static void imdct_step3(const float* e, const float* f, float* u_e, float* u_f, const float* T, int count) {
+	const float* TR = T;
+	const float* TI = T + count * 2;
+	float d_1, d_2;
+	int i = 0;
+
+#if defined CC_BUILD_SSE2
+	__m128 ev, fv, dv;
+	for (; i + 2 <= count; i += 2) {
+		ev = _mm_loadu_ps(e + i*2); fv = _mm_loadu_ps(f + i*2);
+		dv = _mm_sub_ps(ev, fv);
+
+		_mm_storeu_ps(u_e + i*2, _mm_add_ps(ev, fv));
+		_mm_storeu_ps(u_f + i*2, _mm_add_ps(_mm_mul_ps(dv, _mm_loadu_ps(TR + i*2)),
+			_mm_mul_ps(_mm_shuffle_ps(dv, dv, _MM_SHUFFLE(2,3,0,1)), _mm_loadu_ps(TI + i*2))));
+	}
+#elif defined CC_BUILD_NEON
+	float32x4_t ev, fv, dv;
+	for (; i + 2 <= count; i += 2) {
+		ev = vld1q_f32(e + i*2); fv = vld1q_f32(f + i*2);
+		dv = vsubq_f32(ev, fv);
+
+		vst1q_f32(u_e + i*2, vaddq_f32(ev, fv));
+		vst1q_f32(u_f + i*2, vaddq_f32(vmulq_f32(dv, vld1q_f32(TR + i*2)),
+			vmulq_f32(vrev64q_f32(dv), vld1q_f32(TI + i*2))));
+	}
+#endif
+
+	for (; i < count; i++) {
+		d_1 = e[i*2]   - f[i*2];
+		d_2 = e[i*2+1] - f[i*2+1];
+		u_e[i*2]   = e[i*2]   + f[i*2];
+		u_e[i*2+1] = e[i*2+1] + f[i*2+1];
+
+		u_f[i*2]   = d_1 * TR[i*2] + d_2 * TI[i*2];
+		u_f[i*2+1] = d_2 * TR[i*2] + d_1 * TI[i*2+1];
+	}
 }
 
 void imdct_calc(float* in, float* out, struct imdct_state* state) {
-	int k, k2, k4, k8, n = state->n;
+	int k, k2, k4, n = state->n;
 	int n2 = n >> 1, n4 = n >> 2, n8 = n >> 3, n3_4 = n - n4;
 	int l, log2_n;
 	cc_uint32* reversed;
 	
 	/* Optimised algorithm from "The use of multirate filter banks for coding of high quality digital audio" */
 	/* Uses a few fixes for the paper noted at http://www.nothings.org/stb_vorbis/mdct_01.txt */
-	float *A = state->a, *B = state->b, *C = state->c;
+	float *A = state->a, *B = state->b, *C = state->c, *T = state->t;
 
-	float u[VORBIS_MAX_BLOCK_SIZE];
-	float w[VORBIS_MAX_BLOCK_SIZE];
+	/* Only odd indices of the paper's u/w arrays are ever used, so they are stored compacted */
+	/* i.e. paper's w[n-1-2*i] is stored at w[i], which makes step 3 operate on contiguous data */
+	float bufs[2][VORBIS_MAX_BLOCK_SIZE / 2];
+	float* w = bufs[0];
+	float* u = bufs[1];
+	float* tmp;
 	float e_1, e_2, f_1, f_2;
 	float g_1, g_2, h_1, h_2;
 	float x_1, x_2, y_1, y_2;
@@ -1047,45 +1159,33 @@ void imdct_calc(float* in, float* out, struct imdct_state* state) {
 		h_2 = f_1 * A[n4-2-k2] - f_2 * A[n4-1-k2];
 		h_1 = f_1 * A[n4-1-k2] + f_2 * A[n4-2-k2];
 
-		w[n2+3+k4] = h_2 + g_2;
-		w[n2+1+k4] = h_1 + g_1;
+		w[n4-2-k2] = h_2 + g_2;
+		w[n4-1-k2] = h_1 + g_1;
 
-		w[k4+3] = (h_2 - g_2) * A[n2-4-k4] - (h_1 - g_1) * A[n2-3-k4];
-		w[k4+1] = (h_1 - g_1) * A[n2-4-k4] + (h_2 - g_2) * A[n2-3-k4];
+		w[n2-2-k2] = (h_2 - g_2) * A[n2-4-k4] - (h_1 - g_1) * A[n2-3-k4];
+		w[n2-1-k2] = (h_1 - g_1) * A[n2-4-k4] + (h_2 - g_2) * A[n2-3-k4];
 	}
 
 	/* step 3 */
 	log2_n = state->log2_n;
 	for (l = 0; l <= log2_n - 4; l++) {
-		int k0 = n >> (l+2), k1 = 1 << (l+3);
-		int r, r4, rMax = n >> (l+4), s2, s2Max = 1 << (l+2);
-
-		for (r = 0, r4 = 0; r < rMax; r++, r4 += 4) {
-			for (s2 = 0; s2 < s2Max; s2 += 2) {
-				e_1 = w[n-1-k0*s2-r4];     e_2 = w[n-3-k0*s2-r4];
-				f_1 = w[n-1-k0*(s2+1)-r4]; f_2 = w[n-3-k0*(s2+1)-r4];
-
-				u[n-1-k0*s2-r4] = e_1 + f_1;
-				u[n-3-k0*s2-r4] = e_2 + f_2;
+		int k0 = n >> (l+2), rMax = n >> (l+4);
+		int s, sMax = 1 << (l+1);
 
-				u[n-1-k0*(s2+1)-r4] = (e_1 - f_1) * A[r*k1] - (e_2 - f_2) * A[r*k1+1];
-				u[n-3-k0*(s2+1)-r4] = (e_2 - f_2) * A[r*k1] + (e_1 - f_1) * A[r*k1+1];
-			}
-		}
-
-		/* TODO: eliminate this, do w/u in-place */
-		/* TODO: dynamically allocate mem for imdct */
-		if (l+1 <= log2_n - 4) {
-			Mem_Copy(w, u, sizeof(u));
+		for (s = 0; s < sMax; s++) {
+			imdct_step3(w + k0*s, w + k0*s + k0/2, u + k0*s, u + k0*s + k0/2, T, rMax);
 		}
+		T  += rMax * 4;
+		tmp = w; w = u; u = tmp;
 	}
+	u = w; /* output of last stage */
 
 	/* step 4, step 5, step 6, step 7, step 8, output */
 	reversed = state->reversed;
-	for (k = 0, k2 = 0, k8 = 0; k < n8; k++, k2 += 2, k8 += 8) {
-		cc_uint32 j = reversed[k], j8 = j << 3;
-		e_1 = u[n-j8-1]; e_2 = u[n-j8-3];
-		f_1 = u[j8+3];   f_2 = u[j8+1];
+	for (k = 0, k2 = 0; k < n8; k++, k2 += 2) {
+		cc_uint32 j4 = reversed[k] << 2;
+		e_1 = u[j4];      e_2 = u[j4+1];
+		f_1 = u[n2-2-j4]; f_2 = u[n2-1-j4];
 
 		g_1 =  e_1 + f_1 + C[k2+1] * (e_1 - f_1) + C[k2] * (e_2 + f_2);
 		h_1 =  e_1 + f_1 - C[k2+1] * (e_1 - f_1) - C[k2] * (e_2 + f_2);
@@ -1474,15 +1574,88 @@ cc_result Vorbis_DecodeFrame(struct VorbisState* ctx) {
 	return 0;
 }
 
+/* Multiplies prev and cur samples by their window values, then adds them together */
+static void Vorbis_ApplyWindow(float* dst, const float* prev, const float* cur, const float* prevWindow, const float* curWindow, int count) {
+	int i = 0;
+#if defined CC_BUILD_SSE2
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(prev + i), _mm_loadu_ps(prevWindow + i)),
+			_mm_mul_ps(_mm_loadu_ps(cur + i), _mm_loadu_ps(curWindow + i))));
+	}
+#elif defined CC_BUILD_NEON
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(dst + i, vaddq_f32(vmulq_f32(vld1q_f32(prev + i), vld1q_f32(prevWindow + i)),
+			vmulq_f32(vld1q_f32(cur + i), vld1q_f32(curWindow + i))));
+	}
+#endif
+
+	for (; i < count; i++) {
+		dst[i] = prev[i] * prevWindow[i] + cur[i] * curWindow[i];
+	}
+}
+
+/* Clamps samples of each channel to between -1 and 1, then interleaves them as 16 bit samples */
+static void Vorbis_ConvertSamples(cc_int16* dst, float** src, int channels, int count) {
+	float sample;
+	int i = 0, ch;
+
+#if defined CC_BUILD_SSE2
+	__m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+	__m128i a, b, ab;
+	#define Vorbis_ToInt32(data) _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(data), lo), hi), scale))
+
+	if (channels == 1) {
+		for (; i + 8 <= count; i += 8, dst += 8) {
+			a = Vorbis_ToInt32(src[0] + i); b = Vorbis_ToInt32(src[0] + i + 4);
+			_mm_storeu_si128((__m128i*)dst, _mm_packs_epi32(a, b));
+		}
+	} else if (channels == 2) {
+		for (; i + 4 <= count; i += 4, dst += 8) {
+			a  = Vorbis_ToInt32(src[0] + i); b = Vorbis_ToInt32(src[1] + i);
+			ab = _mm_packs_epi32(a, b); /* L0 L1 L2 L3 R0 R1 R2 R3 */
+			_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(ab, _mm_unpackhi_epi64(ab, ab)));
+		}
+	}
+	#undef Vorbis_ToInt32
+#elif defined CC_BUILD_NEON
+	float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+	int16x4x2_t lr;
+	#define Vorbis_ToInt16(data) vqmovn_s32(vcvtq_s32_f32(vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(data), lo), hi), 32767.0f)))
+
+	if (channels == 1) {
+		for (; i + 4 <= count; i += 4, dst += 4) {
+			vst1_s16(dst, Vorbis_ToInt16(src[0] + i));
+		}
+	} else if (channels == 2) {
+		for (; i + 4 <= count; i += 4, dst += 8) {
+			lr.val[0] = Vorbis_ToInt16(src[0] + i);
+			lr.val[1] = Vorbis_ToInt16(src[1] + i);
+			vst2_s16(dst, lr);
+		}
+	}
+	#undef Vorbis_ToInt16
+#endif
+
+	for (; i < count; i++) {
+		for (ch = 0; ch < channels; ch++) {
+			sample = src[ch][i];
+			Math_Clamp(sample, -1.0f, 1.0f);
+			*dst++ = (cc_int16)(sample * 32767);
+		}
+	}
+}
+
+#define VORBIS_WINDOW_CHUNK 256
 int Vorbis_OutputFrame(struct VorbisState* ctx, cc_int16* data) {
 	struct VorbisWindow window;
 	float* prev[VORBIS_MAX_CHANS];
 	float*  cur[VORBIS_MAX_CHANS];
+	float* windowed[VORBIS_MAX_CHANS];
+	float windowedData[VORBIS_MAX_CHANS][VORBIS_WINDOW_CHUNK];
 
 	int curQrtr, prevQrtr, overlapQtr;
 	int curOffset, prevOffset, overlapSize;
-	float sample;
-	int i, ch;
+	int i, ch, count;
 
 	/* first frame decoded has no data */
 	if (ctx->prevBlockSize == 0) {
@@ -1514,13 +1687,8 @@ int Vorbis_OutputFrame(struct VorbisState* ctx, cc_int16* data) {
 	}
 
 	/* for long prev and short cur block, there will be non-overlapped data before */
-	for (i = 0; i < prevOffset; i++) {
-		for (ch = 0; ch < ctx->channels; ch++) {
-			sample = prev[ch][i];
-			Math_Clamp(sample, -1.0f, 1.0f);
-			*data++ = (cc_int16)(sample * 32767);
-		}
-	}
+	Vorbis_ConvertSamples(data, prev, ctx->channels, prevOffset);
+	data += prevOffset * ctx->channels;
 
 	/* adjust pointers to start at 0 for overlapping */
 	for (i = 0; i < ctx->channels; i++) {
@@ -1532,23 +1700,20 @@ int Vorbis_OutputFrame(struct VorbisState* ctx, cc_int16* data) {
 
 	/* overlap and add data */
 	/* also perform windowing here */
-	for (i = 0; i < overlapSize; i++) {
+	for (i = 0; i < overlapSize; i += count) {
+		count = min(overlapSize - i, VORBIS_WINDOW_CHUNK);
+
 		for (ch = 0; ch < ctx->channels; ch++) {
-			sample = prev[ch][i] * window.Prev[i] + cur[ch][i] * window.Cur[i];
-			Math_Clamp(sample, -1.0f, 1.0f);
-			*data++ = (cc_int16)(sample * 32767);
+			windowed[ch] = windowedData[ch];
+			Vorbis_ApplyWindow(windowed[ch], prev[ch] + i, cur[ch] + i, window.Prev + i, window.Cur + i, count);
 		}
+		Vorbis_ConvertSamples(data, windowed, ctx->channels, count);
+		data += count * ctx->channels;
 	}
 
 	/* for long cur and short prev block, there will be non-overlapped data after */
 	for (i = 0; i < ctx->channels; i++) { cur[i] += overlapSize; }
-	for (i = 0; i < curOffset; i++) {
-		for (ch = 0; ch < ctx->channels; ch++) {
-			sample = cur[ch][i];
-			Math_Clamp(sample, -1.0f, 1.0f);
-			*data++ = (cc_int16)(sample * 32767);
-		}
-	}
+	Vorbis_ConvertSamples(data, cur, ctx->channels, curOffset);
 
 	ctx->prevBlockSize = ctx->curBlockSize;
 	return (prevQrtr + curQrtr) * ctx->channels;
@@ -27,6 +27,7 @@ struct imdct_state {
 	float a[VORBIS_MAX_BLOCK_SIZE / 2];
 	float b[VORBIS_MAX_BLOCK_SIZE / 2];
 	float c[VORBIS_MAX_BLOCK_SIZE / 4];
+	float t[VORBIS_MAX_BLOCK_SIZE / 2]; /* step 3 twiddle factors, laid out contiguously per stage */
 	cc_uint32 reversed[VORBIS_MAX_BLOCK_SIZE / 8];
 };
 
@@ -10,6 +10,8 @@
 #include "Game.h"
 #include "TexturePack.h"
 #include "Window.h"
+#include "Funcs.h"
+#include "Options.h"
 
 struct _WorldData World;
 /*########################################################################################################################*
@@ -36,16 +38,32 @@ static void GenerateNewUuid(void) {
 	World.Uuid[8] |= 0x80; /* variant 2*/
 }
 
+#ifdef EXTENDED_BLOCKS
+static void FreeSections(void);
+static void World_InitSections(void);
+/* Upper 8 bits of blocks of the map currently being loaded */
+static BlockRaw* pendingUpper;
+#endif
+
+static void Snapshot_Detach(void);
+static void Occupancy_Free(void);
+static void Occupancy_Calculate(void);
+static void Occupancy_Update(int x, int y, int z, BlockID old, BlockID now);
+
 void World_Reset(void) {
+	Snapshot_Detach();
+	Occupancy_Free();
 #ifdef EXTENDED_BLOCKS
-	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
-	World.Blocks2 = NULL;
-	World.IDMask  = 0xFF;
+	FreeSections();
+	Mem_Free(pendingUpper);
+	pendingUpper = NULL;
+	World.IDMask = 0xFF;
 #endif
 	Mem_Free(World.Blocks);
 	World.Blocks = NULL;
 
 	World_SetDimensions(0, 0, 0);
+	World.LoadedHeight = 0;
 	Env_Reset();
 }
 
@@ -64,21 +82,42 @@ void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
 
 	if (!World.Volume) World.Blocks = NULL;
 #ifdef EXTENDED_BLOCKS
-	/* .cw maps may have set this to a non-NULL when importing */
-	if (!World.Blocks2) {
-		World.Blocks2 = World.Blocks;
-		World.IDMask  = 0xFF;
-	}
+	/* .cw maps may have set pendingUpper to a non-NULL when importing */
+	World_InitSections();
+	Mem_Free(pendingUpper);
+	pendingUpper = NULL;
+	if (!World.Sections) World.IDMask = 0xFF;
 #endif
 
 	if (Env.EdgeHeight == -1)   { Env.EdgeHeight   = height / 2; }
 	if (Env.CloudsHeight == -1) { Env.CloudsHeight = height + 2; }
+	/* Apply changed block definitions (e.g. from the map file) now, so they don't cause */
+	/*  occupancy to be counted again or chunks to be rebuilt once the map has loaded */
+	Block_ApplyChanges();
+	Occupancy_Calculate();
 
 	GenerateNewUuid();
-	World.Loaded = true;
+	World.Loaded       = true;
+	World.LoadedHeight = World.Height;
 	Event_RaiseVoid(&WorldEvents.MapLoaded);
 }
 
+void World_BeginProgressiveMap(BlockRaw* blocks, int width, int height, int length) {
+	Occupancy_Free();
+	World_SetDimensions(width, height, length);
+	World.Blocks       = blocks;
+	World.LoadedHeight = 0;
+	Event_RaiseInt(&WorldEvents.LayersLoaded, 0);
+}
+
+void World_SetLoadedHeight(int height) {
+	if (height > World.Height) height = World.Height;
+	if (height <= World.LoadedHeight) return;
+
+	World.LoadedHeight = height;
+	Event_RaiseInt(&WorldEvents.LayersLoaded, height);
+}
+
 CC_NOINLINE void World_SetDimensions(int width, int height, int length) {
 	World.Width  = width; World.Height = height; World.Length = length;
 	World.Volume = width * height * length;
@@ -87,46 +126,293 @@ CC_NOINLINE void World_SetDimensions(int width, int height, int length) {
 	World.MaxX = width  - 1;
 	World.MaxY = height - 1;
 	World.MaxZ = length - 1;
+
+	World.SectionsX = (width  + CHUNK_MAX) >> CHUNK_SHIFT;
+	World.SectionsY = (height + CHUNK_MAX) >> CHUNK_SHIFT;
+	World.SectionsZ = (length + CHUNK_MAX) >> CHUNK_SHIFT;
 }
+#define SectionsCount() (World.SectionsX * World.SectionsY * World.SectionsZ)
+
 
 #ifdef EXTENDED_BLOCKS
-void World_SetMapUpper(BlockRaw* blocks) {
-	World.Blocks2 = blocks;
-	World.IDMask  = 0x3FF;
+/*########################################################################################################################*
+*-----------------------------------------------------World sections------------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of bytes needed to store all the indices of a section */
+#define Section_IndicesSize(bits) (CHUNK_SIZE_3 * (bits) / 8)
+/* Byte that contains the palette index of the i'th block, and bit offset of the index in that byte */
+#define Section_IndexByte(s, i)  (((i) * (s)->bits) >> 3)
+#define Section_IndexShift(s, i) (((i) * (s)->bits) & 7)
+/* Number of sections allocated (World dimensions may change before sections are freed) */
+static int sectionsCount;
+/* Whether blocks of maps should be stored in sections, even if they have no blocks over 255 */
+/* Off by default, as reading blocks from sections is much slower than from World.Blocks */
+static cc_bool useSections;
+
+static void Section_Free(struct WorldSection* s) {
+	Mem_Free(s->indices);
+	Mem_Free(s->palette);
+	s->indices = NULL;
+	s->palette = NULL;
+}
+
+static void FreeSections(void) {
+	int i;
+	if (!World.Sections) return;
+
+	for (i = 0; i < sectionsCount; i++) { Section_Free(&World.Sections[i]); }
+	Mem_Free(World.Sections);
+	World.Sections = NULL;
 }
-#endif
 
+/* Allocates sections for the world, with all blocks initially being air */
+static cc_bool AllocSections(void) {
+	int count = SectionsCount();
+	World.Sections = (struct WorldSection*)Mem_TryAllocCleared(count, sizeof(struct WorldSection));
+	if (!World.Sections) return false;
 
-#ifdef EXTENDED_BLOCKS
-static CC_NOINLINE void LazyInitUpper(int i, BlockID block) {
-	BlockRaw* data = (BlockRaw*)Mem_TryAllocCleared(World.Volume, 1);
-	if (data) {
-		World_SetMapUpper(data);
-		World.Blocks2[i] = (BlockRaw)(block >> 8);
+	sectionsCount = count;
+	return true;
+}
+
+static int Section_GetIndex(const struct WorldSection* s, int i) {
+	return (s->indices[Section_IndexByte(s, i)] >> Section_IndexShift(s, i)) & ((1 << s->bits) - 1);
+}
+
+static void Section_SetIndex(struct WorldSection* s, int i, int idx) {
+	cc_uint8* ptr = &s->indices[Section_IndexByte(s, i)];
+	int shift     = Section_IndexShift(s, i);
+	int mask      = (1 << s->bits) - 1;
+	*ptr = (*ptr & ~(mask << shift)) | (idx << shift);
+}
+
+/* Allocates indices (and palette) of a section for the given number of bits per index */
+static cc_bool Section_Alloc(struct WorldSection* s, int bits) {
+	s->indices = (cc_uint8*)Mem_TryAllocCleared(Section_IndicesSize(bits), 1);
+	if (!s->indices) return false;
+	s->bits = bits;
+	if (bits == 16) return true;
+
+	s->palette = (BlockID*)Mem_TryAlloc(1 << bits, sizeof(BlockID));
+	if (s->palette) return true;
+
+	Mem_Free(s->indices);
+	s->indices = NULL;
+	return false;
+}
+
+/* Doubles number of bits per index, so that more entries can be added to the palette */
+/* Returns false when out of memory, or if bits is already at the max (in which case there is no palette) */
+static cc_bool Section_Grow(struct WorldSection* s) {
+	struct WorldSection old = *s;
+	int i, bits = s->bits ? s->bits * 2 : 1;
+	if (old.bits == 16) return false;
+
+	s->indices = NULL; s->palette = NULL;
+	if (!Section_Alloc(s, bits)) { *s = old; return false; }
+
+	if (bits == 16) {
+		/* Store blocks directly, as palette would be bigger than the blocks */
+		for (i = 0; i < CHUNK_SIZE_3; i++) {
+			((cc_uint16*)s->indices)[i] = WorldSection_Get(&old, i);
+		}
+		s->count = 0;
+	} else if (!old.bits) {
+		/* Uniform sections already have all indices as 0 */
+		s->palette[0] = old.block;
+		s->count      = 1;
 	} else {
-		Window_ShowDialog("Out of memory", "Not enough free memory to load the map.\nTry joining a different map.");
-		World_Reset();
+		Mem_Copy(s->palette, old.palette, old.count * sizeof(BlockID));
+		for (i = 0; i < CHUNK_SIZE_3; i++) {
+			Section_SetIndex(s, i, Section_GetIndex(&old, i));
+		}
 	}
+
+	Section_Free(&old);
+	return true;
 }
 
-void World_SetBlock(int x, int y, int z, BlockID block) {
-	int i = World_Pack(x, y, z);
-	World.Blocks[i] = (BlockRaw)block;
+static cc_bool Section_Set(struct WorldSection* s, int i, BlockID block) {
+	int idx;
+	if (s->bits == 0 && s->block == block) return true;
+	if (s->bits == 16) { ((cc_uint16*)s->indices)[i] = block; return true; }
 
-	/* defer allocation of second map array if possible */
-	if (World.Blocks == World.Blocks2) {
-		if (block < 256) return;
-		LazyInitUpper(i, block);
-		return;
+	for (idx = 0; idx < s->count; idx++) {
+		if (s->palette[idx] == block) break;
+	}
+
+	if (idx == s->count) {
+		if (s->bits == 0 || s->count == (1 << s->bits)) {
+			if (!Section_Grow(s)) return false;
+			return Section_Set(s, i, block);
+		}
+		s->palette[s->count++] = block;
+	}
+	Section_SetIndex(s, i, idx);
+	return true;
+}
+
+/* Stores the blocks of the given section from World.Blocks (and upper 8 bits) into the section */
+static cc_bool Section_Fill(struct WorldSection* s, int x1, int y1, int z1, const BlockRaw* upper) {
+	BlockID blocks[CHUNK_SIZE_3];
+	BlockID palette[CHUNK_SIZE_3];
+	/* Index of each block in the palette + 1, or 0 if not in the palette yet */
+	cc_uint16 slots[BLOCK_COUNT];
+	int x2 = min(x1 + CHUNK_SIZE, World.Width);
+	int y2 = min(y1 + CHUNK_SIZE, World.Height);
+	int z2 = min(z1 + CHUNK_SIZE, World.Length);
+	int x, y, z, i, index, bits, count = 0;
+	int upperMask = World.IDMask >> 8;
+	BlockID block;
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			index = World_Pack(x1, y, z);
+			i     = WorldSection_Pack(x1, y, z);
+
+			for (x = x1; x < x2; x++, index++, i++) {
+				block = World.Blocks[index];
+				/* Upper bits may be anything in map files, but block IDs are limited to IDMask */
+				if (upper) block |= (upper[index] & upperMask) << 8;
+				/* Blocks past BLOCK_MAX_DEFINED would index past the end of the block arrays */
+				if (block > BLOCK_MAX_DEFINED) block = BLOCK_AIR;
+				blocks[i] = block;
+			}
+		}
+	}
+
+	/* Blocks outside the map are never read, so just use the first block for them */
+	/* (that way they don't add an extra entry to the palette) */
+	if (x2 - x1 < CHUNK_SIZE || y2 - y1 < CHUNK_SIZE || z2 - z1 < CHUNK_SIZE) {
+		for (i = 0; i < CHUNK_SIZE_3; i++) {
+			x = i & CHUNK_MASK; z = (i >> 4) & CHUNK_MASK; y = i >> 8;
+			if (x1 + x >= x2 || y1 + y >= y2 || z1 + z >= z2) blocks[i] = blocks[0];
+		}
+	}
+
+	Mem_Set(slots, 0, sizeof(slots));
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		block = blocks[i];
+		if (slots[block]) continue;
+		palette[count++] = block;
+		slots[block]     = count;
+	}
+
+	if (count == 1) { s->block = blocks[0]; return true; }
+	for (bits = 1; (1 << bits) < count && bits < 16; bits *= 2) { }
+
+	if (!Section_Alloc(s, bits)) return false;
+	if (bits == 16) {
+		Mem_Copy(s->indices, blocks, sizeof(blocks));
+		return true;
 	}
-	World.Blocks2[i] = (BlockRaw)(block >> 8);
+
+	Mem_Copy(s->palette, palette, count * sizeof(BlockID));
+	s->count = count;
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		Section_SetIndex(s, i, slots[blocks[i]] - 1);
+	}
+	return true;
+}
+
+/* Moves the blocks of the world (and optionally their upper 8 bits) into sections, then frees World.Blocks */
+static cc_bool ConvertToSections(const BlockRaw* upper) {
+	int sx, sy, sz;
+	struct WorldSection* s;
+	if (!AllocSections()) return false;
+
+	for (sy = 0; sy < World.SectionsY; sy++) {
+		for (sz = 0; sz < World.SectionsZ; sz++) {
+			for (sx = 0; sx < World.SectionsX; sx++) {
+				s = &World.Sections[World_PackSection(sx, sy, sz)];
+				if (Section_Fill(s, sx << CHUNK_SHIFT, sy << CHUNK_SHIFT, sz << CHUNK_SHIFT, upper)) continue;
+
+				FreeSections();
+				return false;
+			}
+		}
+	}
+
+	Mem_Free(World.Blocks);
+	World.Blocks = NULL;
+	return true;
+}
+
+/* Converts the blocks of the new map into sections, if needed */
+static void World_InitSections(void) {
+	cc_bool hasUpper = pendingUpper != NULL;
+	if (!World.Blocks || !(hasUpper || useSections)) return;
+	if (ConvertToSections(pendingUpper)) return;
+
+	/* Just ignore upper bits of blocks, rather than failing to load the entire map */
+	World.IDMask = 0xFF;
+	if (hasUpper) Window_ShowDialog("Out of memory", "Not enough free memory to load blocks over 255 in the map.");
+}
+
+void World_SetMapUpper(BlockRaw* blocks) {
+	Mem_Free(pendingUpper);
+	pendingUpper = blocks;
+	World.IDMask = 0x3FF;
+}
+
+void World_GetUpperLayer(int y, BlockRaw* dst) {
+	int x, z;
+	if (!World.Sections) { Mem_Set(dst, 0, World.OneY); return; }
+
+	for (z = 0; z < World.Length; z++) {
+		for (x = 0; x < World.Width; x++) {
+			*dst++ = (BlockRaw)(World_GetSectionBlock(x, y, z) >> 8);
+		}
+	}
+}
+
+void World_GetLayer(int y, BlockRaw* dst) {
+	int x, z;
+	if (!World.Sections) { Mem_Copy(dst, World.Blocks + y * World.OneY, World.OneY); return; }
+
+	for (z = 0; z < World.Length; z++) {
+		for (x = 0; x < World.Width; x++) {
+			*dst++ = (BlockRaw)World_GetSectionBlock(x, y, z);
+		}
+	}
+}
+
+static cc_bool SetBlock(int x, int y, int z, BlockID block) {
+	struct WorldSection* s;
+	if (block > 0xFF) World.IDMask = 0x3FF;
+
+	/* defer moving blocks into sections if possible */
+	if (!World.Sections) {
+		if (block <= 0xFF) {
+			World.Blocks[World_Pack(x, y, z)] = (BlockRaw)block;
+			return true;
+		}
+		if (!ConvertToSections(NULL)) return false;
+	}
+
+	s = &World.Sections[World_PackSection(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+	return Section_Set(s, WorldSection_Pack(x, y, z), block & World.IDMask);
 }
 #else
-void World_SetBlock(int x, int y, int z, BlockID block) {
+void World_GetLayer(int y, BlockRaw* dst) {
+	Mem_Copy(dst, World.Blocks + y * World.OneY, World.OneY);
+}
+
+static cc_bool SetBlock(int x, int y, int z, BlockID block) {
 	World.Blocks[World_Pack(x, y, z)] = block; 
+	return true;
 }
 #endif
 
+static cc_bool Snapshot_SetBlock(int x, int y, int z, BlockID block);
+void World_SetBlock(int x, int y, int z, BlockID block) {
+	Occupancy_Update(x, y, z, World_GetBlock(x, y, z), block);
+	if (Snapshot_SetBlock(x, y, z, block)) return;
+
+	Window_ShowDialog("Out of memory", "Not enough free memory to load the map.\nTry joining a different map.");
+	World_Reset();
+}
+
 BlockID World_GetPhysicsBlock(int x, int y, int z) {
 	if (y < 0 || !World_ContainsXZ(x, z)) return BLOCK_BEDROCK;
 	if (y >= World.Height) return BLOCK_AIR;
@@ -139,6 +425,354 @@ BlockID World_SafeGetBlock(int x, int y, int z) {
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------World occupancy------------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of blocks in a section that are not drawn as gas, and that are not fully opaque */
+/* Also which blocks are in the section, with bit (block & 63) set for each block */
+struct SectionOccupancy { cc_uint64 blocks; cc_uint16 nonAir, nonOpaque; };
+#define Occupancy_BlockBit(block) ((cc_uint64)1 << ((block) & 63))
+#define OCCUPANCY_NON_AIR    0x01
+#define OCCUPANCY_NON_OPAQUE 0x02
+#define OCCUPANCY_MAX_WORKERS 8
+
+/* NULL if not calculated yet, or not enough memory to allocate */
+static struct SectionOccupancy* occupancy;
+/* Whether occupancy needs to be recalculated before next use (e.g. block definitions changed) */
+static cc_bool occupancyDirty;
+static cc_uint8 occupancyFlags[BLOCK_COUNT];
+
+static void* occupancy_mutex;
+static int occupancy_nextLayer;
+
+static void Occupancy_Free(void) {
+	Mem_Free(occupancy);
+	occupancy      = NULL;
+	occupancyDirty = false;
+}
+
+/* Calculates occupancy flags of all blocks, returning whether any flags changed */
+static cc_bool Occupancy_CalcFlags(void) {
+	cc_bool changed = false;
+	int i, flags;
+	for (i = 0; i < BLOCK_COUNT; i++) {
+		flags = 
+			(Blocks.Draw[i] != DRAW_GAS ? OCCUPANCY_NON_AIR    : 0) |
+			(!Blocks.FullOpaque[i]      ? OCCUPANCY_NON_OPAQUE : 0);
+
+		changed |= occupancyFlags[i] != flags;
+		occupancyFlags[i] = flags;
+	}
+	return changed;
+}
+
+#define Occupancy_CountRow(get_block)\
+for (x1 = 0; x1 < World.Width; x1 += CHUNK_SIZE, s++) {\
+	x2 = min(x1 + CHUNK_SIZE, World.Width);\
+	nonAir = 0; nonOpaque = 0; blocks = 0;\
+\
+	for (x = x1; x < x2; x++) {\
+		block      = get_block;\
+		flags      = occupancyFlags[block];\
+		nonAir    += flags & OCCUPANCY_NON_AIR;\
+		nonOpaque += flags >> 1;\
+		blocks    |= Occupancy_BlockBit(block);\
+	}\
+	s->nonAir += nonAir; s->nonOpaque += nonOpaque; s->blocks |= blocks;\
+}
+
+#ifdef EXTENDED_BLOCKS
+/* Counts the blocks of the given section, when the world is stored in sections */
+static void Occupancy_CountSection(struct SectionOccupancy* s, const struct WorldSection* ws, int x1, int y1, int z1) {
+	int x2 = min(x1 + CHUNK_SIZE, World.Width);
+	int y2 = min(y1 + CHUNK_SIZE, World.Height);
+	int z2 = min(z1 + CHUNK_SIZE, World.Length);
+	int x, y, z, flags, volume;
+	BlockID block;
+
+	/* Uniform sections don't need to look at each block */
+	if (!ws->indices) {
+		volume    = (x2 - x1) * (y2 - y1) * (z2 - z1);
+		flags     = occupancyFlags[ws->block];
+		s->nonAir    = (flags & OCCUPANCY_NON_AIR) ? volume : 0;
+		s->nonOpaque = (flags >> 1) ? volume : 0;
+		s->blocks    = Occupancy_BlockBit(ws->block);
+		return;
+	}
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			for (x = x1; x < x2; x++) {
+				block = WorldSection_Get(ws, WorldSection_Pack(x, y, z));
+				flags = occupancyFlags[block];
+				s->nonAir    += flags & OCCUPANCY_NON_AIR;
+				s->nonOpaque += flags >> 1;
+				s->blocks    |= Occupancy_BlockBit(block);
+			}
+		}
+	}
+}
+#endif
+
+/* Counts the blocks of all the sections in the given layer of sections */
+static void Occupancy_CountLayer(int sy) {
+	struct SectionOccupancy* s;
+	const BlockRaw* row;
+	int x, y, z, x1, x2, y1, y2;
+	int flags, nonAir, nonOpaque;
+	cc_uint64 blocks;
+	BlockID block;
+
+#ifdef EXTENDED_BLOCKS
+	int sx, sz, i;
+	if (World.Sections) {
+		for (sz = 0; sz < World.SectionsZ; sz++) {
+			for (sx = 0; sx < World.SectionsX; sx++) {
+				i = World_PackSection(sx, sy, sz);
+				Occupancy_CountSection(&occupancy[i], &World.Sections[i],
+					sx << CHUNK_SHIFT, sy << CHUNK_SHIFT, sz << CHUNK_SHIFT);
+			}
+		}
+		return;
+	}
+#endif
+	y1 = sy << CHUNK_SHIFT;
+	y2 = min(y1 + CHUNK_SIZE, World.Height);
+
+	for (y = y1; y < y2; y++) {
+		for (z = 0; z < World.Length; z++) {
+			s   = &occupancy[World_PackSection(0, sy, z >> CHUNK_SHIFT)];
+			row = World.Blocks + World_Pack(0, y, z);
+			Occupancy_CountRow(row[x]);
+		}
+	}
+}
+
+static void Occupancy_WorkerFunc(void) {
+	int sy;
+	for (;;) {
+		Mutex_Lock(occupancy_mutex);
+		{
+			sy = occupancy_nextLayer++;
+		}
+		Mutex_Unlock(occupancy_mutex);
+
+		if (sy >= World.SectionsY) return;
+		Occupancy_CountLayer(sy);
+	}
+}
+
+/* Counts the air and fully opaque blocks in every section of the world */
+static void Occupancy_Calculate(void) {
+	void* threads[OCCUPANCY_MAX_WORKERS];
+	int i, workers;
+	Occupancy_Free();
+	if (!World_HasBlocks()) return;
+
+	/* Not skipping any sections is slower, but still works */
+	occupancy = (struct SectionOccupancy*)Mem_TryAllocCleared(SectionsCount(), sizeof(struct SectionOccupancy));
+	if (!occupancy) return;
+	Occupancy_CalcFlags();
+
+#ifdef CC_BUILD_WEB
+	workers = 0; /* no real threading support */
+#else
+	/* Calling thread counts one layer of sections too */
+	workers = min(Thread_ProcessorsCount(), OCCUPANCY_MAX_WORKERS) - 1;
+	workers = min(workers, World.SectionsY - 1);
+#endif
+	occupancy_nextLayer = 0;
+	occupancy_mutex     = Mutex_Create();
+
+	for (i = 0; i < workers; i++) {
+		threads[i] = Thread_Start(Occupancy_WorkerFunc, false);
+	}
+	Occupancy_WorkerFunc();
+	for (i = 0; i < workers; i++) { Thread_Join(threads[i]); }
+
+	Mutex_Free(occupancy_mutex);
+	occupancy_mutex = NULL;
+}
+
+static void Occupancy_Update(int x, int y, int z, BlockID old, BlockID now) {
+	struct SectionOccupancy* s;
+	int oldFlags, nowFlags;
+	if (!occupancy || occupancyDirty) return;
+
+	/* Bit of old block is left set, as other blocks in the section may still use it */
+	s = &occupancy[World_PackSection(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+	s->blocks |= Occupancy_BlockBit(now);
+
+	oldFlags = occupancyFlags[old];
+	nowFlags = occupancyFlags[now];
+	if (oldFlags == nowFlags) return;
+
+	s->nonAir    += (nowFlags & OCCUPANCY_NON_AIR)  - (oldFlags & OCCUPANCY_NON_AIR);
+	s->nonOpaque += (nowFlags >> 1) - (oldFlags >> 1);
+}
+
+static struct SectionOccupancy* Occupancy_Get(int sx, int sy, int sz) {
+	if (occupancyDirty) Occupancy_Calculate();
+	if (!occupancy) return NULL;
+
+	if ((unsigned)sx >= (unsigned)World.SectionsX || (unsigned)sy >= (unsigned)World.SectionsY 
+		|| (unsigned)sz >= (unsigned)World.SectionsZ) return NULL;
+	return &occupancy[World_PackSection(sx, sy, sz)];
+}
+
+cc_bool World_IsSectionAllAir(int sx, int sy, int sz) {
+	struct SectionOccupancy* s = Occupancy_Get(sx, sy, sz);
+	return s && !s->nonAir;
+}
+
+cc_bool World_IsSectionAllSolid(int sx, int sy, int sz) {
+	struct SectionOccupancy* s = Occupancy_Get(sx, sy, sz);
+	return s && !s->nonOpaque;
+}
+
+cc_uint64 World_GetSectionBlocks(int sx, int sy, int sz) {
+	struct SectionOccupancy* s = Occupancy_Get(sx, sy, sz);
+	if (s) return s->blocks;
+
+	/* Unknown (e.g. out of memory), so the section might contain any block */
+	if (occupancy || !World_HasBlocks()) return 0;
+	return (cc_uint64)-1;
+}
+
+/* Draw types of blocks may have changed, in which case all sections need to be counted again */
+/* (not needed when e.g. only the textures of blocks changed) */
+static void OnBlockDefChanged(void* obj) {
+	if (!occupancy || occupancyDirty) return;
+	occupancyDirty = Occupancy_CalcFlags();
+}
+
+static void World_Init(void) {
+	Event_RegisterVoid(&BlockEvents.BlockDefChanged, NULL, OnBlockDefChanged);
+#ifdef EXTENDED_BLOCKS
+	useSections = Options_GetBool(OPT_WORLD_SECTIONS, false);
+#endif
+}
+
+static void World_Free(void) {
+	Event_UnregisterVoid(&BlockEvents.BlockDefChanged, NULL, OnBlockDefChanged);
+}
+
+struct IGameComponent World_Component = {
+	World_Init, /* Init */
+	World_Free  /* Free */
+};
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------World snapshot------------------------------------------------------*
+*#########################################################################################################################*/
+static struct WorldSnapshotState {
+	/* Whether snapshot still refers to the blocks of the current world */
+	cc_bool live;
+	cc_bool hasUpper;
+	int height, layerSize;
+	/* Original blocks (lower bits, then upper bits) of each layer changed since snapshot was taken */
+	/* NULL if layer has not been changed */
+	BlockRaw** layers;
+	/* Number of layers that have been read (and so no longer need to be preserved) */
+	int lowerRead, upperRead;
+	void* mutex;
+} snapshot;
+
+/* Copies the original blocks of the given layer, if the layer hasn't already been read or copied */
+static void Snapshot_CopyLayer(int y) {
+	int size = snapshot.layerSize;
+	BlockRaw* layer;
+
+	if (snapshot.layers[y]) return;
+	if (y < snapshot.lowerRead && (!snapshot.hasUpper || y < snapshot.upperRead)) return;
+
+	layer = (BlockRaw*)Mem_Alloc(size, snapshot.hasUpper ? 2 : 1, "snapshot layer");
+	World_GetLayer(y, layer);
+#ifdef EXTENDED_BLOCKS
+	if (snapshot.hasUpper) World_GetUpperLayer(y, layer + size);
+#endif
+	snapshot.layers[y] = layer;
+}
+
+static cc_bool Snapshot_SetBlock(int x, int y, int z, BlockID block) {
+	cc_bool success;
+	if (!snapshot.live) return SetBlock(x, y, z, block);
+
+	/* Other thread may be reading from the live world */
+	Mutex_Lock(snapshot.mutex);
+	{
+		Snapshot_CopyLayer(y);
+		success = SetBlock(x, y, z, block);
+	}
+	Mutex_Unlock(snapshot.mutex);
+	return success;
+}
+
+/* Copies all layers that haven't been read yet, so snapshot no longer depends on the current world */
+static void Snapshot_Detach(void) {
+	int y;
+	if (!snapshot.live) return;
+
+	Mutex_Lock(snapshot.mutex);
+	{
+		for (y = 0; y < snapshot.height; y++) { Snapshot_CopyLayer(y); }
+		snapshot.live = false;
+	}
+	Mutex_Unlock(snapshot.mutex);
+}
+
+void World_BeginSnapshot(void) {
+	snapshot.hasUpper  = false;
+#ifdef EXTENDED_BLOCKS
+	snapshot.hasUpper  = World.IDMask > 0xFF;
+#endif
+	snapshot.height    = World.Height;
+	snapshot.layerSize = World.Width * World.Length;
+	snapshot.lowerRead = 0;
+	snapshot.upperRead = 0;
+
+	snapshot.layers = (BlockRaw**)Mem_AllocCleared(World.Height, sizeof(BlockRaw*), "snapshot layers");
+	snapshot.mutex  = Mutex_Create();
+	snapshot.live   = World_HasBlocks();
+}
+
+void World_ReadSnapshotLayer(int y, BlockRaw* dst, cc_bool upper) {
+	int size = snapshot.layerSize;
+	Mutex_Lock(snapshot.mutex);
+	{
+		if (snapshot.layers[y]) {
+			Mem_Copy(dst, snapshot.layers[y] + (upper ? size : 0), size);
+		} else if (!upper) {
+			World_GetLayer(y, dst);
+		} else {
+#ifdef EXTENDED_BLOCKS
+			World_GetUpperLayer(y, dst);
+#endif
+		}
+
+		if (upper) {
+			snapshot.upperRead = y + 1;
+		} else {
+			snapshot.lowerRead = y + 1;
+		}
+	}
+	Mutex_Unlock(snapshot.mutex);
+}
+
+void World_EndSnapshot(void) {
+	int y;
+	snapshot.live = false;
+
+	for (y = 0; y < snapshot.height; y++) { Mem_Free(snapshot.layers[y]); }
+	Mem_Free(snapshot.layers);
+	Mutex_Free(snapshot.mutex);
+
+	snapshot.layers = NULL;
+	snapshot.mutex  = NULL;
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------Environment-------------------------------------------------------*
 *#########################################################################################################################*/
@@ -2,25 +2,52 @@
 #define CC_WORLD_H
 #include "Vectors.h"
 #include "PackedCol.h"
+#include "Constants.h"
 /* Represents a fixed size 3D array of blocks.
    Also contains associated environment metadata.
    Copyright 2014-2020 ClassiCube | Licensed under BSD-3
 */
 struct AABB;
+struct IGameComponent;
+extern struct IGameComponent World_Component;
 
 /* Unpacka an index into x,y,z (slow!) */
 #define World_Unpack(idx, x, y, z) x = idx % World.Width; z = (idx / World.Width) % World.Length; y = (idx / World.Width) / World.Length;
 /* Packs an x,y,z into a single index */
 #define World_Pack(x, y, z) (((y) * World.Length + (z)) * World.Width + (x))
 
+#define World_PackSection(sx, sy, sz) (((sy) * World.SectionsZ + (sz)) * World.SectionsX + (sx))
+
+#ifdef EXTENDED_BLOCKS
+/* Stores the blocks in a 16x16x16 section of the world. */
+/* Either a single block for the whole section, or a palette of blocks with bit-packed indices. */
+struct WorldSection {
+	/* Bit-packed palette indices, or the blocks themselves when bits is 16. */
+	/* NULL if every block in the section is the same block. */
+	cc_uint8* indices;
+	/* Blocks that indices refer to. (NULL if indices is NULL or bits is 16) */
+	BlockID* palette;
+	/* The block of the whole section, when indices is NULL. */
+	BlockID block;
+	/* Number of entries in the palette. */
+	cc_uint16 count;
+	/* Number of bits per index. (0, 1, 2, 4, 8 or 16) */
+	cc_uint8 bits;
+};
+#endif
+
 CC_VAR extern struct _WorldData {
-	/* The blocks in the world. */
+	/* The blocks in the world, one byte per block. */
+	/* NULL if the blocks are stored in Sections instead. */
 	BlockRaw* Blocks;
 #ifdef EXTENDED_BLOCKS
-	/* The upper 8 bit of blocks in the world. */
-	/* If only 8 bit blocks are used, equals World_Blocks. */
-	BlockRaw* Blocks2;
+	/* The blocks in the world, stored per 16x16x16 section. */
+	/* NULL if the blocks are stored in Blocks instead. */
+	/* Used when blocks over 255 are in the map, or to save memory. (see OPT_WORLD_SECTIONS) */
+	struct WorldSection* Sections;
 #endif
+	/* Number of 16x16x16 sections along each axis. */
+	int SectionsX, SectionsY, SectionsZ;
 	/* Volume of the world. */
 	int Volume;
 
@@ -35,13 +62,16 @@ CC_VAR extern struct _WorldData {
 	cc_uint8 Uuid[16];
 
 #ifdef EXTENDED_BLOCKS
-	/* Masks access to World.Blocks/World.Blocks2 */
+	/* Mask of valid block IDs in the world */
 	/* e.g. this will be 255 if only 8 bit blocks are used */
 	int IDMask;
 #endif
 	/* Whether the world has finished loading/generating. */
 	/* NOTE: Blocks may still be NULL. (e.g. error during loading) */
 	cc_bool Loaded;
+	/* Number of Y layers (from the bottom up) of the blocks that have been loaded. */
+	/* NOTE: Only less than Height while the world is being progressively loaded. */
+	int LoadedHeight;
 } World;
 extern String World_TextureUrl;
 
@@ -53,22 +83,73 @@ CC_API void World_NewMap(void);
 /* Sets blocks array/dimensions of the map and raises WorldEvents.MapLoaded event */
 /* May also sets some environment settings like border/clouds height, if they are -1 */
 CC_API void World_SetNewMap(BlockRaw* blocks, int width, int height, int length);
+/* Sets blocks array/dimensions of a map whose blocks are still being loaded, so that */
+/*  the bottom layers can be shown while the rest of the map is still being loaded. */
+/* NOTE: Blocks must be loaded in order of increasing Y. (which is the case for the usual XZY layout) */
+/* NOTE: World_SetNewMap must still be called with the same blocks once all of them have been loaded. */
+CC_API void World_BeginProgressiveMap(BlockRaw* blocks, int width, int height, int length);
+/* Sets how many Y layers of a progressively loading map have been loaded, */
+/*  then raises WorldEvents.LayersLoaded event if that is more than before. */
+CC_API void World_SetLoadedHeight(int height);
 /* Sets the various dimension and max coordinate related variables. */
 /* NOTE: This is an internal API. Use World_SetNewMap instead. */
 CC_NOINLINE void World_SetDimensions(int width, int height, int length);
 
+/* Copies the lower 8 bits of the blocks in the given Y layer of the world into dst. */
+/* NOTE: dst must have room for World.Width * World.Length bytes. */
+void World_GetLayer(int y, BlockRaw* dst);
+
 #ifdef EXTENDED_BLOCKS
-/* Sets World.Blocks2 and updates internal state for more than 256 blocks. */
+/* Sets the upper 8 bits of the blocks in the world, and updates internal state for more than 256 blocks. */
+/* NOTE: blocks is combined into sections (and then freed) when World_SetNewMap is called. */
 void World_SetMapUpper(BlockRaw* blocks);
+/* Copies the upper 8 bits of the blocks in the given Y layer of the world into dst. */
+/* NOTE: dst must have room for World.Width * World.Length bytes. */
+void World_GetUpperLayer(int y, BlockRaw* dst);
+/* Whether the world has any blocks. (i.e. either Blocks or Sections is not NULL) */
+#define World_HasBlocks() (World.Blocks || World.Sections)
+
+/* Index of the block at the given coordinates within a section */
+#define WorldSection_Pack(x, y, z) ((((y) & CHUNK_MASK) << 8) | (((z) & CHUNK_MASK) << 4) | ((x) & CHUNK_MASK))
+/* Gets the block at the given index in the given section. */
+static CC_INLINE BlockID WorldSection_Get(const struct WorldSection* s, int i) {
+	switch (s->bits) {
+	case 0: return s->block;
+	case 1: return s->palette[(s->indices[i >> 3] >> (i & 7)) & 1];
+	case 2: return s->palette[(s->indices[i >> 2] >> ((i & 3) << 1)) & 3];
+	case 4: return s->palette[(s->indices[i >> 1] >> ((i & 1) << 2)) & 15];
+	case 8: return s->palette[s->indices[i]];
+	}
+	return ((cc_uint16*)s->indices)[i];
+}
+
+/* Gets the block at the given coordinates, when the world is stored in sections. */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+static CC_INLINE BlockID World_GetSectionBlock(int x, int y, int z) {
+	const struct WorldSection* s = &World.Sections[World_PackSection(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+	return WorldSection_Get(s, WorldSection_Pack(x, y, z));
+}
 
 /* Gets the block at the given coordinates. */
 /* NOTE: Does NOT check that the coordinates are inside the map. */
 static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
-	int i = World_Pack(x, y, z);
-	return (BlockID)((World.Blocks[i] | (World.Blocks2[i] << 8)) & World.IDMask);
+	if (!World.Sections) return World.Blocks[World_Pack(x, y, z)];
+	return World_GetSectionBlock(x, y, z);
+}
+
+/* Gets the block at the given packed index. (see World_Pack) */
+/* NOTE: Slower than World_GetBlock when the world is stored in sections. */
+static CC_INLINE BlockID World_GetBlockAt(int i) {
+	int x, y, z;
+	if (!World.Sections) return World.Blocks[i];
+
+	World_Unpack(i, x, y, z);
+	return World_GetSectionBlock(x, y, z);
 }
 #else
-#define World_GetBlock(x, y, z) World_Blocks[World_Pack(x, y, z)]
+#define World_HasBlocks() (World.Blocks != NULL)
+#define World_GetBlock(x, y, z) World.Blocks[World_Pack(x, y, z)]
+#define World_GetBlockAt(i) World.Blocks[i]
 #endif
 
 /* If Y is above the map, returns BLOCK_AIR. */
@@ -82,6 +163,28 @@ void World_SetBlock(int x, int y, int z, BlockID block);
 /* Otherwise returns the block at the given coordinates. */
 BlockID World_SafeGetBlock(int x, int y, int z);
 
+/* Whether every block in the given 16x16x16 section is drawn as gas. (e.g. air) */
+/* NOTE: Returns false if the section is outside the map, or this is not known yet. */
+cc_bool World_IsSectionAllAir(int sx, int sy, int sz);
+/* Whether every block in the given 16x16x16 section is fully opaque. (e.g. stone) */
+/* NOTE: Returns false if the section is outside the map, or this is not known yet. */
+cc_bool World_IsSectionAllSolid(int sx, int sy, int sz);
+/* Returns which blocks may be in the given section, with bit (block & 63) set for each block. */
+/* NOTE: Can have false positives, as blocks share bits and bits of removed blocks stay set. */
+/* NOTE: Returns 0 if the section is outside the map. Returns all bits set if this is not known. */
+cc_uint64 World_GetSectionBlocks(int sx, int sy, int sz);
+
+/* Takes a snapshot of the blocks in the world, that can then be read from on another thread. */
+/* Layers are only copied when first changed afterwards, so the world can keep being modified. */
+/* NOTE: Only one snapshot can be taken at a time. Must be called on the main thread. */
+void World_BeginSnapshot(void);
+/* Copies the lower (or upper) 8 bits of the blocks in the given Y layer of the snapshot into dst. */
+/* NOTE: Lower and upper layers must each be read in order of increasing Y. */
+/* NOTE: dst must have room for World.Width * World.Length bytes (of the world when snapshot was taken) */
+void World_ReadSnapshotLayer(int y, BlockRaw* dst, cc_bool upper);
+/* Frees the snapshot. Must be called on the main thread, once the other thread has finished reading. */
+void World_EndSnapshot(void);
+
 /* Whether the given coordinates lie inside the map. */
 static CC_INLINE cc_bool World_Contains(int x, int y, int z) {
 	return (unsigned)x < (unsigned)World.Width